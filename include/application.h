@@ -13,11 +13,15 @@ class Shader;
 class Renderer;
 class EquationRenderer;
 class GridRenderer;
+class CurvePlot;
+class PlotRenderer;
+class PlotView;
 class UIController;
 class Settings;
 class DataManager;
-class EquationParser;
-class EquationGenerator;
+class GenerationScheduler;
+class NativeKernelCache;
+struct GenerationOptions;
 struct Equation;
 struct Point;
 
@@ -55,13 +59,17 @@ private:
     std::unique_ptr<Settings> settings_;
     std::unique_ptr<Camera> camera_;
     std::unique_ptr<Shader> shader_;
+    std::unique_ptr<Shader> lineShader_;
     std::unique_ptr<Renderer> renderer_;
     std::unique_ptr<EquationRenderer> equationRenderer_;
     std::unique_ptr<GridRenderer> gridRenderer_;
+    std::unique_ptr<CurvePlot> curvePlot_;
+    std::unique_ptr<PlotRenderer> plotRenderer_;
+    std::unique_ptr<PlotView> plotView_;
     std::unique_ptr<UIController> uiController_;
     std::unique_ptr<DataManager> dataManager_;
-    std::unique_ptr<EquationParser> equationParser_;
-    std::unique_ptr<EquationGenerator> equationGenerator_;
+    std::unique_ptr<GenerationScheduler> generationScheduler_;
+    std::shared_ptr<NativeKernelCache> nativeKernels_;
 
     // Data
     std::vector<Equation> equations_;
@@ -90,13 +98,16 @@ private:
     // Input handling
     void processInput();
     void handleKeyboardInput();
+    void handlePlotKeyboardInput();
 
     // Rendering
     void render();
+    void renderPlot(); // orthographic 2D curves in place of the 3D scene
 
     // UI callbacks
     void setupUICallbacks();
     void onEquationRender(Equation& equation, size_t index);
+    void onEquationStyle(Equation& equation, size_t index);
     void onEquationRemove(size_t index);
     void onPointRender(Point& point, size_t index);
     void onPointRemove(size_t index);
@@ -108,6 +119,8 @@ private:
     // Helper methods
     void updateEquationVertices(Equation& equation);
     void updatePointVertices(Point& point);
+    GenerationOptions generationOptions(); // sampling options and native kernels from Settings
+    void applyGenerationResults();         // swap in geometry finished since the last frame
     void rerender();
 };
 
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <atomic>
+
+namespace graphgl {
+
+/// Flag shared between the owner of a job and the code running it. Long-running work polls
+/// isCancelled() and stops early once its result is no longer wanted. A job whose result is
+/// unwanted but whose samples a later job reuses is told to stopAfterSamples() instead: it
+/// skips everything but storing its final samples, then stops as if cancelled.
+class CancellationToken {
+public:
+    void cancel() { state_.store(kCancelled, std::memory_order_relaxed); }
+    bool isCancelled() const { return state_.load(std::memory_order_relaxed) == kCancelled; }
+
+    /// No effect once cancelled.
+    void stopAfterSamples() {
+        int running = kRunning;
+        state_.compare_exchange_strong(running, kStoppingAfterSamples, std::memory_order_relaxed);
+    }
+    bool isStoppingAfterSamples() const {
+        return state_.load(std::memory_order_relaxed) == kStoppingAfterSamples;
+    }
+
+private:
+    static constexpr int kRunning = 0;
+    static constexpr int kStoppingAfterSamples = 1;
+    static constexpr int kCancelled = 2;
+
+    std::atomic<int> state_{kRunning};
+};
+
+} // namespace graphgl
@@ -0,0 +1,172 @@
+#pragma once
+
+#include "equation.h"
+#include "generation_scheduler.h"
+#include <glm/glm.hpp>
+#include <cmath>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace graphgl {
+
+/// Pan and zoom of the orthographic 2D plot: the world point at the centre of the viewport
+/// and the world units one pixel spans on both axes.
+class PlotView {
+public:
+    static constexpr double DEFAULT_UNITS_PER_PIXEL = 20.0 / 1280.0; // x in [-10, 10] on a default window
+    static constexpr double MIN_UNITS_PER_PIXEL = 1e-6;
+    static constexpr double MAX_UNITS_PER_PIXEL = 1e6;
+
+    PlotView();
+
+    void reset();
+
+    /// Move the view by a drag of (dx, dy) window pixels (y down); the content follows the drag.
+    void pan(double dxPixels, double dyPixels);
+
+    /// Scale the units per pixel by factor, keeping the world point under pixel (x, y) (y down,
+    /// as window coordinates) in place.
+    void zoomAt(double factor, double x, double y, int width, int height);
+
+    double getCenterX() const { return centerX_; }
+    double getCenterY() const { return centerY_; }
+    double getUnitsPerPixel() const { return unitsPerPixel_; }
+
+    double getMinX(int width) const { return centerX_ - 0.5 * width * unitsPerPixel_; }
+    double getMaxX(int width) const { return centerX_ + 0.5 * width * unitsPerPixel_; }
+    double getMinY(int height) const { return centerY_ - 0.5 * height * unitsPerPixel_; }
+    double getMaxY(int height) const { return centerY_ + 0.5 * height * unitsPerPixel_; }
+
+    /// Orthographic projection of the visible rectangle (with the identity view matrix).
+    glm::mat4 getProjection(int width, int height) const;
+
+private:
+    double centerX_;
+    double centerY_;
+    double unitsPerPixel_;
+};
+
+/// Samples of one equation over one tile, in increasing x; a NaN y marks a gap.
+struct CurveTile {
+    std::vector<glm::vec2> points;
+};
+
+/// Least-recently-used cache of curve tiles by (equation, zoom level, tile index).
+class CurveTileCache {
+public:
+    struct Key {
+        uint64_t equationId = 0;
+        int zoom = 0;
+        int64_t index = 0;
+
+        bool operator==(const Key& other) const {
+            return equationId == other.equationId && zoom == other.zoom && index == other.index;
+        }
+    };
+
+    explicit CurveTileCache(size_t capacity);
+
+    /// The cached tile, marked most recently used; null if absent.
+    const CurveTile* find(const Key& key);
+
+    /// Store tile as the most recently used, evicting the least recently used beyond capacity.
+    const CurveTile& insert(const Key& key, CurveTile&& tile);
+
+    /// Drop every tile of the equation.
+    void erase(uint64_t equationId);
+
+    size_t size() const { return index_.size(); }
+    size_t getCapacity() const { return capacity_; }
+
+private:
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+    using Entry = std::pair<Key, CurveTile>;
+
+    size_t capacity_;
+    std::list<Entry> entries_; // most recently used first
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index_;
+};
+
+/// Curves of the 2D equations over the visible x range of the plot. The range is covered by
+/// tiles 2^zoom wide, zoom chosen so a few tiles span the view; tiles are sampled with the
+/// generator's adaptive sampler and cached, so panning only samples the tiles that come into
+/// view and zooming back reuses the earlier level. Sampling (and parsing) runs on a background
+/// GenerationScheduler, never on the calling thread: until a tile arrives, a cached tile of a
+/// coarser level or its two halves one level down stand in for it.
+class CurvePlot {
+public:
+    static constexpr size_t DEFAULT_TILE_CAPACITY = 512;
+    static constexpr size_t DEFAULT_MAX_PENDING_TILES = 8; // in flight at once
+
+    explicit CurvePlot(size_t tileCapacity = DEFAULT_TILE_CAPACITY);
+
+    /// Take the tiles sampled since the last call, request missing tiles in view while fewer
+    /// than maxPendingTiles are in flight, and rebuild the line strips of the visible 2D
+    /// equations over [minX, maxX]. Returns false while tiles in view are still missing.
+    bool update(const std::vector<Equation>& equations, double minX, double maxX,
+                const GenerationOptions& options, size_t maxPendingTiles = DEFAULT_MAX_PENDING_TILES);
+
+    /// Block until every requested tile is sampled; the next update takes them.
+    void waitIdle() { sampler_.waitIdle(); }
+
+    /// Position/color pairs as the other renderers take them.
+    const std::vector<glm::vec3>& getVertices() const { return vertices_; }
+
+    /// Runs of vertices (pairs) drawn as line strips; undefined stretches split a curve.
+    const std::vector<IndexRange>& getStrips() const { return strips_; }
+
+    /// Tiles the last update asked the sampler for.
+    size_t getRequestedTiles() const { return requestedTiles_; }
+
+    /// Incremented whenever an update changes the vertices or strips.
+    uint64_t getRevision() const { return revision_; }
+
+    const CurveTileCache& getCache() const { return cache_; }
+
+    /// Zoom level whose tiles are at least a quarter of width wide.
+    static int zoomLevel(double width);
+    static double tileWidth(int zoom) { return std::ldexp(1.0, zoom); }
+
+private:
+    // What an equation's tiles were sampled with.
+    struct Source {
+        std::string signature;
+        bool isValid = true;   // false once the sampler reports a parse error
+        uint64_t revision = 0; // incremented on every change of signature
+        bool seen = false;     // present in the current update
+    };
+
+    // A tile being sampled, by sampler job id.
+    struct PendingTile {
+        CurveTileCache::Key key;
+        uint64_t revision; // of the source when requested
+    };
+
+    CurveTileCache cache_;
+    std::unordered_map<uint64_t, Source> sources_;
+    std::unordered_map<uint64_t, PendingTile> pending_;
+    std::vector<glm::vec3> vertices_;
+    std::vector<IndexRange> strips_;
+    size_t requestedTiles_;
+    uint64_t revision_;
+    bool complete_;                     // the last update drew every tile in view
+    std::vector<uint64_t> scene_;       // what the last update drew: view tiles, then per equation
+    std::vector<uint64_t> sceneScratch_;
+    GenerationScheduler sampler_;       // last, so its workers stop before the rest goes
+
+    Source& source(const Equation& equation, const GenerationOptions& options);
+    // Drop the tiles of an equation still being sampled.
+    void cancelPending(uint64_t equationId);
+    // Move finished tiles into the cache; true if any arrived or an equation turned out invalid.
+    bool collectTiles();
+    void requestTile(const Equation& equation, const CurveTileCache::Key& key, const GenerationOptions& options);
+    // Append the points of tile within [from, to] (and one past either end) to the strips.
+    void appendPoints(const CurveTile& tile, double from, double to, const glm::vec3& color, bool& open);
+};
+
+} // namespace graphgl
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "expression_program.h"
+
+namespace graphgl {
+
+/// A value with its partial derivatives, for forward-mode automatic differentiation.
+struct DualNumber {
+    float value = 0.0f;
+    float dx = 0.0f;
+    float dy = 0.0f;
+};
+
+/// Evaluate program and its gradient at (x, y) in one pass. value matches
+/// ExpressionProgram::evaluate exactly. Derivatives of piecewise-constant operations
+/// (floor, sgn, ...) are 0; at kinks (abs, min, ...) the derivative of the branch taken is
+/// used. registers must hold at least program.size() entries.
+DualNumber evaluateDual(const ExpressionProgram& program, float x, float y, DualNumber* registers);
+
+} // namespace graphgl
@@ -1,13 +1,38 @@
 #pragma once
 
+#include "mesh_indices.h"
+#include "surface_lod.h"
 #include <glm/glm.hpp>
 #include <vector>
 #include <string>
 #include <array>
+#include <atomic>
+#include <cstdint>
 
 namespace graphgl {
 
+/// Process-unique identity for a new equation.
+inline uint64_t nextEquationId() {
+    static std::atomic<uint64_t> next{1};
+    return next.fetch_add(1, std::memory_order_relaxed);
+}
+
+/// Process-unique stamp for a new version of an equation's or point's geometry.
+inline uint64_t nextGeometryRevision() {
+    static std::atomic<uint64_t> next{1};
+    return next.fetch_add(1, std::memory_order_relaxed);
+}
+
+/// A square block of a surface mesh, for culling: the run of Equation::indices holding its
+/// triangles and the bounds of their vertices.
+struct MeshChunk {
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+    IndexRange indices;
+};
+
 struct Equation {
+    uint64_t id = nextEquationId(); // stable while the equation is edited or reordered
     std::string expression;
     std::array<float, 3> color = {1.0f, 0.5f, 0.2f};
     int sampleSize = 1000;
@@ -19,14 +44,23 @@ struct Equation {
     bool is3D = true;
     bool isVisible = true;
     float opacity = 1.0f;
+    float minHeight = 0.0f; // range of the generated heights, for the heatmap
+    float maxHeight = 0.0f;
     bool isMesh = false;
-    std::vector<unsigned int> indices;
+    MeshIndices indices;
+    std::vector<MeshChunk> meshChunks; // partition indices into blocks of the surface
+    SurfaceLod lod; // chunked surface meshes; when present it replaces indices
+    std::vector<IndexRange> strips; // runs of vertices drawn as polylines when not a mesh
+    glm::vec3 boundsMin = glm::vec3(0.0f); // of the vertices; min > max when there are none
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+    uint64_t revision = 0; // nextGeometryRevision() when vertices, indices or lod last changed
 };
 
 struct Point {
     glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f);
     std::array<float, 3> color = {1.0f, 0.5f, 0.2f};
     std::vector<glm::vec3> vertexData;
+    uint64_t revision = 0; // nextGeometryRevision() when vertexData last changed
 };
 
 } // namespace graphgl
@@ -2,40 +2,303 @@
 
 #include "equation.h"
 #include "equation_parser.h"
+#include "rtin_mesh.h"
+#include "cancellation_token.h"
+#include <memory>
 #include <vector>
 #include <functional>
 #include <algorithm>
+#include <array>
+#include <string>
 
 namespace graphgl {
 
+/// How the adaptive sampler decides to split a curve segment.
+enum class CurveRefinement {
+    /// Split where the slope (or its change across a segment) exceeds the derivative threshold.
+    Slope,
+    /// Split where the curve, normalized to the domain width and its height spread, turns by
+    /// more than the angle tolerance. Straight lines stay coarse at any steepness.
+    TurningAngle
+};
+
+/// Surface heights on a tensor grid, kept between generations of one equation so that a
+/// regeneration only evaluates the rows and columns it has not seen before.
+struct SurfaceSampleCache {
+    std::string key;              // expression, mode and approximation tolerance of the heights
+    std::vector<float> xs;        // ascending
+    std::vector<float> ys;        // ascending
+    std::vector<float> heights;   // row-major: heights[row * xs.size() + col]
+    size_t evaluatedSamples = 0;  // samples the last generation had to evaluate
+
+    void clear() {
+        key.clear();
+        xs.clear();
+        ys.clear();
+        heights.clear();
+        evaluatedSamples = 0;
+    }
+};
+
 /// Produces vertex data for equations using adaptive subdivision sampling.
 class EquationGenerator {
 public:
+    /// Side, in lattice cells, of the blocks a surface mesh is split into for culling.
+    static constexpr uint32_t MESH_CHUNK_CELLS = 64;
+
     EquationGenerator();
     ~EquationGenerator() = default;
 
     /// Populate equation.vertices (and indices for meshes) from the parsed expression.
+    /// Curves subdivide up to maxDepth times where the slope exceeds derivativeThreshold.
+    /// Surfaces are sampled with at least 2^(maxDepth + 2) cells per side (clamped) inside the
+    /// domain, on the largest power-of-two spacing that gives that many, so samples line up
+    /// across domains and levels and come from the sample cache where possible; the mesh is
+    /// simplified to the surface tolerance. Mesh triangles are ordered by blocks of MESH_CHUNK_CELLS
+    /// cells, listed with their bounds in meshChunks, and the equation's bounds are set.
     void generateVertices(Equation& equation, EquationParser& parser, 
                           int maxDepth = 6, double derivativeThreshold = 5.0);
 
+    /// Called with the equation after each level of generateProgressive; isFinal marks the
+    /// full-resolution level. The equation's geometry is overwritten by the next level.
+    using LevelCallback = std::function<void(const Equation& equation, bool isFinal)>;
+
+    /// generateVertices at successively finer levels, ending with maxDepth. Surfaces start on
+    /// the coarsest lattice and step up two lattice levels (16x the samples) at a time, so the
+    /// previews cost a few percent of the final level; curves preview their base samples.
+    /// Stops without a final level when cancelled.
+    void generateProgressive(Equation& equation, EquationParser& parser, int maxDepth,
+                             double derivativeThreshold, const LevelCallback& onLevel);
+
+    /// The samples generateVertices takes of the parsed curve over [minX, maxX], in increasing
+    /// x and including undefined (NaN) values. sampleSize is the budget when one is used.
+    void sampleCurve(EquationParser& parser, float minX, float maxX, int maxDepth, double derivativeThreshold,
+                     int sampleSize, std::vector<float>& xs, std::vector<float>& ys);
+
     float getMinHeight() const { return minHeight_; }
     float getMaxHeight() const { return maxHeight_; }
 
+    /// Accuracy bound for heights that are filled instead of evaluated: surfaces filled from
+    /// a radial profile or a single period (relative to the height range of the sampled
+    /// table, at least 1) and boxes whose interval bounds prove them flat (relative to their
+    /// magnitude, at least 1). 0 disables those shortcuts; provably undefined boxes are
+    /// always skipped.
+    float getApproximationTolerance() const { return approximationTolerance_; }
+    void setApproximationTolerance(float tolerance) { approximationTolerance_ = tolerance; }
+
+    /// Largest vertical error of a surface mesh relative to its height range. Lattice samples
+    /// are dropped while the mesh stays within it; 0 keeps the full lattice.
+    float getSurfaceTolerance() const { return surfaceTolerance_; }
+    void setSurfaceTolerance(float tolerance) { surfaceTolerance_ = tolerance; }
+
+    /// Treat Equation::sampleSize as a vertex budget. Curves split their worst segments
+    /// first until the budget is spent; surfaces use the smallest error threshold whose mesh
+    /// fits, coarsening domain edges too when they alone would exceed it. maxDepth and the
+    /// lattice still bound the resolution, and the derivative threshold and surface tolerance
+    /// are ignored.
+    bool getUseSampleBudget() const { return useSampleBudget_; }
+    void setUseSampleBudget(bool use) { useSampleBudget_ = use; }
+
+    CurveRefinement getCurveRefinement() const { return curveRefinement_; }
+    void setCurveRefinement(CurveRefinement refinement) { curveRefinement_ = refinement; }
+
+    /// Largest turning angle (radians) of an unsplit segment under CurveRefinement::TurningAngle.
+    float getAngleTolerance() const { return angleTolerance_; }
+    void setAngleTolerance(float radians) { angleTolerance_ = radians; }
+
+    /// Build surface meshes as SurfaceLod chunks (Equation::lod instead of indices): aligned
+    /// squares of the lattice, each meshed at the surface tolerance and at coarser levels,
+    /// with skirts along their shared borders. Chunk borders are always split, which adds a
+    /// few vertices to the plain mesh.
+    bool getChunkedLod() const { return chunkedLod_; }
+    void setChunkedLod(bool chunked) { chunkedLod_ = chunked; }
+
+    /// Cache of the surface heights of the equation being generated. Null uses a cache owned
+    /// by the generator, which helps when one equation is regenerated repeatedly.
+    void setSampleCache(std::shared_ptr<SurfaceSampleCache> cache) { sampleCache_ = std::move(cache); }
+
+    /// Threads a surface grid is evaluated on; 0 (the default) uses every hardware thread.
+    /// Callers running several generators at once share the hardware between them.
+    size_t getThreadCount() const { return threadCount_; }
+    void setThreadCount(size_t threads) { threadCount_ = threads; }
+
+    /// Token polled every few rows or tiles of a surface grid, between sampling phases and
+    /// between curve segments. Once it is cancelled generateVertices stops early and leaves
+    /// partial output (the sample cache is not updated); null never cancels. Once it is told
+    /// to stop after samples, surfaces skip the remaining previews and stop right after the
+    /// final grid is stored in the sample cache, before meshing.
+    void setCancellationToken(std::shared_ptr<const CancellationToken> token) { cancellation_ = std::move(token); }
+    bool isCancelled() const { return cancellation_ && cancellation_->isCancelled(); }
+    bool isStoppingAfterSamples() const { return cancellation_ && cancellation_->isStoppingAfterSamples(); }
+
 private:
     float minHeight_;
     float maxHeight_;
+    float approximationTolerance_;
+    float surfaceTolerance_;
+    bool useSampleBudget_;
+    CurveRefinement curveRefinement_;
+    float angleTolerance_;
+    bool chunkedLod_;
+    size_t threadCount_;
+    std::shared_ptr<const CancellationToken> cancellation_;
+    std::shared_ptr<SurfaceSampleCache> sampleCache_;
+    SurfaceSampleCache localCache_;
+    bool storeSamples_; // false while generating previews
+
+    // Surface simplification state and scratch buffers, reused across calls. lattice_ is the
+    // evaluated grid padded to the full RTIN lattice by repeating its last row and column.
+    RtinMesh rtin_;
+    std::vector<float> lattice_;
+    size_t latticeCols_ = 0; // lattice columns and rows inside the domain
+    size_t latticeRows_ = 0;
+    std::vector<uint32_t> triangles_;
+    std::vector<uint32_t> triangleScratch_;
+    std::vector<uint32_t> blockStarts_; // first triangle of each mesh block in triangles_
+    std::vector<uint32_t> blockNext_;
+    std::vector<uint32_t> vertexIndex_;
+    std::vector<unsigned int> meshIndices_; // triangles before they are packed into Equation::indices
+
+    // A function value and derivative at x, carried from subdivision to vertex emission.
+    struct Sample {
+        float x;
+        DualNumber f;
+    };
+
+    // A pending segment of the adaptive sampler.
+    struct SampleSegment {
+        Sample start;
+        Sample end;
+        int depth;
+    };
+
+    // Scratch buffers for evaluation and sampling, reused across calls.
+    std::vector<float> heights_;
+    std::vector<float> surfaceScratch_;
+    std::vector<float> samples_;
+    std::vector<Sample> baseSamples_;
+    std::vector<SampleSegment> segments_;
 
-    // Adaptive sampling helper
-    std::vector<float> adaptiveSample(
-        const std::function<float(float)>& func,
+    // A segment of the budget sampler, by index into baseSamples_.
+    struct BudgetSegment {
+        double error;
+        uint32_t start;
+        uint32_t end;
+        int depth;
+    };
+
+    std::vector<BudgetSegment> budgetQueue_;
+    std::vector<uint32_t> sampleNext_;
+
+    // The lattice sample inside the domain that a collapsed sample past it coincides with.
+    uint32_t domainSample(uint32_t sample) const {
+        const uint32_t gridSize = rtin_.getGridSize();
+        const uint32_t col = std::min<uint32_t>(sample % gridSize, static_cast<uint32_t>(latticeCols_ - 1));
+        const uint32_t row = std::min<uint32_t>(sample / gridSize, static_cast<uint32_t>(latticeRows_ - 1));
+        return row * gridSize + col;
+    }
+
+    // Fill heights_ for the grid xSamples × ySamples, evaluating only the samples missing from
+    // cache and then storing the grid in it.
+    void evaluateCachedSurface(const CompiledExpression& expression, SurfaceSampleCache& cache,
+                               const std::vector<float>& xSamples,
+                               const std::vector<float>& ySamples);
+
+    // Threads to evaluate a surface grid on.
+    size_t surfaceThreads() const;
+
+    // Evaluate the surface grid into heights_, splitting rows across surfaceThreads().
+    void evaluateSurface(const CompiledExpression& expression,
+                         const std::vector<float>& xSamples,
+                         const std::vector<float>& ySamples);
+
+    // Bound the surface over tiles of the grid with interval arithmetic; fill tiles that are
+    // provably undefined or flat and evaluate the rest. Returns false if no tile was pruned.
+    bool evaluatePrunedSurface(const CompiledExpression& expression,
+                               const std::vector<float>& xSamples,
+                               const std::vector<float>& ySamples);
+
+    // Fill heights_ by interpolating a 1D radial profile. Returns false if not worthwhile.
+    bool fillRadialSurface(const CompiledExpression& expression,
+                           const ExpressionProgram& profile,
+                           const std::vector<float>& xSamples,
+                           const std::vector<float>& ySamples);
+
+    // Fill heights_ from one period along each periodic axis. Returns false if not worthwhile
+    // or if the tolerance cannot be met.
+    bool fillPeriodicSurface(const CompiledExpression& expression,
+                             float periodX, float periodY,
+                             const std::vector<float>& xSamples,
+                             const std::vector<float>& ySamples);
+
+    // Move triangles_ inside the domain and emit each used, defined lattice sample once;
+    // vertexIndex_ maps lattice samples to vertex indices.
+    void emitLatticeVertices(Equation& equation, const std::vector<float>& xSamples,
+                             const std::vector<float>& ySamples);
+
+    // Move triangles_ inside the domain and emit the same vertices row by row instead, with a
+    // strip per run of them not broken by an undefined sample (surfaces drawn as lines).
+    void emitLatticeRows(Equation& equation, const std::vector<float>& xSamples,
+                         const std::vector<float>& ySamples);
+
+    // The body of generateVertices, before the bounds are taken.
+    void generateGeometry(Equation& equation, EquationParser& parser, int maxDepth,
+                          double derivativeThreshold);
+
+    // Group triangles_ by the block of MESH_CHUNK_CELLS cells holding their centroid, filling
+    // blockStarts_.
+    void sortTrianglesIntoBlocks();
+
+    // Set equation.boundsMin/boundsMax from its vertices.
+    static void computeBounds(Equation& equation);
+
+    // Vertex indices of the lattice triangle at samples; false if it touches an undefined
+    // sample or has no area.
+    bool meshTriangle(const Equation& equation, const uint32_t* samples, std::array<uint32_t, 3>& triangle) const;
+
+    // Fill equation.lod (and the vertices) with the chunked mesh of the built lattice.
+    void emitSurfaceChunks(Equation& equation, float maxError, float range,
+                           const std::vector<float>& xSamples, const std::vector<float>& ySamples);
+
+    // Vertices of the surface mesh for maxError (fills triangles_).
+    size_t countSurfaceVertices(float maxError);
+
+    // Smallest surface error threshold whose mesh has at most budget vertices.
+    float fitSampleBudget(size_t budget);
+
+    // Budget-driven counterpart of adaptiveSample: returns at most budget samples, splitting
+    // the segment with the largest estimated error first.
+    void budgetSample(
+        const std::function<DualNumber(float)>& func,
         float min,
         float max,
         int maxDepth,
-        double derivativeThreshold
-    ) const;
+        size_t budget,
+        std::vector<float>& xs,
+        std::vector<float>& values,
+        const std::function<Interval(float, float)>& bounds = nullptr
+    );
+
+    // Slope of a sample taken without a derivative (dx NaN, value defined) from its neighbours,
+    // either of which may be null or undefined: central where both are defined, else one-sided.
+    static void estimateSlope(const Sample* left, Sample& sample, const Sample* right);
 
-    // Safe evaluation wrapper
-    float safeEvaluate(EquationParser& parser, float x, float y, bool is3D) const;
+    // Adaptive sampling helper. func returns the value and, in dx, the derivative along the
+    // sampled axis, or NaN in dx when it has none (see estimateSlope). Replaces xs and values
+    // with the samples in increasing x and the value of func at each, evaluating every x
+    // once. bounds, if set, returns the interval of func over [a, b]; it lets segments that
+    // are provably flat or undefined stop early and forces subdivision where the samples miss
+    // variation or a domain boundary.
+    void adaptiveSample(
+        const std::function<DualNumber(float)>& func,
+        float min,
+        float max,
+        int maxDepth,
+        double derivativeThreshold,
+        std::vector<float>& xs,
+        std::vector<float>& values,
+        const std::function<Interval(float, float)>& bounds = nullptr
+    );
 };
 
 } // namespace graphgl
@@ -1,11 +1,119 @@
 #pragma once
 
 #include "equation.h"
+#include "expression_program.h"
+#include "simd_evaluator.h"
+#include "separable_expression.h"
+#include "surface_symmetry.h"
+#include "native_kernel.h"
+#include "preset_kernels.h"
+#include "interval_arithmetic.h"
+#include "dual_number.h"
 #include <string>
 #include <memory>
+#include <vector>
+#include <cstddef>
 
 namespace graphgl {
 
+/// Immutable result of compiling an expression. Safe to share between threads;
+/// each thread evaluates through its own Context.
+class CompiledExpression {
+public:
+    class Context;
+
+    CompiledExpression(std::string source, bool is3D, ExpressionProgram program,
+                       std::shared_ptr<const NativeKernel> nativeKernel = nullptr);
+
+    const std::string& getSource() const { return source_; }
+    bool is3D() const { return is3D_; }
+
+    /// True when the expression was lowered to the built-in interpreter. Otherwise
+    /// each context compiles a private ExprTk instance from the source.
+    bool hasProgram() const { return !program_.empty(); }
+
+    /// True when Context::evaluateGradient takes one forward-mode pass. Otherwise it takes
+    /// central differences: 3 ExprTk evaluations in 2D and 5 in 3D, so callers that can
+    /// estimate slopes from their own samples should evaluate values only.
+    bool hasGradient() const { return hasProgram(); }
+    const ExpressionProgram& getProgram() const { return program_; }
+
+    /// Vectorized form of the program used for batch and grid evaluation.
+    const SimdEvaluator& getSimdEvaluator() const { return simd_; }
+
+    /// Split into pure-x and pure-y factors for grid evaluation, or null if the
+    /// expression is not separable (or is 2D).
+    const SeparableExpression* getSeparable() const { return separable_.get(); }
+
+    /// Radial and periodic structure of a 3D program, analyzed once at compile time; empty
+    /// for 2D expressions and ExprTk fallbacks.
+    const SurfaceSymmetry& getSymmetry() const { return symmetry_; }
+
+    /// Machine-code build of the program, used in place of the interpreter when present.
+    const NativeKernel* getNativeKernel() const { return nativeKernel_.get(); }
+
+    /// Compile-time specialized kernel of the matching built-in preset, or null. Takes
+    /// precedence over the native kernel and the interpreter.
+    const PresetKernel* getPresetKernel() const { return preset_; }
+
+    /// Create per-thread evaluation state. The context must not outlive this object.
+    Context createContext() const;
+
+private:
+    std::string source_;
+    bool is3D_;
+    ExpressionProgram program_;
+    SimdEvaluator simd_;
+    std::unique_ptr<const SeparableExpression> separable_;
+    SurfaceSymmetry symmetry_;
+    std::shared_ptr<const NativeKernel> nativeKernel_;
+    const PresetKernel* preset_;
+};
+
+/// Variable bindings and scratch registers for evaluating a CompiledExpression on one thread.
+class CompiledExpression::Context {
+public:
+    explicit Context(const CompiledExpression& expression);
+    ~Context();
+
+    Context(const Context&) = delete;
+    Context& operator=(const Context&) = delete;
+    Context(Context&& other) noexcept;
+    Context& operator=(Context&& other) noexcept;
+
+    /// Evaluate at (x, y). y is ignored for 2D expressions; failures yield NaN.
+    float evaluate(float x, float y = 0.0f);
+
+    /// Evaluate count (xs[i], ys[i]) pairs into out. ys may be null for 2D expressions.
+    void evaluateBatch(const float* xs, const float* ys, float* out, size_t count);
+
+    /// Evaluate the tensor grid xs × ys into a row-major matrix: out[row * xCount + col] = f(xs[col], ys[row]).
+    void evaluateGrid(const float* xs, size_t xCount, const float* ys, size_t yCount, float* out);
+
+    /// Bounds of the expression over the box x × y (y is ignored for 2D expressions).
+    /// Expressions evaluated by ExprTk have no interval form and return Interval::entire().
+    Interval evaluateInterval(const Interval& x, const Interval& y = Interval::point(0.0));
+
+    /// Value and partial derivatives at (x, y) from one forward-mode pass. dy is 0 for 2D
+    /// expressions. Expressions evaluated by ExprTk fall back to central differences, which
+    /// cost 3 evaluations in 2D and 5 in 3D; see CompiledExpression::hasGradient().
+    DualNumber evaluateGradient(float x, float y = 0.0f);
+
+    /// Points this context has evaluated with ExprTk; 0 for expressions with a program.
+    size_t getFallbackEvaluations() const;
+
+private:
+    class Fallback;
+
+    const CompiledExpression* expression_;
+    std::vector<float> registers_;
+    std::vector<float> simdScratch_;
+    std::vector<float> axisValues_;
+    std::vector<Interval> intervalRegisters_;
+    std::vector<DualNumber> dualRegisters_;
+    std::unique_ptr<Fallback> fallback_;
+};
+
 /// Wraps ExprTk behind a PIMPL to parse and evaluate math expressions.
 class EquationParser {
 public:
@@ -15,22 +123,49 @@ public:
     EquationParser(const EquationParser&) = delete;
     EquationParser& operator=(const EquationParser&) = delete;
 
-    /// Compile an expression string. Returns false on syntax errors.
-    [[nodiscard]] bool parseExpression(const std::string& expression, bool is3D = true);
+    /// Compile an expression string. Returns null on syntax errors.
+    [[nodiscard]] std::shared_ptr<const CompiledExpression> parseExpression(const std::string& expression,
+                                                                            bool is3D = true);
+
+    /// The last successfully compiled expression, or null.
+    std::shared_ptr<const CompiledExpression> getCompiledExpression() const { return compiled_; }
 
     /// Evaluate the last compiled expression at (x, y).
     float evaluate(float x, float y = 0.0f) const;
 
+    /// Evaluate count (xs[i], ys[i]) pairs into out. ys may be null for 2D expressions.
+    /// Samples that fail to evaluate are written as NaN.
+    void evaluateBatch(const float* xs, const float* ys, float* out, size_t count) const;
+
+    /// Evaluate the tensor grid xs × ys into a row-major matrix: out[row * xCount + col] = f(xs[col], ys[row]).
+    void evaluateGrid(const float* xs, size_t xCount, const float* ys, size_t yCount, float* out) const;
+
+    /// Value, df/dx and df/dy of the last compiled expression at (x, y): one evaluation when
+    /// hasGradient(), else central differences over 3 (2D) or 5 (3D) ExprTk evaluations.
+    DualNumber evaluateGradient(float x, float y = 0.0f) const;
+
+    /// Whether the last compiled expression has forward-mode gradients.
+    bool hasGradient() const { return compiled_ && compiled_->hasGradient(); }
+
+    /// Points evaluated with ExprTk through this parser since the last compile.
+    size_t getFallbackEvaluations() const;
+
     bool isValid() const { return isValid_; }
     std::string getErrorMessage() const { return errorMessage_; }
 
+    /// Compile later expressions to native kernels through cache, or stop doing so (null).
+    /// Expressions that cannot be built natively keep using the interpreter.
+    void setNativeKernelCache(std::shared_ptr<NativeKernelCache> cache) { nativeKernels_ = std::move(cache); }
+    const std::shared_ptr<NativeKernelCache>& getNativeKernelCache() const { return nativeKernels_; }
+
 private:
     class Impl;
     std::unique_ptr<Impl> pImpl_;
+    std::shared_ptr<const CompiledExpression> compiled_;
+    std::shared_ptr<NativeKernelCache> nativeKernels_;
     bool isValid_;
     std::string errorMessage_;
 
 };
 
 } // namespace graphgl
-
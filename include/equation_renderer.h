@@ -1,14 +1,25 @@
 #pragma once
 
 #include "equation.h"
+#include "frustum.h"
+#include "gpu_buffer.h"
+#include "line_batch.h"
 #include "shader.h"
 #include <glm/glm.hpp>
 #include <vector>
 #include <memory>
+#include <unordered_map>
+#include <utility>
 
 namespace graphgl {
 
-/// Manages OpenGL buffers and draw calls for equation curves, surfaces, and points.
+/// Manages OpenGL buffers and draw calls for equation curves, surfaces, and points. Each
+/// equation owns ranges of one shared vertex buffer and one shared index buffer, so an edit
+/// re-uploads that equation's ranges only. All meshes are drawn with one multi-draw per index
+/// width; per-equation color, opacity and height range come from a texture buffer of draw
+/// records that the vertex shader looks up by vertex. Curves and non-mesh surfaces are drawn
+/// as thick lines along their strips, all in one more draw. Equations, and the blocks of
+/// their meshes, whose bounds lie outside the view frustum are left out of the draws.
 class EquationRenderer {
 public:
     EquationRenderer();
@@ -19,29 +30,122 @@ public:
 
     void initialize();
 
-    /// Re-upload vertex/index data from the current equations and points.
+    /// Upload vertex/index data from the current equations and points. Cheap to call every
+    /// frame: an equation is uploaded when it becomes visible with a new revision, and its
+    /// indices again when its selected chunk levels change; removed equations free their
+    /// ranges. Chunked surfaces draw the levels selected for the LOD view (their finest level
+    /// until one is set).
     void updateVertices(const std::vector<Equation>& equations, const std::vector<Point>& points);
 
-    /// Issue draw calls for meshes (indexed) and standalone points.
+    /// Camera used to select chunk levels on the next updateVertices.
+    void setLodView(const LodView& view) { lodView_ = view; hasLodView_ = true; }
+
+    /// View volume culled against on the next updateVertices; by default nothing is culled.
+    void setFrustum(const Frustum& frustum) { frustum_ = frustum; }
+
+    /// Draw the meshes (at most two calls) and standalone points. Meshes take their heatmap
+    /// range from their own heights; points use [minHeight, maxHeight].
     void render(const Shader& shader, bool useHeatmap, float minHeight, float maxHeight) const;
 
-    size_t getVertexCount() const { return vertices_.size(); }
-    size_t getIndexCount() const { return indices_.size(); }
+    /// Draw the strips of curves and non-mesh surfaces width pixels wide with lineShader,
+    /// whose matrices are already set.
+    void renderLines(const Shader& lineShader, float width, int viewportWidth, int viewportHeight) const;
+
+    size_t getVertexCount() const { return vertexCount_; }
+    size_t getIndexCount() const { return indexCount_; } // drawn, after culling
+    size_t getDrawCallCount() const;
 
 private:
+    // One indexed draw of mesh triangles.
+    struct MeshDraw {
+        bool wide;          // 32-bit indices, else 16-bit
+        size_t start;       // position of the first index in the equation's index sequence
+        size_t byteOffset;  // into the index buffer
+        size_t count;
+        int baseVertex;
+    };
+
+    // Arguments of one glMultiDrawElementsBaseVertex.
+    struct DrawBatch {
+        std::vector<int> counts;
+        std::vector<const void*> offsets;
+        std::vector<int> baseVertices;
+
+        void clear() {
+            counts.clear();
+            offsets.clear();
+            baseVertices.clear();
+        }
+    };
+
+    // The ranges one equation owns in the shared buffers and its draws into them.
+    struct Slot {
+        uint64_t revision = 0;
+        bool isMesh = false;
+        bool uploaded = false;
+        bool seen = false;        // present in the current update
+        size_t firstVertex = 0;   // vertices (position/color pairs)
+        size_t vertexCount = 0;
+        size_t firstIndexUnit = 0; // 4-byte units of the index buffer
+        size_t indexUnits = 0;
+        std::vector<uint8_t> lodLevels;
+        std::vector<MeshDraw> draws;      // ordered by start
+        std::vector<MeshChunk> cullChunks; // blocks of the uploaded index sequence
+        glm::vec3 boundsMin = glm::vec3(0.0f);
+        glm::vec3 boundsMax = glm::vec3(0.0f);
+    };
+
     unsigned int VAO_;
-    unsigned int VBO_;
-    unsigned int EBO_;
-    
-    std::vector<glm::vec3> vertices_;
-    std::vector<unsigned int> indices_;
-    size_t equationVertexCount_; // vec3 entries belonging to equations (before points).
-    
+    std::unique_ptr<SubAllocatedBuffer> vertexBuffer_;
+    std::unique_ptr<SubAllocatedBuffer> indexBuffer_;
+    unsigned int boundVertexBuffer_; // buffer names the vertex array was set up with
+    unsigned int boundIndexBuffer_;
+
+    std::unordered_map<uint64_t, Slot> slots_;
+    std::vector<uint64_t> visible_; // ids of the visible equations, in draw order
+    std::vector<uint64_t> visibleScratch_;
+    DrawBatch compactBatch_; // 16-bit indices
+    DrawBatch wideBatch_;    // 32-bit indices
+
+    unsigned int recordBuffer_;
+    unsigned int recordTexture_;
+    std::vector<uint32_t> records_; // as uploaded; eight words per visible mesh
+    std::vector<uint32_t> recordScratch_;
+    std::vector<std::pair<size_t, const Equation*>> recordOrder_;
+
+    std::unique_ptr<LineBatch> lines_;
+
+    std::vector<uint64_t> pointRevisions_;
+    std::vector<uint64_t> pointScratch_;
+    std::vector<glm::vec3> pointVertices_;
+    size_t firstPointVertex_;
+    size_t pointVertexCount_;
+
+    LodView lodView_;
+    bool hasLodView_;
+    Frustum frustum_;
+    std::vector<uint8_t> inView_; // per visible equation, then per cull chunk of it
+    std::vector<uint8_t> inViewScratch_;
+    std::vector<uint8_t> lodScratch_;
+    std::vector<unsigned int> lodIndices_;
+    MeshIndices lodPacked_;
+
+    size_t vertexCount_; // vec3 entries drawn (two per vertex)
+    size_t indexCount_;
+
     bool initialized_;
 
+    void uploadVertices(const Equation& equation, Slot& slot);
+    void uploadIndices(const Equation& equation, Slot& slot);
+    void uploadPoints(const std::vector<Point>& points);
+    void releaseSlot(Slot& slot);
+    void updateRecords(const std::vector<Equation>& equations);
+    void updateLines(const std::vector<Equation>& equations);
+    void appendDraws(const Slot& slot, size_t first, size_t last);
+
     void setupBuffers();
+    void bindBuffers();
     void cleanupBuffers();
 };
 
 } // namespace graphgl
-
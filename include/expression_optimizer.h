@@ -0,0 +1,17 @@
+#pragma once
+
+#include "expression_program.h"
+
+namespace graphgl {
+
+/// Rewrite a program into a cheaper equivalent one:
+///  - literal arithmetic and constants (pi, e) are folded,
+///  - identical subexpressions are shared (hash-consing, commutative operands canonicalized),
+///  - small integer powers become multiplies (x^2 -> x*x, x^3 -> x*x*x, x^-1 -> 1/x),
+///  - nodes that do not depend on x are moved in front of those that do, so grid
+///    evaluation can compute them once per row instead of once per sample,
+///  - nodes no longer reachable from the result are dropped.
+/// Rewrites are exact except for x^3 and x^4, which round like ExprTk's own expansion.
+ExpressionProgram optimizeExpression(const ExpressionProgram& program);
+
+} // namespace graphgl
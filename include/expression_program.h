@@ -0,0 +1,102 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace graphgl {
+
+/// Operations understood by the built-in expression interpreter.
+enum class ExprOp : uint8_t {
+    Const,
+    VarX,
+    VarY,
+    Neg,
+    Add,
+    Sub,
+    Mul,
+    Div,
+    Mod,
+    Pow,
+    Min,
+    Max,
+    Atan2,
+    Hypot,
+    Sin,
+    Cos,
+    Tan,
+    Asin,
+    Acos,
+    Atan,
+    Sinh,
+    Cosh,
+    Tanh,
+    Exp,
+    Log,
+    Log10,
+    Log2,
+    Sqrt,
+    Abs,
+    Floor,
+    Ceil,
+    Round,
+    Trunc,
+    Sgn
+};
+
+/// Number of operands an operation reads (0, 1 or 2).
+int exprOpArity(ExprOp op);
+
+/// Apply a unary or binary operation to scalar operands.
+float applyExprOp(ExprOp op, float lhs, float rhs = 0.0f);
+
+/// One node of a flattened expression tree. Operands always refer to earlier nodes.
+struct ExprNode {
+    ExprOp op = ExprOp::Const;
+    uint32_t lhs = 0;
+    uint32_t rhs = 0;
+    float value = 0.0f;
+};
+
+/// A leaf of a flattened sum (inverted = subtracted) or product (inverted = divided by).
+struct ExprTerm {
+    uint32_t node;
+    bool inverted;
+};
+
+/// Immutable, flattened form of an expression that can be evaluated without ExprTk.
+/// Nodes are ordered so that evaluating them front to back evaluates the whole
+/// expression; the last node holds the result.
+class ExpressionProgram {
+public:
+    /// Parse the subset of ExprTk syntax the interpreter understands. Returns false for
+    /// anything else (comparisons, implicit multiplication, ...), so callers can fall back to ExprTk.
+    /// In 2D mode y is bound to the constant 0, matching EquationParser::evaluate.
+    [[nodiscard]] static bool parse(const std::string& source, bool is3D, ExpressionProgram& program);
+
+    bool empty() const { return nodes_.empty(); }
+    size_t size() const { return nodes_.size(); }
+    const std::vector<ExprNode>& getNodes() const { return nodes_; }
+
+    /// Evaluate at (x, y). registers must hold at least size() floats.
+    float evaluate(float x, float y, float* registers) const;
+
+    /// Flatten the chain of +, - and unary minus rooted at node into its terms.
+    void collectSum(uint32_t node, std::vector<ExprTerm>& terms) const;
+
+    /// Flatten the chain of *, / and unary minus rooted at node into its factors.
+    /// negated is toggled once per unary minus.
+    void collectProduct(uint32_t node, std::vector<ExprTerm>& terms, bool& negated) const;
+
+    /// Append a node and return its index.
+    uint32_t addNode(ExprOp op, uint32_t lhs = 0, uint32_t rhs = 0, float value = 0.0f);
+
+private:
+    std::vector<ExprNode> nodes_;
+
+    void collectSum(uint32_t node, bool inverted, std::vector<ExprTerm>& terms) const;
+    void collectProduct(uint32_t node, bool inverted, std::vector<ExprTerm>& terms, bool& negated) const;
+};
+
+} // namespace graphgl
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <array>
+
+namespace graphgl {
+
+/// The six planes bounding what a view-projection matrix maps into clip space, for culling
+/// axis-aligned bounding boxes.
+class Frustum {
+public:
+    /// A frustum that contains everything.
+    Frustum();
+
+    explicit Frustum(const glm::mat4& viewProjection);
+
+    /// False if the box lies entirely outside one of the planes. Boxes near a corner of the
+    /// frustum may be reported as intersecting when they are not; empty boxes (min > max on
+    /// some axis) never intersect.
+    bool intersects(const glm::vec3& boundsMin, const glm::vec3& boundsMax) const;
+
+private:
+    std::array<glm::vec4, 6> planes_; // (normal, offset), inside where dot >= 0
+};
+
+} // namespace graphgl
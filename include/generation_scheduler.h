@@ -0,0 +1,134 @@
+#pragma once
+
+#include "equation.h"
+#include "equation_generator.h"
+#include "cancellation_token.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace graphgl {
+
+class NativeKernelCache;
+
+/// Sampling options captured when a job is submitted, so later settings changes do not
+/// affect work already queued.
+struct GenerationOptions {
+    int maxDepth = 6;
+    double derivativeThreshold = 5.0;
+    bool useSampleBudget = false;
+    CurveRefinement curveRefinement = CurveRefinement::Slope;
+    float angleTolerance = 0.035f; // radians
+    bool progressive = true;       // publish coarse previews before the full-resolution level
+    bool chunkedLod = false;       // mesh surfaces as SurfaceLod chunks
+    std::shared_ptr<NativeKernelCache> nativeKernels; // null evaluates without native kernels
+};
+
+/// Geometry produced for one equation. isValid is false when the expression did not parse;
+/// errorMessage then holds the parser's message. isFinal is false for progressive previews,
+/// which a later result for the same equation replaces.
+struct GenerationResult {
+    uint64_t equationId = 0;
+    bool isValid = false;
+    bool isFinal = true;
+    std::string errorMessage;
+    std::vector<glm::vec3> vertices;
+    MeshIndices indices;
+    std::vector<MeshChunk> meshChunks;
+    SurfaceLod lod;
+    std::vector<IndexRange> strips;
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+    float minHeight = 0.0f;
+    float maxHeight = 0.0f;
+    size_t evaluatedSamples = 0; // surface samples evaluated rather than taken from the cache
+};
+
+/// Runs parse + generateVertices on a pool of worker threads. Each equation (by Equation::id)
+/// has at most one wanted job: a newer submission replaces a queued one, and only the results
+/// of the latest submission are ever returned. Progressive jobs publish coarse previews first.
+/// Each equation keeps a surface sample cache between jobs, so edits that keep the expression
+/// only evaluate new samples. At most one job per equation runs at a time: a queued job waits
+/// until its equation's running job is done, so every job starts with the cache its
+/// predecessor left. A newer submission cancels the running job unless it is a surface with
+/// the same expression: that job skips its remaining previews, stores its final grid in the
+/// cache and stops before meshing, while the edits meanwhile merge into the one queued job.
+/// Jobs share the hardware threads: each claims a fair share of the free ones for its surface
+/// grid and returns them when done. The owner polls takeResults() (once per frame) and swaps
+/// the geometry in on its own thread.
+class GenerationScheduler {
+public:
+    /// workerCount 0 picks one less than the hardware threads, between 1 and 4.
+    explicit GenerationScheduler(size_t workerCount = 0);
+    ~GenerationScheduler();
+
+    GenerationScheduler(const GenerationScheduler&) = delete;
+    GenerationScheduler& operator=(const GenerationScheduler&) = delete;
+
+    /// Queue generation for a copy of equation (its current geometry is not copied).
+    void submit(const Equation& equation, const GenerationOptions& options);
+
+    /// Drop queued work, pending results and the sample cache of the equation and cancel its
+    /// running job.
+    void cancel(uint64_t equationId);
+
+    /// Results finished since the last call, oldest first. At most one per equation: the
+    /// finest level completed so far.
+    std::vector<GenerationResult> takeResults();
+
+    /// Whether any job is queued or running.
+    bool isBusy() const;
+
+    /// Block until no job is queued or running.
+    void waitIdle();
+
+    size_t getWorkerCount() const { return workers_.size(); }
+
+private:
+    struct Job {
+        Equation equation;
+        GenerationOptions options;
+        uint64_t sequence;
+        std::shared_ptr<CancellationToken> token;
+    };
+
+    struct RunningJob {
+        uint64_t equationId;
+        std::string expression;
+        bool is3D;
+        std::shared_ptr<CancellationToken> token;
+        size_t threads; // hardware threads claimed from freeThreads_
+    };
+
+    mutable std::mutex mutex_;
+    std::condition_variable workAvailable_;
+    std::condition_variable idle_;
+    std::deque<Job> queue_;
+    std::vector<RunningJob> running_;
+    std::unordered_map<uint64_t, uint64_t> latestSequence_; // equation id -> wanted job
+    std::vector<GenerationResult> results_;
+    // Per-equation caches; a running job holds its equation's cache and leaves null behind.
+    std::unordered_map<uint64_t, std::shared_ptr<SurfaceSampleCache>> sampleCaches_;
+    size_t hardwareThreads_;
+    size_t freeThreads_;
+    uint64_t nextSequence_;
+    bool stopping_;
+    std::vector<std::thread> workers_;
+
+    void workerLoop();
+    // Drop queued jobs and results of the equation and cancel its running job; if next can
+    // reuse that job's samples, the job stops once they are cached. Caller holds mutex_.
+    void discard(uint64_t equationId, const Equation* next = nullptr);
+    // The first queued job whose equation has no running job. Caller holds mutex_.
+    std::deque<Job>::iterator nextRunnable();
+    void publish(const Job& job, GenerationResult&& result); // caller holds mutex_
+    void run(Job& job, EquationParser& parser, EquationGenerator& generator, const SurfaceSampleCache& cache);
+};
+
+} // namespace graphgl
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "range_allocator.h"
+#include <cstddef>
+
+namespace graphgl {
+
+/// An OpenGL buffer handed out in ranges of fixed-size units. Ranges are written with
+/// glBufferSubData; when no free range is large enough the buffer is replaced by one twice
+/// the size and the contents are copied across, so offsets stay valid but the buffer name
+/// changes (vertex arrays that reference it must be rebound).
+class SubAllocatedBuffer {
+public:
+    SubAllocatedBuffer(size_t unitBytes, size_t initialUnits);
+    ~SubAllocatedBuffer();
+
+    SubAllocatedBuffer(const SubAllocatedBuffer&) = delete;
+    SubAllocatedBuffer& operator=(const SubAllocatedBuffer&) = delete;
+
+    /// Offset (in units) of a new range of units, growing the buffer if needed.
+    size_t allocate(size_t units);
+    void release(size_t offset, size_t units);
+
+    /// Copy bytes of data to the buffer at offset (in units).
+    void write(size_t offset, const void* data, size_t bytes) const;
+
+    unsigned int getId() const { return id_; }
+    size_t getUnitBytes() const { return unitBytes_; }
+    const RangeAllocator& getRanges() const { return ranges_; }
+
+private:
+    unsigned int id_;
+    size_t unitBytes_;
+    RangeAllocator ranges_;
+
+    void resize(size_t units);
+};
+
+} // namespace graphgl
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "expression_program.h"
+#include <limits>
+
+namespace graphgl {
+
+/// Bounds of an expression over a box. lo > hi (see undefined()) means the expression is
+/// NaN everywhere in the box; mayBeUndefined means it may be NaN somewhere. Infinite
+/// bounds are allowed.
+struct Interval {
+    double lo = 0.0;
+    double hi = 0.0;
+    bool mayBeUndefined = false;
+
+    static Interval point(double value) { return {value, value, false}; }
+    static Interval of(double lo, double hi) { return {lo, hi, false}; }
+    static Interval undefined() {
+        return {std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity(), true};
+    }
+    static Interval entire() {
+        return {-std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity(), true};
+    }
+
+    /// NaN at every point of the box.
+    bool isUndefined() const { return !(lo <= hi); }
+
+    double width() const { return isUndefined() ? 0.0 : hi - lo; }
+};
+
+/// Bounds of program over x × y. Every operation widens its result to cover float rounding
+/// in the scalar and vectorized evaluators, so point results stay inside the bounds.
+/// registers must hold at least program.size() intervals.
+Interval evaluateInterval(const ExpressionProgram& program, const Interval& x, const Interval& y,
+                          Interval* registers);
+
+} // namespace graphgl
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "shader.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace graphgl {
+
+/// Polylines drawn as anti-aliased quads of a fixed width in pixels, one instance per segment,
+/// all in one instanced draw. Vertices (position/color pairs) are read from a vertex buffer
+/// through a texture buffer, and a table of strips sorted by first segment maps each instance
+/// to its segment, so strips anywhere in the buffer, with any gaps between them, cost no
+/// extra draws. Width does not depend on glLineWidth.
+///
+/// The texture buffer holds six GL_R32F texels per vertex, and GL 3.3 only guarantees
+/// GL_MAX_TEXTURE_BUFFER_SIZE = 65536 texels (packing as GL_RGB32F needs GL 4.0). When the
+/// strips reach past the limit, they are split into windows of vertices that fit; each window
+/// is copied into a buffer of its own and drawn separately, so such scenes take one draw
+/// (and one buffer copy) per window instead of failing to read their vertices.
+class LineBatch {
+public:
+    LineBatch();
+    ~LineBatch();
+
+    LineBatch(const LineBatch&) = delete;
+    LineBatch& operator=(const LineBatch&) = delete;
+
+    /// Read vertices from the buffer object named buffer; call again when the name changes.
+    void setVertexBuffer(unsigned int buffer);
+
+    /// Start a new strip table.
+    void begin();
+
+    /// Draw vertices [firstVertex, firstVertex + count) as a polyline; single vertices are
+    /// skipped.
+    void addStrip(size_t firstVertex, size_t count, float opacity);
+
+    /// Upload the table unless it matches the one already uploaded, splitting it into windows
+    /// when the strips reach past the vertices the texture buffer can address.
+    void end();
+
+    /// Draw every segment with lineShader (line.vs/line.fs), whose matrices are already set.
+    void render(const Shader& lineShader, float width, int viewportWidth, int viewportHeight) const;
+
+    size_t getSegmentCount() const { return segmentCount_; }
+
+    /// Draws a render takes: one, or one per window past the texture buffer limit.
+    size_t getWindowCount() const { return windowed_ ? windows_.size() : (segmentCount_ > 0 ? 1 : 0); }
+
+private:
+    struct Strip {
+        size_t firstVertex;
+        size_t count;
+        uint32_t opacityBits;
+    };
+
+    // Vertices [firstVertex, firstVertex + vertexCount) and the strips drawing from them.
+    struct Window {
+        size_t firstVertex;
+        size_t vertexCount;
+        size_t firstStrip;
+        size_t stripCount;
+        size_t segmentCount;
+
+        bool operator==(const Window& other) const {
+            return firstVertex == other.firstVertex && vertexCount == other.vertexCount &&
+                   firstStrip == other.firstStrip && stripCount == other.stripCount &&
+                   segmentCount == other.segmentCount;
+        }
+    };
+
+    unsigned int VAO_; // no attributes; core profile draws need one bound
+    unsigned int vertexTexture_;
+    unsigned int stripBuffer_;
+    unsigned int stripTexture_;
+    unsigned int vertexBuffer_;
+    unsigned int windowBuffer_;  // created on first need
+    unsigned int windowTexture_;
+    size_t maxVertices_;         // vertices the texture buffer can address
+
+    std::vector<Strip> added_;
+    std::vector<uint32_t> strips_; // as uploaded; four words per strip
+    std::vector<uint32_t> stripScratch_;
+    std::vector<Window> windows_;
+    std::vector<Window> windowScratch_;
+    bool windowed_;
+    size_t segmentCount_;
+    size_t segmentScratch_;
+    size_t vertexEnd_; // one past the last vertex of any strip added
+
+    // Split the added strips into windows of at most maxVertices_ vertices each.
+    void buildWindows();
+};
+
+} // namespace graphgl
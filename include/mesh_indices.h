@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace graphgl {
+
+/// A run of triangle indices: 16-bit offsets from baseVertex, or absolute 32-bit indices for
+/// triangles whose vertices lie 65536 or more apart.
+struct IndexChunk {
+    uint32_t start = 0;      // position of the first index in the whole sequence
+    uint32_t first = 0;      // into MeshIndices::compact, or MeshIndices::wide
+    uint32_t count = 0;
+    uint32_t baseVertex = 0; // added to each 16-bit index
+    bool wide = false;
+
+    bool operator==(const IndexChunk& other) const {
+        return start == other.start && first == other.first && count == other.count &&
+               baseVertex == other.baseVertex && wide == other.wide;
+    }
+};
+
+/// Triangle indices of a mesh, packed into chunks of 16-bit indices that each span fewer than
+/// 65536 vertices. Meshes emit vertices in the order their triangles first use them, so runs
+/// of triangles stay within that span and the index buffer is half the size of a 32-bit one.
+class MeshIndices {
+public:
+    static constexpr uint32_t MAX_CHUNK_SPAN = 0xFFFF;
+
+    /// Pack indices (a multiple of 3), keeping their order.
+    void assign(const std::vector<unsigned int>& indices);
+
+    void clear();
+    bool empty() const { return size_ == 0; }
+    size_t size() const { return size_; }
+
+    /// The index at position i of the original sequence.
+    unsigned int operator[](size_t i) const;
+
+    bool operator==(const MeshIndices& other) const {
+        return size_ == other.size_ && chunks_ == other.chunks_ && compact_ == other.compact_ && wide_ == other.wide_;
+    }
+    bool operator!=(const MeshIndices& other) const { return !(*this == other); }
+
+    const std::vector<IndexChunk>& getChunks() const { return chunks_; }
+    const std::vector<uint16_t>& getCompact() const { return compact_; }
+    const std::vector<unsigned int>& getWide() const { return wide_; }
+
+private:
+    std::vector<IndexChunk> chunks_;
+    std::vector<uint16_t> compact_;
+    std::vector<unsigned int> wide_;
+    size_t size_ = 0;
+};
+
+} // namespace graphgl
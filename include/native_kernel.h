@@ -0,0 +1,99 @@
+#pragma once
+
+#include "expression_program.h"
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace graphgl {
+
+/// Batch entry point of a compiled kernel: out[i] = f(xs[i], ys ? ys[i] : 0).
+using NativeBatchFunction = void (*)(const float* xs, const float* ys, float* out, size_t count);
+
+/// Grid entry point of a compiled kernel: out[row * xCount + col] = f(xs[col], ys[row]).
+using NativeGridFunction = void (*)(const float* xs, size_t xCount, const float* ys, size_t yCount, float* out);
+
+/// Translate a program into a self-contained C++ translation unit that exports
+/// graphgl_kernel_batch and graphgl_kernel_grid with the signatures above.
+/// Every operation matches applyExprOp, including NaN handling of min and max.
+std::string transpileExpression(const ExpressionProgram& program);
+
+/// An expression compiled to machine code, loaded from a shared object. Immutable and
+/// safe to call from any thread; the library stays loaded while the kernel is alive.
+class NativeKernel {
+public:
+    NativeKernel(void* handle, NativeBatchFunction batch, NativeGridFunction grid);
+    ~NativeKernel();
+
+    NativeKernel(const NativeKernel&) = delete;
+    NativeKernel& operator=(const NativeKernel&) = delete;
+
+    void evaluateBatch(const float* xs, const float* ys, float* out, size_t count) const {
+        batch_(xs, ys, out, count);
+    }
+
+    void evaluateGrid(const float* xs, size_t xCount, const float* ys, size_t yCount, float* out) const {
+        grid_(xs, xCount, ys, yCount, out);
+    }
+
+private:
+    void* handle_;
+    NativeBatchFunction batch_;
+    NativeGridFunction grid_;
+};
+
+/// Builds kernels with the system C++ compiler and caches the shared objects on disk under
+/// a hash of the generated source and compiler command, so repeat plots of an expression
+/// load in a few milliseconds instead of invoking the compiler. Thread-safe: the lock is
+/// only held for bookkeeping, so cached kernels stay available while another one builds,
+/// and concurrent requests for the same kernel wait on a single compile.
+class NativeKernelCache {
+public:
+    /// Empty arguments select the defaults: $CXX (or "c++") and
+    /// $XDG_CACHE_HOME/graphgl/kernels (or ~/.cache/graphgl/kernels).
+    explicit NativeKernelCache(std::string directory = "", std::string compiler = "");
+    ~NativeKernelCache();
+
+    NativeKernelCache(const NativeKernelCache&) = delete;
+    NativeKernelCache& operator=(const NativeKernelCache&) = delete;
+
+    const std::string& getDirectory() const { return directory_; }
+    const std::string& getCompiler() const { return compiler_; }
+
+    /// Whether the compiler can be run. Checked once, on first use.
+    bool isCompilerAvailable();
+
+    /// The kernel for program, compiled on a cache miss. Returns null when the kernel cannot
+    /// be built or loaded (no compiler, unsupported platform, ...); see getLastError().
+    std::shared_ptr<const NativeKernel> load(const ExpressionProgram& program);
+
+    /// Number of compiler invocations made by this cache.
+    size_t getCompileCount() const;
+
+    std::string getLastError() const;
+
+private:
+    using KernelFuture = std::shared_future<std::shared_ptr<const NativeKernel>>;
+
+    std::string directory_;
+    std::string compiler_;
+    bool compilerAvailable_;
+    std::once_flag compilerChecked_;
+    size_t compileCount_;
+    std::string lastError_;
+    // Kernels loaded or still being built, by source hash. Failed builds are removed so a
+    // later request tries again.
+    std::unordered_map<uint64_t, KernelFuture> loaded_;
+    mutable std::mutex mutex_;
+
+    std::shared_ptr<const NativeKernel> build(uint64_t hash, const std::string& source, std::string& error);
+    bool compile(const std::string& source, const std::string& sourcePath, const std::string& libraryPath,
+                 std::string& message);
+    std::shared_ptr<const NativeKernel> open(const std::string& libraryPath, std::string& message);
+};
+
+} // namespace graphgl
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "curve_plot.h"
+#include "line_batch.h"
+#include "shader.h"
+#include <cstdint>
+#include <memory>
+
+namespace graphgl {
+
+/// Draws the curves of the 2D plot mode as thick anti-aliased lines.
+class PlotRenderer {
+public:
+    PlotRenderer();
+    ~PlotRenderer();
+
+    PlotRenderer(const PlotRenderer&) = delete;
+    PlotRenderer& operator=(const PlotRenderer&) = delete;
+
+    void initialize();
+
+    /// Upload the curves of plot unless this revision is already uploaded.
+    void update(const CurvePlot& plot);
+
+    /// Draw the curves width pixels wide with lineShader, whose matrices are already set.
+    void render(const Shader& lineShader, float width, int viewportWidth, int viewportHeight) const;
+
+private:
+    unsigned int VBO_;
+    std::unique_ptr<LineBatch> lines_;
+    uint64_t revision_; // of the uploaded curves
+
+    bool initialized_;
+
+    void setupBuffers();
+    void cleanupBuffers();
+};
+
+} // namespace graphgl
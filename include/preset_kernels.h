@@ -0,0 +1,144 @@
+#pragma once
+
+#include "expression_program.h"
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace graphgl {
+
+/// Compile-time expression templates. Each node type is an empty struct with
+///   static float eval(float x, float y)              - the inlined value, and
+///   static uint32_t build(ExpressionProgram& program) - the same tree for the interpreter,
+/// so one definition yields both a native functor and the pattern it is matched against.
+namespace kernels {
+
+struct X {
+    static float eval(float x, float) { return x; }
+    static uint32_t build(ExpressionProgram& program) { return program.addNode(ExprOp::VarX); }
+};
+
+struct Y {
+    static float eval(float, float y) { return y; }
+    static uint32_t build(ExpressionProgram& program) { return program.addNode(ExprOp::VarY); }
+};
+
+/// The constant Num / Den.
+template <int Num, int Den = 1>
+struct Const {
+    static constexpr float value = static_cast<float>(Num) / static_cast<float>(Den);
+    static float eval(float, float) { return value; }
+    static uint32_t build(ExpressionProgram& program) { return program.addNode(ExprOp::Const, 0, 0, value); }
+};
+
+/// Same results as applyExprOp for the operations the presets need.
+template <ExprOp Op>
+inline float apply(float a, float b) {
+    if constexpr (Op == ExprOp::Neg) {
+        return -a;
+    } else if constexpr (Op == ExprOp::Add) {
+        return a + b;
+    } else if constexpr (Op == ExprOp::Sub) {
+        return a - b;
+    } else if constexpr (Op == ExprOp::Mul) {
+        return a * b;
+    } else if constexpr (Op == ExprOp::Div) {
+        return a / b;
+    } else if constexpr (Op == ExprOp::Sin) {
+        return std::sin(a);
+    } else if constexpr (Op == ExprOp::Cos) {
+        return std::cos(a);
+    } else if constexpr (Op == ExprOp::Exp) {
+        return std::exp(a);
+    } else if constexpr (Op == ExprOp::Sqrt) {
+        return std::sqrt(a);
+    } else {
+        static_assert(Op == ExprOp::Abs, "operation not supported by preset kernels");
+        return std::fabs(a);
+    }
+}
+
+template <ExprOp Op, class A>
+struct Unary {
+    static float eval(float x, float y) { return apply<Op>(A::eval(x, y), 0.0f); }
+    static uint32_t build(ExpressionProgram& program) { return program.addNode(Op, A::build(program)); }
+};
+
+template <ExprOp Op, class A, class B>
+struct Binary {
+    static float eval(float x, float y) { return apply<Op>(A::eval(x, y), B::eval(x, y)); }
+    static uint32_t build(ExpressionProgram& program) {
+        const uint32_t lhs = A::build(program);
+        const uint32_t rhs = B::build(program);
+        return program.addNode(Op, lhs, rhs);
+    }
+};
+
+template <class A> using Neg = Unary<ExprOp::Neg, A>;
+template <class A> using Sin = Unary<ExprOp::Sin, A>;
+template <class A> using Cos = Unary<ExprOp::Cos, A>;
+template <class A> using Exp = Unary<ExprOp::Exp, A>;
+template <class A> using Sqrt = Unary<ExprOp::Sqrt, A>;
+template <class A> using Abs = Unary<ExprOp::Abs, A>;
+template <class A, class B> using Add = Binary<ExprOp::Add, A, B>;
+template <class A, class B> using Sub = Binary<ExprOp::Sub, A, B>;
+template <class A, class B> using Mul = Binary<ExprOp::Mul, A, B>;
+template <class A, class B> using Div = Binary<ExprOp::Div, A, B>;
+
+/// x^2 after optimization (see optimizeExpression).
+template <class A> using Square = Mul<A, A>;
+
+/// Batch loop over a functor. The body is fully inlined; loops over arithmetic-only
+/// functors auto-vectorize, transcendental ones call libm per lane.
+template <class F>
+void evaluateBatch(const float* xs, const float* ys, float* out, size_t count) {
+    if (ys) {
+        for (size_t i = 0; i < count; ++i) {
+            out[i] = F::eval(xs[i], ys[i]);
+        }
+    } else {
+        for (size_t i = 0; i < count; ++i) {
+            out[i] = F::eval(xs[i], 0.0f);
+        }
+    }
+}
+
+template <class F>
+void evaluateGrid(const float* xs, size_t xCount, const float* ys, size_t yCount, float* out) {
+    for (size_t row = 0; row < yCount; ++row) {
+        const float y = ys ? ys[row] : 0.0f;
+        float* rowOut = out + row * xCount;
+        for (size_t col = 0; col < xCount; ++col) {
+            rowOut[col] = F::eval(xs[col], y);
+        }
+    }
+}
+
+template <class F>
+ExpressionProgram buildProgram() {
+    ExpressionProgram program;
+    F::build(program);
+    return program;
+}
+
+} // namespace kernels
+
+/// A built-in preset with its compile-time specialized kernel.
+struct PresetKernel {
+    const char* name;
+    const char* expression;
+    bool is3D;
+    void (*evaluateBatch)(const float* xs, const float* ys, float* out, size_t count);
+    void (*evaluateGrid)(const float* xs, size_t xCount, const float* ys, size_t yCount, float* out);
+    ExpressionProgram (*buildProgram)();
+};
+
+/// All presets, in UI order.
+const std::vector<PresetKernel>& getPresetKernels();
+
+/// The preset whose expression tree matches an optimized program, or null. Any spelling
+/// that optimizes to the same tree matches (e.g. "x*x" and "x^2").
+const PresetKernel* findPresetKernel(const ExpressionProgram& program);
+
+} // namespace graphgl
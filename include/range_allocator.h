@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+
+namespace graphgl {
+
+/// First-fit allocator of ranges in a buffer of a given capacity (in any unit). Freed ranges
+/// are merged with free neighbours, so a range released and allocated again at the same size
+/// lands where it was as long as nothing else took the space.
+class RangeAllocator {
+public:
+    static constexpr size_t NO_SPACE = static_cast<size_t>(-1);
+
+    explicit RangeAllocator(size_t capacity = 0);
+
+    /// Offset of a free range of size units, or NO_SPACE. Empty ranges are at offset 0.
+    size_t allocate(size_t size);
+
+    /// Return a range from allocate.
+    void release(size_t offset, size_t size);
+
+    /// Extend the capacity; the new space is free.
+    void grow(size_t capacity);
+
+    size_t getCapacity() const { return capacity_; }
+    size_t getUsed() const { return used_; }
+    size_t getFreeRanges() const { return free_.size(); }
+
+private:
+    std::map<size_t, size_t> free_; // offset -> size, never adjacent
+    size_t capacity_;
+    size_t used_;
+
+    void insertFree(size_t offset, size_t size);
+};
+
+} // namespace graphgl
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace graphgl {
+
+/// Right-triangulated irregular network over a square height lattice of 2^k + 1 samples per
+/// side (after Martini). Every triangle is split at the midpoint of its hypotenuse. The error
+/// stored at a midpoint is the largest deviation of the lattice from the planes of the two
+/// triangles on that hypotenuse and of all triangles below them, so any error threshold
+/// yields a crack-free mesh whose triangles stay within it.
+class RtinMesh {
+public:
+    /// Compute split errors for a row-major gridSize × gridSize table (index row * gridSize + col).
+    /// gridSize must be 2^k + 1 with k >= 1. Triangles that cover both finite and non-finite
+    /// heights have infinite error, so domain edges refine to the finest level.
+    /// xs and ys optionally place the columns and rows (non-decreasing, gridSize each); errors
+    /// are then measured against the triangles at those positions. Repeated positions collapse
+    /// cells to zero width, which lets a smaller grid be padded out to the lattice.
+    void build(const float* heights, uint32_t gridSize, const float* xs = nullptr, const float* ys = nullptr);
+
+    uint32_t getGridSize() const { return gridSize_; }
+
+    /// Split error per lattice sample (0 for corners and samples that are never midpoints).
+    const std::vector<float>& getErrors() const { return errors_; }
+
+    /// Replace the infinite errors of triangles across domain edges with base × (1 + s), where
+    /// s is the size in cells of the triangle's legs. base must be at least every finite
+    /// error. Thresholds above base then coarsen the edges too, by more as they grow; errors
+    /// still shrink down the hierarchy, so meshes stay crack-free.
+    void limitUndefinedErrors(float base);
+
+    /// Append the leaf triangles for maxError to triangles as lattice indices, three per
+    /// triangle. Triangles are split while the error at their midpoint exceeds maxError;
+    /// a negative maxError yields the full lattice.
+    void extractTriangles(float maxError, std::vector<uint32_t>& triangles) const;
+
+    /// extractTriangles for the aligned square of size cells with corner (x, y) alone. size is
+    /// a power of two and x, y are multiples of it; the square is then the union of two
+    /// triangles of the hierarchy, which are split as extractTriangles would. Returns the
+    /// largest split error of the emitted triangles, i.e. the error of the square's mesh.
+    float extractSquare(uint32_t x, uint32_t y, uint32_t size, float maxError,
+                        std::vector<uint32_t>& triangles) const;
+
+private:
+    uint32_t gridSize_ = 0;
+    std::vector<float> errors_;
+
+    // Emit the leaves of triangle (a, b, c) for maxError; returns their largest split error.
+    float collect(uint32_t ax, uint32_t ay, uint32_t bx, uint32_t by, uint32_t cx, uint32_t cy,
+                  float maxError, std::vector<uint32_t>& triangles) const;
+};
+
+} // namespace graphgl
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "expression_program.h"
+#include "simd_evaluator.h"
+#include <memory>
+#include <vector>
+#include <cstddef>
+
+namespace graphgl {
+
+/// A surface expression that splits into a pure-x and a pure-y factor:
+/// f(x, y) = X(x) + Y(y) or f(x, y) = X(x) * Y(y). A grid of n × m samples then costs
+/// n + m expression evaluations plus one combine pass instead of n * m evaluations.
+class SeparableExpression {
+public:
+    SeparableExpression(ExprOp combine, ExpressionProgram xPart, ExpressionProgram yPart);
+
+    /// Detect additive separability (top-level sums and differences whose terms each
+    /// depend on at most one variable), then multiplicative separability (products and
+    /// quotients of such factors). Returns null when some term mixes x and y.
+    /// Terms may be regrouped, so results can differ from direct evaluation in the last bit.
+    static std::unique_ptr<const SeparableExpression> detect(const ExpressionProgram& program);
+
+    /// ExprOp::Add or ExprOp::Mul.
+    ExprOp getCombineOp() const { return combine_; }
+
+    /// The x factor. Empty when the expression does not depend on x.
+    const ExpressionProgram& getXPart() const { return xPart_; }
+
+    /// The y factor. Empty when the expression does not depend on y.
+    const ExpressionProgram& getYPart() const { return yPart_; }
+
+    /// Floats of SIMD scratch evaluateGrid needs.
+    size_t getScratchSize() const;
+
+    /// Evaluate the tensor grid xs × ys into a row-major matrix. axisValues is resized to hold
+    /// the two 1D factors.
+    void evaluateGrid(const float* xs, size_t xCount, const float* ys, size_t yCount, float* out,
+                      float* scratch, std::vector<float>& axisValues) const;
+
+private:
+    ExprOp combine_;
+    ExpressionProgram xPart_;
+    ExpressionProgram yPart_;
+    SimdEvaluator xSimd_;
+    SimdEvaluator ySimd_;
+};
+
+} // namespace graphgl
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <string>
 #include <limits>
 #include <cfloat>
@@ -15,8 +16,18 @@ public:
     // Rendering settings
     static constexpr float DEFAULT_MAX_VIEW_DISTANCE = 250.0f;
     static constexpr float DEFAULT_POINT_SIZE = 1.0f;
+    static constexpr float DEFAULT_LINE_WIDTH = 2.0f;
     static constexpr int DEFAULT_MAX_DEPTH = 6;
     static constexpr double DEFAULT_DERIVATIVE_THRESHOLD = 5.0;
+    static constexpr bool DEFAULT_USE_NATIVE_KERNELS = false;
+    static constexpr bool DEFAULT_USE_SAMPLE_BUDGET = false;
+    static constexpr bool DEFAULT_USE_ANGLE_REFINEMENT = false;
+    static constexpr double DEFAULT_ANGLE_TOLERANCE = 2.0;
+    static constexpr double MIN_ANGLE_TOLERANCE = 0.1; // 0 would split every segment to maxDepth
+    static constexpr double MAX_ANGLE_TOLERANCE = 90.0;
+    static constexpr bool DEFAULT_USE_SURFACE_LOD = false;
+    static constexpr float DEFAULT_LOD_PIXEL_TOLERANCE = 1.0f;
+    static constexpr bool DEFAULT_PLOT_MODE_2D = false;
     
     // Domain settings
     static constexpr float DEFAULT_MIN_X = -100.0f;
@@ -45,6 +56,10 @@ public:
     
     float getPointSize() const { return pointSize_; }
     void setPointSize(float size) { pointSize_ = size; }
+
+    // Width in pixels of curves and non-mesh surfaces.
+    float getLineWidth() const { return lineWidth_; }
+    void setLineWidth(float width) { lineWidth_ = width; }
     
     int getMaxDepth() const { return maxDepth_; }
     void setMaxDepth(int depth) { maxDepth_ = depth; }
@@ -52,6 +67,33 @@ public:
     double getDerivativeThreshold() const { return derivativeThreshold_; }
     void setDerivativeThreshold(double threshold) { derivativeThreshold_ = threshold; }
 
+    // Compile equations to machine code with the system compiler (cached on disk).
+    bool getUseNativeKernels() const { return useNativeKernels_; }
+    void setUseNativeKernels(bool use) { useNativeKernels_ = use; }
+
+    // Limit each equation to its sample size in vertices, spending them where the error is largest.
+    bool getUseSampleBudget() const { return useSampleBudget_; }
+    void setUseSampleBudget(bool use) { useSampleBudget_ = use; }
+
+    // Refine curves by turning angle (degrees, domain-normalized) instead of the derivative threshold.
+    bool getUseAngleRefinement() const { return useAngleRefinement_; }
+    void setUseAngleRefinement(bool use) { useAngleRefinement_ = use; }
+    double getAngleTolerance() const { return angleTolerance_; }
+    // Clamped to [MIN_ANGLE_TOLERANCE, MAX_ANGLE_TOLERANCE]; NaN gives the minimum.
+    void setAngleTolerance(double degrees) {
+        angleTolerance_ = degrees >= MIN_ANGLE_TOLERANCE ? std::min(degrees, MAX_ANGLE_TOLERANCE) : MIN_ANGLE_TOLERANCE;
+    }
+
+    // Mesh surfaces in chunks whose detail follows the camera, within a screen-space error in pixels.
+    bool getUseSurfaceLod() const { return useSurfaceLod_; }
+    void setUseSurfaceLod(bool use) { useSurfaceLod_ = use; }
+    float getLodPixelTolerance() const { return lodPixelTolerance_; }
+    void setLodPixelTolerance(float pixels) { lodPixelTolerance_ = pixels; }
+
+    // Plot 2D curves in an orthographic pan/zoom view, sampled for the visible x range.
+    bool getPlotMode2D() const { return plotMode2D_; }
+    void setPlotMode2D(bool enabled) { plotMode2D_ = enabled; }
+
     // Domain settings
     float getMinX() const { return minX_; }
     float getMaxX() const { return maxX_; }
@@ -89,8 +131,16 @@ private:
     
     float maxViewDistance_;
     float pointSize_;
+    float lineWidth_;
     int maxDepth_;
     double derivativeThreshold_;
+    bool useNativeKernels_;
+    bool useSampleBudget_;
+    bool useAngleRefinement_;
+    double angleTolerance_;
+    bool useSurfaceLod_;
+    float lodPixelTolerance_;
+    bool plotMode2D_;
     
     float minX_;
     float maxX_;
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "expression_program.h"
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace graphgl {
+
+/// Instruction sets the vectorized interpreter can run on.
+enum class SimdLevel {
+    Scalar,
+    Sse41,
+    Avx2
+};
+
+/// One register-machine instruction: dst = op(lhs, rhs).
+struct SimdInstruction {
+    ExprOp op;
+    uint16_t dst;
+    uint16_t lhs;
+    uint16_t rhs;
+};
+
+/// Plain view of lowered bytecode handed to the per-ISA kernels.
+struct SimdKernelArgs {
+    const SimdInstruction* instructions;
+    size_t instructionCount;
+    size_t uniformCount; // leading instructions that do not read x
+    const float* constants;
+    size_t constantCount;
+    uint16_t result;
+    float* registers; // registerCount * kSimdBlockSize floats, 32-byte aligned
+};
+
+// Every instruction is applied to a block of this many samples before moving on.
+constexpr size_t kSimdBlockSize = 64;
+
+// Register layout: x, y, then the constant pool, then temporaries.
+constexpr uint16_t kSimdRegisterX = 0;
+constexpr uint16_t kSimdRegisterY = 1;
+constexpr uint16_t kSimdFirstConstant = 2;
+
+/// Evaluate count samples. When ys is null every sample uses yValue and the leading
+/// uniform instructions run once per call instead of once per block.
+void runSimdKernelScalar(const SimdKernelArgs& args, const float* xs, const float* ys, float yValue,
+                         float* out, size_t count);
+void runSimdKernelSse41(const SimdKernelArgs& args, const float* xs, const float* ys, float yValue,
+                        float* out, size_t count);
+void runSimdKernelAvx2(const SimdKernelArgs& args, const float* xs, const float* ys, float yValue,
+                       float* out, size_t count);
+
+/// Register bytecode lowered from an ExpressionProgram and run over 8 (AVX2) or 4 (SSE4.1)
+/// lanes at a time, with a scalar fallback. Immutable after construction; callers supply
+/// the register file so one evaluator can be shared between threads.
+class SimdEvaluator {
+public:
+    explicit SimdEvaluator(const ExpressionProgram& program);
+
+    /// Best instruction set supported by the running CPU.
+    static SimdLevel detectLevel();
+    static const char* getLevelName(SimdLevel level);
+
+    /// False when the program could not be lowered (empty or too many registers).
+    bool isValid() const { return registerCount_ != 0; }
+
+    SimdLevel getLevel() const { return level_; }
+
+    /// Force an instruction set (clamped to what the CPU supports). Used by tests and benchmarks.
+    void setLevel(SimdLevel level);
+
+    /// Floats of scratch a caller must provide to evaluateBatch/evaluateGrid.
+    size_t getScratchSize() const;
+
+    size_t getInstructionCount() const { return instructions_.size(); }
+
+    /// Instructions that only depend on y and constants; evaluateGrid runs them once per row.
+    size_t getUniformInstructionCount() const { return uniformCount_; }
+    size_t getRegisterCount() const { return registerCount_; }
+
+    /// Evaluate count (xs[i], ys[i]) pairs. ys may be null, in which case y = 0.
+    void evaluateBatch(const float* xs, const float* ys, float* out, size_t count, float* scratch) const;
+
+    /// Evaluate the tensor grid xs × ys into a row-major matrix.
+    void evaluateGrid(const float* xs, size_t xCount, const float* ys, size_t yCount, float* out,
+                      float* scratch) const;
+
+private:
+    std::vector<SimdInstruction> instructions_;
+    std::vector<float> constants_;
+    size_t uniformCount_;
+    uint16_t registerCount_;
+    uint16_t result_;
+    SimdLevel level_;
+
+    SimdKernelArgs makeArgs(float* scratch) const;
+    void run(const SimdKernelArgs& args, const float* xs, const float* ys, float yValue, float* out,
+             size_t count) const;
+};
+
+} // namespace graphgl
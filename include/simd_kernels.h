@@ -0,0 +1,333 @@
+#pragma once
+
+// Shared body of the vectorized bytecode interpreter. Only the per-ISA translation
+// units (simd_kernels_*.cpp) include this file; each is compiled with matching -m flags
+// and instantiates runSimdKernel with an Ops type from an anonymous namespace, so the
+// instantiations never leak into code that must run on older CPUs. Every function in
+// this header must therefore be a template on Ops: a plain inline function would be
+// emitted as a weak symbol by each ISA unit and the linker would keep only one copy.
+//
+// Ops provides a float vector F, an int vector I, kLanes, and the primitives used below.
+// The transcendental functions follow the single-precision Cephes routines.
+
+#include "simd_evaluator.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace graphgl {
+namespace simd {
+
+template <typename Ops>
+inline typename Ops::F signMask() {
+    return Ops::casti2f(Ops::set1i(static_cast<int>(0x80000000u)));
+}
+
+template <typename Ops>
+inline typename Ops::F neg(typename Ops::F a) {
+    return Ops::xor_(a, signMask<Ops>());
+}
+
+template <typename Ops>
+inline typename Ops::F abs(typename Ops::F a) {
+    return Ops::andnot(signMask<Ops>(), a);
+}
+
+/// exp(x) = 2^n * exp(r) with |r| <= ln(2)/2. 2^n is applied in two halves so results
+/// stay correct down into the denormal range.
+template <typename Ops>
+inline typename Ops::F exp(typename Ops::F x) {
+    using F = typename Ops::F;
+    using I = typename Ops::I;
+
+    const F input = x;
+    x = Ops::min(Ops::max(x, Ops::set1(-103.0f)), Ops::set1(88.7228394f));
+
+    const F n = Ops::floor(Ops::fmadd(x, Ops::set1(1.44269504088896341f), Ops::set1(0.5f)));
+    x = Ops::sub(x, Ops::mul(n, Ops::set1(0.693359375f)));
+    x = Ops::sub(x, Ops::mul(n, Ops::set1(-2.12194440e-4f)));
+
+    F p = Ops::set1(1.9875691500e-4f);
+    p = Ops::fmadd(p, x, Ops::set1(1.3981999507e-3f));
+    p = Ops::fmadd(p, x, Ops::set1(8.3334519073e-3f));
+    p = Ops::fmadd(p, x, Ops::set1(4.1665795894e-2f));
+    p = Ops::fmadd(p, x, Ops::set1(1.6666665459e-1f));
+    p = Ops::fmadd(p, x, Ops::set1(5.0000001201e-1f));
+    p = Ops::fmadd(p, Ops::mul(x, x), Ops::add(x, Ops::set1(1.0f)));
+
+    const I ni = Ops::cvtt(n);
+    const I half = Ops::template srai<1>(ni);
+    const I rest = Ops::subi(ni, half);
+    const I bias = Ops::set1i(127);
+    const F scaleA = Ops::casti2f(Ops::template slli<23>(Ops::addi(half, bias)));
+    const F scaleB = Ops::casti2f(Ops::template slli<23>(Ops::addi(rest, bias)));
+    F result = Ops::mul(Ops::mul(p, scaleA), scaleB);
+
+    result = Ops::blend(Ops::cmpgt(input, Ops::set1(88.7228394f)), Ops::set1(__builtin_inff()), result);
+    result = Ops::blend(Ops::cmplt(input, Ops::set1(-103.0f)), Ops::set1(0.0f), result);
+    return Ops::blend(Ops::isnan(input), input, result);
+}
+
+/// Natural logarithm. Negative inputs give NaN, zero gives -inf.
+template <typename Ops>
+inline typename Ops::F log(typename Ops::F x) {
+    using F = typename Ops::F;
+    using I = typename Ops::I;
+
+    const F input = x;
+
+    // Scale denormals into the normal range.
+    const F denormal = Ops::cmplt(x, Ops::set1(1.17549435e-38f));
+    x = Ops::blend(denormal, Ops::mul(x, Ops::set1(8388608.0f)), x);
+    F exponentBias = Ops::blend(denormal, Ops::set1(23.0f), Ops::set1(0.0f));
+
+    const I bits = Ops::castf2i(x);
+    F e = Ops::cvt(Ops::subi(Ops::template srli<23>(bits), Ops::set1i(126)));
+    e = Ops::sub(e, exponentBias);
+    F m = Ops::casti2f(Ops::ori(Ops::andi(bits, Ops::set1i(0x007fffff)), Ops::set1i(0x3f000000)));
+
+    // Keep the mantissa in [sqrt(1/2), sqrt(2)) so the polynomial argument stays small.
+    const F small = Ops::cmplt(m, Ops::set1(0.707106781186547524f));
+    e = Ops::sub(e, Ops::and_(small, Ops::set1(1.0f)));
+    m = Ops::sub(Ops::add(m, Ops::and_(small, m)), Ops::set1(1.0f));
+
+    const F z = Ops::mul(m, m);
+    F y = Ops::set1(7.0376836292e-2f);
+    y = Ops::fmadd(y, m, Ops::set1(-1.1514610310e-1f));
+    y = Ops::fmadd(y, m, Ops::set1(1.1676998740e-1f));
+    y = Ops::fmadd(y, m, Ops::set1(-1.2420140846e-1f));
+    y = Ops::fmadd(y, m, Ops::set1(1.4249322787e-1f));
+    y = Ops::fmadd(y, m, Ops::set1(-1.6668057665e-1f));
+    y = Ops::fmadd(y, m, Ops::set1(2.0000714765e-1f));
+    y = Ops::fmadd(y, m, Ops::set1(-2.4999993993e-1f));
+    y = Ops::fmadd(y, m, Ops::set1(3.3333331174e-1f));
+    y = Ops::mul(Ops::mul(y, m), z);
+    y = Ops::fmadd(e, Ops::set1(-2.12194440e-4f), y);
+    y = Ops::fmadd(z, Ops::set1(-0.5f), y);
+    F result = Ops::fmadd(e, Ops::set1(0.693359375f), Ops::add(m, y));
+
+    result = Ops::blend(Ops::cmpeq(input, Ops::set1(__builtin_inff())), input, result);
+    result = Ops::blend(Ops::cmpeq(input, Ops::set1(0.0f)), Ops::set1(-__builtin_inff()), result);
+    result = Ops::blend(Ops::cmplt(input, Ops::set1(0.0f)), Ops::set1(__builtin_nanf("")), result);
+    return Ops::blend(Ops::isnan(input), input, result);
+}
+
+/// Lanes whose argument is too large (or not finite) for the single-step range reduction.
+template <typename Ops>
+inline typename Ops::F trigOutOfRange(typename Ops::F x) {
+    return Ops::cmpnle(abs<Ops>(x), Ops::set1(8192.0f));
+}
+
+/// sin(x) or cos(x) for |x| <= 8192.
+template <typename Ops, bool Cosine>
+inline typename Ops::F sincos(typename Ops::F x) {
+    using F = typename Ops::F;
+    using I = typename Ops::I;
+
+    F sign = Cosine ? Ops::set1(0.0f) : Ops::and_(x, signMask<Ops>());
+    x = abs<Ops>(x);
+
+    I j = Ops::cvtt(Ops::mul(x, Ops::set1(1.27323954473516f)));
+    j = Ops::andi(Ops::addi(j, Ops::set1i(1)), Ops::set1i(~1));
+    const F y = Ops::cvt(j);
+    if (Cosine) {
+        j = Ops::subi(j, Ops::set1i(2));
+        sign = Ops::casti2f(Ops::template slli<29>(Ops::andnoti(j, Ops::set1i(4))));
+    } else {
+        sign = Ops::xor_(sign, Ops::casti2f(Ops::template slli<29>(Ops::andi(j, Ops::set1i(4)))));
+    }
+    const F useSinPoly = Ops::casti2f(Ops::cmpeqi(Ops::andi(j, Ops::set1i(2)), Ops::set1i(0)));
+
+    x = Ops::fmadd(y, Ops::set1(-0.78515625f), x);
+    x = Ops::fmadd(y, Ops::set1(-2.4187564849853515625e-4f), x);
+    x = Ops::fmadd(y, Ops::set1(-3.77489497744594108e-8f), x);
+    const F z = Ops::mul(x, x);
+
+    F cosPoly = Ops::set1(2.443315711809948e-5f);
+    cosPoly = Ops::fmadd(cosPoly, z, Ops::set1(-1.388731625493765e-3f));
+    cosPoly = Ops::fmadd(cosPoly, z, Ops::set1(4.166664568298827e-2f));
+    cosPoly = Ops::mul(Ops::mul(cosPoly, z), z);
+    cosPoly = Ops::fmadd(z, Ops::set1(-0.5f), cosPoly);
+    cosPoly = Ops::add(cosPoly, Ops::set1(1.0f));
+
+    F sinPoly = Ops::set1(-1.9515295891e-4f);
+    sinPoly = Ops::fmadd(sinPoly, z, Ops::set1(8.3321608736e-3f));
+    sinPoly = Ops::fmadd(sinPoly, z, Ops::set1(-1.6666654611e-1f));
+    sinPoly = Ops::fmadd(Ops::mul(sinPoly, z), x, x);
+
+    return Ops::xor_(Ops::blend(useSinPoly, sinPoly, cosPoly), sign);
+}
+
+/// a^b for exponents that are whole numbers with |b| <= 64, by repeated squaring.
+/// Matches ExprTk, which also expands integer powers into multiplications.
+template <typename Ops>
+inline typename Ops::F powInteger(typename Ops::F a, typename Ops::F b) {
+    using F = typename Ops::F;
+    using I = typename Ops::I;
+
+    const I e = Ops::cvtt(abs<Ops>(b));
+    F result = Ops::set1(1.0f);
+    F base = a;
+    for (int bit = 1; bit <= 64; bit <<= 1) {
+        const F take = Ops::casti2f(Ops::cmpeqi(Ops::andi(e, Ops::set1i(bit)), Ops::set1i(bit)));
+        result = Ops::blend(take, Ops::mul(result, base), result);
+        base = Ops::mul(base, base);
+    }
+    return Ops::blend(Ops::cmplt(b, Ops::set1(0.0f)), Ops::div(Ops::set1(1.0f), result), result);
+}
+
+template <typename Ops>
+inline typename Ops::F isSmallInteger(typename Ops::F b) {
+    return Ops::and_(Ops::cmpeq(Ops::trunc(b), b), Ops::cmple(abs<Ops>(b), Ops::set1(64.0f)));
+}
+
+/// General a^b via exp(b * log|a|), with the sign and special cases of std::pow.
+template <typename Ops>
+inline typename Ops::F pow(typename Ops::F a, typename Ops::F b) {
+    using F = typename Ops::F;
+    using I = typename Ops::I;
+
+    F result = exp<Ops>(Ops::mul(b, log<Ops>(abs<Ops>(a))));
+
+    const F negative = Ops::cmplt(a, Ops::set1(0.0f));
+    const F integer = Ops::cmpeq(Ops::trunc(b), b);
+    const I odd = Ops::andi(Ops::cvtt(b), Ops::set1i(1));
+    const F oddInteger = Ops::and_(integer, Ops::casti2f(Ops::cmpeqi(odd, Ops::set1i(1))));
+
+    result = Ops::xor_(result, Ops::and_(Ops::and_(negative, oddInteger), signMask<Ops>()));
+    result = Ops::blend(Ops::andnot(integer, negative), Ops::set1(__builtin_nanf("")), result);
+
+    const F one = Ops::set1(1.0f);
+    result = Ops::blend(Ops::cmpeq(a, one), one, result);
+    return Ops::blend(Ops::cmpeq(b, Ops::set1(0.0f)), one, result);
+}
+
+template <typename Ops>
+inline typename Ops::F round(typename Ops::F a) {
+    using F = typename Ops::F;
+    const F truncated = Ops::trunc(a);
+    const F halfway = Ops::cmpge(abs<Ops>(Ops::sub(a, truncated)), Ops::set1(0.5f));
+    const F step = Ops::or_(Ops::set1(1.0f), Ops::and_(a, signMask<Ops>()));
+    return Ops::add(truncated, Ops::and_(halfway, step));
+}
+
+template <typename Ops>
+inline typename Ops::F sgn(typename Ops::F a) {
+    using F = typename Ops::F;
+    const F positive = Ops::and_(Ops::cmpgt(a, Ops::set1(0.0f)), Ops::set1(1.0f));
+    const F negative = Ops::and_(Ops::cmplt(a, Ops::set1(0.0f)), Ops::set1(-1.0f));
+    return Ops::or_(positive, negative);
+}
+
+/// Apply a scalar operation lane by lane over a whole block. Templated on Ops like
+/// everything else here so each ISA translation unit keeps its own copy.
+template <typename Ops>
+inline void applyScalarBlock(ExprOp op, const float* lhs, const float* rhs, float* dst) {
+    for (size_t i = 0; i < kSimdBlockSize; ++i) {
+        dst[i] = applyExprOp(op, lhs[i], rhs[i]);
+    }
+}
+
+template <typename Ops>
+inline void executeInstruction(const SimdInstruction& ins, float* registers) {
+    using F = typename Ops::F;
+    constexpr size_t W = Ops::kLanes;
+
+    const float* lhs = registers + ins.lhs * kSimdBlockSize;
+    const float* rhs = registers + ins.rhs * kSimdBlockSize;
+    float* dst = registers + ins.dst * kSimdBlockSize;
+
+    for (size_t i = 0; i < kSimdBlockSize; i += W) {
+        const F a = Ops::load(lhs + i);
+        const F b = Ops::load(rhs + i);
+        F r;
+        switch (ins.op) {
+            case ExprOp::Neg:   r = neg<Ops>(a); break;
+            case ExprOp::Add:   r = Ops::add(a, b); break;
+            case ExprOp::Sub:   r = Ops::sub(a, b); break;
+            case ExprOp::Mul:   r = Ops::mul(a, b); break;
+            case ExprOp::Div:   r = Ops::div(a, b); break;
+            case ExprOp::Min:   r = Ops::min(a, b); break;
+            case ExprOp::Max:   r = Ops::max(a, b); break;
+            case ExprOp::Sqrt:  r = Ops::sqrt(a); break;
+            case ExprOp::Abs:   r = abs<Ops>(a); break;
+            case ExprOp::Floor: r = Ops::floor(a); break;
+            case ExprOp::Ceil:  r = Ops::ceil(a); break;
+            case ExprOp::Trunc: r = Ops::trunc(a); break;
+            case ExprOp::Round: r = round<Ops>(a); break;
+            case ExprOp::Sgn:   r = sgn<Ops>(a); break;
+            case ExprOp::Exp:   r = exp<Ops>(a); break;
+            case ExprOp::Log:   r = log<Ops>(a); break;
+            case ExprOp::Log10: r = Ops::mul(log<Ops>(a), Ops::set1(0.434294481903251828f)); break;
+            case ExprOp::Log2:  r = Ops::mul(log<Ops>(a), Ops::set1(1.44269504088896341f)); break;
+            case ExprOp::Pow:
+                r = Ops::all(isSmallInteger<Ops>(b)) ? powInteger<Ops>(a, b) : pow<Ops>(a, b);
+                break;
+            case ExprOp::Sin:
+            case ExprOp::Cos:
+                if (Ops::any(trigOutOfRange<Ops>(a))) {
+                    for (size_t lane = 0; lane < W; ++lane) {
+                        dst[i + lane] = applyExprOp(ins.op, lhs[i + lane]);
+                    }
+                    continue;
+                }
+                r = (ins.op == ExprOp::Sin) ? sincos<Ops, false>(a) : sincos<Ops, true>(a);
+                break;
+            default:
+                // No vector implementation; finish the block one lane at a time.
+                applyScalarBlock<Ops>(ins.op, lhs, rhs, dst);
+                return;
+        }
+        Ops::store(dst + i, r);
+    }
+}
+
+template <typename Ops>
+inline void runSimdKernel(const SimdKernelArgs& args, const float* xs, const float* ys, float yValue,
+                          float* out, size_t count) {
+    float* registers = args.registers;
+    float* xReg = registers + kSimdRegisterX * kSimdBlockSize;
+    float* yReg = registers + kSimdRegisterY * kSimdBlockSize;
+    const float* result = registers + args.result * kSimdBlockSize;
+
+    for (size_t c = 0; c < args.constantCount; ++c) {
+        float* reg = registers + (kSimdFirstConstant + c) * kSimdBlockSize;
+        for (size_t i = 0; i < kSimdBlockSize; i += Ops::kLanes) {
+            Ops::store(reg + i, Ops::set1(args.constants[c]));
+        }
+    }
+    // With a single y the leading y-only instructions give the same value in every
+    // block, so they run once up front.
+    size_t first = 0;
+    if (!ys) {
+        for (size_t i = 0; i < kSimdBlockSize; i += Ops::kLanes) {
+            Ops::store(yReg + i, Ops::set1(yValue));
+        }
+        for (; first < args.uniformCount; ++first) {
+            executeInstruction<Ops>(args.instructions[first], registers);
+        }
+    }
+
+    for (size_t base = 0; base < count; base += kSimdBlockSize) {
+        const size_t n = (count - base < kSimdBlockSize) ? count - base : kSimdBlockSize;
+
+        // A short final block is padded with its last sample.
+        for (size_t i = 0; i < kSimdBlockSize; ++i) {
+            const size_t src = base + (i < n ? i : n - 1);
+            xReg[i] = xs[src];
+            if (ys) {
+                yReg[i] = ys[src];
+            }
+        }
+
+        for (size_t k = first; k < args.instructionCount; ++k) {
+            executeInstruction<Ops>(args.instructions[k], registers);
+        }
+
+        for (size_t i = 0; i < n; ++i) {
+            out[base + i] = result[i];
+        }
+    }
+}
+
+} // namespace simd
+} // namespace graphgl
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace graphgl {
+
+/// Camera parameters for choosing levels of detail.
+struct LodView {
+    glm::vec3 eye = glm::vec3(0.0f);
+    float pixelsPerUnit = 1.0f;  // viewport height / (2 tan(fovy / 2)): pixels per unit at distance 1
+    float pixelTolerance = 1.0f; // largest on-screen error of a chunk, in pixels
+};
+
+/// A contiguous run of an index or vertex array.
+struct IndexRange {
+    uint32_t first = 0;
+    uint32_t count = 0;
+};
+
+/// One square tile of a chunked surface, meshed at several levels from fine to coarse.
+struct SurfaceChunk {
+    glm::vec3 boundsMin = glm::vec3(0.0f); // of the finest mesh; min > max when it is empty
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+    std::vector<float> errors;          // vertical error of each level's mesh, non-decreasing
+    std::vector<IndexRange> triangles;  // per level
+    std::vector<IndexRange> skirts;     // per level; hang below the chunk's inner borders
+};
+
+/// Chunked levels of detail for a surface mesh. Chunks form a row-major grid of columns × rows
+/// and share the equation's vertices. Each level comes with skirts deep enough to hide the
+/// seam against a neighbour one level coarser, so levels are chosen per frame with
+/// neighbours at most one level apart.
+struct SurfaceLod {
+    uint32_t columns = 0;
+    uint32_t rows = 0;
+    uint32_t levels = 0;
+    std::vector<SurfaceChunk> chunks;
+    std::vector<unsigned int> indices;
+
+    bool empty() const { return chunks.empty(); }
+
+    void clear() {
+        columns = rows = levels = 0;
+        chunks.clear();
+        indices.clear();
+    }
+
+    /// Level of each chunk for view: the coarsest whose error projects to at most the pixel
+    /// tolerance from the nearest point of the chunk, then refined until neighbouring chunks
+    /// are at most one level apart.
+    void selectLevels(const LodView& view, std::vector<uint8_t>& selected) const;
+
+    /// Append the triangles and skirts of every chunk at its selected level, offset by
+    /// baseVertex.
+    void appendIndices(const std::vector<uint8_t>& selected, unsigned int baseVertex,
+                       std::vector<unsigned int>& out) const;
+};
+
+} // namespace graphgl
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "expression_program.h"
+
+namespace graphgl {
+
+/// Structure of a surface expression that is proved from its expression tree and lets
+/// EquationGenerator fill a grid from far fewer evaluations.
+class SurfaceSymmetry {
+public:
+    /// Analyze an optimized 3D program (see optimizeExpression).
+    static SurfaceSymmetry analyze(const ExpressionProgram& program);
+
+    /// True when f(x, y) = h(r) with r = sqrt(x^2 + y^2). x and y may only appear as
+    /// hypot(x, y) or as x^2 and y^2 with equal signs in the same sum.
+    bool isRadial() const { return !radialProfile_.empty(); }
+
+    /// h(r), with r bound to the program's x variable.
+    const ExpressionProgram& getRadialProfile() const { return radialProfile_; }
+
+    /// Proven period along x (or y), or 0 when none was found. An axis is periodic when
+    /// every use of its variable sits inside sin, cos or tan of an expression affine in it
+    /// and the resulting periods are integer multiples of each other.
+    float getPeriodX() const { return periodX_; }
+    float getPeriodY() const { return periodY_; }
+
+private:
+    ExpressionProgram radialProfile_;
+    float periodX_ = 0.0f;
+    float periodY_ = 0.0f;
+};
+
+} // namespace graphgl
@@ -36,6 +36,8 @@ public:
 
     // Set callbacks for user actions
     void setOnEquationRender(std::function<void(Equation&, size_t)> callback);
+    // Color or opacity changed without needing new geometry.
+    void setOnEquationStyle(std::function<void(Equation&, size_t)> callback);
     void setOnEquationRemove(std::function<void(size_t)> callback);
     void setOnPointRender(std::function<void(Point&, size_t)> callback);
     void setOnPointRemove(std::function<void(size_t)> callback);
@@ -75,6 +77,7 @@ private:
 
     // Callbacks
     std::function<void(Equation&, size_t)> onEquationRender_;
+    std::function<void(Equation&, size_t)> onEquationStyle_;
     std::function<void(size_t)> onEquationRemove_;
     std::function<void(Point&, size_t)> onPointRender_;
     std::function<void(size_t)> onPointRemove_;
@@ -0,0 +1,15 @@
+#version 330 core
+out vec4 FragColor;
+in vec4 lineColor;
+noperspective in float edgeDistance;
+flat in float halfWidth;
+
+void main()
+{
+    // Fraction of the pixel the line covers, fading over the outermost pixel.
+    float coverage = clamp(halfWidth + 0.5 - abs(edgeDistance), 0.0, 1.0);
+    if (coverage <= 0.0) {
+        discard;
+    }
+    FragColor = vec4(lineColor.rgb, lineColor.a * coverage);
+}
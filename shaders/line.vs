@@ -0,0 +1,87 @@
+#version 330 core
+// One instance per line segment; vertices 0-3 of an instance are the corners of its quad.
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+uniform vec2 viewport_size; // pixels
+uniform float line_width;   // pixels
+
+// Six floats per vertex: position, color. Past GL_MAX_TEXTURE_BUFFER_SIZE the batch is drawn
+// in windows, each with its vertices copied to the start of a buffer of their own.
+uniform samplerBuffer line_vertices;
+// (first segment, first vertex, opacity bits, 0) per strip, sorted by first segment; this draw
+// uses strips [line_strip_first, line_strip_first + line_strip_count), numbered from zero.
+uniform usamplerBuffer line_strips;
+uniform int line_strip_first;
+uniform int line_strip_count;
+
+out vec4 lineColor;
+noperspective out float edgeDistance; // signed pixels from the centre line
+flat out float halfWidth;
+
+vec3 fetchVec3(int index)
+{
+    return vec3(texelFetch(line_vertices, index).r,
+                texelFetch(line_vertices, index + 1).r,
+                texelFetch(line_vertices, index + 2).r);
+}
+
+// Index of the strip holding segment.
+int findStrip(int segment)
+{
+    int lo = line_strip_first;
+    int hi = line_strip_first + line_strip_count - 1;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (int(texelFetch(line_strips, mid).x) <= segment) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return lo;
+}
+
+void main()
+{
+    uvec4 strip = texelFetch(line_strips, findStrip(gl_InstanceID));
+    int vertex = int(strip.y) + gl_InstanceID - int(strip.x);
+    int end = gl_VertexID & 1;
+    float side = float(gl_VertexID >> 1) * 2.0 - 1.0;
+
+    mat4 transform = projection * view * model;
+    vec4 a = transform * vec4(fetchVec3(6 * vertex), 1.0);
+    vec4 b = transform * vec4(fetchVec3(6 * (vertex + 1)), 1.0);
+
+    // Clip the segment to the near plane so both ends have a screen position.
+    float da = a.z + a.w;
+    float db = b.z + b.w;
+    if (da < 0.0 && db < 0.0) {
+        gl_Position = vec4(0.0, 0.0, 2.0, 1.0); // behind the camera: outside the clip volume
+        return;
+    }
+    if (da < 0.0) {
+        a = mix(a, b, da / (da - db));
+    } else if (db < 0.0) {
+        b = mix(b, a, db / (db - da));
+    }
+
+    vec2 screenA = a.xy / a.w * 0.5 * viewport_size;
+    vec2 screenB = b.xy / b.w * 0.5 * viewport_size;
+    vec2 direction = screenB - screenA;
+    float len = length(direction);
+    direction = len > 0.0 ? direction / len : vec2(1.0, 0.0);
+    vec2 normal = vec2(-direction.y, direction.x);
+
+    // One pixel beyond the half width holds the anti-aliased edge; extending the ends by as
+    // much covers the joints between segments.
+    halfWidth = 0.5 * line_width;
+    float extent = halfWidth + 1.0;
+    vec4 position = end == 0 ? a : b;
+    vec2 offset = (normal * side + direction * (end == 0 ? -1.0 : 1.0)) * extent;
+    gl_Position = position + vec4(offset / viewport_size * 2.0 * position.w, 0.0, 0.0);
+
+    edgeDistance = side * extent;
+    lineColor = vec4(fetchVec3(6 * (vertex + end) + 3), uintBitsToFloat(strip.z));
+}
@@ -2,14 +2,13 @@
 out vec4 FragColor;
 in vec3 ourColor;
 in float heightY;
+flat in float opacity;
+flat in vec2 heightRange;
 
 uniform vec3 color;
 uniform bool use_line;
 uniform bool use_gridline;
 uniform bool use_heatmap;
-uniform float min_height;
-uniform float max_height;
-uniform float point_opacity;
 
 vec3 computeColor(float value)
 {
@@ -36,14 +35,14 @@ void main()
     }
     else if (use_heatmap) {
         // Guard against zero range to avoid NaN when all vertices share the same height.
-        float range = max_height - min_height;
-        float normalizedHeight = (range > 0.0) ? (heightY - min_height) / range : 0.5;
+        float range = heightRange.y - heightRange.x;
+        float normalizedHeight = (range > 0.0) ? (heightY - heightRange.x) / range : 0.5;
         normalizedHeight = clamp(normalizedHeight, 0.0, 1.0);
         vec3 heatmap_color = computeColor(normalizedHeight);
 
-        FragColor = vec4(heatmap_color, point_opacity);
+        FragColor = vec4(heatmap_color, opacity);
     }
     else {
-        FragColor = vec4(ourColor, point_opacity);
+        FragColor = vec4(ourColor, opacity);
     }
 }
@@ -6,13 +6,51 @@ uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 uniform float point_size;
+uniform float point_opacity;
+uniform float min_height;
+uniform float max_height;
+
+// Per-draw records of a batched draw, two texels each, sorted by first vertex:
+// (first vertex, end vertex, min height bits, max height bits), (r, g, b, opacity bits).
+uniform bool use_draw_records;
+uniform int draw_record_count;
+uniform usamplerBuffer draw_records;
 
 out vec3 ourColor;
 out float heightY;
+flat out float opacity;
+flat out vec2 heightRange;
+
+// Index of the record whose vertex range holds vertex; gl_VertexID includes the base vertex.
+int findRecord(int vertex)
+{
+    int lo = 0;
+    int hi = draw_record_count - 1;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (int(texelFetch(draw_records, 2 * mid).x) <= vertex) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return lo;
+}
 
 void main()
 {
     ourColor = aColor;
+    opacity = point_opacity;
+    heightRange = vec2(min_height, max_height);
+    if (use_draw_records) {
+        int record = findRecord(gl_VertexID);
+        uvec4 range = texelFetch(draw_records, 2 * record);
+        uvec4 style = texelFetch(draw_records, 2 * record + 1);
+        ourColor = uintBitsToFloat(style.rgb);
+        opacity = uintBitsToFloat(style.a);
+        heightRange = uintBitsToFloat(range.zw);
+    }
+
     gl_PointSize = point_size;
     vec4 worldPos = model * vec4(aPos, 1.0);
     heightY = worldPos.y;
@@ -4,17 +4,20 @@
 #include "renderer.h"
 #include "equation_renderer.h"
 #include "grid_renderer.h"
+#include "curve_plot.h"
+#include "plot_renderer.h"
 #include "ui_controller.h"
 #include "settings.h"
 #include "data_manager.h"
-#include "equation_parser.h"
-#include "equation_generator.h"
+#include "generation_scheduler.h"
+#include "native_kernel.h"
 #include "equation.h"
 #include "resource_path.h"
 #include "screenshot.h"
 #include "../lib/imgui/imgui.h"
 #include "../lib/imgui/backends/imgui_impl_glfw.h"
 #include "../lib/imgui/backends/imgui_impl_opengl3.h"
+#include <algorithm>
 #include <iostream>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -25,6 +28,8 @@ namespace graphgl {
 constexpr float kNearPlane = 0.1f;
 constexpr float kDefaultCameraHeight = 6.0f;
 constexpr float kDefaultCameraDistance = 12.0f;
+constexpr double kPlotPanSpeed = 600.0; // pixels per second
+constexpr double kPlotZoomStep = 1.1;   // per scroll notch
 
 Application::Application()
     : window_(nullptr)
@@ -117,6 +122,8 @@ bool Application::initialize(int width, int height, const char* title) {
         std::string vsPath = resolveResourcePath("shaders/shader.vs");
         std::string fsPath = resolveResourcePath("shaders/shader.fs");
         shader_ = std::make_unique<Shader>(vsPath, fsPath);
+        lineShader_ = std::make_unique<Shader>(resolveResourcePath("shaders/line.vs"),
+                                               resolveResourcePath("shaders/line.fs"));
     } catch (const std::exception& e) {
         std::cerr << "Failed to load shaders: " << e.what() << std::endl;
         return false;
@@ -131,6 +138,11 @@ bool Application::initialize(int width, int height, const char* title) {
     gridRenderer_ = std::make_unique<GridRenderer>();
     gridRenderer_->initialize();
 
+    curvePlot_ = std::make_unique<CurvePlot>();
+    plotRenderer_ = std::make_unique<PlotRenderer>();
+    plotRenderer_->initialize();
+    plotView_ = std::make_unique<PlotView>();
+
     uiController_ = std::make_unique<UIController>();
     if (!uiController_->initialize(window_)) {
         std::cerr << "Failed to initialize UI controller" << std::endl;
@@ -138,8 +150,7 @@ bool Application::initialize(int width, int height, const char* title) {
     }
 
     dataManager_ = std::make_unique<DataManager>();
-    equationParser_ = std::make_unique<EquationParser>();
-    equationGenerator_ = std::make_unique<EquationGenerator>();
+    generationScheduler_ = std::make_unique<GenerationScheduler>();
 
     // Set up UI data references
     uiController_->setEquations(&equations_);
@@ -179,6 +190,9 @@ void Application::run() {
         // Process input (before ImGui processes)
         processInput();
 
+        // Swap in geometry generated in the background before anything draws it
+        applyGenerationResults();
+
         // Render (which includes ImGui processing)
         render();
 
@@ -209,6 +223,10 @@ void Application::handleKeyboardInput() {
     if (!camera_) {
         return;
     }
+    if (settings_ && settings_->getPlotMode2D()) {
+        handlePlotKeyboardInput();
+        return;
+    }
 
     // Camera movement keys
     if (glfwGetKey(window_, GLFW_KEY_W) == GLFW_PRESS) {
@@ -240,8 +258,27 @@ void Application::handleKeyboardInput() {
     }
 }
 
+void Application::handlePlotKeyboardInput() {
+    const double step = kPlotPanSpeed * deltaTime_;
+    if (glfwGetKey(window_, GLFW_KEY_W) == GLFW_PRESS) {
+        plotView_->pan(0.0, step);
+    }
+    if (glfwGetKey(window_, GLFW_KEY_S) == GLFW_PRESS) {
+        plotView_->pan(0.0, -step);
+    }
+    if (glfwGetKey(window_, GLFW_KEY_A) == GLFW_PRESS) {
+        plotView_->pan(step, 0.0);
+    }
+    if (glfwGetKey(window_, GLFW_KEY_D) == GLFW_PRESS) {
+        plotView_->pan(-step, 0.0);
+    }
+    if (glfwGetKey(window_, GLFW_KEY_I) == GLFW_PRESS) {
+        plotView_->reset();
+    }
+}
+
 void Application::render() {
-    if (!renderer_ || !shader_ || !camera_ || !settings_) {
+    if (!renderer_ || !shader_ || !lineShader_ || !camera_ || !settings_) {
         return;
     }
 
@@ -280,6 +317,11 @@ void Application::render() {
     glm::mat4 model = glm::mat4(1.0f);
     shader_->setMat4("model", model);
 
+    if (settings_->getPlotMode2D()) {
+        renderPlot();
+        return;
+    }
+
     glm::mat4 projection = glm::perspective(
         glm::radians(camera_->getZoom()),
         static_cast<float>(width_) / static_cast<float>(height_),
@@ -305,17 +347,53 @@ void Application::render() {
     }
     glDepthMask(GL_TRUE);
 
-    // Render equations
+    // Render equations, with chunk levels chosen for this camera and what it cannot see culled
+    LodView lodView;
+    lodView.eye = camera_->getPosition();
+    lodView.pixelsPerUnit = static_cast<float>(height_) / (2.0f * std::tan(glm::radians(camera_->getZoom()) * 0.5f));
+    lodView.pixelTolerance = settings_->getLodPixelTolerance();
+    equationRenderer_->setLodView(lodView);
+    equationRenderer_->setFrustum(Frustum(projection * view));
     equationRenderer_->updateVertices(equations_, points_);
 
-    // NOTE: Per-equation colors are baked into vertex attributes by EquationGenerator.
-    // The color uniform only affects grid/line rendering, not equations.
+    // NOTE: Meshes take their color, opacity and heatmap range from the renderer's per-equation
+    // draw records. The color uniform only affects grid/line rendering, not equations.
     equationRenderer_->render(
         *shader_,
         settings_->getUseHeatmap(),
         settings_->getMinHeight(),
         settings_->getMaxHeight()
     );
+
+    lineShader_->use();
+    lineShader_->setMat4("model", model);
+    lineShader_->setMat4("view", view);
+    lineShader_->setMat4("projection", projection);
+    equationRenderer_->renderLines(*lineShader_, settings_->getLineWidth(), width_, height_);
+}
+
+void Application::renderPlot() {
+    const glm::mat4 projection = plotView_->getProjection(width_, height_);
+    shader_->setMat4("projection", projection);
+    shader_->setMat4("view", glm::mat4(1.0f));
+    shader_->setFloat("point_size", settings_->getPointSize());
+    shader_->setFloat("point_opacity", 1.0f);
+
+    // Only the axes: the grid planes of the 3D scene would be seen edge-on.
+    glDepthMask(GL_FALSE);
+    if (settings_->getShowGridlines()) {
+        gridRenderer_->renderAxes(*shader_);
+    }
+    glDepthMask(GL_TRUE);
+
+    // Tiles are sampled in the background; coarser cached tiles stand in until they arrive.
+    curvePlot_->update(equations_, plotView_->getMinX(width_), plotView_->getMaxX(width_), generationOptions());
+    plotRenderer_->update(*curvePlot_);
+    lineShader_->use();
+    lineShader_->setMat4("model", glm::mat4(1.0f));
+    lineShader_->setMat4("view", glm::mat4(1.0f));
+    lineShader_->setMat4("projection", projection);
+    plotRenderer_->render(*lineShader_, settings_->getLineWidth(), width_, height_);
 }
 
 void Application::setupUICallbacks() {
@@ -323,6 +401,10 @@ void Application::setupUICallbacks() {
         onEquationRender(eq, idx);
     });
 
+    uiController_->setOnEquationStyle([this](Equation& eq, size_t idx) {
+        onEquationStyle(eq, idx);
+    });
+
     uiController_->setOnEquationRemove([this](size_t idx) {
         onEquationRemove(idx);
     });
@@ -353,34 +435,19 @@ void Application::setupUICallbacks() {
 }
 
 void Application::onEquationRender(Equation& equation, size_t /* index */) {
-    if (!equationParser_ || !equationGenerator_ || !settings_) {
-        return;
-    }
-
-    // Parse expression
-    if (!equationParser_->parseExpression(equation.expression, equation.is3D)) {
-        std::cerr << "Failed to parse equation: " << equationParser_->getErrorMessage() << std::endl;
-        return;
-    }
-
-    // Generate vertices
-    equationGenerator_->generateVertices(
-        equation,
-        *equationParser_,
-        settings_->getMaxDepth(),
-        settings_->getDerivativeThreshold()
-    );
-
-    // Update height tracking
-    settings_->setMinHeight(equationGenerator_->getMinHeight());
-    settings_->setMaxHeight(equationGenerator_->getMaxHeight());
+    // Parse and generate in the background; the previous geometry stays on screen until
+    // applyGenerationResults swaps in the new one.
+    updateEquationVertices(equation);
+}
 
-    // Rerender
+void Application::onEquationStyle(Equation& /* equation */, size_t /* index */) {
+    // The geometry stands; the draw records pick up the new color and opacity.
     rerender();
 }
 
 void Application::onEquationRemove(size_t index) {
     if (index < equations_.size()) {
+        generationScheduler_->cancel(equations_[index].id);
         equations_.erase(equations_.begin() + index);
         rerender();
     }
@@ -435,26 +502,79 @@ void Application::onExport(const std::string& filename) {
 }
 
 void Application::updateEquationVertices(Equation& equation) {
-    if (!equationParser_ || !equationGenerator_ || !settings_) {
+    if (!generationScheduler_ || !settings_) {
         return;
     }
 
-    if (!equationParser_->parseExpression(equation.expression, equation.is3D)) {
+    // Supersedes any job still queued or running for this equation.
+    generationScheduler_->submit(equation, generationOptions());
+}
+
+GenerationOptions Application::generationOptions() {
+    GenerationOptions options;
+    options.maxDepth = settings_->getMaxDepth();
+    options.derivativeThreshold = settings_->getDerivativeThreshold();
+    options.useSampleBudget = settings_->getUseSampleBudget();
+    options.curveRefinement = settings_->getUseAngleRefinement() ? CurveRefinement::TurningAngle
+                                                                 : CurveRefinement::Slope;
+    options.angleTolerance = static_cast<float>(glm::radians(settings_->getAngleTolerance()));
+    options.chunkedLod = settings_->getUseSurfaceLod();
+
+    if (settings_->getUseNativeKernels()) {
+        if (!nativeKernels_) {
+            nativeKernels_ = std::make_shared<NativeKernelCache>();
+            if (!nativeKernels_->isCompilerAvailable()) {
+                std::cerr << "Native kernels disabled: no C++ compiler found (" << nativeKernels_->getCompiler()
+                          << ")" << std::endl;
+            }
+        }
+        options.nativeKernels = nativeKernels_;
+    }
+    return options;
+}
+
+void Application::applyGenerationResults() {
+    if (!generationScheduler_) {
         return;
     }
 
-    equationGenerator_->generateVertices(
-        equation,
-        *equationParser_,
-        settings_->getMaxDepth(),
-        settings_->getDerivativeThreshold()
-    );
+    std::vector<GenerationResult> results = generationScheduler_->takeResults();
+    if (results.empty()) {
+        return;
+    }
+    for (GenerationResult& result : results) {
+        auto equation = std::find_if(equations_.begin(), equations_.end(),
+                                     [&](const Equation& eq) { return eq.id == result.equationId; });
+        if (equation == equations_.end()) {
+            continue; // removed while generating
+        }
+        if (!result.isValid) {
+            std::cerr << "Failed to parse equation: " << result.errorMessage << std::endl;
+            continue;
+        }
+        equation->vertices = std::move(result.vertices);
+        equation->indices = std::move(result.indices);
+        equation->meshChunks = std::move(result.meshChunks);
+        equation->lod = std::move(result.lod);
+        equation->strips = std::move(result.strips);
+        equation->boundsMin = result.boundsMin;
+        equation->boundsMax = result.boundsMax;
+        equation->minHeight = result.minHeight;
+        equation->maxHeight = result.maxHeight;
+        equation->revision = nextGeometryRevision();
+
+        // Update height tracking
+        settings_->setMinHeight(result.minHeight);
+        settings_->setMaxHeight(result.maxHeight);
+    }
+    rerender();
 }
 
 void Application::updatePointVertices(Point& point) {
     point.vertexData.clear();
     point.vertexData.push_back(point.position);
     point.vertexData.push_back(glm::vec3(point.color[0], point.color[1], point.color[2]));
+    point.revision = nextGeometryRevision();
 }
 
 void Application::rerender() {
@@ -500,12 +620,26 @@ void Application::mouseCallback(GLFWwindow* window, double xposIn, double yposIn
     app->lastX_ = xpos;
     app->lastY_ = ypos;
 
+    if (app->settings_ && app->settings_->getPlotMode2D()) {
+        app->plotView_->pan(xoffset, -yoffset); // drag the plot
+        return;
+    }
     app->camera_->processMouseMovement(xoffset, yoffset);
 }
 
 void Application::scrollCallback(GLFWwindow* window, double /* xoffset */, double yoffset) {
     Application* app = static_cast<Application*>(glfwGetWindowUserPointer(window));
     ImGui_ImplGlfw_ScrollCallback(window, 0.0, yoffset);
+    if (app && app->plotView_ && app->settings_ && app->settings_->getPlotMode2D()) {
+        // Zoom about the cursor; with the cursor captured, about the centre.
+        double x = app->width_ * 0.5;
+        double y = app->height_ * 0.5;
+        if (!app->mouseFocus_) {
+            glfwGetCursorPos(window, &x, &y);
+        }
+        app->plotView_->zoomAt(std::pow(kPlotZoomStep, -yoffset), x, y, app->width_, app->height_);
+        return;
+    }
     if (app && app->camera_) {
         app->camera_->processMouseScroll(static_cast<float>(yoffset));
     }
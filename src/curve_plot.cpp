@@ -0,0 +1,346 @@
+#include "curve_plot.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <sstream>
+
+namespace graphgl {
+
+namespace {
+
+// A tile is at least this fraction of the view wide, so at most five tiles are visible.
+constexpr double kTilesPerView = 4.0;
+
+// Tile widths stay well inside what a float x coordinate can resolve and reach.
+constexpr int kMinZoom = -40;
+constexpr int kMaxZoom = 100;
+
+// Background threads sampling tiles, and how many levels up a missing tile looks for a
+// coarser one to show instead.
+constexpr size_t kSamplerWorkers = 2;
+constexpr int kFallbackLevels = 4;
+
+} // namespace
+
+PlotView::PlotView() {
+    reset();
+}
+
+void PlotView::reset() {
+    centerX_ = 0.0;
+    centerY_ = 0.0;
+    unitsPerPixel_ = DEFAULT_UNITS_PER_PIXEL;
+}
+
+void PlotView::pan(double dxPixels, double dyPixels) {
+    centerX_ -= dxPixels * unitsPerPixel_;
+    centerY_ += dyPixels * unitsPerPixel_;
+}
+
+void PlotView::zoomAt(double factor, double x, double y, int width, int height) {
+    const double offsetX = x - 0.5 * width;
+    const double offsetY = 0.5 * height - y;
+    const double anchorX = centerX_ + offsetX * unitsPerPixel_;
+    const double anchorY = centerY_ + offsetY * unitsPerPixel_;
+    unitsPerPixel_ = std::clamp(unitsPerPixel_ * factor, MIN_UNITS_PER_PIXEL, MAX_UNITS_PER_PIXEL);
+    centerX_ = anchorX - offsetX * unitsPerPixel_;
+    centerY_ = anchorY - offsetY * unitsPerPixel_;
+}
+
+glm::mat4 PlotView::getProjection(int width, int height) const {
+    return glm::ortho(static_cast<float>(getMinX(width)), static_cast<float>(getMaxX(width)),
+                      static_cast<float>(getMinY(height)), static_cast<float>(getMaxY(height)), -1.0f, 1.0f);
+}
+
+CurveTileCache::CurveTileCache(size_t capacity)
+    : capacity_(std::max<size_t>(capacity, 1))
+{
+}
+
+size_t CurveTileCache::KeyHash::operator()(const Key& key) const {
+    size_t hash = std::hash<uint64_t>()(key.equationId);
+    hash ^= std::hash<int>()(key.zoom) + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+    hash ^= std::hash<int64_t>()(key.index) + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+    return hash;
+}
+
+const CurveTile* CurveTileCache::find(const Key& key) {
+    const auto it = index_.find(key);
+    if (it == index_.end()) {
+        return nullptr;
+    }
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return &it->second->second;
+}
+
+const CurveTile& CurveTileCache::insert(const Key& key, CurveTile&& tile) {
+    const auto existing = index_.find(key);
+    if (existing != index_.end()) {
+        entries_.erase(existing->second);
+        index_.erase(existing);
+    }
+    entries_.emplace_front(key, std::move(tile));
+    index_[key] = entries_.begin();
+    while (index_.size() > capacity_) {
+        index_.erase(entries_.back().first);
+        entries_.pop_back();
+    }
+    return entries_.front().second;
+}
+
+void CurveTileCache::erase(uint64_t equationId) {
+    for (auto it = entries_.begin(); it != entries_.end();) {
+        if (it->first.equationId == equationId) {
+            index_.erase(it->first);
+            it = entries_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+CurvePlot::CurvePlot(size_t tileCapacity)
+    : cache_(tileCapacity)
+    , requestedTiles_(0)
+    , revision_(0)
+    , complete_(false)
+    , sampler_(kSamplerWorkers)
+{
+}
+
+int CurvePlot::zoomLevel(double width) {
+    if (!(width > 0.0)) {
+        return kMinZoom;
+    }
+    const int zoom = static_cast<int>(std::ceil(std::log2(width / kTilesPerView)));
+    return std::clamp(zoom, kMinZoom, kMaxZoom);
+}
+
+bool CurvePlot::update(const std::vector<Equation>& equations, double minX, double maxX,
+                       const GenerationOptions& options, size_t maxPendingTiles) {
+    requestedTiles_ = 0;
+    for (auto& entry : sources_) {
+        entry.second.seen = false;
+    }
+
+    const int zoom = zoomLevel(maxX - minX);
+    const double width = tileWidth(zoom);
+    const int64_t firstTile = static_cast<int64_t>(std::floor(minX / width));
+    const int64_t lastTile = static_cast<int64_t>(std::floor(maxX / width));
+
+    // The curves drawn depend only on the tiles in view and, per drawn equation, its
+    // signature and its color; and on which tiles have arrived.
+    std::vector<std::pair<const Equation*, Source*>> drawn;
+    sceneScratch_.assign({static_cast<uint64_t>(zoom), static_cast<uint64_t>(firstTile),
+                          static_cast<uint64_t>(lastTile)});
+    for (const Equation& equation : equations) {
+        if (equation.is3D) {
+            continue;
+        }
+        Source& src = source(equation, options);
+        if (!equation.isVisible || !src.isValid) {
+            continue;
+        }
+        drawn.emplace_back(&equation, &src);
+        sceneScratch_.insert(sceneScratch_.end(), {equation.id, src.revision});
+        for (float channel : equation.color) {
+            uint32_t bits;
+            std::memcpy(&bits, &channel, sizeof(bits));
+            sceneScratch_.push_back(bits);
+        }
+    }
+
+    // Equations that were removed or turned 3D no longer need their tiles.
+    for (auto it = sources_.begin(); it != sources_.end();) {
+        if (!it->second.seen) {
+            cache_.erase(it->first);
+            cancelPending(it->first);
+            it = sources_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    const bool arrived = collectTiles();
+    for (auto it = drawn.begin(); it != drawn.end();) {
+        it = it->second->isValid ? it + 1 : drawn.erase(it);
+    }
+
+    // Ask for the missing tiles in view, left to right and equation by equation.
+    for (const auto& [equation, src] : drawn) {
+        for (int64_t index = firstTile; index <= lastTile && pending_.size() < maxPendingTiles; ++index) {
+            const CurveTileCache::Key key{equation->id, zoom, index};
+            const bool isPending = std::any_of(pending_.begin(), pending_.end(),
+                                               [&](const auto& entry) { return entry.second.key == key; });
+            if (!isPending && !cache_.find(key)) {
+                requestTile(*equation, key, options);
+            }
+        }
+    }
+
+    if (!arrived && sceneScratch_ == scene_) {
+        return complete_;
+    }
+    scene_.swap(sceneScratch_);
+    vertices_.clear();
+    strips_.clear();
+    ++revision_;
+
+    complete_ = true;
+    for (const auto& [equation, src] : drawn) {
+        const glm::vec3 color(equation->color[0], equation->color[1], equation->color[2]);
+        bool open = false; // the last vertex can be continued by the next sample
+        for (int64_t index = firstTile; index <= lastTile; ++index) {
+            const double from = index * width;
+            const double to = (index + 1) * width;
+            if (const CurveTile* tile = cache_.find({equation->id, zoom, index})) {
+                appendPoints(*tile, from, to, color, open);
+                continue;
+            }
+            complete_ = false;
+
+            // A coarser tile covering this one, or else its two halves one level down.
+            const CurveTile* coarser = nullptr;
+            for (int up = 1; up <= kFallbackLevels && !coarser && zoom + up <= kMaxZoom; ++up) {
+                const int64_t parent = static_cast<int64_t>(std::floor(std::ldexp(static_cast<double>(index), -up)));
+                coarser = cache_.find({equation->id, zoom + up, parent});
+            }
+            if (coarser) {
+                appendPoints(*coarser, from, to, color, open);
+                continue;
+            }
+            const CurveTile* left = cache_.find({equation->id, zoom - 1, 2 * index});
+            const CurveTile* right = cache_.find({equation->id, zoom - 1, 2 * index + 1});
+            const double middle = 0.5 * (from + to);
+            if (left) {
+                appendPoints(*left, from, middle, color, open);
+            } else {
+                open = false;
+            }
+            if (right) {
+                appendPoints(*right, middle, to, color, open);
+            } else {
+                open = false;
+            }
+        }
+    }
+    return complete_;
+}
+
+void CurvePlot::appendPoints(const CurveTile& tile, double from, double to, const glm::vec3& color, bool& open) {
+    const std::vector<glm::vec2>& points = tile.points;
+    size_t begin = 0;
+    size_t end = points.size();
+    while (begin + 1 < end && points[begin + 1].x <= from) {
+        ++begin;
+    }
+    while (end > begin + 2 && points[end - 2].x >= to) {
+        --end;
+    }
+
+    for (size_t i = begin; i < end; ++i) {
+        const glm::vec2& point = points[i];
+        if (!std::isfinite(point.y)) {
+            open = false;
+            continue;
+        }
+        // Adjacent tiles both sample their shared endpoint, and stand-ins reach past theirs.
+        if (open && point.x <= vertices_[vertices_.size() - 2].x) {
+            continue;
+        }
+        if (!open) {
+            strips_.push_back({static_cast<uint32_t>(vertices_.size() / 2), 0});
+            open = true;
+        }
+        vertices_.emplace_back(point.x, point.y, 0.0f);
+        vertices_.push_back(color);
+        ++strips_.back().count;
+    }
+}
+
+CurvePlot::Source& CurvePlot::source(const Equation& equation, const GenerationOptions& options) {
+    Source& src = sources_[equation.id];
+    src.seen = true;
+
+    std::ostringstream signature;
+    signature << equation.expression << '\n' << options.maxDepth << ' ' << options.derivativeThreshold << ' '
+              << options.useSampleBudget << ' ' << static_cast<int>(options.curveRefinement) << ' '
+              << options.angleTolerance << ' ' << equation.sampleSize;
+    if (signature.str() != src.signature) {
+        // Tiles sampled (or being sampled) from the old expression or settings are stale.
+        cache_.erase(equation.id);
+        cancelPending(equation.id);
+        src.signature = signature.str();
+        src.isValid = true;
+        ++src.revision;
+    }
+    return src;
+}
+
+void CurvePlot::cancelPending(uint64_t equationId) {
+    for (auto it = pending_.begin(); it != pending_.end();) {
+        if (it->second.key.equationId == equationId) {
+            sampler_.cancel(it->first);
+            it = pending_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void CurvePlot::requestTile(const Equation& equation, const CurveTileCache::Key& key,
+                            const GenerationOptions& options) {
+    // Each tile is a job of its own, under an id no equation uses.
+    const double width = tileWidth(key.zoom);
+    Equation tile;
+    tile.expression = equation.expression;
+    tile.is3D = false;
+    tile.sampleSize = equation.sampleSize;
+    tile.minX = static_cast<float>(key.index * width);
+    tile.maxX = static_cast<float>((key.index + 1) * width);
+
+    GenerationOptions tileOptions = options;
+    tileOptions.progressive = false;
+    pending_[tile.id] = {key, sources_[key.equationId].revision};
+    sampler_.submit(tile, tileOptions);
+    ++requestedTiles_;
+}
+
+bool CurvePlot::collectTiles() {
+    bool changed = false;
+    for (GenerationResult& result : sampler_.takeResults()) {
+        const auto request = pending_.find(result.equationId);
+        if (request == pending_.end()) {
+            continue;
+        }
+        const PendingTile pending = request->second;
+        pending_.erase(request);
+        const auto src = sources_.find(pending.key.equationId);
+        if (src == sources_.end() || src->second.revision != pending.revision) {
+            continue;
+        }
+        changed = true;
+        if (!result.isValid) {
+            src->second.isValid = false;
+            cancelPending(pending.key.equationId);
+            continue;
+        }
+
+        // The strips become one run of points with a NaN between them.
+        CurveTile tile;
+        tile.points.reserve(result.vertices.size() / 2 + result.strips.size());
+        for (const IndexRange& strip : result.strips) {
+            if (!tile.points.empty()) {
+                tile.points.emplace_back(result.vertices[strip.first * 2].x, std::numeric_limits<float>::quiet_NaN());
+            }
+            for (uint32_t i = strip.first; i < strip.first + strip.count; ++i) {
+                tile.points.emplace_back(result.vertices[i * 2].x, result.vertices[i * 2].y);
+            }
+        }
+        cache_.insert(pending.key, std::move(tile));
+    }
+    return changed;
+}
+
+} // namespace graphgl
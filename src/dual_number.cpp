@@ -0,0 +1,91 @@
+#include "dual_number.h"
+#include <cmath>
+
+namespace graphgl {
+
+namespace {
+
+constexpr float kLn2 = 0.693147180559945309417f;
+constexpr float kLn10 = 2.30258509299404568402f;
+
+/// Derivative factors for f(a, b): df = fa * da + fb * db.
+struct Partials {
+    float fa = 0.0f;
+    float fb = 0.0f;
+};
+
+Partials partials(ExprOp op, float a, float b, float value) {
+    switch (op) {
+        case ExprOp::Neg:   return {-1.0f, 0.0f};
+        case ExprOp::Add:   return {1.0f, 1.0f};
+        case ExprOp::Sub:   return {1.0f, -1.0f};
+        case ExprOp::Mul:   return {b, a};
+        case ExprOp::Div:   return {1.0f / b, -a / (b * b)};
+        case ExprOp::Mod:   return {1.0f, -std::trunc(a / b)};
+        case ExprOp::Pow:
+            // The log term only matters when the exponent varies; skip it when it would
+            // turn a valid result into NaN (a <= 0).
+            return {b * std::pow(a, b - 1.0f), a > 0.0f ? value * std::log(a) : 0.0f};
+        case ExprOp::Min:   return (b < a) ? Partials{0.0f, 1.0f} : Partials{1.0f, 0.0f};
+        case ExprOp::Max:   return (a < b) ? Partials{0.0f, 1.0f} : Partials{1.0f, 0.0f};
+        case ExprOp::Atan2: {
+            const float r2 = a * a + b * b;
+            return {b / r2, -a / r2};
+        }
+        case ExprOp::Hypot: return {a / value, b / value};
+        case ExprOp::Sin:   return {std::cos(a)};
+        case ExprOp::Cos:   return {-std::sin(a)};
+        case ExprOp::Tan:   return {1.0f + value * value};
+        case ExprOp::Asin:  return {1.0f / std::sqrt(1.0f - a * a)};
+        case ExprOp::Acos:  return {-1.0f / std::sqrt(1.0f - a * a)};
+        case ExprOp::Atan:  return {1.0f / (1.0f + a * a)};
+        case ExprOp::Sinh:  return {std::cosh(a)};
+        case ExprOp::Cosh:  return {std::sinh(a)};
+        case ExprOp::Tanh:  return {1.0f - value * value};
+        case ExprOp::Exp:   return {value};
+        case ExprOp::Log:   return {1.0f / a};
+        case ExprOp::Log10: return {1.0f / (a * kLn10)};
+        case ExprOp::Log2:  return {1.0f / (a * kLn2)};
+        case ExprOp::Sqrt:  return {0.5f / value};
+        case ExprOp::Abs:   return {(a < 0.0f) ? -1.0f : 1.0f};
+        default:            return {}; // floor, ceil, round, trunc, sgn: piecewise constant
+    }
+}
+
+} // namespace
+
+DualNumber evaluateDual(const ExpressionProgram& program, float x, float y, DualNumber* registers) {
+    const std::vector<ExprNode>& nodes = program.getNodes();
+    if (nodes.empty()) {
+        return {std::nanf(""), std::nanf(""), std::nanf("")};
+    }
+
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        const ExprNode& node = nodes[i];
+        DualNumber& r = registers[i];
+        switch (node.op) {
+            case ExprOp::Const:
+                r = {node.value, 0.0f, 0.0f};
+                break;
+            case ExprOp::VarX:
+                r = {x, 1.0f, 0.0f};
+                break;
+            case ExprOp::VarY:
+                r = {y, 0.0f, 1.0f};
+                break;
+            default: {
+                const DualNumber a = registers[node.lhs];
+                const DualNumber b = exprOpArity(node.op) == 2 ? registers[node.rhs] : DualNumber{};
+                const float value = applyExprOp(node.op, a.value, b.value);
+                const Partials p = partials(node.op, a.value, b.value, value);
+                // Zero partials must not turn infinite or NaN operand derivatives into NaN.
+                auto chain = [](float f, float d) { return f == 0.0f ? 0.0f : f * d; };
+                r = {value, chain(p.fa, a.dx) + chain(p.fb, b.dx), chain(p.fa, a.dy) + chain(p.fb, b.dy)};
+                break;
+            }
+        }
+    }
+    return registers[nodes.size() - 1];
+}
+
+} // namespace graphgl
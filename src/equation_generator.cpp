@@ -1,170 +1,1395 @@
 #include "equation_generator.h"
+#include "surface_symmetry.h"
+#include <algorithm>
+#include <array>
 #include <cmath>
+#include <cstdint>
 #include <limits>
+#include <thread>
+#include <unordered_map>
 
 namespace graphgl {
 
+// Below this many samples a surface is evaluated on the calling thread.
+constexpr size_t kMinParallelSamples = 16384;
+constexpr size_t kMinRowsPerWorker = 4;
+
+// Grid rows evaluated between checks of the cancellation token.
+constexpr size_t kRowsPerCancellationCheck = 8;
+
+constexpr float kDefaultApproximationTolerance = 1e-4f;
+constexpr float kDefaultSurfaceTolerance = 1e-3f;
+constexpr float kDefaultAngleTolerance = 0.035f; // about 2 degrees
+
+// Bisection steps when fitting the surface error threshold to a vertex budget.
+constexpr int kBudgetSearchSteps = 24;
+
+// Curve errors below this fraction of the values' magnitude are treated as exact.
+constexpr double kBudgetErrorFloor = 1e-4;
+
+// Surface lattices have 2^level + 1 samples per side, level = maxDepth + 2 within these bounds.
+constexpr int kMinLatticeLevel = 4;
+constexpr int kMaxLatticeLevel = 10;
+
+// Lattice levels between successive surface previews of generateProgressive.
+constexpr int kProgressiveLevelStep = 2;
+
+// Chunked surfaces: chunks per lattice side (chunks are at least the coarsest lattice),
+// levels per chunk, and the error of the first coarse level relative to the height range;
+// each further level allows kLodErrorRatio times more.
+constexpr uint32_t kLodChunksPerSide = 8;
+constexpr int kLodLevels = 6;
+constexpr float kLodBaseTolerance = kDefaultSurfaceTolerance;
+constexpr float kLodErrorRatio = 4.0f;
+
+// vertexIndex_ entry of a lattice sample without a vertex.
+constexpr uint32_t kUnusedVertex = std::numeric_limits<uint32_t>::max();
+
+// Samples per side of the tiles bounded with interval arithmetic.
+constexpr size_t kIntervalTileSize = 16;
+constexpr size_t kMinTilesPerWorker = 4;
+
+// Largest radial table; the table is also kept under a quarter of the grid.
+constexpr size_t kMaxRadialIntervals = 1 << 15;
+
+// Coarse intervals per period; doubled until the tolerance is met.
+constexpr size_t kMinPeriodIntervals = 8;
+constexpr size_t kMaxPeriodIntervals = 512;
+
+namespace {
+
+/// Positions along one axis with at least 2^level cells inside the domain; returns how many lie
+/// in it. Interior samples sit on multiples of a power-of-two spacing, the largest that puts
+/// 2^level cells into [lo, hi], so they are shared by every domain and level with that spacing.
+/// The first and last domain samples are moved onto the domain ends. The caller pads the axis
+/// out to its lattice.
+size_t buildLatticeAxis(float lo, float hi, int level, std::vector<float>& positions) {
+    const size_t cells = size_t(1) << level;
+    positions.clear();
+    if (!(hi > lo) || !std::isfinite(hi - lo)) {
+        for (size_t i = 0; i <= cells; ++i) {
+            positions.push_back(lo + (hi - lo) * (i / float(cells)));
+        }
+        positions.back() = hi;
+        return positions.size();
+    }
+
+    const double width = double(hi) - lo;
+    double spacing = std::exp2(std::floor(std::log2(width / cells)));
+    while (width / spacing < cells) {
+        spacing *= 0.5;
+    }
+    while (width / (spacing * 2.0) >= cells) {
+        spacing *= 2.0;
+    }
+    const double first = std::floor(lo / spacing);
+    const size_t inDomain = static_cast<size_t>(std::ceil(hi / spacing) - first) + 1;
+    for (size_t i = 0; i < inDomain; ++i) {
+        positions.push_back(static_cast<float>((first + i) * spacing));
+    }
+    positions.front() = lo;
+    positions.back() = hi;
+    return inDomain;
+}
+
+/// Spread of the finite values in a table, at least 1 so flat tables get an absolute bound.
+float finiteRange(const std::vector<float>& values) {
+    float lo = std::numeric_limits<float>::max();
+    float hi = -std::numeric_limits<float>::max();
+    for (float v : values) {
+        if (std::isfinite(v)) {
+            lo = std::min(lo, v);
+            hi = std::max(hi, v);
+        }
+    }
+    return (hi >= lo) ? std::max(1.0f, hi - lo) : 1.0f;
+}
+
+/// Weights of the 4-point Lagrange cubic through nodes -1, 0, 1, 2, evaluated at t in [0, 1].
+/// Its error is proportional to the fourth derivative everywhere in the interval and peaks at
+/// t = 0.5, so the error at interval midpoints bounds it.
+std::array<float, 4> cubicWeights(float t) {
+    const float tp = t + 1.0f;
+    const float tm = t - 1.0f;
+    const float tm2 = t - 2.0f;
+    return {-t * tm * tm2 * (1.0f / 6.0f), tp * tm * tm2 * 0.5f, -tp * t * tm2 * 0.5f, tp * t * tm * (1.0f / 6.0f)};
+}
+
+/// Error of the cubic through the even neighbours of odd entry j, i.e. at the midpoint of a
+/// table with twice the spacing. Entries are table[first + k * stride].
+float midpointResidual(const float* table, size_t first, size_t stride, size_t jm3, size_t jm1, size_t j,
+                       size_t jp1, size_t jp3) {
+    const float predicted = (9.0f * (table[first + jm1 * stride] + table[first + jp1 * stride]) -
+                             (table[first + jm3 * stride] + table[first + jp3 * stride])) * (1.0f / 16.0f);
+    return std::fabs(table[first + j * stride] - predicted);
+}
+
+/// How each grid sample along one axis reads the table of a periodic fill.
+struct AxisTaps {
+    std::vector<float> positions;                 // table positions along this axis
+    std::vector<std::array<uint32_t, 4>> index;   // per sample
+    std::vector<std::array<float, 4>> weight;     // per sample
+    size_t taps = 1;                              // 1 (direct) or 4 (cubic)
+};
+
+/// Along a non-periodic axis the table holds the samples themselves.
+void buildDirectAxis(const std::vector<float>& samples, AxisTaps& axis) {
+    axis.positions = samples;
+    axis.taps = 1;
+    axis.index.resize(samples.size());
+    axis.weight.resize(samples.size());
+    for (size_t i = 0; i < samples.size(); ++i) {
+        axis.index[i] = {static_cast<uint32_t>(i), 0, 0, 0};
+        axis.weight[i] = {1.0f, 0.0f, 0.0f, 0.0f};
+    }
+}
+
+/// Along a periodic axis the table is one period at n points, read cyclically with a cubic.
+void buildPeriodicAxis(const std::vector<float>& samples, float period, size_t n, AxisTaps& axis) {
+    const double origin = samples.front();
+    const double step = static_cast<double>(period) / n;
+    axis.taps = 4;
+    axis.positions.resize(n);
+    for (size_t k = 0; k < n; ++k) {
+        axis.positions[k] = static_cast<float>(origin + step * k);
+    }
+
+    axis.index.resize(samples.size());
+    axis.weight.resize(samples.size());
+    for (size_t i = 0; i < samples.size(); ++i) {
+        double phase = std::fmod(samples[i] - origin, static_cast<double>(period));
+        if (phase < 0.0) {
+            phase += period;
+        }
+        const double u = phase / step;
+        const size_t k = std::min(static_cast<size_t>(u), n - 1);
+        axis.index[i] = {static_cast<uint32_t>((k + n - 1) % n), static_cast<uint32_t>(k),
+                         static_cast<uint32_t>((k + 1) % n), static_cast<uint32_t>((k + 2) % n)};
+        axis.weight[i] = cubicWeights(static_cast<float>(u - k));
+    }
+}
+
+/// Largest midpoint residual of a cyclic table of n entries.
+float cyclicMidpointError(const float* table, size_t first, size_t stride, size_t n) {
+    float worst = 0.0f;
+    for (size_t j = 1; j < n; j += 2) {
+        worst = std::max(worst, midpointResidual(table, first, stride, (j + n - 3) % n, j - 1, j, (j + 1) % n,
+                                                 (j + 3) % n));
+    }
+    return worst;
+}
+
+} // namespace
+
 EquationGenerator::EquationGenerator()
     : minHeight_(std::numeric_limits<float>::max())
     , maxHeight_(-std::numeric_limits<float>::max())
+    , approximationTolerance_(kDefaultApproximationTolerance)
+    , surfaceTolerance_(kDefaultSurfaceTolerance)
+    , useSampleBudget_(false)
+    , curveRefinement_(CurveRefinement::Slope)
+    , angleTolerance_(kDefaultAngleTolerance)
+    , chunkedLod_(false)
+    , threadCount_(0)
+    , storeSamples_(true)
 {
 }
 
+size_t EquationGenerator::surfaceThreads() const {
+    return threadCount_ > 0 ? threadCount_ : std::max(1u, std::thread::hardware_concurrency());
+}
+
 void EquationGenerator::generateVertices(Equation& equation, EquationParser& parser,
                                         int maxDepth, double derivativeThreshold) {
+    generateGeometry(equation, parser, maxDepth, derivativeThreshold);
+    computeBounds(equation);
+}
+
+void EquationGenerator::computeBounds(Equation& equation) {
+    equation.boundsMin = glm::vec3(std::numeric_limits<float>::max());
+    equation.boundsMax = glm::vec3(-std::numeric_limits<float>::max());
+    for (size_t i = 0; i < equation.vertices.size(); i += 2) {
+        equation.boundsMin = glm::min(equation.boundsMin, equation.vertices[i]);
+        equation.boundsMax = glm::max(equation.boundsMax, equation.vertices[i]);
+    }
+}
+
+void EquationGenerator::generateGeometry(Equation& equation, EquationParser& parser,
+                                         int maxDepth, double derivativeThreshold) {
     equation.vertices.clear();
     equation.indices.clear();
+    equation.meshChunks.clear();
+    equation.lod.clear();
+    equation.strips.clear();
     minHeight_ = std::numeric_limits<float>::max();
     maxHeight_ = -std::numeric_limits<float>::max();
 
+    const auto compiled = parser.getCompiledExpression();
+    if (!compiled) {
+        return;
+    }
+
     if (equation.is3D) {
-        // Generate 3D surface
-        auto xSamples = adaptiveSample(
-            [&](float x) { return safeEvaluate(parser, x, equation.minY, equation.is3D); },
-            equation.minX,
-            equation.maxX,
-            maxDepth,
-            derivativeThreshold
-        );
-
-        auto ySamples = adaptiveSample(
-            [&](float y) { return safeEvaluate(parser, equation.minX, y, equation.is3D); },
-            equation.minY,
-            equation.maxY,
-            maxDepth,
-            derivativeThreshold
-        );
-
-        // Generate vertices for 3D surface
-        for (float x : xSamples) {
-            for (float y : ySamples) {
-                float z = safeEvaluate(parser, x, y, equation.is3D);
-                if (!std::isnan(z)) {
-                    equation.vertices.emplace_back(x, z, y);
-                    equation.vertices.emplace_back(glm::vec3(equation.color[0], equation.color[1], equation.color[2]));
-                    minHeight_ = std::min(minHeight_, z);
-                    maxHeight_ = std::max(maxHeight_, z);
+        // Generate 3D surface on a square lattice, then keep only the vertices the RTIN
+        // needs to stay within the surface tolerance.
+        const int level = std::clamp(maxDepth + 2, kMinLatticeLevel, kMaxLatticeLevel);
+        std::vector<float> xSamples;
+        std::vector<float> ySamples;
+        const size_t cols = buildLatticeAxis(equation.minX, equation.maxX, level, xSamples);
+        const size_t rows = buildLatticeAxis(equation.minY, equation.maxY, level, ySamples);
+
+        // The lattice is the smallest that holds both axes, usually one level up; the samples
+        // past the domain collapse onto its far ends.
+        int latticeLevel = level;
+        while ((size_t(1) << latticeLevel) + 1 < std::max(cols, rows)) {
+            ++latticeLevel;
+        }
+        const uint32_t gridSize = (1u << latticeLevel) + 1;
+        xSamples.resize(gridSize, equation.maxX);
+        ySamples.resize(gridSize, equation.maxY);
+
+        // Heights are row-major (row = y sample).
+        evaluateCachedSurface(*compiled, sampleCache_ ? *sampleCache_ : localCache_,
+                              std::vector<float>(xSamples.begin(), xSamples.begin() + cols),
+                              std::vector<float>(ySamples.begin(), ySamples.begin() + rows));
+        if (isCancelled() || isStoppingAfterSamples()) {
+            return;
+        }
+
+        // The collapsed lattice past the domain repeats the last row and column.
+        lattice_.resize(static_cast<size_t>(gridSize) * gridSize);
+        for (size_t row = 0; row < gridSize; ++row) {
+            const float* source = heights_.data() + std::min(row, rows - 1) * cols;
+            float* target = lattice_.data() + row * gridSize;
+            std::copy_n(source, cols, target);
+            std::fill(target + cols, target + gridSize, source[cols - 1]);
+        }
+        latticeCols_ = cols;
+        latticeRows_ = rows;
+        rtin_.build(lattice_.data(), gridSize, xSamples.data(), ySamples.data());
+        if (isCancelled()) {
+            return;
+        }
+
+        // The surface tolerance is relative to the height range of the defined samples.
+        float lo = std::numeric_limits<float>::max();
+        float hi = -std::numeric_limits<float>::max();
+        for (float z : heights_) {
+            if (std::isfinite(z)) {
+                lo = std::min(lo, z);
+                hi = std::max(hi, z);
+            }
+        }
+        const float range = lo <= hi ? hi - lo : 0.0f;
+        float maxError = surfaceTolerance_ > 0.0f ? surfaceTolerance_ * range : -1.0f;
+        if (useSampleBudget_) {
+            maxError = fitSampleBudget(static_cast<size_t>(std::max(equation.sampleSize, 4)));
+        }
+        if (chunkedLod_ && equation.isMesh) {
+            emitSurfaceChunks(equation, maxError, range, xSamples, ySamples);
+            return;
+        }
+
+        triangles_.clear();
+        rtin_.extractTriangles(maxError, triangles_);
+        if (!equation.isMesh) {
+            emitLatticeRows(equation, xSamples, ySamples);
+            return;
+        }
+        // Vertices follow the triangles, so blocks also keep their vertices close together.
+        sortTrianglesIntoBlocks();
+        emitLatticeVertices(equation, xSamples, ySamples);
+
+        // Generate mesh indices block by block, skipping triangles that touch undefined samples.
+        meshIndices_.clear();
+        meshIndices_.reserve(triangles_.size());
+        std::array<uint32_t, 3> triangle;
+        for (size_t block = 0; block + 1 < blockStarts_.size(); ++block) {
+            MeshChunk chunk;
+            chunk.boundsMin = glm::vec3(std::numeric_limits<float>::max());
+            chunk.boundsMax = glm::vec3(-std::numeric_limits<float>::max());
+            chunk.indices.first = static_cast<uint32_t>(meshIndices_.size());
+            for (size_t t = blockStarts_[block]; t < blockStarts_[block + 1]; t += 3) {
+                if (!meshTriangle(equation, &triangles_[t], triangle)) {
+                    continue;
+                }
+                meshIndices_.insert(meshIndices_.end(), triangle.begin(), triangle.end());
+                for (uint32_t vertex : triangle) {
+                    chunk.boundsMin = glm::min(chunk.boundsMin, equation.vertices[vertex * 2]);
+                    chunk.boundsMax = glm::max(chunk.boundsMax, equation.vertices[vertex * 2]);
                 }
             }
+            chunk.indices.count = static_cast<uint32_t>(meshIndices_.size()) - chunk.indices.first;
+            if (chunk.indices.count > 0) {
+                equation.meshChunks.push_back(chunk);
+            }
         }
+        equation.indices.assign(meshIndices_);
+    } else {
+        sampleCurve(parser, equation.minX, equation.maxX, maxDepth, derivativeThreshold, equation.sampleSize,
+                    samples_, heights_);
 
-        // Generate mesh indices if requested
-        if (equation.isMesh) {
-            const size_t cols = xSamples.size();
-            const size_t rows = ySamples.size();
-
-            for (size_t y = 0; y < rows - 1; ++y) {
-                for (size_t x = 0; x < cols - 1; ++x) {
-                    const size_t i0 = y * cols + x;
-                    const size_t i1 = y * cols + (x + 1);
-                    const size_t i2 = (y + 1) * cols + x;
-                    const size_t i3 = (y + 1) * cols + (x + 1);
-
-                    // Check if vertices are valid (not NaN)
-                    if (i0 * 2 < equation.vertices.size() &&
-                        i1 * 2 < equation.vertices.size() &&
-                        i2 * 2 < equation.vertices.size() &&
-                        i3 * 2 < equation.vertices.size()) {
-                        
-                        const float y0 = equation.vertices[i0 * 2].y;
-                        const float y1 = equation.vertices[i1 * 2].y;
-                        const float y2 = equation.vertices[i2 * 2].y;
-                        const float y3 = equation.vertices[i3 * 2].y;
-
-                        if (!std::isnan(y0) && !std::isnan(y1) && 
-                            !std::isnan(y2) && !std::isnan(y3)) {
-                            equation.indices.insert(equation.indices.end(), {
-                                static_cast<unsigned int>(i0),
-                                static_cast<unsigned int>(i1),
-                                static_cast<unsigned int>(i2),
-                                static_cast<unsigned int>(i1),
-                                static_cast<unsigned int>(i3),
-                                static_cast<unsigned int>(i2)
-                            });
-                        }
+        const glm::vec3 color(equation.color[0], equation.color[1], equation.color[2]);
+        equation.vertices.reserve(samples_.size() * 2);
+        bool open = false; // the last vertex can be continued by the next sample
+        for (size_t i = 0; i < samples_.size(); ++i) {
+            const float y = heights_[i];
+            if (std::isnan(y)) {
+                open = false;
+                continue;
+            }
+            if (!open) {
+                equation.strips.push_back({static_cast<uint32_t>(equation.vertices.size() / 2), 0});
+                open = true;
+            }
+            equation.vertices.emplace_back(samples_[i], y, 0.0f);
+            equation.vertices.push_back(color);
+            ++equation.strips.back().count;
+            minHeight_ = std::min(minHeight_, y);
+            maxHeight_ = std::max(maxHeight_, y);
+        }
+    }
+}
+
+void EquationGenerator::sampleCurve(EquationParser& parser, float minX, float maxX, int maxDepth,
+                                    double derivativeThreshold, int sampleSize,
+                                    std::vector<float>& xs, std::vector<float>& ys) {
+    const auto compiled = parser.getCompiledExpression();
+    if (!compiled) {
+        xs.clear();
+        ys.clear();
+        return;
+    }
+
+    // Interval bounds guide the samplers.
+    auto boundsContext = compiled->createContext();
+    std::function<Interval(float, float)> xBounds;
+    if (compiled->hasProgram()) {
+        xBounds = [&boundsContext](float a, float b) {
+            return boundsContext.evaluateInterval(Interval::of(a, b));
+        };
+    }
+
+    // The samplers hand back the values they evaluated, so nothing is evaluated twice. ExprTk
+    // gradients cost two extra evaluations per sample, so without a program only values are
+    // taken and the samplers difference neighbouring samples instead.
+    std::function<DualNumber(float)> func;
+    if (compiled->hasGradient()) {
+        func = [&](float x) { return parser.evaluateGradient(x); };
+    } else {
+        func = [&](float x) {
+            DualNumber f;
+            f.value = parser.evaluate(x);
+            f.dx = std::numeric_limits<float>::quiet_NaN();
+            return f;
+        };
+    }
+    if (useSampleBudget_) {
+        budgetSample(func, minX, maxX, maxDepth, static_cast<size_t>(std::max(sampleSize, 2)), xs, ys, xBounds);
+    } else {
+        adaptiveSample(func, minX, maxX, maxDepth, derivativeThreshold, xs, ys, xBounds);
+    }
+}
+
+void EquationGenerator::generateProgressive(Equation& equation, EquationParser& parser, int maxDepth,
+                                            double derivativeThreshold, const LevelCallback& onLevel) {
+    std::vector<int> depths;
+    if (equation.is3D) {
+        const int last = std::clamp(maxDepth + 2, kMinLatticeLevel, kMaxLatticeLevel);
+        for (int level = last; level >= kMinLatticeLevel; level -= kProgressiveLevelStep) {
+            depths.push_back(level - 2);
+        }
+        depths.back() = kMinLatticeLevel - 2; // start on the coarsest lattice
+        depths.front() = maxDepth;
+    } else {
+        depths.push_back(maxDepth);
+        if (maxDepth > 0) {
+            depths.push_back(0);
+        }
+    }
+
+    // Previews read the sample cache but leave it holding the previous full-resolution grid,
+    // which the final level shares far more samples with.
+    for (size_t i = depths.size(); i-- > 0;) {
+        if (i > 0 && isStoppingAfterSamples()) {
+            continue; // only the final level's samples are kept
+        }
+        storeSamples_ = i == 0;
+        generateVertices(equation, parser, depths[i], derivativeThreshold);
+        storeSamples_ = true;
+        if (isCancelled()) {
+            return;
+        }
+        if (!isStoppingAfterSamples()) {
+            onLevel(equation, i == 0);
+        }
+    }
+}
+
+void EquationGenerator::evaluateCachedSurface(const CompiledExpression& expression, SurfaceSampleCache& cache,
+                                              const std::vector<float>& xSamples,
+                                              const std::vector<float>& ySamples) {
+    std::string key = expression.getSource();
+    key += expression.is3D() ? "|3d|" : "|2d|";
+    key += std::to_string(approximationTolerance_);
+    if (cache.key != key) {
+        cache.clear();
+        cache.key = std::move(key);
+    }
+
+    // Both grids are tensor products of ascending axes, so the cached samples are the product
+    // of the shared columns and rows, and the rest splits into two tensor grids: new columns
+    // over all rows, and shared columns over new rows.
+    auto match = [](const std::vector<float>& axis, const std::vector<float>& cached, std::vector<size_t>& at) {
+        at.assign(axis.size(), SIZE_MAX);
+        size_t j = 0;
+        for (size_t i = 0; i < axis.size(); ++i) {
+            while (j < cached.size() && cached[j] < axis[i]) {
+                ++j;
+            }
+            if (j < cached.size() && cached[j] == axis[i]) {
+                at[i] = j;
+            }
+        }
+    };
+    std::vector<size_t> cachedCol;
+    std::vector<size_t> cachedRow;
+    match(xSamples, cache.xs, cachedCol);
+    match(ySamples, cache.ys, cachedRow);
+
+    std::vector<size_t> newCols, sharedCols, newRows;
+    std::vector<float> newXs, sharedXs, newYs;
+    for (size_t col = 0; col < xSamples.size(); ++col) {
+        (cachedCol[col] == SIZE_MAX ? newCols : sharedCols).push_back(col);
+        (cachedCol[col] == SIZE_MAX ? newXs : sharedXs).push_back(xSamples[col]);
+    }
+    for (size_t row = 0; row < ySamples.size(); ++row) {
+        if (cachedRow[row] == SIZE_MAX) {
+            newRows.push_back(row);
+            newYs.push_back(ySamples[row]);
+        }
+    }
+
+    const size_t cols = xSamples.size();
+    const size_t rows = ySamples.size();
+    if (newCols.size() == cols) {
+        evaluateSurface(expression, xSamples, ySamples); // nothing shared
+    } else {
+        std::vector<float>& grid = surfaceScratch_;
+        grid.resize(cols * rows);
+        for (size_t row = 0; row < rows; ++row) {
+            if (cachedRow[row] == SIZE_MAX) {
+                continue;
+            }
+            const float* cachedHeights = cache.heights.data() + cachedRow[row] * cache.xs.size();
+            for (size_t col : sharedCols) {
+                grid[row * cols + col] = cachedHeights[cachedCol[col]];
+            }
+        }
+        if (!newCols.empty()) {
+            evaluateSurface(expression, newXs, ySamples);
+            for (size_t row = 0; row < rows; ++row) {
+                for (size_t i = 0; i < newCols.size(); ++i) {
+                    grid[row * cols + newCols[i]] = heights_[row * newCols.size() + i];
+                }
+            }
+        }
+        if (!newRows.empty() && !sharedCols.empty()) {
+            evaluateSurface(expression, sharedXs, newYs);
+            for (size_t j = 0; j < newRows.size(); ++j) {
+                for (size_t i = 0; i < sharedCols.size(); ++i) {
+                    grid[newRows[j] * cols + sharedCols[i]] = heights_[j * sharedCols.size() + i];
+                }
+            }
+        }
+        heights_.swap(grid);
+    }
+
+    // A cancelled evaluation leaves holes in heights_; keep the cache as it was.
+    if (isCancelled()) {
+        return;
+    }
+    cache.evaluatedSamples = newCols.size() * rows + sharedCols.size() * newRows.size();
+    if (!storeSamples_) {
+        return;
+    }
+    cache.xs = xSamples;
+    cache.ys = ySamples;
+    cache.heights = heights_;
+}
+
+void EquationGenerator::evaluateSurface(const CompiledExpression& expression,
+                                        const std::vector<float>& xSamples,
+                                        const std::vector<float>& ySamples) {
+    const size_t cols = xSamples.size();
+    const size_t rows = ySamples.size();
+    heights_.resize(cols * rows);
+
+    // Radial and periodic surfaces are filled from a small table when that is provably
+    // accurate enough. Separable surfaces are already exact and cheap.
+    if (approximationTolerance_ > 0.0f && expression.hasProgram() && !expression.getSeparable() &&
+        cols > 1 && rows > 1) {
+        const SurfaceSymmetry& symmetry = expression.getSymmetry();
+        if (symmetry.isRadial() &&
+            fillRadialSurface(expression, symmetry.getRadialProfile(), xSamples, ySamples)) {
+            return;
+        }
+        if ((symmetry.getPeriodX() > 0.0f || symmetry.getPeriodY() > 0.0f) &&
+            fillPeriodicSurface(expression, symmetry.getPeriodX(), symmetry.getPeriodY(), xSamples, ySamples)) {
+            return;
+        }
+    }
+
+    if (expression.hasProgram() && !expression.getSeparable() &&
+        evaluatePrunedSurface(expression, xSamples, ySamples)) {
+        return;
+    }
+
+    // Rows are evaluated in bands so a superseded job stops within a few rows.
+    auto evaluateRows = [&](CompiledExpression::Context& context, size_t firstRow, size_t lastRow) {
+        for (size_t row = firstRow; row < lastRow && !isCancelled(); row += kRowsPerCancellationCheck) {
+            const size_t count = std::min(kRowsPerCancellationCheck, lastRow - row);
+            context.evaluateGrid(xSamples.data(), cols, ySamples.data() + row, count, heights_.data() + row * cols);
+        }
+    };
+
+    // Separable surfaces cost O(cols + rows) evaluations; splitting them across
+    // threads would only repeat the x factor in every worker.
+    const size_t workers = std::min(surfaceThreads(), rows / kMinRowsPerWorker);
+    if (expression.getSeparable()) {
+        auto context = expression.createContext();
+        context.evaluateGrid(xSamples.data(), cols, ySamples.data(), rows, heights_.data());
+        return;
+    }
+    if (workers <= 1 || heights_.size() < kMinParallelSamples) {
+        auto context = expression.createContext();
+        evaluateRows(context, 0, rows);
+        return;
+    }
+
+    // Each worker owns a contiguous band of rows and its own evaluation context.
+    std::vector<std::thread> threads;
+    threads.reserve(workers);
+    for (size_t w = 0; w < workers; ++w) {
+        const size_t firstRow = rows * w / workers;
+        const size_t lastRow = rows * (w + 1) / workers;
+        threads.emplace_back([&, firstRow, lastRow]() {
+            auto context = expression.createContext();
+            evaluateRows(context, firstRow, lastRow);
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+bool EquationGenerator::evaluatePrunedSurface(const CompiledExpression& expression,
+                                              const std::vector<float>& xSamples,
+                                              const std::vector<float>& ySamples) {
+    const size_t cols = xSamples.size();
+    const size_t rows = ySamples.size();
+    const size_t tileCols = (cols + kIntervalTileSize - 1) / kIntervalTileSize;
+    const size_t tileRows = (rows + kIntervalTileSize - 1) / kIntervalTileSize;
+    if (tileCols * tileRows < 2) {
+        return false;
+    }
+
+    struct Tile {
+        size_t col;
+        size_t row;
+        size_t cols;
+        size_t rows;
+    };
+    std::vector<Tile> live;
+    size_t pruned = 0;
+    auto context = expression.createContext();
+
+    for (size_t tr = 0; tr < tileRows; ++tr) {
+        if (isCancelled()) {
+            return true;
+        }
+        for (size_t tc = 0; tc < tileCols; ++tc) {
+            Tile tile;
+            tile.col = tc * kIntervalTileSize;
+            tile.row = tr * kIntervalTileSize;
+            tile.cols = std::min(kIntervalTileSize, cols - tile.col);
+            tile.rows = std::min(kIntervalTileSize, rows - tile.row);
+            const Interval z = context.evaluateInterval(
+                Interval::of(xSamples[tile.col], xSamples[tile.col + tile.cols - 1]),
+                Interval::of(ySamples[tile.row], ySamples[tile.row + tile.rows - 1]));
+
+            float fill;
+            if (z.isUndefined()) {
+                fill = std::numeric_limits<float>::quiet_NaN();
+            } else if (approximationTolerance_ > 0.0f && !z.mayBeUndefined && std::isfinite(z.width()) &&
+                       z.width() <= 2.0 * approximationTolerance_ *
+                                        std::max(1.0, std::max(std::fabs(z.lo), std::fabs(z.hi)))) {
+                // Any value inside the bounds is within the tolerance of every sample.
+                fill = static_cast<float>(0.5 * (z.lo + z.hi));
+            } else {
+                live.push_back(tile);
+                continue;
+            }
+
+            ++pruned;
+            for (size_t row = tile.row; row < tile.row + tile.rows; ++row) {
+                std::fill_n(heights_.begin() + row * cols + tile.col, tile.cols, fill);
+            }
+        }
+    }
+    if (pruned == 0) {
+        return false;
+    }
+
+    // Live tiles are evaluated into a scratch block and copied into place.
+    auto evaluateTiles = [&](CompiledExpression::Context& tileContext, size_t first, size_t last) {
+        std::vector<float> block(kIntervalTileSize * kIntervalTileSize);
+        for (size_t t = first; t < last && !isCancelled(); ++t) {
+            const Tile& tile = live[t];
+            tileContext.evaluateGrid(xSamples.data() + tile.col, tile.cols, ySamples.data() + tile.row, tile.rows,
+                                     block.data());
+            for (size_t row = 0; row < tile.rows; ++row) {
+                std::copy_n(block.begin() + row * tile.cols, tile.cols,
+                            heights_.begin() + (tile.row + row) * cols + tile.col);
+            }
+        }
+    };
+
+    const size_t workers = std::min(surfaceThreads(), live.size() / kMinTilesPerWorker);
+    if (workers <= 1 || live.size() * kIntervalTileSize * kIntervalTileSize < kMinParallelSamples) {
+        evaluateTiles(context, 0, live.size());
+        return true;
+    }
+
+    std::vector<std::thread> threads;
+    threads.reserve(workers);
+    for (size_t w = 0; w < workers; ++w) {
+        const size_t first = live.size() * w / workers;
+        const size_t last = live.size() * (w + 1) / workers;
+        threads.emplace_back([&, first, last]() {
+            auto workerContext = expression.createContext();
+            evaluateTiles(workerContext, first, last);
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    return true;
+}
+
+bool EquationGenerator::fillRadialSurface(const CompiledExpression& expression,
+                                          const ExpressionProgram& profile,
+                                          const std::vector<float>& xSamples,
+                                          const std::vector<float>& ySamples) {
+    const size_t cols = xSamples.size();
+    const size_t rows = ySamples.size();
+
+    // The table spends at most a quarter of the grid's evaluations and must still be finer
+    // than the grid along r.
+    const size_t intervals = std::min(kMaxRadialIntervals, cols * rows / 4) & ~size_t(1);
+    if (intervals < 2 * std::max(cols, rows)) {
+        return false;
+    }
+
+    const SimdEvaluator evaluator(profile);
+    if (!evaluator.isValid()) {
+        return false;
+    }
+
+    // Range of r over the sampled rectangle.
+    const float x0 = xSamples.front();
+    const float x1 = xSamples.back();
+    const float y0 = ySamples.front();
+    const float y1 = ySamples.back();
+    const float rMin = std::hypot(std::max(0.0f, std::max(x0, -x1)), std::max(0.0f, std::max(y0, -y1)));
+    const float rMax = std::hypot(std::max(std::fabs(x0), std::fabs(x1)), std::max(std::fabs(y0), std::fabs(y1)));
+    if (!(rMax > rMin)) {
+        return false;
+    }
+
+    // Entry i holds h(rMin + (i - kPad) * step). The padding gives every interval in
+    // [rMin, rMax] its outer cubic taps and every tap its midpoint residual.
+    constexpr size_t kPad = 3;
+    const size_t tableSize = intervals + 2 * kPad + 1;
+    const double step = (static_cast<double>(rMax) - rMin) / intervals;
+    std::vector<float> radii(tableSize);
+    for (size_t i = 0; i < tableSize; ++i) {
+        radii[i] = static_cast<float>(rMin + step * (static_cast<double>(i) - kPad));
+    }
+    std::vector<float> table(tableSize);
+    std::vector<float> scratch(evaluator.getScratchSize());
+    evaluator.evaluateBatch(radii.data(), nullptr, table.data(), tableSize, scratch.data());
+
+    // Odd entries measure the error of interpolating from the even ones at twice the spacing,
+    // which is 16x the error of interpolating the full table.
+    const float tolerance = approximationTolerance_ * finiteRange(table);
+    std::vector<float> residual(tableSize, 0.0f);
+    for (size_t j = kPad; j + kPad < tableSize; j += 2) {
+        const float r = midpointResidual(table.data(), 0, 1, j - 3, j - 1, j, j + 1, j + 3);
+        residual[j] = std::isnan(r) ? std::numeric_limits<float>::infinity() : r;
+    }
+
+    // Per table interval [i, i + 1]: interpolate, evaluate exactly, or NaN throughout.
+    enum Mode : uint8_t { Interpolate, Exact, Undefined };
+    std::vector<uint8_t> mode(tableSize, Exact);
+    for (size_t i = kPad; i < kPad + intervals; ++i) {
+        const float* taps = table.data() + i - 1;
+        if (std::isnan(taps[0]) && std::isnan(taps[1]) && std::isnan(taps[2]) && std::isnan(taps[3])) {
+            mode[i] = Undefined;
+        } else if (std::max(std::max(residual[i - 1], residual[i]), std::max(residual[i + 1], residual[i + 2])) <=
+                   tolerance) {
+            mode[i] = Interpolate;
+        }
+    }
+
+    std::vector<size_t> exact;
+    for (size_t row = 0; row < rows; ++row) {
+        const float y = ySamples[row];
+        for (size_t col = 0; col < cols; ++col) {
+            const float x = xSamples[col];
+            const double u = (std::sqrt(static_cast<double>(x) * x + static_cast<double>(y) * y) - rMin) / step;
+            const size_t k = std::min(static_cast<size_t>(std::max(0.0, u)), intervals - 1);
+            const size_t i = kPad + k;
+            const size_t out = row * cols + col;
+            switch (mode[i]) {
+                case Interpolate: {
+                    const auto w = cubicWeights(static_cast<float>(std::min(1.0, std::max(0.0, u - k))));
+                    const float* taps = table.data() + i - 1;
+                    heights_[out] = w[0] * taps[0] + w[1] * taps[1] + w[2] * taps[2] + w[3] * taps[3];
+                    break;
+                }
+                case Undefined:
+                    heights_[out] = std::numeric_limits<float>::quiet_NaN();
+                    break;
+                default:
+                    exact.push_back(out);
+                    break;
+            }
+        }
+    }
+
+    if (!exact.empty()) {
+        std::vector<float> xs(exact.size());
+        std::vector<float> ys(exact.size());
+        std::vector<float> zs(exact.size());
+        for (size_t n = 0; n < exact.size(); ++n) {
+            xs[n] = xSamples[exact[n] % cols];
+            ys[n] = ySamples[exact[n] / cols];
+        }
+        auto context = expression.createContext();
+        context.evaluateBatch(xs.data(), ys.data(), zs.data(), exact.size());
+        for (size_t n = 0; n < exact.size(); ++n) {
+            heights_[exact[n]] = zs[n];
+        }
+    }
+    return true;
+}
+
+bool EquationGenerator::fillPeriodicSurface(const CompiledExpression& expression,
+                                            float periodX, float periodY,
+                                            const std::vector<float>& xSamples,
+                                            const std::vector<float>& ySamples) {
+    const size_t cols = xSamples.size();
+    const size_t rows = ySamples.size();
+
+    // Only worth it when the domain spans at least two periods.
+    const bool periodicX = periodX > 0.0f && xSamples.back() - xSamples.front() >= 2.0f * periodX;
+    const bool periodicY = periodY > 0.0f && ySamples.back() - ySamples.front() >= 2.0f * periodY;
+    if (!periodicX && !periodicY) {
+        return false;
+    }
+
+    AxisTaps xAxis;
+    AxisTaps yAxis;
+    std::vector<float> table;
+    auto context = expression.createContext();
+
+    for (size_t intervals = kMinPeriodIntervals; intervals <= kMaxPeriodIntervals; intervals *= 2) {
+        const size_t n = 2 * intervals;
+        if (periodicX) {
+            buildPeriodicAxis(xSamples, periodX, n, xAxis);
+        } else {
+            buildDirectAxis(xSamples, xAxis);
+        }
+        if (periodicY) {
+            buildPeriodicAxis(ySamples, periodY, n, yAxis);
+        } else {
+            buildDirectAxis(ySamples, yAxis);
+        }
+
+        const size_t tx = xAxis.positions.size();
+        const size_t ty = yAxis.positions.size();
+        if (2 * tx * ty > cols * rows) {
+            return false; // no longer cheaper than evaluating the grid
+        }
+
+        table.resize(tx * ty);
+        context.evaluateGrid(xAxis.positions.data(), tx, yAxis.positions.data(), ty, table.data());
+        if (!std::all_of(table.begin(), table.end(), [](float v) { return std::isfinite(v); })) {
+            return false; // poles and undefined regions are evaluated directly
+        }
+
+        // The check runs on the coarse half of the table; interpolating the full table is
+        // more accurate still.
+        const float tolerance = approximationTolerance_ * finiteRange(table);
+        float error = 0.0f;
+        if (periodicX) {
+            for (size_t row = 0; row < ty; ++row) {
+                error = std::max(error, cyclicMidpointError(table.data(), row * tx, 1, tx));
+            }
+        }
+        if (periodicY) {
+            for (size_t col = 0; col < tx; ++col) {
+                error = std::max(error, cyclicMidpointError(table.data(), col, tx, ty));
+            }
+        }
+        if (error > tolerance) {
+            continue;
+        }
+
+        for (size_t row = 0; row < rows; ++row) {
+            const auto& yIndex = yAxis.index[row];
+            const auto& yWeight = yAxis.weight[row];
+            for (size_t col = 0; col < cols; ++col) {
+                const auto& xIndex = xAxis.index[col];
+                const auto& xWeight = xAxis.weight[col];
+                float z = 0.0f;
+                for (size_t a = 0; a < yAxis.taps; ++a) {
+                    const float* tableRow = table.data() + yIndex[a] * tx;
+                    float sum = 0.0f;
+                    for (size_t b = 0; b < xAxis.taps; ++b) {
+                        sum += xWeight[b] * tableRow[xIndex[b]];
                     }
+                    z += yWeight[a] * sum;
                 }
+                heights_[row * cols + col] = z;
             }
         }
-    } else {
-        // Generate 2D curve
-        auto xSamples = adaptiveSample(
-            [&](float x) { return safeEvaluate(parser, x, 0.0f, equation.is3D); },
-            equation.minX,
-            equation.maxX,
-            maxDepth,
-            derivativeThreshold
-        );
+        return true;
+    }
+    return false;
+}
+
+void EquationGenerator::emitLatticeVertices(Equation& equation, const std::vector<float>& xSamples,
+                                            const std::vector<float>& ySamples) {
+    const uint32_t gridSize = rtin_.getGridSize();
+    const glm::vec3 color(equation.color[0], equation.color[1], equation.color[2]);
+    vertexIndex_.assign(lattice_.size(), kUnusedVertex);
+    uint32_t vertexCount = 0;
+    for (uint32_t& sample : triangles_) {
+        sample = domainSample(sample);
+        const float z = lattice_[sample];
+        if (vertexIndex_[sample] != kUnusedVertex || std::isnan(z)) {
+            continue;
+        }
+        vertexIndex_[sample] = vertexCount++;
+        equation.vertices.emplace_back(xSamples[sample % gridSize], z, ySamples[sample / gridSize]);
+        equation.vertices.push_back(color);
+        minHeight_ = std::min(minHeight_, z);
+        maxHeight_ = std::max(maxHeight_, z);
+    }
+}
+
+void EquationGenerator::sortTrianglesIntoBlocks() {
+    const uint32_t gridSize = rtin_.getGridSize();
+    const uint32_t blocksPerSide = (gridSize - 1 + MESH_CHUNK_CELLS - 1) / MESH_CHUNK_CELLS;
+    auto blockOf = [&](const uint32_t* samples) {
+        const uint32_t col = (samples[0] % gridSize + samples[1] % gridSize + samples[2] % gridSize) / 3;
+        const uint32_t row = (samples[0] / gridSize + samples[1] / gridSize + samples[2] / gridSize) / 3;
+        return std::min(row / MESH_CHUNK_CELLS, blocksPerSide - 1) * blocksPerSide +
+               std::min(col / MESH_CHUNK_CELLS, blocksPerSide - 1);
+    };
 
-        for (float x : xSamples) {
-            float y = safeEvaluate(parser, x, 0.0f, equation.is3D);
-            if (!std::isnan(y)) {
-                equation.vertices.emplace_back(x, y, 0.0f);
-                equation.vertices.emplace_back(glm::vec3(equation.color[0], equation.color[1], equation.color[2]));
-                minHeight_ = std::min(minHeight_, y);
-                maxHeight_ = std::max(maxHeight_, y);
+    // Counting sort, stable within a block.
+    blockStarts_.assign(static_cast<size_t>(blocksPerSide) * blocksPerSide + 1, 0);
+    for (size_t t = 0; t < triangles_.size(); t += 3) {
+        blockStarts_[blockOf(&triangles_[t]) + 1] += 3;
+    }
+    for (size_t block = 1; block < blockStarts_.size(); ++block) {
+        blockStarts_[block] += blockStarts_[block - 1];
+    }
+    triangleScratch_.resize(triangles_.size());
+    blockNext_.assign(blockStarts_.begin(), blockStarts_.end() - 1);
+    for (size_t t = 0; t < triangles_.size(); t += 3) {
+        uint32_t& at = blockNext_[blockOf(&triangles_[t])];
+        std::copy_n(&triangles_[t], 3, &triangleScratch_[at]);
+        at += 3;
+    }
+    triangles_.swap(triangleScratch_);
+}
+
+void EquationGenerator::emitLatticeRows(Equation& equation, const std::vector<float>& xSamples,
+                                        const std::vector<float>& ySamples) {
+    const uint32_t gridSize = rtin_.getGridSize();
+    const glm::vec3 color(equation.color[0], equation.color[1], equation.color[2]);
+    vertexIndex_.assign(lattice_.size(), kUnusedVertex);
+    for (uint32_t& sample : triangles_) {
+        sample = domainSample(sample);
+        vertexIndex_[sample] = 0; // used
+    }
+
+    uint32_t vertexCount = 0;
+    for (uint32_t row = 0; row < latticeRows_; ++row) {
+        bool open = false;
+        for (uint32_t col = 0; col < latticeCols_; ++col) {
+            const uint32_t sample = row * gridSize + col;
+            const float z = lattice_[sample];
+            if (std::isnan(z)) {
+                open = false;
+                continue;
+            }
+            if (vertexIndex_[sample] == kUnusedVertex) {
+                continue;
             }
+            if (!open) {
+                equation.strips.push_back({vertexCount, 0});
+                open = true;
+            }
+            vertexIndex_[sample] = vertexCount++;
+            ++equation.strips.back().count;
+            equation.vertices.emplace_back(xSamples[col], z, ySamples[row]);
+            equation.vertices.push_back(color);
+            minHeight_ = std::min(minHeight_, z);
+            maxHeight_ = std::max(maxHeight_, z);
+        }
+    }
+}
+
+bool EquationGenerator::meshTriangle(const Equation& equation, const uint32_t* samples,
+                                     std::array<uint32_t, 3>& triangle) const {
+    for (int i = 0; i < 3; ++i) {
+        triangle[i] = vertexIndex_[samples[i]];
+        if (triangle[i] == kUnusedVertex) {
+            return false;
         }
     }
+    // Triangles in the collapsed lattice past the domain have no area.
+    const glm::vec3& a = equation.vertices[triangle[0] * 2];
+    const glm::vec3& b = equation.vertices[triangle[1] * 2];
+    const glm::vec3& c = equation.vertices[triangle[2] * 2];
+    return (b.x - a.x) * (c.z - a.z) != (c.x - a.x) * (b.z - a.z);
 }
 
-std::vector<float> EquationGenerator::adaptiveSample(
-    const std::function<float(float)>& func,
+void EquationGenerator::emitSurfaceChunks(Equation& equation, float maxError, float range,
+                                          const std::vector<float>& xSamples,
+                                          const std::vector<float>& ySamples) {
+    const uint32_t gridSize = rtin_.getGridSize();
+    const uint32_t cells = gridSize - 1;
+    const uint32_t chunkCells = std::min(cells, std::max(cells / kLodChunksPerSide, 1u << kMinLatticeLevel));
+    SurfaceLod& lod = equation.lod;
+    lod.columns = static_cast<uint32_t>(std::max<size_t>(latticeCols_, 2) - 2) / chunkCells + 1;
+    lod.rows = static_cast<uint32_t>(std::max<size_t>(latticeRows_, 2) - 2) / chunkCells + 1;
+    lod.levels = kLodLevels;
+
+    // Level 0 is the mesh generateVertices would build; each coarser level allows
+    // kLodErrorRatio times the error of the one before, from a fraction of the height range.
+    std::array<float, kLodLevels + 1> thresholds;
+    thresholds[0] = maxError;
+    float bound = std::max({maxError, kLodBaseTolerance * range, 0.0f});
+    for (int level = 1; level <= kLodLevels; ++level) {
+        bound *= kLodErrorRatio;
+        thresholds[level] = std::max(thresholds[level - 1], bound);
+    }
+
+    // Extract every chunk at every level; a level with as many triangles as the finer one is
+    // the same cut of the hierarchy and shares its triangles.
+    struct ChunkLevel {
+        uint32_t first;
+        uint32_t count;
+        float error;
+    };
+    std::vector<ChunkLevel> chunkLevels;
+    chunkLevels.reserve(static_cast<size_t>(lod.columns) * lod.rows * kLodLevels);
+    triangles_.clear();
+    for (uint32_t row = 0; row < lod.rows; ++row) {
+        for (uint32_t col = 0; col < lod.columns; ++col) {
+            for (int level = 0; level < kLodLevels; ++level) {
+                const uint32_t first = static_cast<uint32_t>(triangles_.size());
+                const float error = rtin_.extractSquare(col * chunkCells, row * chunkCells, chunkCells,
+                                                        thresholds[level], triangles_);
+                const uint32_t count = static_cast<uint32_t>(triangles_.size()) - first;
+                if (level > 0 && count == chunkLevels.back().count) {
+                    triangles_.resize(first);
+                    chunkLevels.push_back(chunkLevels.back());
+                } else {
+                    chunkLevels.push_back({first, count, error});
+                }
+            }
+        }
+    }
+    if (isCancelled()) {
+        return;
+    }
+    // Coarser levels only use samples of the finest one, so this emits the same vertices.
+    emitLatticeVertices(equation, xSamples, ySamples);
+
+    std::unordered_map<uint32_t, uint32_t> skirtVertex; // lattice sample -> skirt vertex
+    std::array<uint32_t, 3> triangle;
+    lod.chunks.resize(static_cast<size_t>(lod.columns) * lod.rows);
+    for (size_t c = 0; c < lod.chunks.size(); ++c) {
+        SurfaceChunk& chunk = lod.chunks[c];
+        const uint32_t x0 = static_cast<uint32_t>(c % lod.columns) * chunkCells;
+        const uint32_t y0 = static_cast<uint32_t>(c / lod.columns) * chunkCells;
+        const uint32_t x1 = x0 + chunkCells;
+        const uint32_t y1 = y0 + chunkCells;
+        // Only borders shared with another chunk get skirts; samples were already moved
+        // inside the domain, which leaves inner borders where they are.
+        auto innerBorder = [&](uint32_t a, uint32_t b) {
+            const uint32_t ax = a % gridSize, ay = a / gridSize;
+            const uint32_t bx = b % gridSize, by = b / gridSize;
+            return (ax == bx && ((ax == x0 && x0 > 0) || (ax == x1 && x1 + 1 < latticeCols_))) ||
+                   (ay == by && ((ay == y0 && y0 > 0) || (ay == y1 && y1 + 1 < latticeRows_)));
+        };
+
+        chunk.boundsMin = glm::vec3(std::numeric_limits<float>::max());
+        chunk.boundsMax = glm::vec3(-std::numeric_limits<float>::max());
+        for (int level = 0; level < kLodLevels; ++level) {
+            const ChunkLevel& source = chunkLevels[c * kLodLevels + level];
+            chunk.errors.push_back(source.error);
+
+            if (level > 0 && source.first == chunkLevels[c * kLodLevels + level - 1].first) {
+                chunk.triangles.push_back(chunk.triangles.back());
+            } else {
+                IndexRange mesh{static_cast<uint32_t>(lod.indices.size()), 0};
+                for (uint32_t t = source.first; t < source.first + source.count; t += 3) {
+                    if (!meshTriangle(equation, &triangles_[t], triangle)) {
+                        continue;
+                    }
+                    lod.indices.insert(lod.indices.end(), triangle.begin(), triangle.end());
+                    if (level == 0) {
+                        for (uint32_t vertex : triangle) {
+                            chunk.boundsMin = glm::min(chunk.boundsMin, equation.vertices[vertex * 2]);
+                            chunk.boundsMax = glm::max(chunk.boundsMax, equation.vertices[vertex * 2]);
+                        }
+                    }
+                }
+                mesh.count = static_cast<uint32_t>(lod.indices.size()) - mesh.first;
+                chunk.triangles.push_back(mesh);
+            }
+
+            // A neighbour is at most one level coarser, so the seam is within this level's
+            // error plus the next level's threshold; the height range bounds it anyway.
+            const float depth = std::min(source.error + thresholds[level + 1], range);
+            IndexRange skirts{static_cast<uint32_t>(lod.indices.size()), 0};
+            skirtVertex.clear();
+            auto skirtOf = [&](uint32_t sample, uint32_t vertex) {
+                const auto [it, inserted] = skirtVertex.try_emplace(sample, 0);
+                if (inserted) {
+                    const glm::vec3 position = equation.vertices[vertex * 2] - glm::vec3(0.0f, depth, 0.0f);
+                    const glm::vec3 color = equation.vertices[vertex * 2 + 1];
+                    it->second = static_cast<uint32_t>(equation.vertices.size() / 2);
+                    equation.vertices.push_back(position);
+                    equation.vertices.push_back(color);
+                }
+                return it->second;
+            };
+            for (uint32_t t = source.first; depth > 0.0f && t < source.first + source.count; t += 3) {
+                if (!meshTriangle(equation, &triangles_[t], triangle)) {
+                    continue;
+                }
+                for (int e = 0; e < 3; ++e) {
+                    const uint32_t a = triangles_[t + e];
+                    const uint32_t b = triangles_[t + (e + 1) % 3];
+                    if (a == b || !innerBorder(a, b)) {
+                        continue;
+                    }
+                    const uint32_t va = triangle[e];
+                    const uint32_t vb = triangle[(e + 1) % 3];
+                    const uint32_t sa = skirtOf(a, va);
+                    const uint32_t sb = skirtOf(b, vb);
+                    lod.indices.insert(lod.indices.end(), {va, vb, sb, va, sb, sa});
+                }
+            }
+            skirts.count = static_cast<uint32_t>(lod.indices.size()) - skirts.first;
+            chunk.skirts.push_back(skirts);
+        }
+    }
+}
+
+size_t EquationGenerator::countSurfaceVertices(float maxError) {
+    triangles_.clear();
+    rtin_.extractTriangles(maxError, triangles_);
+    vertexIndex_.resize(triangles_.size());
+    std::transform(triangles_.begin(), triangles_.end(), vertexIndex_.begin(),
+                   [this](uint32_t sample) { return domainSample(sample); });
+    std::sort(vertexIndex_.begin(), vertexIndex_.end());
+    const auto end = std::unique(vertexIndex_.begin(), vertexIndex_.end());
+    return std::count_if(vertexIndex_.begin(), end, [this](uint32_t i) { return !std::isnan(lattice_[i]); });
+}
+
+float EquationGenerator::fitSampleBudget(size_t budget) {
+    if (countSurfaceVertices(-1.0f) <= budget) {
+        return -1.0f;
+    }
+
+    // Vertex count only grows as the threshold drops, so bisect between 0 and the largest
+    // finite error for the smallest threshold that fits.
+    float hi = 0.0f;
+    for (float error : rtin_.getErrors()) {
+        if (std::isfinite(error)) {
+            hi = std::max(hi, error);
+        }
+    }
+    float lo = 0.0f;
+    if (countSurfaceVertices(hi) > budget) {
+        // Domain edges alone exceed the budget, so they have to coarsen as well. Past
+        // gridSize × base nothing is split and the mesh is the four corners.
+        const float base = hi > 0.0f ? hi : 1.0f;
+        rtin_.limitUndefinedErrors(base);
+        lo = hi;
+        hi = base * float(rtin_.getGridSize());
+    }
+    for (int i = 0; i < kBudgetSearchSteps && lo < hi && !isCancelled(); ++i) {
+        const float mid = (lo + hi) * 0.5f;
+        if (countSurfaceVertices(mid) <= budget) {
+            hi = mid;
+        } else {
+            lo = mid;
+        }
+    }
+    return hi;
+}
+
+void EquationGenerator::estimateSlope(const Sample* left, Sample& sample, const Sample* right) {
+    if (!std::isnan(sample.f.dx) || std::isnan(sample.f.value)) {
+        return;
+    }
+    const bool hasLeft = left && std::isfinite(left->f.value);
+    const bool hasRight = right && std::isfinite(right->f.value);
+    if (hasLeft && hasRight) {
+        sample.f.dx = (right->f.value - left->f.value) / (right->x - left->x);
+    } else if (hasLeft) {
+        sample.f.dx = (sample.f.value - left->f.value) / (sample.x - left->x);
+    } else if (hasRight) {
+        sample.f.dx = (right->f.value - sample.f.value) / (right->x - sample.x);
+    } else {
+        sample.f.dx = 0.0f;
+    }
+}
+
+void EquationGenerator::budgetSample(
+    const std::function<DualNumber(float)>& func,
     float min,
     float max,
     int maxDepth,
-    double derivativeThreshold
-) const {
-    std::vector<float> samples;
-    constexpr double epsilon = 1e-6;
+    size_t budget,
+    std::vector<float>& xs,
+    std::vector<float>& values,
+    const std::function<Interval(float, float)>& bounds
+) {
+    xs.clear();
+    values.clear();
 
-    std::function<void(float, float, float, float, int)> subdivide = 
-        [&](float x0, float x1, float y0, float y1, int depth) {
-            if (depth >= maxDepth) {
-                samples.push_back(x0);
-                return;
+    // Samples form a linked list in x order; new samples are spliced in after their left end.
+    const size_t baseSampleCount = std::clamp<size_t>(budget, 2, 100);
+    baseSamples_.resize(baseSampleCount);
+    sampleNext_.resize(baseSampleCount);
+    for (size_t i = 0; i < baseSampleCount; ++i) {
+        const float x = i + 1 < baseSampleCount ? min + (max - min) * (i / float(baseSampleCount - 1)) : max;
+        baseSamples_[i] = {x, func(x)};
+        sampleNext_[i] = static_cast<uint32_t>(i + 1);
+    }
+    for (size_t i = 0; i < baseSampleCount; ++i) {
+        estimateSlope(i > 0 ? &baseSamples_[i - 1] : nullptr, baseSamples_[i],
+                      i + 1 < baseSampleCount ? &baseSamples_[i + 1] : nullptr);
+    }
+
+    // Estimated vertical error of drawing [start, end] as a straight line, or < 0 if the
+    // segment cannot or need not be split.
+    auto estimate = [&](uint32_t start, uint32_t end, int depth) {
+        if (depth >= maxDepth) {
+            return -1.0;
+        }
+        const Sample& a = baseSamples_[start];
+        const Sample& b = baseSamples_[end];
+        const double length = b.x - a.x;
+        Interval range = Interval::entire();
+        if (bounds) {
+            range = bounds(a.x, b.x);
+            if (range.isUndefined()) {
+                return -1.0;
             }
+        }
+        const bool undefinedA = std::isnan(a.f.value);
+        const bool undefinedB = std::isnan(b.f.value);
+        if (undefinedA != undefinedB) {
+            // A domain edge; resolve it before any smooth segment.
+            return std::numeric_limits<double>::infinity();
+        }
+        if (undefinedA) {
+            // Only the bounds can tell that a defined region may lie in between.
+            return bounds ? length : -1.0;
+        }
 
-            const float xMid = (x0 + x1) * 0.5f;
-            const float yMid = func(xMid);
+        // A cubic through both ends with the end slopes bulges away from the chord by about
+        // a quarter of the segment times the slope mismatch.
+        const double secant = (double(b.f.value) - a.f.value) / length;
+        double error = 0.25 * length * (std::abs(a.f.dx - secant) + std::abs(b.f.dx - secant));
+        if (bounds) {
+            // Variation the end samples missed, e.g. a spike between them.
+            error = std::max({error, range.hi - std::max(a.f.value, b.f.value),
+                              std::min(a.f.value, b.f.value) - range.lo});
+        }
+        if (std::isnan(error)) {
+            return std::numeric_limits<double>::infinity();
+        }
+        // Rounding in the slopes and the padding of the bounds are not worth a sample.
+        const double magnitude = std::max({1.0, std::abs(double(a.f.value)), std::abs(double(b.f.value))});
+        return error > kBudgetErrorFloor * magnitude ? error : -1.0;
+    };
 
-            const float dyLeft = std::abs((yMid - y0) / (xMid - x0 + epsilon));
-            const float dyRight = std::abs((y1 - yMid) / (x1 - xMid + epsilon));
+    auto byError = [](const BudgetSegment& a, const BudgetSegment& b) { return a.error < b.error; };
+    budgetQueue_.clear();
+    auto push = [&](uint32_t start, uint32_t end, int depth) {
+        const double error = estimate(start, end, depth);
+        if (error > 0.0) {
+            budgetQueue_.push_back({error, start, end, depth});
+            std::push_heap(budgetQueue_.begin(), budgetQueue_.end(), byError);
+        }
+    };
+    for (size_t i = 0; i + 1 < baseSampleCount; ++i) {
+        push(static_cast<uint32_t>(i), static_cast<uint32_t>(i + 1), 0);
+    }
 
-            if (dyLeft > derivativeThreshold || dyRight > derivativeThreshold) {
-                subdivide(x0, xMid, y0, yMid, depth + 1);
-                subdivide(xMid, x1, yMid, y1, depth + 1);
-            } else {
-                samples.push_back(x0);
-            }
-        };
+    // Split the worst segment until the budget is spent or nothing is left to improve.
+    while (baseSamples_.size() < budget && !budgetQueue_.empty() && !isCancelled()) {
+        std::pop_heap(budgetQueue_.begin(), budgetQueue_.end(), byError);
+        const BudgetSegment segment = budgetQueue_.back();
+        budgetQueue_.pop_back();
+
+        const float xMid = (baseSamples_[segment.start].x + baseSamples_[segment.end].x) * 0.5f;
+        const uint32_t middle = static_cast<uint32_t>(baseSamples_.size());
+        baseSamples_.push_back({xMid, func(xMid)});
+        estimateSlope(&baseSamples_[segment.start], baseSamples_.back(), &baseSamples_[segment.end]);
+        sampleNext_.push_back(segment.end);
+        sampleNext_[segment.start] = middle;
+        push(segment.start, middle, segment.depth + 1);
+        push(middle, segment.end, segment.depth + 1);
+    }
+
+    const uint32_t last = static_cast<uint32_t>(baseSampleCount - 1);
+    for (uint32_t i = 0;; i = sampleNext_[i]) {
+        xs.push_back(baseSamples_[i].x);
+        values.push_back(baseSamples_[i].f.value);
+        if (i == last) {
+            break;
+        }
+    }
+}
+
+void EquationGenerator::adaptiveSample(
+    const std::function<DualNumber(float)>& func,
+    float min,
+    float max,
+    int maxDepth,
+    double derivativeThreshold,
+    std::vector<float>& xs,
+    std::vector<float>& values,
+    const std::function<Interval(float, float)>& bounds
+) {
+    xs.clear();
+    values.clear();
 
-    // Create base samples
+    // Create base samples; each is evaluated once and shared by its neighbours.
     const int baseSampleCount = 100;
-    std::vector<float> baseX;
+    baseSamples_.resize(baseSampleCount);
     for (int i = 0; i < baseSampleCount; ++i) {
-        baseX.push_back(min + (max - min) * (i / float(baseSampleCount - 1)));
+        const float x = i + 1 < baseSampleCount ? min + (max - min) * (i / float(baseSampleCount - 1)) : max;
+        baseSamples_[i] = {x, func(x)};
+    }
+    for (int i = 0; i < baseSampleCount; ++i) {
+        estimateSlope(i > 0 ? &baseSamples_[i - 1] : nullptr, baseSamples_[i],
+                      i + 1 < baseSampleCount ? &baseSamples_[i + 1] : nullptr);
     }
 
-    // Apply adaptive sampling
-    for (size_t i = 0; i < baseX.size() - 1; ++i) {
-        const float x0 = baseX[i];
-        const float x1 = baseX[i + 1];
-        subdivide(x0, x1, func(x0), func(x1), 0);
+    // The turning-angle test works in domain-normalized units: x over the domain width and y
+    // over the spread of the base samples, as a plot fitted to the screen would show them.
+    double slopeScale = 1.0;
+    if (curveRefinement_ == CurveRefinement::TurningAngle) {
+        float lo = std::numeric_limits<float>::max();
+        float hi = -std::numeric_limits<float>::max();
+        for (const Sample& sample : baseSamples_) {
+            if (std::isfinite(sample.f.value)) {
+                lo = std::min(lo, sample.f.value);
+                hi = std::max(hi, sample.f.value);
+            }
+        }
+        const double spread = lo < hi ? double(hi) - lo : 1.0;
+        slopeScale = (double(max) - min) / spread;
     }
+    const double tanTolerance = std::tan(angleTolerance_);
 
-    samples.push_back(max);
-    std::sort(samples.begin(), samples.end());
-    return samples;
-}
+    // Depth-first over an explicit stack; pushing the right half first emits samples in order.
+    for (int i = 0; i + 1 < baseSampleCount && !isCancelled(); ++i) {
+        segments_.push_back({baseSamples_[i], baseSamples_[i + 1], 0});
+        while (!segments_.empty()) {
+            const SampleSegment segment = segments_.back();
+            segments_.pop_back();
+            const float x0 = segment.start.x;
+            const float x1 = segment.end.x;
+            const DualNumber& f0 = segment.start.f;
+            const DualNumber& f1 = segment.end.f;
 
-float EquationGenerator::safeEvaluate(EquationParser& parser, float x, float y, bool /* is3D */) const {
-    try {
-        return parser.evaluate(x, y);
-    }
-    catch (...) {
-        return std::nanf("");
+            bool refine = false;
+            if (segment.depth < maxDepth) {
+                const bool byAngle = curveRefinement_ == CurveRefinement::TurningAngle;
+                const double secant = (double(f1.value) - f0.value) / (x1 - x0);
+
+                // Variation a segment may hide without failing its test: a slope test on
+                // halves of the segment cannot exceed the threshold when the whole range fits
+                // in half a segment's worth of slope, and a bump a quarter of the tolerance's
+                // slope high turns the curve by about the tolerance.
+                const double slack = byAngle ? tanTolerance * (x1 - x0) * 0.25 / slopeScale
+                                             : derivativeThreshold * (x1 - x0) * 0.5;
+                Interval range = Interval::entire();
+                bool settled = false;
+                if (bounds) {
+                    range = bounds(x0, x1);
+                    settled = range.isUndefined() || (!range.mayBeUndefined && range.width() <= slack);
+                }
+
+                if (!settled && byAngle) {
+                    // The drawn curve turns away from the chord at either end by more than
+                    // the tolerance; straight lines never split, however steep.
+                    const double chord = std::atan(secant * slopeScale);
+                    refine = std::abs(std::atan(f0.dx * slopeScale) - chord) +
+                             std::abs(std::atan(f1.dx * slopeScale) - chord) > angleTolerance_;
+                } else if (!settled) {
+                    // Steep at either end, or the end slopes disagree with the chord, which
+                    // means the curve turns somewhere inside the segment.
+                    refine = std::abs(f0.dx) > derivativeThreshold || std::abs(f1.dx) > derivativeThreshold ||
+                             std::abs(f0.dx - secant) + std::abs(f1.dx - secant) > derivativeThreshold;
+                }
+
+                if (!settled && !refine && bounds) {
+                    if (std::isnan(f0.value) || std::isnan(f1.value)) {
+                        // The segment touches a domain boundary, or a defined region the
+                        // bounds could not rule out lies between two undefined ends.
+                        refine = true;
+                    } else {
+                        // Variation the end samples missed, e.g. a spike between them.
+                        const double sampledLo = std::min(f0.value, f1.value);
+                        const double sampledHi = std::max(f0.value, f1.value);
+                        refine = range.hi - sampledHi > slack || sampledLo - range.lo > slack;
+                    }
+                }
+            }
+
+            if (refine) {
+                const float xMid = (x0 + x1) * 0.5f;
+                Sample middle{xMid, func(xMid)};
+                estimateSlope(&segment.start, middle, &segment.end);
+                segments_.push_back({middle, segment.end, segment.depth + 1});
+                segments_.push_back({segment.start, middle, segment.depth + 1});
+            } else {
+                xs.push_back(x0);
+                values.push_back(f0.value);
+            }
+        }
     }
+
+    xs.push_back(baseSamples_.back().x);
+    values.push_back(baseSamples_.back().f.value);
 }
 
 } // namespace graphgl
@@ -1,82 +1,329 @@
 #include "equation_parser.h"
+#include "expression_optimizer.h"
 #include "../lib/exprtk/exprtk.hpp"
 #include <iostream>
 #include <cmath>
+#include <algorithm>
 
 namespace graphgl {
 
-class EquationParser::Impl {
-public:
+namespace {
+
+/// An ExprTk expression bound to its own x/y/z variables.
+struct ExprtkInstance {
     exprtk::symbol_table<float> symbolTable;
     exprtk::expression<float> expression;
-    exprtk::parser<float> parser;
-    
+
     float x = 0.0f;
     float y = 0.0f;
     float z = 0.0f;
-    
-    bool is3D = true;
-    
-    void setupSymbolTable() {
+
+    ExprtkInstance() {
         constexpr double e = 2.71828182845904523536028747135266249775724709369996;
-        
+
         symbolTable.add_constant("e", e);
         symbolTable.add_pi();
         symbolTable.add_variable("x", x);
         symbolTable.add_variable("y", y);
         symbolTable.add_variable("z", z);
-        
+
         expression.register_symbol_table(symbolTable);
     }
+
+    ExprtkInstance(const ExprtkInstance&) = delete;
+    ExprtkInstance& operator=(const ExprtkInstance&) = delete;
+};
+
+} // namespace
+
+class CompiledExpression::Context::Fallback {
+public:
+    ExprtkInstance instance;
+    bool isValid = false;
+    size_t evaluations = 0;
+};
+
+class EquationParser::Impl {
+public:
+    exprtk::parser<float> parser;
+    ExprtkInstance validation;
+    std::unique_ptr<CompiledExpression::Context> context;
 };
 
+CompiledExpression::CompiledExpression(std::string source, bool is3D, ExpressionProgram program,
+                                       std::shared_ptr<const NativeKernel> nativeKernel)
+    : source_(std::move(source))
+    , is3D_(is3D)
+    , program_(std::move(program))
+    , simd_(program_)
+    , separable_(is3D_ ? SeparableExpression::detect(program_) : nullptr)
+    , symmetry_(is3D_ && !program_.empty() ? SurfaceSymmetry::analyze(program_) : SurfaceSymmetry())
+    , nativeKernel_(std::move(nativeKernel))
+    , preset_(findPresetKernel(program_))
+{
+}
+
+CompiledExpression::Context CompiledExpression::createContext() const {
+    return Context(*this);
+}
+
+CompiledExpression::Context::Context(const CompiledExpression& expression)
+    : expression_(&expression)
+{
+    if (expression.hasProgram()) {
+        registers_.resize(expression.getProgram().size());
+        size_t scratchSize = expression.getSimdEvaluator().getScratchSize();
+        if (expression.getSeparable()) {
+            scratchSize = std::max(scratchSize, expression.getSeparable()->getScratchSize());
+        }
+        simdScratch_.resize(scratchSize);
+        return;
+    }
+
+    // Expressions outside the interpreter's grammar need their own ExprTk instance per thread.
+    fallback_ = std::make_unique<Fallback>();
+    exprtk::parser<float> parser;
+    fallback_->isValid = parser.compile(expression.getSource(), fallback_->instance.expression);
+}
+
+CompiledExpression::Context::~Context() = default;
+CompiledExpression::Context::Context(Context&& other) noexcept = default;
+CompiledExpression::Context& CompiledExpression::Context::operator=(Context&& other) noexcept = default;
+
+float CompiledExpression::Context::evaluate(float x, float y) {
+    // Single samples skip the block setup of the vectorized path.
+    if (!fallback_) {
+        return expression_->getProgram().evaluate(x, expression_->is3D() ? y : 0.0f, registers_.data());
+    }
+
+    float result;
+    evaluateBatch(&x, &y, &result, 1);
+    return result;
+}
+
+void CompiledExpression::Context::evaluateBatch(const float* xs, const float* ys, float* out, size_t count) {
+    const bool useY = expression_->is3D() && ys;
+
+    if (!fallback_) {
+        if (const PresetKernel* preset = expression_->getPresetKernel()) {
+            preset->evaluateBatch(xs, useY ? ys : nullptr, out, count);
+            return;
+        }
+        if (const NativeKernel* native = expression_->getNativeKernel()) {
+            native->evaluateBatch(xs, useY ? ys : nullptr, out, count);
+            return;
+        }
+        const SimdEvaluator& simd = expression_->getSimdEvaluator();
+        if (simd.isValid()) {
+            simd.evaluateBatch(xs, useY ? ys : nullptr, out, count, simdScratch_.data());
+            return;
+        }
+        const ExpressionProgram& program = expression_->getProgram();
+        for (size_t i = 0; i < count; ++i) {
+            out[i] = program.evaluate(xs[i], useY ? ys[i] : 0.0f, registers_.data());
+        }
+        return;
+    }
+
+    if (!fallback_->isValid) {
+        std::fill(out, out + count, std::nanf(""));
+        return;
+    }
+
+    // One try block covers a whole run of samples; if a sample throws, it is
+    // written as NaN and the loop resumes with the next one.
+    fallback_->evaluations += count;
+    ExprtkInstance& instance = fallback_->instance;
+    instance.z = 0.0f;
+    size_t i = 0;
+    while (i < count) {
+        try {
+            for (; i < count; ++i) {
+                instance.x = xs[i];
+                instance.y = useY ? ys[i] : 0.0f;
+                out[i] = instance.expression.value();
+            }
+        }
+        catch (...) {
+            out[i++] = std::nanf("");
+        }
+    }
+}
+
+void CompiledExpression::Context::evaluateGrid(const float* xs, size_t xCount, const float* ys, size_t yCount,
+                                               float* out) {
+    const bool useY = expression_->is3D();
+
+    if (!fallback_) {
+        if (const SeparableExpression* separable = expression_->getSeparable()) {
+            separable->evaluateGrid(xs, xCount, ys, yCount, out, simdScratch_.data(), axisValues_);
+            return;
+        }
+        if (const PresetKernel* preset = expression_->getPresetKernel()) {
+            preset->evaluateGrid(xs, xCount, useY ? ys : nullptr, yCount, out);
+            return;
+        }
+        if (const NativeKernel* native = expression_->getNativeKernel()) {
+            native->evaluateGrid(xs, xCount, useY ? ys : nullptr, yCount, out);
+            return;
+        }
+        const SimdEvaluator& simd = expression_->getSimdEvaluator();
+        if (simd.isValid()) {
+            simd.evaluateGrid(xs, xCount, ys, yCount, out, simdScratch_.data());
+            return;
+        }
+        const ExpressionProgram& program = expression_->getProgram();
+        for (size_t row = 0; row < yCount; ++row) {
+            const float y = useY ? ys[row] : 0.0f;
+            float* rowOut = out + row * xCount;
+            for (size_t col = 0; col < xCount; ++col) {
+                rowOut[col] = program.evaluate(xs[col], y, registers_.data());
+            }
+        }
+        return;
+    }
+
+    if (!fallback_->isValid) {
+        std::fill(out, out + xCount * yCount, std::nanf(""));
+        return;
+    }
+
+    fallback_->evaluations += xCount * yCount;
+    ExprtkInstance& instance = fallback_->instance;
+    instance.z = 0.0f;
+    for (size_t row = 0; row < yCount; ++row) {
+        instance.y = useY ? ys[row] : 0.0f;
+        float* rowOut = out + row * xCount;
+        size_t col = 0;
+        while (col < xCount) {
+            try {
+                for (; col < xCount; ++col) {
+                    instance.x = xs[col];
+                    rowOut[col] = instance.expression.value();
+                }
+            }
+            catch (...) {
+                rowOut[col++] = std::nanf("");
+            }
+        }
+    }
+}
+
+Interval CompiledExpression::Context::evaluateInterval(const Interval& x, const Interval& y) {
+    if (fallback_) {
+        return Interval::entire();
+    }
+    const ExpressionProgram& program = expression_->getProgram();
+    intervalRegisters_.resize(program.size());
+    return graphgl::evaluateInterval(program, x, expression_->is3D() ? y : Interval::point(0.0),
+                                     intervalRegisters_.data());
+}
+
+size_t CompiledExpression::Context::getFallbackEvaluations() const {
+    return fallback_ ? fallback_->evaluations : 0;
+}
+
+DualNumber CompiledExpression::Context::evaluateGradient(float x, float y) {
+    if (!expression_->is3D()) {
+        y = 0.0f;
+    }
+    if (!fallback_) {
+        const ExpressionProgram& program = expression_->getProgram();
+        dualRegisters_.resize(program.size());
+        return evaluateDual(program, x, y, dualRegisters_.data());
+    }
+
+    // ExprTk has no derivative form; difference around the sample with a step relative to it.
+    auto step = [](float v) { return 1e-3f * std::max(1.0f, std::abs(v)); };
+    const float hx = step(x);
+    DualNumber result;
+    result.value = evaluate(x, y);
+    result.dx = (evaluate(x + hx, y) - evaluate(x - hx, y)) / (2.0f * hx);
+    if (expression_->is3D()) {
+        const float hy = step(y);
+        result.dy = (evaluate(x, y + hy) - evaluate(x, y - hy)) / (2.0f * hy);
+    }
+    return result;
+}
+
 EquationParser::EquationParser()
     : pImpl_(std::make_unique<Impl>())
     , isValid_(false)
     , errorMessage_("")
 {
-    pImpl_->setupSymbolTable();
 }
 
 EquationParser::~EquationParser() = default;
 
-bool EquationParser::parseExpression(const std::string& expr, bool is3D) {
+std::shared_ptr<const CompiledExpression> EquationParser::parseExpression(const std::string& expr, bool is3D) {
     isValid_ = false;
     errorMessage_.clear();
+    compiled_.reset();
+    pImpl_->context.reset();
     
     if (expr.empty()) {
         errorMessage_ = "Expression is empty";
-        return false;
+        return nullptr;
     }
     
-    pImpl_->is3D = is3D;
-    
-    // Compile the expression
-    if (!pImpl_->parser.compile(expr, pImpl_->expression)) {
+    // ExprTk remains the reference for what is valid syntax.
+    if (!pImpl_->parser.compile(expr, pImpl_->validation.expression)) {
         errorMessage_ = "Failed to compile expression: " + expr;
-        return false;
+        return nullptr;
+    }
+
+    // Lowering may fail for syntax the interpreter does not cover; contexts then use ExprTk.
+    ExpressionProgram program;
+    std::shared_ptr<const NativeKernel> nativeKernel;
+    if (ExpressionProgram::parse(expr, is3D, program)) {
+        program = optimizeExpression(program);
+        // Without a compiler the kernel is null and the interpreter is used as before.
+        // Presets already have a specialized kernel.
+        if (nativeKernels_ && !findPresetKernel(program)) {
+            nativeKernel = nativeKernels_->load(program);
+        }
     }
+
+    compiled_ = std::make_shared<const CompiledExpression>(expr, is3D, std::move(program), std::move(nativeKernel));
+    pImpl_->context = std::make_unique<CompiledExpression::Context>(*compiled_);
     
     isValid_ = true;
-    return true;
+    return compiled_;
 }
 
 float EquationParser::evaluate(float x, float y) const {
     if (!isValid_) {
         return std::nanf("");
     }
-    
-    try {
-        pImpl_->x = x;
-        pImpl_->y = pImpl_->is3D ? y : 0.0f;
-        pImpl_->z = 0.0f;
-        
-        return pImpl_->expression.value();
-    }
-    catch (...) {
-        return std::nanf("");
+    return pImpl_->context->evaluate(x, y);
+}
+
+void EquationParser::evaluateBatch(const float* xs, const float* ys, float* out, size_t count) const {
+    if (!isValid_) {
+        std::fill(out, out + count, std::nanf(""));
+        return;
     }
+    pImpl_->context->evaluateBatch(xs, ys, out, count);
 }
 
-} // namespace graphgl
+void EquationParser::evaluateGrid(const float* xs, size_t xCount, const float* ys, size_t yCount,
+                                  float* out) const {
+    if (!isValid_) {
+        std::fill(out, out + xCount * yCount, std::nanf(""));
+        return;
+    }
+    pImpl_->context->evaluateGrid(xs, xCount, ys, yCount, out);
+}
+
+size_t EquationParser::getFallbackEvaluations() const {
+    return pImpl_->context ? pImpl_->context->getFallbackEvaluations() : 0;
+}
 
+DualNumber EquationParser::evaluateGradient(float x, float y) const {
+    if (!isValid_) {
+        return {std::nanf(""), std::nanf(""), std::nanf("")};
+    }
+    return pImpl_->context->evaluateGradient(x, y);
+}
+
+} // namespace graphgl
@@ -1,6 +1,8 @@
 #include "equation_renderer.h"
 #include <glad/glad.h>
-#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <limits>
 
 namespace graphgl {
 
@@ -8,11 +10,37 @@ namespace graphgl {
 constexpr size_t kFloatsPerVertex = 6;
 constexpr size_t kVertexStride = kFloatsPerVertex * sizeof(float);
 
+// Index ranges are counted in 4-byte units so 32-bit indices stay aligned after 16-bit ones.
+constexpr size_t kIndexUnitBytes = sizeof(unsigned int);
+
+// Starting sizes of the shared buffers; they double when full.
+constexpr size_t kInitialVertices = size_t(1) << 16;
+constexpr size_t kInitialIndexUnits = size_t(1) << 17;
+
+// Texture unit of the draw records; ImGui uses unit 0.
+constexpr int kRecordTextureUnit = 1;
+
+namespace {
+
+uint32_t floatBits(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+} // namespace
+
 EquationRenderer::EquationRenderer()
     : VAO_(0)
-    , VBO_(0)
-    , EBO_(0)
-    , equationVertexCount_(0)
+    , boundVertexBuffer_(0)
+    , boundIndexBuffer_(0)
+    , recordBuffer_(0)
+    , recordTexture_(0)
+    , firstPointVertex_(0)
+    , pointVertexCount_(0)
+    , hasLodView_(false)
+    , vertexCount_(0)
+    , indexCount_(0)
     , initialized_(false)
 {
 }
@@ -29,69 +57,303 @@ void EquationRenderer::initialize() {
     initialized_ = true;
 }
 
-void EquationRenderer::updateVertices(const std::vector<Equation>& equations, 
+void EquationRenderer::updateVertices(const std::vector<Equation>& equations,
                                      const std::vector<Point>& points) {
-    vertices_.clear();
-    indices_.clear();
+    if (VAO_ == 0) {
+        setupBuffers();
+    }
 
-    size_t vertexOffset = 0;
+    bool changed = false;
+    visibleScratch_.clear();
+    for (auto& entry : slots_) {
+        entry.second.seen = false;
+    }
 
-    // Add equation vertices
     for (const auto& equation : equations) {
-        if (equation.isVisible) {
-            vertices_.insert(vertices_.end(), 
-                           equation.vertices.begin(), 
-                           equation.vertices.end());
-
-            // Add indices with offset
-            if (equation.isMesh) {
-                for (unsigned int index : equation.indices) {
-                    indices_.push_back(index + vertexOffset);
-                }
+        Slot& slot = slots_[equation.id];
+        slot.seen = true;
+        // Hidden equations keep their ranges and catch up when shown again.
+        if (!equation.isVisible) {
+            continue;
+        }
+        visibleScratch_.push_back(equation.id);
+
+        const bool geometryChanged = !slot.uploaded || slot.revision != equation.revision ||
+                                     slot.isMesh != equation.isMesh;
+        if (geometryChanged) {
+            uploadVertices(equation, slot);
+        }
+        bool indicesChanged = geometryChanged;
+        if (equation.isMesh && !equation.lod.empty()) {
+            if (hasLodView_) {
+                equation.lod.selectLevels(lodView_, lodScratch_);
+            } else {
+                lodScratch_.assign(equation.lod.chunks.size(), 0);
             }
-            vertexOffset += equation.vertices.size();
+            if (lodScratch_ != slot.lodLevels) {
+                slot.lodLevels.swap(lodScratch_);
+                indicesChanged = true;
+            }
+        }
+        if (indicesChanged) {
+            uploadIndices(equation, slot);
+            changed = true;
         }
     }
 
-    equationVertexCount_ = vertexOffset;
+    // Removed equations give their ranges back.
+    for (auto it = slots_.begin(); it != slots_.end();) {
+        if (!it->second.seen) {
+            releaseSlot(it->second);
+            it = slots_.erase(it);
+            changed = true;
+        } else {
+            ++it;
+        }
+    }
+    if (visibleScratch_ != visible_) {
+        visible_.swap(visibleScratch_);
+        changed = true;
+    }
 
+    pointScratch_.clear();
     for (const auto& point : points) {
-        vertices_.insert(vertices_.end(),
-                        point.vertexData.begin(),
-                        point.vertexData.end());
+        pointScratch_.push_back(point.revision);
+    }
+    if (pointScratch_ != pointRevisions_) {
+        pointRevisions_.swap(pointScratch_);
+        uploadPoints(points);
+        changed = true;
     }
 
-    // Update OpenGL buffers
-    if (VAO_ == 0) {
-        setupBuffers();
+    // A buffer that grew has a new name.
+    if (vertexBuffer_->getId() != boundVertexBuffer_ || indexBuffer_->getId() != boundIndexBuffer_) {
+        bindBuffers();
     }
 
-    glBindVertexArray(VAO_);
+    // Styles can change without new geometry.
+    updateRecords(equations);
+    updateLines(equations);
+
+    inViewScratch_.clear();
+    for (uint64_t id : visible_) {
+        const Slot& slot = slots_[id];
+        const bool inView = frustum_.intersects(slot.boundsMin, slot.boundsMax);
+        inViewScratch_.push_back(inView);
+        for (const MeshChunk& chunk : slot.cullChunks) {
+            inViewScratch_.push_back(inView && frustum_.intersects(chunk.boundsMin, chunk.boundsMax));
+        }
+    }
+    if (inViewScratch_ != inView_) {
+        inView_.swap(inViewScratch_);
+        changed = true;
+    }
 
-    // Update vertex buffer
-    glBindBuffer(GL_ARRAY_BUFFER, VBO_);
-    if (!vertices_.empty()) {
-        glBufferData(GL_ARRAY_BUFFER, 
-                    vertices_.size() * sizeof(glm::vec3),
-                    vertices_.data(),
-                    GL_STATIC_DRAW);
+    if (!changed) {
+        return;
+    }
+    compactBatch_.clear();
+    wideBatch_.clear();
+    vertexCount_ = pointVertexCount_ * 2;
+    indexCount_ = 0;
+    size_t cursor = 0;
+    for (uint64_t id : visible_) {
+        const Slot& slot = slots_[id];
+        vertexCount_ += slot.vertexCount * 2;
+        const bool inView = inView_[cursor++];
+        if (slot.cullChunks.empty()) {
+            if (inView) {
+                appendDraws(slot, 0, std::numeric_limits<size_t>::max());
+            }
+            continue;
+        }
+        // Neighbouring chunks in view are drawn together.
+        size_t first = 0;
+        size_t last = 0;
+        for (const MeshChunk& chunk : slot.cullChunks) {
+            if (!inView_[cursor++]) {
+                continue;
+            }
+            if (chunk.indices.first != last) {
+                appendDraws(slot, first, last);
+                first = chunk.indices.first;
+            }
+            last = chunk.indices.first + chunk.indices.count;
+        }
+        appendDraws(slot, first, last);
     }
+}
 
-    // Update index buffer
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO_);
-    if (!indices_.empty()) {
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-                    indices_.size() * sizeof(unsigned int),
-                    indices_.data(),
-                    GL_STATIC_DRAW);
+void EquationRenderer::appendDraws(const Slot& slot, size_t first, size_t last) {
+    for (const MeshDraw& draw : slot.draws) {
+        const size_t lo = std::max(first, draw.start);
+        const size_t hi = std::min(last, draw.start + draw.count);
+        if (lo >= hi) {
+            continue;
+        }
+        DrawBatch& batch = draw.wide ? wideBatch_ : compactBatch_;
+        const size_t indexBytes = draw.wide ? sizeof(unsigned int) : sizeof(uint16_t);
+        batch.counts.push_back(static_cast<int>(hi - lo));
+        batch.offsets.push_back(reinterpret_cast<const void*>(draw.byteOffset + (lo - draw.start) * indexBytes));
+        batch.baseVertices.push_back(draw.baseVertex);
+        indexCount_ += hi - lo;
     }
+}
 
-    glBindVertexArray(0);
+void EquationRenderer::updateRecords(const std::vector<Equation>& equations) {
+    // The shader finds a vertex's record by binary search over the first vertices.
+    recordOrder_.clear();
+    for (const auto& equation : equations) {
+        const auto slot = slots_.find(equation.id);
+        if (equation.isVisible && slot != slots_.end() && !slot->second.draws.empty()) {
+            recordOrder_.emplace_back(slot->second.firstVertex, &equation);
+        }
+    }
+    std::sort(recordOrder_.begin(), recordOrder_.end(),
+              [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    recordScratch_.clear();
+    for (const auto& [firstVertex, equation] : recordOrder_) {
+        const Slot& slot = slots_[equation->id];
+        recordScratch_.insert(recordScratch_.end(), {
+            static_cast<uint32_t>(firstVertex), static_cast<uint32_t>(firstVertex + slot.vertexCount),
+            floatBits(equation->minHeight), floatBits(equation->maxHeight),
+            floatBits(equation->color[0]), floatBits(equation->color[1]), floatBits(equation->color[2]),
+            floatBits(equation->opacity)});
+    }
+    if (recordScratch_ == records_) {
+        return;
+    }
+    records_.swap(recordScratch_);
+    if (!records_.empty()) {
+        glBindBuffer(GL_TEXTURE_BUFFER, recordBuffer_);
+        glBufferData(GL_TEXTURE_BUFFER, records_.size() * sizeof(uint32_t), records_.data(), GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+}
+
+void EquationRenderer::updateLines(const std::vector<Equation>& equations) {
+    lines_->begin();
+    for (const auto& equation : equations) {
+        if (!equation.isVisible || equation.isMesh) {
+            continue;
+        }
+        const auto slot = slots_.find(equation.id);
+        if (slot == slots_.end() || !slot->second.uploaded ||
+            !frustum_.intersects(slot->second.boundsMin, slot->second.boundsMax)) {
+            continue;
+        }
+        for (const IndexRange& strip : equation.strips) {
+            lines_->addStrip(slot->second.firstVertex + strip.first, strip.count, equation.opacity);
+        }
+    }
+    lines_->end();
+}
+
+size_t EquationRenderer::getDrawCallCount() const {
+    return (compactBatch_.counts.empty() ? 0 : 1) + (wideBatch_.counts.empty() ? 0 : 1) +
+           (pointVertexCount_ > 0 ? 1 : 0) + (lines_ ? lines_->getWindowCount() : 0);
+}
+
+void EquationRenderer::uploadVertices(const Equation& equation, Slot& slot) {
+    const size_t count = equation.vertices.size() / 2;
+    if (count != slot.vertexCount) {
+        vertexBuffer_->release(slot.firstVertex, slot.vertexCount);
+        slot.firstVertex = vertexBuffer_->allocate(count);
+        slot.vertexCount = count;
+    }
+    vertexBuffer_->write(slot.firstVertex, equation.vertices.data(), count * kVertexStride);
+    slot.revision = equation.revision;
+    slot.isMesh = equation.isMesh;
+    slot.uploaded = true;
+    slot.boundsMin = equation.boundsMin;
+    slot.boundsMax = equation.boundsMax;
+}
+
+void EquationRenderer::uploadIndices(const Equation& equation, Slot& slot) {
+    const MeshIndices* mesh = nullptr;
+    slot.cullChunks.clear();
+    if (equation.isMesh && !equation.lod.empty()) {
+        lodIndices_.clear();
+        equation.lod.appendIndices(slot.lodLevels, 0, lodIndices_);
+        lodPacked_.assign(lodIndices_);
+        mesh = &lodPacked_;
+
+        // Each chunk's triangles and skirts are appended in chunk order.
+        uint32_t first = 0;
+        for (size_t c = 0; c < equation.lod.chunks.size(); ++c) {
+            const SurfaceChunk& chunk = equation.lod.chunks[c];
+            const uint32_t count = chunk.triangles[slot.lodLevels[c]].count + chunk.skirts[slot.lodLevels[c]].count;
+            if (count > 0) {
+                slot.cullChunks.push_back({chunk.boundsMin, chunk.boundsMax, {first, count}});
+            }
+            first += count;
+        }
+    } else if (equation.isMesh) {
+        mesh = &equation.indices;
+        slot.cullChunks = equation.meshChunks;
+    }
+    if (!equation.isMesh || equation.lod.empty()) {
+        slot.lodLevels.clear();
+    }
+
+    // The 16-bit indices come first, then the 32-bit ones.
+    const size_t compactBytes = mesh ? mesh->getCompact().size() * sizeof(uint16_t) : 0;
+    const size_t compactUnits = (compactBytes + kIndexUnitBytes - 1) / kIndexUnitBytes;
+    const size_t units = mesh ? compactUnits + mesh->getWide().size() : 0;
+    if (units != slot.indexUnits) {
+        indexBuffer_->release(slot.firstIndexUnit, slot.indexUnits);
+        slot.firstIndexUnit = indexBuffer_->allocate(units);
+        slot.indexUnits = units;
+    }
+    slot.draws.clear();
+    if (!mesh) {
+        return;
+    }
+
+    indexBuffer_->write(slot.firstIndexUnit, mesh->getCompact().data(), compactBytes);
+    indexBuffer_->write(slot.firstIndexUnit + compactUnits, mesh->getWide().data(),
+                        mesh->getWide().size() * sizeof(unsigned int));
+    const size_t compactStart = slot.firstIndexUnit * kIndexUnitBytes;
+    const size_t wideStart = (slot.firstIndexUnit + compactUnits) * kIndexUnitBytes;
+    for (const IndexChunk& chunk : mesh->getChunks()) {
+        if (chunk.count == 0) {
+            continue;
+        }
+        if (chunk.wide) {
+            slot.draws.push_back({true, chunk.start, wideStart + chunk.first * sizeof(unsigned int), chunk.count,
+                                  static_cast<int>(slot.firstVertex)});
+        } else {
+            slot.draws.push_back({false, chunk.start, compactStart + chunk.first * sizeof(uint16_t), chunk.count,
+                                  static_cast<int>(slot.firstVertex + chunk.baseVertex)});
+        }
+    }
+}
+
+void EquationRenderer::uploadPoints(const std::vector<Point>& points) {
+    pointVertices_.clear();
+    for (const auto& point : points) {
+        pointVertices_.insert(pointVertices_.end(), point.vertexData.begin(), point.vertexData.end());
+    }
+    const size_t count = pointVertices_.size() / 2;
+    if (count != pointVertexCount_) {
+        vertexBuffer_->release(firstPointVertex_, pointVertexCount_);
+        firstPointVertex_ = vertexBuffer_->allocate(count);
+        pointVertexCount_ = count;
+    }
+    vertexBuffer_->write(firstPointVertex_, pointVertices_.data(), count * kVertexStride);
 }
 
-void EquationRenderer::render(const Shader& shader, bool useHeatmap, 
+void EquationRenderer::releaseSlot(Slot& slot) {
+    vertexBuffer_->release(slot.firstVertex, slot.vertexCount);
+    indexBuffer_->release(slot.firstIndexUnit, slot.indexUnits);
+    slot.vertexCount = 0;
+    slot.indexUnits = 0;
+}
+
+void EquationRenderer::render(const Shader& shader, bool useHeatmap,
                              float minHeight, float maxHeight) const {
-    if (VAO_ == 0 || vertices_.empty()) {
+    if (VAO_ == 0 || vertexCount_ == 0) {
         return;
     }
 
@@ -102,35 +364,68 @@ void EquationRenderer::render(const Shader& shader, bool useHeatmap,
 
     glBindVertexArray(VAO_);
 
-    // Draw mesh if indices exist
-    if (!indices_.empty()) {
-        glDrawElements(GL_TRIANGLES, 
-                      static_cast<GLsizei>(indices_.size()),
-                      GL_UNSIGNED_INT,
-                      0);
+    // Draw every mesh in one call per index width, styled by its draw record
+    if (!records_.empty()) {
+        glActiveTexture(GL_TEXTURE0 + kRecordTextureUnit);
+        glBindTexture(GL_TEXTURE_BUFFER, recordTexture_);
+        shader.setInt("draw_records", kRecordTextureUnit);
+        shader.setInt("draw_record_count", static_cast<int>(records_.size() / 8));
+        shader.setBool("use_draw_records", true);
+
+        auto drawBatch = [](const DrawBatch& batch, GLenum type) {
+            if (!batch.counts.empty()) {
+                glMultiDrawElementsBaseVertex(GL_TRIANGLES, batch.counts.data(), type, batch.offsets.data(),
+                                              static_cast<GLsizei>(batch.counts.size()),
+                                              batch.baseVertices.data());
+            }
+        };
+        drawBatch(compactBatch_, GL_UNSIGNED_SHORT);
+        drawBatch(wideBatch_, GL_UNSIGNED_INT);
+
+        shader.setBool("use_draw_records", false);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+        glActiveTexture(GL_TEXTURE0);
     }
 
-    // Each vertex is 2 vec3 entries (position + color), so divide by 2 for GL vertex indices.
-    if (equationVertexCount_ < vertices_.size()) {
+    if (pointVertexCount_ > 0) {
         glDrawArrays(GL_POINTS,
-                    static_cast<GLsizei>(equationVertexCount_ / 2),
-                    static_cast<GLsizei>((vertices_.size() - equationVertexCount_) / 2));
+                    static_cast<GLint>(firstPointVertex_),
+                    static_cast<GLsizei>(pointVertexCount_));
     }
 
     glBindVertexArray(0);
 }
 
+void EquationRenderer::renderLines(const Shader& lineShader, float width, int viewportWidth,
+                                   int viewportHeight) const {
+    if (lines_) {
+        lines_->render(lineShader, width, viewportWidth, viewportHeight);
+    }
+}
+
 void EquationRenderer::setupBuffers() {
     cleanupBuffers();
 
     glGenVertexArrays(1, &VAO_);
-    glGenBuffers(1, &VBO_);
-    glGenBuffers(1, &EBO_);
+    vertexBuffer_ = std::make_unique<SubAllocatedBuffer>(kVertexStride, kInitialVertices);
+    indexBuffer_ = std::make_unique<SubAllocatedBuffer>(kIndexUnitBytes, kInitialIndexUnits);
+    lines_ = std::make_unique<LineBatch>();
+    bindBuffers();
+
+    glGenBuffers(1, &recordBuffer_);
+    glGenTextures(1, &recordTexture_);
+    glBindBuffer(GL_TEXTURE_BUFFER, recordBuffer_);
+    glBindTexture(GL_TEXTURE_BUFFER, recordTexture_);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32UI, recordBuffer_);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
 
+void EquationRenderer::bindBuffers() {
     glBindVertexArray(VAO_);
 
-    glBindBuffer(GL_ARRAY_BUFFER, VBO_);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO_);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer_->getId());
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer_->getId());
 
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, kVertexStride, (void*)0);
     glEnableVertexAttribArray(0);
@@ -139,16 +434,36 @@ void EquationRenderer::setupBuffers() {
     glEnableVertexAttribArray(1);
 
     glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    boundVertexBuffer_ = vertexBuffer_->getId();
+    boundIndexBuffer_ = indexBuffer_->getId();
+    lines_->setVertexBuffer(boundVertexBuffer_);
 }
 
 void EquationRenderer::cleanupBuffers() {
-    if (EBO_ != 0) {
-        glDeleteBuffers(1, &EBO_);
-        EBO_ = 0;
+    // Ranges refer to the buffers being dropped.
+    slots_.clear();
+    visible_.clear();
+    inView_.clear();
+    compactBatch_.clear();
+    wideBatch_.clear();
+    records_.clear();
+    pointRevisions_.clear();
+    pointVertexCount_ = 0;
+    vertexCount_ = 0;
+    indexCount_ = 0;
+
+    lines_.reset();
+    indexBuffer_.reset();
+    vertexBuffer_.reset();
+    if (recordTexture_ != 0) {
+        glDeleteTextures(1, &recordTexture_);
+        recordTexture_ = 0;
     }
-    if (VBO_ != 0) {
-        glDeleteBuffers(1, &VBO_);
-        VBO_ = 0;
+    if (recordBuffer_ != 0) {
+        glDeleteBuffers(1, &recordBuffer_);
+        recordBuffer_ = 0;
     }
     if (VAO_ != 0) {
         glDeleteVertexArrays(1, &VAO_);
@@ -157,4 +472,3 @@ void EquationRenderer::cleanupBuffers() {
 }
 
 } // namespace graphgl
-
@@ -0,0 +1,234 @@
+#include "expression_optimizer.h"
+#include <cstring>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace graphgl {
+
+namespace {
+
+/// Identity of a node for hash-consing. Constants compare by bit pattern so that
+/// 0 and -0 (and distinct NaNs) are never merged.
+struct NodeKey {
+    ExprOp op;
+    uint32_t lhs;
+    uint32_t rhs;
+    uint32_t valueBits;
+
+    bool operator==(const NodeKey& other) const {
+        return op == other.op && lhs == other.lhs && rhs == other.rhs && valueBits == other.valueBits;
+    }
+};
+
+struct NodeKeyHash {
+    size_t operator()(const NodeKey& key) const {
+        size_t h = static_cast<size_t>(key.op);
+        h = h * 0x9E3779B1u + key.lhs;
+        h = h * 0x9E3779B1u + key.rhs;
+        h = h * 0x9E3779B1u + key.valueBits;
+        return h;
+    }
+};
+
+uint32_t floatBits(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+bool isCommutative(ExprOp op) {
+    return op == ExprOp::Add || op == ExprOp::Mul || op == ExprOp::Hypot;
+}
+
+/// Emits simplified, deduplicated nodes into a fresh program.
+class ProgramBuilder {
+public:
+    ExpressionProgram program;
+
+    uint32_t constant(float value) {
+        return emit(ExprOp::Const, 0, 0, value);
+    }
+
+    uint32_t emit(ExprOp op, uint32_t lhs = 0, uint32_t rhs = 0, float value = 0.0f) {
+        const int arity = exprOpArity(op);
+        if (arity == 0) {
+            if (op != ExprOp::Const) {
+                value = 0.0f;
+            }
+            return intern(op, 0, 0, value);
+        }
+        if (arity == 1) {
+            rhs = 0;
+            if (isConstant(lhs)) {
+                return constant(applyExprOp(op, valueOf(lhs)));
+            }
+            if (op == ExprOp::Neg && node(lhs).op == ExprOp::Neg) {
+                return node(lhs).lhs;
+            }
+            return intern(op, lhs, 0, 0.0f);
+        }
+
+        if (isConstant(lhs) && isConstant(rhs)) {
+            return constant(applyExprOp(op, valueOf(lhs), valueOf(rhs)));
+        }
+        if (isCommutative(op) && isConstant(lhs)) {
+            std::swap(lhs, rhs);
+        }
+        if (isConstant(rhs)) {
+            const uint32_t simplified = simplifyConstantRhs(op, lhs, valueOf(rhs));
+            if (simplified != kNone) {
+                return simplified;
+            }
+        }
+        if (isCommutative(op) && lhs > rhs) {
+            std::swap(lhs, rhs);
+        }
+        return intern(op, lhs, rhs, 0.0f);
+    }
+
+private:
+    static constexpr uint32_t kNone = 0xFFFFFFFFu;
+
+    std::unordered_map<NodeKey, uint32_t, NodeKeyHash> index_;
+
+    const ExprNode& node(uint32_t i) const { return program.getNodes()[i]; }
+    bool isConstant(uint32_t i) const { return node(i).op == ExprOp::Const; }
+    float valueOf(uint32_t i) const { return node(i).value; }
+
+    uint32_t intern(ExprOp op, uint32_t lhs, uint32_t rhs, float value) {
+        const NodeKey key{op, lhs, rhs, floatBits(value)};
+        const auto it = index_.find(key);
+        if (it != index_.end()) {
+            return it->second;
+        }
+        const uint32_t added = program.addNode(op, lhs, rhs, value);
+        index_.emplace(key, added);
+        return added;
+    }
+
+    /// Identities and strength reductions for `lhs op c`. Returns kNone if nothing applies.
+    uint32_t simplifyConstantRhs(ExprOp op, uint32_t lhs, float c) {
+        switch (op) {
+            case ExprOp::Mul:
+                if (c == 1.0f) {
+                    return lhs;
+                }
+                if (c == -1.0f) {
+                    return emit(ExprOp::Neg, lhs);
+                }
+                break;
+            case ExprOp::Div:
+                if (c == 1.0f) {
+                    return lhs;
+                }
+                break;
+            case ExprOp::Sub:
+                if (floatBits(c) == floatBits(0.0f)) {
+                    return lhs;
+                }
+                break;
+            case ExprOp::Pow:
+                return simplifyPower(lhs, c);
+            default:
+                break;
+        }
+        return kNone;
+    }
+
+    uint32_t simplifyPower(uint32_t base, float exponent) {
+        if (exponent == 0.0f) {
+            return constant(1.0f); // std::pow(x, 0) is 1 even for NaN
+        }
+        if (exponent == 1.0f) {
+            return base;
+        }
+        if (exponent == 2.0f) {
+            return emit(ExprOp::Mul, base, base);
+        }
+        if (exponent == 3.0f) {
+            return emit(ExprOp::Mul, emit(ExprOp::Mul, base, base), base);
+        }
+        if (exponent == 4.0f) {
+            const uint32_t square = emit(ExprOp::Mul, base, base);
+            return emit(ExprOp::Mul, square, square);
+        }
+        if (exponent == -1.0f) {
+            return emit(ExprOp::Div, constant(1.0f), base);
+        }
+        if (exponent == -2.0f) {
+            return emit(ExprOp::Div, constant(1.0f), emit(ExprOp::Mul, base, base));
+        }
+        return kNone;
+    }
+};
+
+} // namespace
+
+ExpressionProgram optimizeExpression(const ExpressionProgram& program) {
+    const std::vector<ExprNode>& nodes = program.getNodes();
+    if (nodes.empty()) {
+        return program;
+    }
+
+    // Rebuild through the simplifying, hash-consing builder.
+    ProgramBuilder builder;
+    std::vector<uint32_t> remap(nodes.size());
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        const ExprNode& n = nodes[i];
+        const int arity = exprOpArity(n.op);
+        remap[i] = builder.emit(n.op,
+                                arity >= 1 ? remap[n.lhs] : 0,
+                                arity == 2 ? remap[n.rhs] : 0,
+                                n.value);
+    }
+
+    const std::vector<ExprNode>& built = builder.program.getNodes();
+    const uint32_t result = remap.back();
+
+    // Keep only what the result needs, and note which nodes vary with x.
+    std::vector<bool> live(built.size(), false);
+    live[result] = true;
+    for (size_t i = result + 1; i-- > 0;) {
+        if (!live[i]) {
+            continue;
+        }
+        const int arity = exprOpArity(built[i].op);
+        if (arity >= 1) {
+            live[built[i].lhs] = true;
+        }
+        if (arity == 2) {
+            live[built[i].rhs] = true;
+        }
+    }
+
+    std::vector<bool> dependsOnX(built.size(), false);
+    for (size_t i = 0; i < built.size(); ++i) {
+        const ExprNode& n = built[i];
+        const int arity = exprOpArity(n.op);
+        dependsOnX[i] = (n.op == ExprOp::VarX) ||
+                        (arity >= 1 && dependsOnX[n.lhs]) ||
+                        (arity == 2 && dependsOnX[n.rhs]);
+    }
+
+    // x-independent nodes first, then the rest; a stable partition keeps operands ahead of
+    // their users, and the result (which every live node feeds) stays last.
+    ExpressionProgram optimized;
+    std::vector<uint32_t> placed(built.size(), 0);
+    for (int pass = 0; pass < 2; ++pass) {
+        for (size_t i = 0; i < built.size(); ++i) {
+            if (!live[i] || dependsOnX[i] != (pass == 1)) {
+                continue;
+            }
+            const ExprNode& n = built[i];
+            const int arity = exprOpArity(n.op);
+            placed[i] = optimized.addNode(n.op,
+                                          arity >= 1 ? placed[n.lhs] : 0,
+                                          arity == 2 ? placed[n.rhs] : 0,
+                                          n.value);
+        }
+    }
+    return optimized;
+}
+
+} // namespace graphgl
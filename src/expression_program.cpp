@@ -0,0 +1,399 @@
+#include "expression_program.h"
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+
+namespace graphgl {
+
+namespace {
+
+struct FunctionInfo {
+    const char* name;
+    ExprOp op;
+    int arity; // -1 for variadic (two or more arguments, folded left)
+};
+
+constexpr FunctionInfo kFunctions[] = {
+    {"sin", ExprOp::Sin, 1},     {"cos", ExprOp::Cos, 1},     {"tan", ExprOp::Tan, 1},
+    {"asin", ExprOp::Asin, 1},   {"acos", ExprOp::Acos, 1},   {"atan", ExprOp::Atan, 1},
+    {"sinh", ExprOp::Sinh, 1},   {"cosh", ExprOp::Cosh, 1},   {"tanh", ExprOp::Tanh, 1},
+    {"exp", ExprOp::Exp, 1},     {"log", ExprOp::Log, 1},     {"log10", ExprOp::Log10, 1},
+    {"log2", ExprOp::Log2, 1},   {"sqrt", ExprOp::Sqrt, 1},   {"abs", ExprOp::Abs, 1},
+    {"floor", ExprOp::Floor, 1}, {"ceil", ExprOp::Ceil, 1},   {"round", ExprOp::Round, 1},
+    {"trunc", ExprOp::Trunc, 1}, {"sgn", ExprOp::Sgn, 1},
+    {"pow", ExprOp::Pow, 2},     {"atan2", ExprOp::Atan2, 2}, {"hypot", ExprOp::Hypot, 2},
+    {"min", ExprOp::Min, -1},    {"max", ExprOp::Max, -1},
+};
+
+constexpr float kE = 2.71828182845904523536f;
+constexpr float kPi = 3.14159265358979323846f;
+
+/// Recursive-descent parser for the interpreter's grammar:
+///   expr    := term (('+' | '-') term)*
+///   term    := unary (('*' | '/' | '%') unary)*
+///   unary   := ('-' | '+') unary | power
+///   power   := primary ['^' ('-' | '+')* primary]
+///   primary := number | constant | variable | function '(' args ')' | '(' expr ')'
+/// Chained powers (a^b^c) are rejected rather than guessing ExprTk's associativity.
+class ProgramParser {
+public:
+    ProgramParser(const std::string& source, bool is3D, ExpressionProgram& program)
+        : source_(source)
+        , pos_(0)
+        , is3D_(is3D)
+        , ok_(true)
+        , program_(program)
+    {
+    }
+
+    bool run() {
+        parseExpr();
+        skipSpace();
+        return ok_ && pos_ == source_.size() && !program_.empty();
+    }
+
+private:
+    const std::string& source_;
+    size_t pos_;
+    bool is3D_;
+    bool ok_;
+    ExpressionProgram& program_;
+
+    void skipSpace() {
+        while (pos_ < source_.size() && std::isspace(static_cast<unsigned char>(source_[pos_]))) {
+            ++pos_;
+        }
+    }
+
+    char peek() {
+        skipSpace();
+        return pos_ < source_.size() ? source_[pos_] : '\0';
+    }
+
+    uint32_t fail() {
+        ok_ = false;
+        return 0;
+    }
+
+    uint32_t parseExpr() {
+        uint32_t lhs = parseTerm();
+        while (ok_) {
+            const char c = peek();
+            if (c != '+' && c != '-') {
+                break;
+            }
+            ++pos_;
+            const uint32_t rhs = parseTerm();
+            lhs = program_.addNode(c == '+' ? ExprOp::Add : ExprOp::Sub, lhs, rhs);
+        }
+        return lhs;
+    }
+
+    uint32_t parseTerm() {
+        uint32_t lhs = parseUnary();
+        while (ok_) {
+            const char c = peek();
+            if (c != '*' && c != '/' && c != '%') {
+                break;
+            }
+            ++pos_;
+            const uint32_t rhs = parseUnary();
+            const ExprOp op = (c == '*') ? ExprOp::Mul : (c == '/') ? ExprOp::Div : ExprOp::Mod;
+            lhs = program_.addNode(op, lhs, rhs);
+        }
+        return lhs;
+    }
+
+    uint32_t parseUnary() {
+        const char c = peek();
+        if (c == '-' || c == '+') {
+            ++pos_;
+            const uint32_t operand = parseUnary();
+            return c == '-' ? program_.addNode(ExprOp::Neg, operand) : operand;
+        }
+        return parsePower();
+    }
+
+    uint32_t parsePower() {
+        const uint32_t base = parsePrimary();
+        if (!ok_ || peek() != '^') {
+            return base;
+        }
+        ++pos_;
+
+        bool negate = false;
+        for (char c = peek(); c == '-' || c == '+'; c = peek()) {
+            negate = negate != (c == '-');
+            ++pos_;
+        }
+        uint32_t exponent = parsePrimary();
+        if (negate) {
+            exponent = program_.addNode(ExprOp::Neg, exponent);
+        }
+        if (peek() == '^') {
+            return fail();
+        }
+        return program_.addNode(ExprOp::Pow, base, exponent);
+    }
+
+    uint32_t parsePrimary() {
+        if (!ok_) {
+            return 0;
+        }
+
+        const char c = peek();
+        if (c == '(') {
+            ++pos_;
+            const uint32_t inner = parseExpr();
+            if (peek() != ')') {
+                return fail();
+            }
+            ++pos_;
+            return inner;
+        }
+
+        if (std::isdigit(static_cast<unsigned char>(c)) || c == '.') {
+            const char* begin = source_.c_str() + pos_;
+            char* end = nullptr;
+            const double value = std::strtod(begin, &end);
+            if (end == begin) {
+                return fail();
+            }
+            pos_ += static_cast<size_t>(end - begin);
+            return program_.addNode(ExprOp::Const, 0, 0, static_cast<float>(value));
+        }
+
+        if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+            std::string name;
+            while (pos_ < source_.size() &&
+                   (std::isalnum(static_cast<unsigned char>(source_[pos_])) || source_[pos_] == '_')) {
+                // ExprTk identifiers are case-insensitive.
+                name += static_cast<char>(std::tolower(static_cast<unsigned char>(source_[pos_])));
+                ++pos_;
+            }
+            if (peek() == '(') {
+                return parseCall(name);
+            }
+            return parseIdentifier(name);
+        }
+
+        return fail();
+    }
+
+    uint32_t parseIdentifier(const std::string& name) {
+        if (name == "x") {
+            return program_.addNode(ExprOp::VarX);
+        }
+        if (name == "y") {
+            return is3D_ ? program_.addNode(ExprOp::VarY) : program_.addNode(ExprOp::Const);
+        }
+        if (name == "z") {
+            // z is registered with ExprTk but always evaluates to zero.
+            return program_.addNode(ExprOp::Const);
+        }
+        if (name == "pi") {
+            return program_.addNode(ExprOp::Const, 0, 0, kPi);
+        }
+        if (name == "e") {
+            return program_.addNode(ExprOp::Const, 0, 0, kE);
+        }
+        return fail();
+    }
+
+    uint32_t parseCall(const std::string& name) {
+        const FunctionInfo* info = nullptr;
+        for (const auto& f : kFunctions) {
+            if (name == f.name) {
+                info = &f;
+                break;
+            }
+        }
+        if (!info) {
+            return fail();
+        }
+
+        ++pos_; // '('
+        std::vector<uint32_t> args;
+        args.push_back(parseExpr());
+        while (ok_ && peek() == ',') {
+            ++pos_;
+            args.push_back(parseExpr());
+        }
+        if (!ok_ || peek() != ')') {
+            return fail();
+        }
+        ++pos_;
+
+        if (info->arity == -1) {
+            if (args.size() < 2) {
+                return fail();
+            }
+            uint32_t acc = args[0];
+            for (size_t i = 1; i < args.size(); ++i) {
+                acc = program_.addNode(info->op, acc, args[i]);
+            }
+            return acc;
+        }
+        if (static_cast<int>(args.size()) != info->arity) {
+            return fail();
+        }
+        return info->arity == 1 ? program_.addNode(info->op, args[0])
+                                : program_.addNode(info->op, args[0], args[1]);
+    }
+};
+
+} // namespace
+
+int exprOpArity(ExprOp op) {
+    switch (op) {
+        case ExprOp::Const:
+        case ExprOp::VarX:
+        case ExprOp::VarY:
+            return 0;
+        case ExprOp::Add:
+        case ExprOp::Sub:
+        case ExprOp::Mul:
+        case ExprOp::Div:
+        case ExprOp::Mod:
+        case ExprOp::Pow:
+        case ExprOp::Min:
+        case ExprOp::Max:
+        case ExprOp::Atan2:
+        case ExprOp::Hypot:
+            return 2;
+        default:
+            return 1;
+    }
+}
+
+float applyExprOp(ExprOp op, float a, float b) {
+    switch (op) {
+        case ExprOp::Neg:   return -a;
+        case ExprOp::Add:   return a + b;
+        case ExprOp::Sub:   return a - b;
+        case ExprOp::Mul:   return a * b;
+        case ExprOp::Div:   return a / b;
+        case ExprOp::Mod:   return std::fmod(a, b);
+        case ExprOp::Pow:   return std::pow(a, b);
+        case ExprOp::Min:   return std::min(a, b);
+        case ExprOp::Max:   return std::max(a, b);
+        case ExprOp::Atan2: return std::atan2(a, b);
+        case ExprOp::Hypot: return std::hypot(a, b);
+        case ExprOp::Sin:   return std::sin(a);
+        case ExprOp::Cos:   return std::cos(a);
+        case ExprOp::Tan:   return std::tan(a);
+        case ExprOp::Asin:  return std::asin(a);
+        case ExprOp::Acos:  return std::acos(a);
+        case ExprOp::Atan:  return std::atan(a);
+        case ExprOp::Sinh:  return std::sinh(a);
+        case ExprOp::Cosh:  return std::cosh(a);
+        case ExprOp::Tanh:  return std::tanh(a);
+        case ExprOp::Exp:   return std::exp(a);
+        case ExprOp::Log:   return std::log(a);
+        case ExprOp::Log10: return std::log10(a);
+        case ExprOp::Log2:  return std::log2(a);
+        case ExprOp::Sqrt:  return std::sqrt(a);
+        case ExprOp::Abs:   return std::fabs(a);
+        case ExprOp::Floor: return std::floor(a);
+        case ExprOp::Ceil:  return std::ceil(a);
+        case ExprOp::Round: return std::round(a);
+        case ExprOp::Trunc: return std::trunc(a);
+        case ExprOp::Sgn:   return (a > 0.0f) ? 1.0f : (a < 0.0f ? -1.0f : 0.0f);
+        default:            return std::nanf("");
+    }
+}
+
+bool ExpressionProgram::parse(const std::string& source, bool is3D, ExpressionProgram& program) {
+    program.nodes_.clear();
+    ProgramParser parser(source, is3D, program);
+    if (!parser.run()) {
+        program.nodes_.clear();
+        return false;
+    }
+    return true;
+}
+
+uint32_t ExpressionProgram::addNode(ExprOp op, uint32_t lhs, uint32_t rhs, float value) {
+    ExprNode node;
+    node.op = op;
+    node.lhs = lhs;
+    node.rhs = rhs;
+    node.value = value;
+    nodes_.push_back(node);
+    return static_cast<uint32_t>(nodes_.size() - 1);
+}
+
+void ExpressionProgram::collectSum(uint32_t node, std::vector<ExprTerm>& terms) const {
+    collectSum(node, false, terms);
+}
+
+void ExpressionProgram::collectSum(uint32_t node, bool inverted, std::vector<ExprTerm>& terms) const {
+    const ExprNode& n = nodes_[node];
+    switch (n.op) {
+        case ExprOp::Add:
+            collectSum(n.lhs, inverted, terms);
+            collectSum(n.rhs, inverted, terms);
+            break;
+        case ExprOp::Sub:
+            collectSum(n.lhs, inverted, terms);
+            collectSum(n.rhs, !inverted, terms);
+            break;
+        case ExprOp::Neg:
+            collectSum(n.lhs, !inverted, terms);
+            break;
+        default:
+            terms.push_back({node, inverted});
+            break;
+    }
+}
+
+void ExpressionProgram::collectProduct(uint32_t node, std::vector<ExprTerm>& terms, bool& negated) const {
+    collectProduct(node, false, terms, negated);
+}
+
+void ExpressionProgram::collectProduct(uint32_t node, bool inverted, std::vector<ExprTerm>& terms,
+                                       bool& negated) const {
+    const ExprNode& n = nodes_[node];
+    switch (n.op) {
+        case ExprOp::Mul:
+            collectProduct(n.lhs, inverted, terms, negated);
+            collectProduct(n.rhs, inverted, terms, negated);
+            break;
+        case ExprOp::Div:
+            collectProduct(n.lhs, inverted, terms, negated);
+            collectProduct(n.rhs, !inverted, terms, negated);
+            break;
+        case ExprOp::Neg:
+            negated = !negated;
+            collectProduct(n.lhs, inverted, terms, negated);
+            break;
+        default:
+            terms.push_back({node, inverted});
+            break;
+    }
+}
+
+float ExpressionProgram::evaluate(float x, float y, float* registers) const {
+    const size_t count = nodes_.size();
+    for (size_t i = 0; i < count; ++i) {
+        const ExprNode& node = nodes_[i];
+        switch (node.op) {
+            case ExprOp::Const:
+                registers[i] = node.value;
+                break;
+            case ExprOp::VarX:
+                registers[i] = x;
+                break;
+            case ExprOp::VarY:
+                registers[i] = y;
+                break;
+            default:
+                registers[i] = applyExprOp(node.op, registers[node.lhs], registers[node.rhs]);
+                break;
+        }
+    }
+    return count ? registers[count - 1] : std::nanf("");
+}
+
+} // namespace graphgl
@@ -0,0 +1,37 @@
+#include "frustum.h"
+
+namespace graphgl {
+
+Frustum::Frustum() {
+    planes_.fill(glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+}
+
+Frustum::Frustum(const glm::mat4& viewProjection) {
+    // Clip space keeps -w <= x, y, z <= w; each inequality is a plane in world space.
+    auto row = [&](int i) {
+        return glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+    };
+    const glm::vec4 w = row(3);
+    for (int axis = 0; axis < 3; ++axis) {
+        planes_[2 * axis] = w + row(axis);
+        planes_[2 * axis + 1] = w - row(axis);
+    }
+}
+
+bool Frustum::intersects(const glm::vec3& boundsMin, const glm::vec3& boundsMax) const {
+    if (boundsMin.x > boundsMax.x || boundsMin.y > boundsMax.y || boundsMin.z > boundsMax.z) {
+        return false;
+    }
+    for (const glm::vec4& plane : planes_) {
+        // The corner furthest along the plane normal.
+        const glm::vec3 corner(plane.x >= 0.0f ? boundsMax.x : boundsMin.x,
+                               plane.y >= 0.0f ? boundsMax.y : boundsMin.y,
+                               plane.z >= 0.0f ? boundsMax.z : boundsMin.z);
+        if (plane.x * corner.x + plane.y * corner.y + plane.z * corner.z + plane.w < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace graphgl
@@ -0,0 +1,256 @@
+#include "generation_scheduler.h"
+#include "equation_parser.h"
+#include <algorithm>
+
+namespace graphgl {
+
+namespace {
+
+constexpr size_t kMaxDefaultWorkers = 4;
+
+} // namespace
+
+GenerationScheduler::GenerationScheduler(size_t workerCount)
+    : hardwareThreads_(std::max(1u, std::thread::hardware_concurrency()))
+    , freeThreads_(hardwareThreads_)
+    , nextSequence_(0)
+    , stopping_(false)
+{
+    if (workerCount == 0) {
+        // Surfaces already split their lattice across threads; a few workers are enough to
+        // keep several equations regenerating without starving the render thread.
+        const size_t hardware = hardwareThreads_;
+        workerCount = std::clamp<size_t>(hardware > 1 ? hardware - 1 : 1, 1, kMaxDefaultWorkers);
+    }
+    workers_.reserve(workerCount);
+    for (size_t i = 0; i < workerCount; ++i) {
+        workers_.emplace_back(&GenerationScheduler::workerLoop, this);
+    }
+}
+
+GenerationScheduler::~GenerationScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+        queue_.clear();
+        for (const RunningJob& job : running_) {
+            job.token->cancel();
+        }
+    }
+    workAvailable_.notify_all();
+    for (std::thread& worker : workers_) {
+        worker.join();
+    }
+}
+
+void GenerationScheduler::submit(const Equation& equation, const GenerationOptions& options) {
+    Job job;
+    job.equation.id = equation.id;
+    job.equation.expression = equation.expression;
+    job.equation.color = equation.color;
+    job.equation.sampleSize = equation.sampleSize;
+    job.equation.minX = equation.minX;
+    job.equation.maxX = equation.maxX;
+    job.equation.minY = equation.minY;
+    job.equation.maxY = equation.maxY;
+    job.equation.is3D = equation.is3D;
+    job.equation.isMesh = equation.isMesh;
+    job.options = options;
+    job.token = std::make_shared<CancellationToken>();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        discard(equation.id, &job.equation);
+        job.sequence = ++nextSequence_;
+        latestSequence_[equation.id] = job.sequence;
+        queue_.push_back(std::move(job));
+    }
+    workAvailable_.notify_one();
+}
+
+void GenerationScheduler::cancel(uint64_t equationId) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    discard(equationId);
+    latestSequence_.erase(equationId);
+    sampleCaches_.erase(equationId);
+    if (queue_.empty() && running_.empty()) {
+        idle_.notify_all();
+    }
+}
+
+std::vector<GenerationResult> GenerationScheduler::takeResults() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<GenerationResult> results;
+    results.swap(results_);
+    return results;
+}
+
+bool GenerationScheduler::isBusy() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return !queue_.empty() || !running_.empty();
+}
+
+void GenerationScheduler::waitIdle() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_.wait(lock, [this] { return queue_.empty() && running_.empty(); });
+}
+
+void GenerationScheduler::discard(uint64_t equationId, const Equation* next) {
+    queue_.erase(std::remove_if(queue_.begin(), queue_.end(),
+                                [&](const Job& job) { return job.equation.id == equationId; }),
+                 queue_.end());
+    for (const RunningJob& job : running_) {
+        if (job.equationId != equationId) {
+            continue;
+        }
+        // The next job reuses the samples of a surface with the same expression, so that job
+        // only finishes its final grid and stores it in the cache.
+        if (next && next->is3D && job.is3D && next->expression == job.expression) {
+            job.token->stopAfterSamples();
+        } else {
+            job.token->cancel();
+        }
+    }
+    results_.erase(std::remove_if(results_.begin(), results_.end(),
+                                  [&](const GenerationResult& r) { return r.equationId == equationId; }),
+                   results_.end());
+}
+
+std::deque<GenerationScheduler::Job>::iterator GenerationScheduler::nextRunnable() {
+    return std::find_if(queue_.begin(), queue_.end(), [this](const Job& job) {
+        return std::none_of(running_.begin(), running_.end(),
+                            [&](const RunningJob& r) { return r.equationId == job.equation.id; });
+    });
+}
+
+void GenerationScheduler::workerLoop() {
+    // Parsers and generators keep scratch state between calls, so each worker owns its own.
+    EquationParser parser;
+    EquationGenerator generator;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        workAvailable_.wait(lock, [this] { return stopping_ || nextRunnable() != queue_.end(); });
+        if (stopping_) {
+            return;
+        }
+        const auto next = nextRunnable();
+        Job job = std::move(*next);
+        queue_.erase(next);
+
+        // An even share of the hardware among the running jobs, from the threads still free;
+        // with none free the job runs on its worker thread alone.
+        const size_t threads = std::min(freeThreads_, hardwareThreads_ / (running_.size() + 1));
+        freeThreads_ -= threads;
+        running_.push_back({job.equation.id, job.equation.expression, job.equation.is3D, job.token, threads});
+
+        // No other job of the equation is running, so the cache is here unless this is the
+        // equation's first job.
+        std::shared_ptr<SurfaceSampleCache>& slot = sampleCaches_[job.equation.id];
+        std::shared_ptr<SurfaceSampleCache> cache = slot ? std::move(slot) : std::make_shared<SurfaceSampleCache>();
+        slot = nullptr;
+
+        lock.unlock();
+        generator.setThreadCount(std::max<size_t>(threads, 1));
+        generator.setSampleCache(cache);
+        run(job, parser, generator, *cache);
+        generator.setSampleCache(nullptr);
+        lock.lock();
+
+        // Hand the cache back unless cancel() dropped the equation meanwhile.
+        const auto returned = sampleCaches_.find(job.equation.id);
+        if (returned != sampleCaches_.end() && !returned->second) {
+            returned->second = std::move(cache);
+        }
+
+        freeThreads_ += threads;
+        running_.erase(std::find_if(running_.begin(), running_.end(),
+                                    [&](const RunningJob& r) { return r.token == job.token; }));
+        const auto latest = latestSequence_.find(job.equation.id);
+        if (latest != latestSequence_.end() && latest->second == job.sequence) {
+            latestSequence_.erase(latest);
+        }
+        if (queue_.empty() && running_.empty()) {
+            idle_.notify_all();
+        }
+        // A job of this equation may have been waiting for this one to finish.
+        if (!queue_.empty()) {
+            workAvailable_.notify_all();
+        }
+    }
+}
+
+void GenerationScheduler::publish(const Job& job, GenerationResult&& result) {
+    // A newer submission or cancel() superseded the job while it ran.
+    const auto latest = latestSequence_.find(job.equation.id);
+    if (latest == latestSequence_.end() || latest->second != job.sequence || job.token->isCancelled()) {
+        return;
+    }
+    // A finer level replaces a preview the owner has not taken yet.
+    results_.erase(std::remove_if(results_.begin(), results_.end(),
+                                  [&](const GenerationResult& r) { return r.equationId == result.equationId; }),
+                   results_.end());
+    results_.push_back(std::move(result));
+}
+
+void GenerationScheduler::run(Job& job, EquationParser& parser, EquationGenerator& generator,
+                              const SurfaceSampleCache& cache) {
+    parser.setNativeKernelCache(job.options.nativeKernels);
+    if (job.token->isCancelled()) {
+        return;
+    }
+    if (!parser.parseExpression(job.equation.expression, job.equation.is3D)) {
+        GenerationResult result;
+        result.equationId = job.equation.id;
+        result.errorMessage = parser.getErrorMessage();
+        std::lock_guard<std::mutex> lock(mutex_);
+        publish(job, std::move(result));
+        return;
+    }
+
+    // Previews are copied out (the generator reuses the equation for the next level); the
+    // final level is moved.
+    auto onLevel = [&](bool isFinal) {
+        GenerationResult result;
+        result.equationId = job.equation.id;
+        result.isValid = true;
+        result.isFinal = isFinal;
+        if (isFinal) {
+            result.vertices = std::move(job.equation.vertices);
+            result.indices = std::move(job.equation.indices);
+            result.meshChunks = std::move(job.equation.meshChunks);
+            result.lod = std::move(job.equation.lod);
+            result.strips = std::move(job.equation.strips);
+        } else {
+            result.vertices = job.equation.vertices;
+            result.indices = job.equation.indices;
+            result.meshChunks = job.equation.meshChunks;
+            result.lod = job.equation.lod;
+            result.strips = job.equation.strips;
+        }
+        result.boundsMin = job.equation.boundsMin;
+        result.boundsMax = job.equation.boundsMax;
+        result.minHeight = generator.getMinHeight();
+        result.maxHeight = generator.getMaxHeight();
+        result.evaluatedSamples = job.equation.is3D ? cache.evaluatedSamples : 0;
+        std::lock_guard<std::mutex> lock(mutex_);
+        publish(job, std::move(result));
+    };
+
+    generator.setUseSampleBudget(job.options.useSampleBudget);
+    generator.setCurveRefinement(job.options.curveRefinement);
+    generator.setAngleTolerance(job.options.angleTolerance);
+    generator.setChunkedLod(job.options.chunkedLod);
+    generator.setCancellationToken(job.token);
+    if (job.options.progressive) {
+        generator.generateProgressive(job.equation, parser, job.options.maxDepth, job.options.derivativeThreshold,
+                                      [&](const Equation&, bool isFinal) { onLevel(isFinal); });
+    } else {
+        generator.generateVertices(job.equation, parser, job.options.maxDepth, job.options.derivativeThreshold);
+        if (!job.token->isCancelled() && !job.token->isStoppingAfterSamples()) {
+            onLevel(true);
+        }
+    }
+    generator.setCancellationToken(nullptr);
+}
+
+} // namespace graphgl
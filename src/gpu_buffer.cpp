@@ -0,0 +1,62 @@
+#include "gpu_buffer.h"
+#include <glad/glad.h>
+#include <algorithm>
+
+namespace graphgl {
+
+// Buffers are bound to the copy targets, which leaves vertex array state alone.
+
+SubAllocatedBuffer::SubAllocatedBuffer(size_t unitBytes, size_t initialUnits)
+    : id_(0)
+    , unitBytes_(unitBytes)
+{
+    resize(std::max<size_t>(initialUnits, 1));
+}
+
+SubAllocatedBuffer::~SubAllocatedBuffer() {
+    if (id_ != 0) {
+        glDeleteBuffers(1, &id_);
+    }
+}
+
+size_t SubAllocatedBuffer::allocate(size_t units) {
+    size_t offset = ranges_.allocate(units);
+    if (offset == RangeAllocator::NO_SPACE) {
+        resize(std::max(ranges_.getCapacity() * 2, ranges_.getCapacity() + units));
+        offset = ranges_.allocate(units);
+    }
+    return offset;
+}
+
+void SubAllocatedBuffer::release(size_t offset, size_t units) {
+    ranges_.release(offset, units);
+}
+
+void SubAllocatedBuffer::write(size_t offset, const void* data, size_t bytes) const {
+    if (bytes == 0) {
+        return;
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, id_);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(offset * unitBytes_), static_cast<GLsizeiptr>(bytes),
+                    data);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void SubAllocatedBuffer::resize(size_t units) {
+    unsigned int buffer = 0;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(units * unitBytes_), nullptr, GL_DYNAMIC_DRAW);
+    if (id_ != 0) {
+        glBindBuffer(GL_COPY_READ_BUFFER, id_);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0,
+                            static_cast<GLsizeiptr>(ranges_.getCapacity() * unitBytes_));
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glDeleteBuffers(1, &id_);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    id_ = buffer;
+    ranges_.grow(units);
+}
+
+} // namespace graphgl
@@ -0,0 +1,294 @@
+#include "interval_arithmetic.h"
+#include <algorithm>
+#include <cmath>
+
+namespace graphgl {
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kTwoPi = 2.0 * kPi;
+constexpr double kInf = std::numeric_limits<double>::infinity();
+
+// Relative widening per operation. Far above the rounding of one float operation (2^-24)
+// and the error of the vectorized math routines, so chains of operations stay covered.
+constexpr double kSlack = 1.0 / (1 << 18);
+
+double magnitude(const Interval& a) {
+    double m = 0.0;
+    if (std::isfinite(a.lo)) {
+        m = std::max(m, std::fabs(a.lo));
+    }
+    if (std::isfinite(a.hi)) {
+        m = std::max(m, std::fabs(a.hi));
+    }
+    return m;
+}
+
+bool containsZero(const Interval& a) { return a.lo <= 0.0 && a.hi >= 0.0; }
+bool isUnbounded(const Interval& a) { return std::isinf(a.lo) || std::isinf(a.hi); }
+
+/// Repair NaN bounds (inf - inf, ...) and widen finite bounds by the rounding slack,
+/// scaled by the largest operand or result magnitude.
+Interval settle(Interval r, double operandMagnitude) {
+    if (std::isnan(r.lo)) {
+        r.lo = -kInf;
+        r.mayBeUndefined = true;
+    }
+    if (std::isnan(r.hi)) {
+        r.hi = kInf;
+        r.mayBeUndefined = true;
+    }
+    if (r.isUndefined()) {
+        return r;
+    }
+    const double pad = kSlack * std::max(operandMagnitude, magnitude(r)) + std::numeric_limits<float>::denorm_min();
+    if (std::isfinite(r.lo)) {
+        r.lo -= pad;
+    }
+    if (std::isfinite(r.hi)) {
+        r.hi += pad;
+    }
+    return r;
+}
+
+double absLow(const Interval& a) { return containsZero(a) ? 0.0 : std::min(std::fabs(a.lo), std::fabs(a.hi)); }
+double absHigh(const Interval& a) { return std::max(std::fabs(a.lo), std::fabs(a.hi)); }
+
+/// The part of a inside [domainLo, domainHi]; NaN outside it.
+Interval restrict(const Interval& a, double domainLo, double domainHi) {
+    if (a.hi < domainLo || a.lo > domainHi) {
+        return Interval::undefined();
+    }
+    return {std::max(a.lo, domainLo), std::min(a.hi, domainHi),
+            a.mayBeUndefined || a.lo < domainLo || a.hi > domainHi};
+}
+
+template <class F>
+Interval increasing(const Interval& a, F f) {
+    if (a.isUndefined()) {
+        return a;
+    }
+    return {f(a.lo), f(a.hi), a.mayBeUndefined};
+}
+
+/// Whether [lo, hi] contains phase + k * period for some integer k.
+bool containsPhase(double lo, double hi, double phase, double period) {
+    const double k = std::ceil((lo - phase) / period);
+    return phase + k * period <= hi;
+}
+
+/// sin(a + shift), with its extrema located exactly.
+Interval sinInterval(const Interval& a, double shift) {
+    if (isUnbounded(a)) {
+        return {-1.0, 1.0, true};
+    }
+    const double lo = a.lo + shift;
+    const double hi = a.hi + shift;
+    if (hi - lo >= kTwoPi) {
+        return {-1.0, 1.0, a.mayBeUndefined};
+    }
+    const double s0 = std::sin(lo);
+    const double s1 = std::sin(hi);
+    return {containsPhase(lo, hi, -0.5 * kPi, kTwoPi) ? -1.0 : std::min(s0, s1),
+            containsPhase(lo, hi, 0.5 * kPi, kTwoPi) ? 1.0 : std::max(s0, s1), a.mayBeUndefined};
+}
+
+double productBound(double a, double b) {
+    return (a == 0.0 || b == 0.0) ? 0.0 : a * b; // 0 * inf only occurs at a limit
+}
+
+Interval multiply(const Interval& a, const Interval& b) {
+    const double p[] = {productBound(a.lo, b.lo), productBound(a.lo, b.hi), productBound(a.hi, b.lo),
+                        productBound(a.hi, b.hi)};
+    const bool zeroTimesInf = (containsZero(a) && isUnbounded(b)) || (containsZero(b) && isUnbounded(a));
+    return {*std::min_element(p, p + 4), *std::max_element(p, p + 4),
+            a.mayBeUndefined || b.mayBeUndefined || zeroTimesInf};
+}
+
+Interval divide(const Interval& a, const Interval& b) {
+    if (containsZero(b)) {
+        // Division by values arbitrarily close to zero; 0/0 and inf/inf are NaN.
+        return {-kInf, kInf, a.mayBeUndefined || b.mayBeUndefined || containsZero(a) || isUnbounded(a)};
+    }
+    Interval r = multiply(a, Interval{1.0 / b.hi, 1.0 / b.lo, b.mayBeUndefined});
+    r.mayBeUndefined = r.mayBeUndefined || (isUnbounded(a) && isUnbounded(b));
+    return r;
+}
+
+/// a^n for an integer n >= 0.
+Interval integerPower(const Interval& a, int n) {
+    const double p0 = std::pow(a.lo, n);
+    const double p1 = std::pow(a.hi, n);
+    if (n % 2 == 1) {
+        return {p0, p1, a.mayBeUndefined};
+    }
+    const double hi = std::max(p0, p1);
+    return {containsZero(a) ? 0.0 : std::min(p0, p1), hi, a.mayBeUndefined};
+}
+
+Interval power(const Interval& a, const Interval& b) {
+    if (b.lo == 0.0 && b.hi == 0.0) {
+        return Interval::point(1.0); // pow(anything, 0) == 1, even NaN
+    }
+    if (a.isUndefined() || b.isUndefined()) {
+        return Interval::undefined();
+    }
+
+    const bool integerExponent = b.lo == b.hi && std::fabs(b.lo) <= 64.0 && b.lo == std::floor(b.lo);
+    if (integerExponent) {
+        const int n = static_cast<int>(b.lo);
+        if (n > 0) {
+            return integerPower(a, n);
+        }
+        Interval r = divide(Interval::point(1.0), integerPower(a, -n));
+        r.mayBeUndefined = r.mayBeUndefined && a.mayBeUndefined; // 1 / 0 is inf, not NaN
+        return r;
+    }
+
+    if (a.lo >= 0.0) {
+        // Monotonic in each argument separately, so the extremes lie at the corners.
+        const double p[] = {std::pow(a.lo, b.lo), std::pow(a.lo, b.hi), std::pow(a.hi, b.lo),
+                            std::pow(a.hi, b.hi)};
+        return {*std::min_element(p, p + 4), *std::max_element(p, p + 4), a.mayBeUndefined || b.mayBeUndefined};
+    }
+    if (a.hi < 0.0 && b.lo == b.hi && b.lo != std::floor(b.lo)) {
+        return Interval::undefined(); // negative base, fractional exponent
+    }
+    return Interval::entire();
+}
+
+Interval modulo(const Interval& a, const Interval& b) {
+    if (b.lo == 0.0 && b.hi == 0.0) {
+        return Interval::undefined();
+    }
+    // The result has the sign of a and is smaller than |b| and |a|.
+    const double m = absHigh(b);
+    return {a.lo < 0.0 ? std::max(-m, a.lo) : 0.0, a.hi > 0.0 ? std::min(m, a.hi) : 0.0,
+            a.mayBeUndefined || b.mayBeUndefined || containsZero(b) || isUnbounded(a)};
+}
+
+/// std::min / std::max keep the first operand when the second is NaN.
+Interval minimum(const Interval& a, const Interval& b) {
+    if (a.isUndefined()) {
+        return Interval::undefined();
+    }
+    if (b.isUndefined()) {
+        return a;
+    }
+    return {std::min(a.lo, b.lo), b.mayBeUndefined ? a.hi : std::min(a.hi, b.hi), a.mayBeUndefined};
+}
+
+Interval maximum(const Interval& a, const Interval& b) {
+    if (a.isUndefined()) {
+        return Interval::undefined();
+    }
+    if (b.isUndefined()) {
+        return a;
+    }
+    return {b.mayBeUndefined ? a.lo : std::max(a.lo, b.lo), std::max(a.hi, b.hi), a.mayBeUndefined};
+}
+
+Interval applyInterval(ExprOp op, const Interval& a, const Interval& b) {
+    switch (op) {
+        case ExprOp::Pow:   return power(a, b);
+        case ExprOp::Min:   return minimum(a, b);
+        case ExprOp::Max:   return maximum(a, b);
+        default:            break;
+    }
+
+    const int arity = exprOpArity(op);
+    if (a.isUndefined() || (arity == 2 && b.isUndefined())) {
+        return Interval::undefined();
+    }
+    const bool undefinedOperand = a.mayBeUndefined || (arity == 2 && b.mayBeUndefined);
+
+    switch (op) {
+        case ExprOp::Neg:   return {-a.hi, -a.lo, a.mayBeUndefined};
+        case ExprOp::Add:   return {a.lo + b.lo, a.hi + b.hi, undefinedOperand};
+        case ExprOp::Sub:   return {a.lo - b.hi, a.hi - b.lo, undefinedOperand};
+        case ExprOp::Mul:   return multiply(a, b);
+        case ExprOp::Div:   return divide(a, b);
+        case ExprOp::Mod:   return modulo(a, b);
+        case ExprOp::Atan2: return {-kPi, kPi, undefinedOperand};
+        case ExprOp::Hypot:
+            return {std::hypot(absLow(a), absLow(b)), std::hypot(absHigh(a), absHigh(b)), undefinedOperand};
+        case ExprOp::Sin:   return sinInterval(a, 0.0);
+        case ExprOp::Cos:   return sinInterval(a, 0.5 * kPi);
+        case ExprOp::Tan:
+            if (isUnbounded(a) || a.hi - a.lo >= kPi || containsPhase(a.lo, a.hi, 0.5 * kPi, kPi)) {
+                return {-kInf, kInf, a.mayBeUndefined || isUnbounded(a)};
+            }
+            return increasing(a, [](double v) { return std::tan(v); });
+        case ExprOp::Asin:
+            return increasing(restrict(a, -1.0, 1.0), [](double v) { return std::asin(v); });
+        case ExprOp::Acos: {
+            const Interval r = restrict(a, -1.0, 1.0);
+            return r.isUndefined() ? r : Interval{std::acos(r.hi), std::acos(r.lo), r.mayBeUndefined};
+        }
+        case ExprOp::Atan:  return increasing(a, [](double v) { return std::atan(v); });
+        case ExprOp::Sinh:  return increasing(a, [](double v) { return std::sinh(v); });
+        case ExprOp::Cosh:  return {std::cosh(absLow(a)), std::cosh(absHigh(a)), a.mayBeUndefined};
+        case ExprOp::Tanh:  return increasing(a, [](double v) { return std::tanh(v); });
+        case ExprOp::Exp:   return increasing(a, [](double v) { return std::exp(v); });
+        case ExprOp::Log:
+            return increasing(restrict(a, 0.0, kInf), [](double v) { return std::log(v); });
+        case ExprOp::Log10:
+            return increasing(restrict(a, 0.0, kInf), [](double v) { return std::log10(v); });
+        case ExprOp::Log2:
+            return increasing(restrict(a, 0.0, kInf), [](double v) { return std::log2(v); });
+        case ExprOp::Sqrt:
+            return increasing(restrict(a, 0.0, kInf), [](double v) { return std::sqrt(v); });
+        case ExprOp::Abs:   return {absLow(a), absHigh(a), a.mayBeUndefined};
+        case ExprOp::Floor: return increasing(a, [](double v) { return std::floor(v); });
+        case ExprOp::Ceil:  return increasing(a, [](double v) { return std::ceil(v); });
+        case ExprOp::Round: return increasing(a, [](double v) { return std::round(v); });
+        case ExprOp::Trunc: return increasing(a, [](double v) { return std::trunc(v); });
+        case ExprOp::Sgn:
+            return increasing(a, [](double v) { return (v > 0.0) ? 1.0 : (v < 0.0 ? -1.0 : 0.0); });
+        default:            return Interval::entire();
+    }
+}
+
+} // namespace
+
+Interval evaluateInterval(const ExpressionProgram& program, const Interval& x, const Interval& y,
+                          Interval* registers) {
+    const std::vector<ExprNode>& nodes = program.getNodes();
+    if (nodes.empty()) {
+        return Interval::undefined();
+    }
+
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        const ExprNode& node = nodes[i];
+        switch (node.op) {
+            case ExprOp::Const:
+                registers[i] = std::isnan(node.value) ? Interval::undefined() : Interval::point(node.value);
+                break;
+            case ExprOp::VarX:
+                registers[i] = x;
+                break;
+            case ExprOp::VarY:
+                registers[i] = y;
+                break;
+            default: {
+                const Interval& a = registers[node.lhs];
+                const Interval& b = registers[exprOpArity(node.op) == 2 ? node.rhs : node.lhs];
+                // x * x (x^2 after optimization) is a square, not a product of independent factors.
+                const Interval r = (node.op == ExprOp::Mul && node.lhs == node.rhs && !a.isUndefined())
+                                       ? integerPower(a, 2)
+                                       : applyInterval(node.op, a, b);
+                // exp rounds relative to its result (argument reduction scales that by |a|),
+                // so a large negative operand must not pad a result near 0 by the operand's size.
+                const double operandMagnitude = node.op == ExprOp::Exp
+                                                    ? magnitude(r) * std::max(1.0, magnitude(a))
+                                                    : std::max(magnitude(a), magnitude(b));
+                registers[i] = settle(r, operandMagnitude);
+                break;
+            }
+        }
+    }
+    return registers[nodes.size() - 1];
+}
+
+} // namespace graphgl
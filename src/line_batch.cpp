@@ -0,0 +1,194 @@
+#include "line_batch.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <cstring>
+
+namespace graphgl {
+
+// Texture units of the vertices and the strip table.
+constexpr int kVertexTextureUnit = 1;
+constexpr int kStripTextureUnit = 2;
+
+// GL_R32F texels per vertex: position, color.
+constexpr size_t kTexelsPerVertex = 6;
+constexpr size_t kVertexStride = kTexelsPerVertex * sizeof(float);
+
+LineBatch::LineBatch()
+    : VAO_(0)
+    , vertexTexture_(0)
+    , stripBuffer_(0)
+    , stripTexture_(0)
+    , vertexBuffer_(0)
+    , windowBuffer_(0)
+    , windowTexture_(0)
+    , maxVertices_(0)
+    , windowed_(false)
+    , segmentCount_(0)
+    , segmentScratch_(0)
+    , vertexEnd_(0)
+{
+    glGenVertexArrays(1, &VAO_);
+    glGenTextures(1, &vertexTexture_);
+    glGenBuffers(1, &stripBuffer_);
+    glGenTextures(1, &stripTexture_);
+
+    GLint maxTexels = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+    // A window holds at least one segment even on a driver reporting nonsense.
+    maxVertices_ = std::max<size_t>(static_cast<size_t>(std::max(maxTexels, 0)) / kTexelsPerVertex, 2);
+
+    glBindBuffer(GL_TEXTURE_BUFFER, stripBuffer_);
+    glBindTexture(GL_TEXTURE_BUFFER, stripTexture_);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32UI, stripBuffer_);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+LineBatch::~LineBatch() {
+    if (windowBuffer_ != 0) {
+        glDeleteTextures(1, &windowTexture_);
+        glDeleteBuffers(1, &windowBuffer_);
+    }
+    glDeleteTextures(1, &stripTexture_);
+    glDeleteBuffers(1, &stripBuffer_);
+    glDeleteTextures(1, &vertexTexture_);
+    glDeleteVertexArrays(1, &VAO_);
+}
+
+void LineBatch::setVertexBuffer(unsigned int buffer) {
+    if (buffer == vertexBuffer_) {
+        return;
+    }
+    vertexBuffer_ = buffer;
+    glBindTexture(GL_TEXTURE_BUFFER, vertexTexture_);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_R32F, vertexBuffer_);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+void LineBatch::begin() {
+    added_.clear();
+    segmentScratch_ = 0;
+    vertexEnd_ = 0;
+}
+
+void LineBatch::addStrip(size_t firstVertex, size_t count, float opacity) {
+    if (count < 2) {
+        return;
+    }
+    uint32_t opacityBits;
+    std::memcpy(&opacityBits, &opacity, sizeof(opacityBits));
+    added_.push_back({firstVertex, count, opacityBits});
+    segmentScratch_ += count - 1;
+    vertexEnd_ = std::max(vertexEnd_, firstVertex + count);
+}
+
+void LineBatch::end() {
+    segmentCount_ = segmentScratch_;
+    stripScratch_.clear();
+    windowScratch_.clear();
+    const bool windowed = vertexEnd_ > maxVertices_;
+    if (windowed) {
+        buildWindows();
+    } else {
+        size_t segment = 0;
+        for (const Strip& strip : added_) {
+            stripScratch_.insert(stripScratch_.end(), {static_cast<uint32_t>(segment),
+                                                       static_cast<uint32_t>(strip.firstVertex),
+                                                       strip.opacityBits, 0});
+            segment += strip.count - 1;
+        }
+    }
+
+    if (windowed && windowBuffer_ == 0) {
+        glGenBuffers(1, &windowBuffer_);
+        glGenTextures(1, &windowTexture_);
+        glBindBuffer(GL_TEXTURE_BUFFER, windowBuffer_);
+        glBufferData(GL_TEXTURE_BUFFER, maxVertices_ * kVertexStride, nullptr, GL_STREAM_DRAW);
+        glBindTexture(GL_TEXTURE_BUFFER, windowTexture_);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_R32F, windowBuffer_);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+    windowed_ = windowed;
+    windows_.swap(windowScratch_);
+
+    if (stripScratch_ == strips_) {
+        return;
+    }
+    strips_.swap(stripScratch_);
+    if (!strips_.empty()) {
+        glBindBuffer(GL_TEXTURE_BUFFER, stripBuffer_);
+        glBufferData(GL_TEXTURE_BUFFER, strips_.size() * sizeof(uint32_t), strips_.data(), GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+}
+
+void LineBatch::buildWindows() {
+    // In vertex order, so neighbouring strips share a window. Strips longer than a window
+    // are cut into pieces sharing their end vertex, which keeps every segment.
+    std::sort(added_.begin(), added_.end(),
+              [](const Strip& a, const Strip& b) { return a.firstVertex < b.firstVertex; });
+    for (const Strip& strip : added_) {
+        size_t offset = 0;
+        while (offset + 1 < strip.count) {
+            const size_t first = strip.firstVertex + offset;
+            const size_t count = std::min(strip.count - offset, maxVertices_);
+            if (windowScratch_.empty() || first + count > windowScratch_.back().firstVertex + maxVertices_) {
+                windowScratch_.push_back({first, 0, stripScratch_.size() / 4, 0, 0});
+            }
+            Window& window = windowScratch_.back();
+            stripScratch_.insert(stripScratch_.end(), {static_cast<uint32_t>(window.segmentCount),
+                                                       static_cast<uint32_t>(first - window.firstVertex),
+                                                       strip.opacityBits, 0});
+            window.vertexCount = std::max(window.vertexCount, first + count - window.firstVertex);
+            ++window.stripCount;
+            window.segmentCount += count - 1;
+            offset += count - 1;
+        }
+    }
+}
+
+void LineBatch::render(const Shader& lineShader, float width, int viewportWidth, int viewportHeight) const {
+    if (segmentCount_ == 0 || vertexBuffer_ == 0) {
+        return;
+    }
+
+    lineShader.use();
+    lineShader.setVec2("viewport_size", static_cast<float>(viewportWidth), static_cast<float>(viewportHeight));
+    lineShader.setFloat("line_width", width);
+    lineShader.setInt("line_vertices", kVertexTextureUnit);
+    lineShader.setInt("line_strips", kStripTextureUnit);
+
+    glActiveTexture(GL_TEXTURE0 + kVertexTextureUnit);
+    glBindTexture(GL_TEXTURE_BUFFER, windowed_ ? windowTexture_ : vertexTexture_);
+    glActiveTexture(GL_TEXTURE0 + kStripTextureUnit);
+    glBindTexture(GL_TEXTURE_BUFFER, stripTexture_);
+    glBindVertexArray(VAO_);
+
+    if (!windowed_) {
+        lineShader.setInt("line_strip_first", 0);
+        lineShader.setInt("line_strip_count", static_cast<int>(strips_.size() / 4));
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(segmentCount_));
+    } else {
+        glBindBuffer(GL_COPY_READ_BUFFER, vertexBuffer_);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, windowBuffer_);
+        for (const Window& window : windows_) {
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                                static_cast<GLintptr>(window.firstVertex * kVertexStride), 0,
+                                static_cast<GLsizeiptr>(window.vertexCount * kVertexStride));
+            lineShader.setInt("line_strip_first", static_cast<int>(window.firstStrip));
+            lineShader.setInt("line_strip_count", static_cast<int>(window.stripCount));
+            glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(window.segmentCount));
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    }
+
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glActiveTexture(GL_TEXTURE0 + kVertexTextureUnit);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+} // namespace graphgl
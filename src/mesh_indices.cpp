@@ -0,0 +1,77 @@
+#include "mesh_indices.h"
+#include <algorithm>
+
+namespace graphgl {
+
+void MeshIndices::assign(const std::vector<unsigned int>& indices) {
+    clear();
+    size_ = indices.size() - indices.size() % 3;
+
+    // Triangles [runFirst, t) are collected for the next 16-bit chunk.
+    size_t runFirst = 0;
+    uint32_t runLo = 0;
+    uint32_t runHi = 0;
+    auto flushRun = [&](size_t end) {
+        if (end == runFirst) {
+            return;
+        }
+        IndexChunk chunk;
+        chunk.start = static_cast<uint32_t>(runFirst);
+        chunk.first = static_cast<uint32_t>(compact_.size());
+        chunk.count = static_cast<uint32_t>(end - runFirst);
+        chunk.baseVertex = runLo;
+        for (size_t i = runFirst; i < end; ++i) {
+            compact_.push_back(static_cast<uint16_t>(indices[i] - runLo));
+        }
+        chunks_.push_back(chunk);
+    };
+
+    for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+        const uint32_t lo = std::min({indices[t], indices[t + 1], indices[t + 2]});
+        const uint32_t hi = std::max({indices[t], indices[t + 1], indices[t + 2]});
+        if (hi - lo > MAX_CHUNK_SPAN) {
+            flushRun(t);
+            if (chunks_.empty() || !chunks_.back().wide) {
+                IndexChunk chunk;
+                chunk.start = static_cast<uint32_t>(t);
+                chunk.first = static_cast<uint32_t>(wide_.size());
+                chunk.wide = true;
+                chunks_.push_back(chunk);
+            }
+            wide_.insert(wide_.end(), indices.begin() + t, indices.begin() + t + 3);
+            chunks_.back().count += 3;
+            runFirst = t + 3;
+            continue;
+        }
+        if (runFirst == t) {
+            runLo = lo;
+            runHi = hi;
+        } else if (std::max(hi, runHi) - std::min(lo, runLo) > MAX_CHUNK_SPAN) {
+            flushRun(t);
+            runFirst = t;
+            runLo = lo;
+            runHi = hi;
+        } else {
+            runLo = std::min(lo, runLo);
+            runHi = std::max(hi, runHi);
+        }
+    }
+    flushRun(size_);
+}
+
+void MeshIndices::clear() {
+    chunks_.clear();
+    compact_.clear();
+    wide_.clear();
+    size_ = 0;
+}
+
+unsigned int MeshIndices::operator[](size_t i) const {
+    const auto next = std::upper_bound(chunks_.begin(), chunks_.end(), i,
+                                       [](size_t position, const IndexChunk& chunk) { return position < chunk.start; });
+    const IndexChunk& chunk = *(next - 1);
+    const size_t offset = chunk.first + (i - chunk.start);
+    return chunk.wide ? wide_[offset] : compact_[offset] + chunk.baseVertex;
+}
+
+} // namespace graphgl
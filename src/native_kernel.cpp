@@ -0,0 +1,355 @@
+#include "native_kernel.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <system_error>
+
+#if !defined(_WIN32)
+#include <dlfcn.h>
+#include <unistd.h>
+#endif
+
+namespace graphgl {
+
+namespace {
+
+namespace fs = std::filesystem;
+
+// Bump when the generated code or entry points change so stale libraries are not reused.
+constexpr int kKernelVersion = 1;
+
+// No -ffast-math: kernels must keep IEEE NaN and infinity semantics to match the interpreter.
+constexpr const char* kCompileFlags = "-std=c++17 -O2 -fno-math-errno -fPIC -shared";
+
+constexpr const char* kBatchSymbol = "graphgl_kernel_batch";
+constexpr const char* kGridSymbol = "graphgl_kernel_grid";
+
+/// FNV-1a, stable across runs and platforms (unlike std::hash).
+uint64_t hashString(const std::string& text, uint64_t hash = 14695981039346656037ull) {
+    for (unsigned char c : text) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+/// Exact float literal for a constant.
+std::string floatLiteral(float value) {
+    if (std::isnan(value)) {
+        return "NAN";
+    }
+    if (std::isinf(value)) {
+        return value > 0.0f ? "HUGE_VALF" : "(-HUGE_VALF)";
+    }
+    char buffer[64];
+    std::snprintf(buffer, sizeof(buffer), value < 0.0f ? "(%af)" : "%af", static_cast<double>(value));
+    return buffer;
+}
+
+const char* functionName(ExprOp op) {
+    switch (op) {
+        case ExprOp::Mod:   return "std::fmod";
+        case ExprOp::Pow:   return "std::pow";
+        case ExprOp::Atan2: return "std::atan2";
+        case ExprOp::Hypot: return "std::hypot";
+        case ExprOp::Sin:   return "std::sin";
+        case ExprOp::Cos:   return "std::cos";
+        case ExprOp::Tan:   return "std::tan";
+        case ExprOp::Asin:  return "std::asin";
+        case ExprOp::Acos:  return "std::acos";
+        case ExprOp::Atan:  return "std::atan";
+        case ExprOp::Sinh:  return "std::sinh";
+        case ExprOp::Cosh:  return "std::cosh";
+        case ExprOp::Tanh:  return "std::tanh";
+        case ExprOp::Exp:   return "std::exp";
+        case ExprOp::Log:   return "std::log";
+        case ExprOp::Log10: return "std::log10";
+        case ExprOp::Log2:  return "std::log2";
+        case ExprOp::Sqrt:  return "std::sqrt";
+        case ExprOp::Abs:   return "std::fabs";
+        case ExprOp::Floor: return "std::floor";
+        case ExprOp::Ceil:  return "std::ceil";
+        case ExprOp::Round: return "std::round";
+        case ExprOp::Trunc: return "std::trunc";
+        default:            return nullptr;
+    }
+}
+
+std::string defaultCacheDirectory() {
+    if (const char* xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg) {
+        return (fs::path(xdg) / "graphgl" / "kernels").string();
+    }
+    if (const char* home = std::getenv("HOME"); home && *home) {
+        return (fs::path(home) / ".cache" / "graphgl" / "kernels").string();
+    }
+    std::error_code error;
+    return (fs::temp_directory_path(error) / "graphgl-kernels").string();
+}
+
+std::string defaultCompiler() {
+    const char* cxx = std::getenv("CXX");
+    return (cxx && *cxx) ? cxx : "c++";
+}
+
+std::string quote(const std::string& text) {
+    std::string quoted = "'";
+    for (char c : text) {
+        quoted += (c == '\'') ? std::string("'\\''") : std::string(1, c);
+    }
+    return quoted + "'";
+}
+
+} // namespace
+
+std::string transpileExpression(const ExpressionProgram& program) {
+    const std::vector<ExprNode>& nodes = program.getNodes();
+
+    std::ostringstream out;
+    out << "// Generated by GraphGL (kernel version " << kKernelVersion << "). Do not edit.\n"
+        << "#include <cmath>\n"
+        << "#include <cstddef>\n\n"
+        << "namespace {\n\n"
+        << "inline float evaluate(float x, float y) {\n"
+        << "    (void)x;\n"
+        << "    (void)y;\n";
+
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        const ExprNode& node = nodes[i];
+        const std::string a = "t" + std::to_string(node.lhs);
+        const std::string b = "t" + std::to_string(node.rhs);
+        out << "    const float t" << i << " = ";
+        switch (node.op) {
+            case ExprOp::Const: out << floatLiteral(node.value); break;
+            case ExprOp::VarX:  out << "x"; break;
+            case ExprOp::VarY:  out << "y"; break;
+            case ExprOp::Neg:   out << "-" << a; break;
+            case ExprOp::Add:   out << a << " + " << b; break;
+            case ExprOp::Sub:   out << a << " - " << b; break;
+            case ExprOp::Mul:   out << a << " * " << b; break;
+            case ExprOp::Div:   out << a << " / " << b; break;
+            // Same operand order as std::min and std::max, so NaNs propagate identically.
+            case ExprOp::Min:   out << "(" << b << " < " << a << ") ? " << b << " : " << a; break;
+            case ExprOp::Max:   out << "(" << a << " < " << b << ") ? " << b << " : " << a; break;
+            case ExprOp::Sgn:
+                out << "(" << a << " > 0.0f) ? 1.0f : ((" << a << " < 0.0f) ? -1.0f : 0.0f)";
+                break;
+            default:
+                out << functionName(node.op) << "(" << a;
+                if (exprOpArity(node.op) == 2) {
+                    out << ", " << b;
+                }
+                out << ")";
+                break;
+        }
+        out << ";\n";
+    }
+
+    out << "    return " << (nodes.empty() ? std::string("NAN") : "t" + std::to_string(nodes.size() - 1))
+        << ";\n"
+        << "}\n\n"
+        << "} // namespace\n\n"
+        << "extern \"C\" void " << kBatchSymbol
+        << "(const float* xs, const float* ys, float* out, std::size_t count) {\n"
+        << "    for (std::size_t i = 0; i < count; ++i) {\n"
+        << "        out[i] = evaluate(xs[i], ys ? ys[i] : 0.0f);\n"
+        << "    }\n"
+        << "}\n\n"
+        << "extern \"C\" void " << kGridSymbol
+        << "(const float* xs, std::size_t xCount, const float* ys, std::size_t yCount, float* out) {\n"
+        << "    for (std::size_t row = 0; row < yCount; ++row) {\n"
+        << "        const float y = ys ? ys[row] : 0.0f;\n"
+        << "        for (std::size_t col = 0; col < xCount; ++col) {\n"
+        << "            out[row * xCount + col] = evaluate(xs[col], y);\n"
+        << "        }\n"
+        << "    }\n"
+        << "}\n";
+    return out.str();
+}
+
+NativeKernel::NativeKernel(void* handle, NativeBatchFunction batch, NativeGridFunction grid)
+    : handle_(handle)
+    , batch_(batch)
+    , grid_(grid)
+{
+}
+
+NativeKernel::~NativeKernel() {
+#if !defined(_WIN32)
+    if (handle_) {
+        dlclose(handle_);
+    }
+#endif
+}
+
+NativeKernelCache::NativeKernelCache(std::string directory, std::string compiler)
+    : directory_(directory.empty() ? defaultCacheDirectory() : std::move(directory))
+    , compiler_(compiler.empty() ? defaultCompiler() : std::move(compiler))
+    , compilerAvailable_(false)
+    , compileCount_(0)
+{
+}
+
+NativeKernelCache::~NativeKernelCache() = default;
+
+bool NativeKernelCache::isCompilerAvailable() {
+    std::call_once(compilerChecked_, [this] {
+#if !defined(_WIN32)
+        const std::string command = quote(compiler_) + " --version > /dev/null 2>&1";
+        compilerAvailable_ = (std::system(command.c_str()) == 0);
+#endif
+    });
+    return compilerAvailable_;
+}
+
+size_t NativeKernelCache::getCompileCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return compileCount_;
+}
+
+std::string NativeKernelCache::getLastError() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return lastError_;
+}
+
+std::shared_ptr<const NativeKernel> NativeKernelCache::load(const ExpressionProgram& program) {
+    if (program.empty()) {
+        return nullptr;
+    }
+
+    const std::string source = transpileExpression(program);
+    const uint64_t hash = hashString(source, hashString(compiler_ + '\n' + kCompileFlags));
+
+    std::promise<std::shared_ptr<const NativeKernel>> promise;
+    KernelFuture pending;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (auto it = loaded_.find(hash); it != loaded_.end()) {
+            pending = it->second;
+        } else {
+            loaded_.emplace(hash, promise.get_future().share());
+        }
+    }
+    if (pending.valid()) {
+        return pending.get();
+    }
+
+    // Build without the lock; other requests for this hash wait on the future.
+    std::string error;
+    std::shared_ptr<const NativeKernel> kernel = build(hash, source, error);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!kernel) {
+            lastError_ = error;
+            loaded_.erase(hash);
+        }
+    }
+    promise.set_value(kernel);
+    return kernel;
+}
+
+std::shared_ptr<const NativeKernel> NativeKernelCache::build(uint64_t hash, const std::string& source,
+                                                             std::string& error) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "kernel_%016llx", static_cast<unsigned long long>(hash));
+    const std::string sourcePath = (fs::path(directory_) / (std::string(name) + ".cpp")).string();
+    const std::string libraryPath = (fs::path(directory_) / (std::string(name) + ".so")).string();
+
+    // A library left by an earlier run (or another process) skips the compiler entirely.
+    std::error_code fsError;
+    if (fs::exists(libraryPath, fsError)) {
+        if (auto kernel = open(libraryPath, error)) {
+            return kernel;
+        }
+        fs::remove(libraryPath, fsError); // unreadable or truncated; rebuild it
+    }
+    if (!isCompilerAvailable()) {
+        error = "C++ compiler not available: " + compiler_;
+        return nullptr;
+    }
+    if (!compile(source, sourcePath, libraryPath, error)) {
+        return nullptr;
+    }
+    return open(libraryPath, error);
+}
+
+bool NativeKernelCache::compile(const std::string& source, const std::string& sourcePath,
+                                const std::string& libraryPath, std::string& message) {
+#if defined(_WIN32)
+    (void)source;
+    (void)sourcePath;
+    (void)libraryPath;
+    message = "Native kernels are not supported on this platform";
+    return false;
+#else
+    std::error_code error;
+    fs::create_directories(directory_, error);
+    if (error) {
+        message = "Cannot create kernel cache directory: " + directory_;
+        return false;
+    }
+
+    {
+        std::ofstream file(sourcePath, std::ios::trunc);
+        file << source;
+        if (!file) {
+            message = "Cannot write kernel source: " + sourcePath;
+            return false;
+        }
+    }
+
+    // Build under a private name and rename into place, so concurrent processes never
+    // load a half-written library.
+    const std::string temporaryPath = libraryPath + "." + std::to_string(getpid()) + ".tmp";
+    const std::string logPath = sourcePath + ".log";
+    const std::string command = quote(compiler_) + " " + kCompileFlags + " -o " + quote(temporaryPath) + " " +
+                                quote(sourcePath) + " > " + quote(logPath) + " 2>&1";
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++compileCount_;
+    }
+    if (std::system(command.c_str()) != 0) {
+        message = "Kernel compilation failed, see " + logPath;
+        fs::remove(temporaryPath, error);
+        return false;
+    }
+
+    fs::rename(temporaryPath, libraryPath, error);
+    if (error) {
+        message = "Cannot move kernel into cache: " + libraryPath;
+        fs::remove(temporaryPath, error);
+        return false;
+    }
+    fs::remove(logPath, error);
+    return true;
+#endif
+}
+
+std::shared_ptr<const NativeKernel> NativeKernelCache::open(const std::string& libraryPath,
+                                                            std::string& message) {
+#if defined(_WIN32)
+    (void)libraryPath;
+    message = "Native kernels are not supported on this platform";
+    return nullptr;
+#else
+    void* handle = dlopen(libraryPath.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+        const char* reason = dlerror();
+        message = reason ? reason : "dlopen failed: " + libraryPath;
+        return nullptr;
+    }
+
+    auto batch = reinterpret_cast<NativeBatchFunction>(dlsym(handle, kBatchSymbol));
+    auto grid = reinterpret_cast<NativeGridFunction>(dlsym(handle, kGridSymbol));
+    if (!batch || !grid) {
+        message = "Kernel entry points missing in " + libraryPath;
+        dlclose(handle);
+        return nullptr;
+    }
+    return std::make_shared<const NativeKernel>(handle, batch, grid);
+#endif
+}
+
+} // namespace graphgl
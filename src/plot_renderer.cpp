@@ -0,0 +1,72 @@
+#include "plot_renderer.h"
+#include <glad/glad.h>
+
+namespace graphgl {
+
+PlotRenderer::PlotRenderer()
+    : VBO_(0)
+    , revision_(0)
+    , initialized_(false)
+{
+}
+
+PlotRenderer::~PlotRenderer() {
+    cleanupBuffers();
+}
+
+void PlotRenderer::initialize() {
+    if (initialized_) {
+        return;
+    }
+    setupBuffers();
+    initialized_ = true;
+}
+
+void PlotRenderer::update(const CurvePlot& plot) {
+    if (VBO_ != 0 && plot.getRevision() == revision_) {
+        return;
+    }
+    revision_ = plot.getRevision();
+
+    if (VBO_ == 0) {
+        setupBuffers();
+    }
+    const std::vector<glm::vec3>& vertices = plot.getVertices();
+    glBindBuffer(GL_ARRAY_BUFFER, VBO_);
+    if (!vertices.empty()) {
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec3), vertices.data(), GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    lines_->begin();
+    for (const IndexRange& strip : plot.getStrips()) {
+        lines_->addStrip(strip.first, strip.count, 1.0f);
+    }
+    lines_->end();
+}
+
+void PlotRenderer::render(const Shader& lineShader, float width, int viewportWidth, int viewportHeight) const {
+    if (lines_) {
+        lines_->render(lineShader, width, viewportWidth, viewportHeight);
+    }
+}
+
+void PlotRenderer::setupBuffers() {
+    cleanupBuffers();
+
+    glGenBuffers(1, &VBO_);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO_); // a texture buffer needs the buffer object to exist
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    lines_ = std::make_unique<LineBatch>();
+    lines_->setVertexBuffer(VBO_);
+}
+
+void PlotRenderer::cleanupBuffers() {
+    lines_.reset();
+    if (VBO_ != 0) {
+        glDeleteBuffers(1, &VBO_);
+        VBO_ = 0;
+    }
+}
+
+} // namespace graphgl
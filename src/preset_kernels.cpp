@@ -0,0 +1,79 @@
+#include "preset_kernels.h"
+#include "expression_optimizer.h"
+
+namespace graphgl {
+
+namespace {
+
+using namespace kernels;
+
+using SineWave = Sin<X>;
+using Parabola = Square<X>;
+using CircleTop = Sqrt<Sub<Const<25>, Square<X>>>;
+using Ripple = Sin<Sqrt<Add<Square<X>, Square<Y>>>>;
+using Saddle = Sub<Square<X>, Square<Y>>;
+using Hemisphere = Sqrt<Sub<Sub<Const<25>, Square<X>>, Square<Y>>>;
+using Waves = Mul<Sin<X>, Cos<Y>>;
+using EggCarton = Add<Sin<X>, Sin<Y>>;
+
+template <class F>
+PresetKernel makePreset(const char* name, const char* expression, bool is3D) {
+    return {name, expression, is3D, &kernels::evaluateBatch<F>, &kernels::evaluateGrid<F>,
+            &kernels::buildProgram<F>};
+}
+
+/// Structural equality of two expression trees.
+bool sameTree(const std::vector<ExprNode>& a, uint32_t ai, const std::vector<ExprNode>& b, uint32_t bi) {
+    const ExprNode& na = a[ai];
+    const ExprNode& nb = b[bi];
+    if (na.op != nb.op) {
+        return false;
+    }
+    const int arity = exprOpArity(na.op);
+    if (arity == 0) {
+        return na.op != ExprOp::Const || na.value == nb.value;
+    }
+    return sameTree(a, na.lhs, b, nb.lhs) && (arity == 1 || sameTree(a, na.rhs, b, nb.rhs));
+}
+
+} // namespace
+
+const std::vector<PresetKernel>& getPresetKernels() {
+    static const std::vector<PresetKernel> presets = {
+        makePreset<SineWave>("Sine Wave", "sin(x)", false),
+        makePreset<Parabola>("Parabola", "x^2", false),
+        makePreset<CircleTop>("Circle (top)", "sqrt(25 - x^2)", false),
+        makePreset<Ripple>("Ripple", "sin(sqrt(x^2 + y^2))", true),
+        makePreset<Saddle>("Saddle", "x^2 - y^2", true),
+        makePreset<Hemisphere>("Hemisphere", "sqrt(25 - x^2 - y^2)", true),
+        makePreset<Waves>("Waves", "sin(x) * cos(y)", true),
+        makePreset<EggCarton>("Egg Carton", "sin(x) + sin(y)", true),
+    };
+    return presets;
+}
+
+const PresetKernel* findPresetKernel(const ExpressionProgram& program) {
+    // Patterns go through the same optimizer as parsed expressions, so both sides are canonical.
+    static const std::vector<ExpressionProgram> patterns = [] {
+        std::vector<ExpressionProgram> built;
+        for (const PresetKernel& preset : getPresetKernels()) {
+            built.push_back(optimizeExpression(preset.buildProgram()));
+        }
+        return built;
+    }();
+
+    if (program.empty()) {
+        return nullptr;
+    }
+    const std::vector<ExprNode>& nodes = program.getNodes();
+    const uint32_t root = static_cast<uint32_t>(nodes.size() - 1);
+    for (size_t i = 0; i < patterns.size(); ++i) {
+        const std::vector<ExprNode>& pattern = patterns[i].getNodes();
+        if (sameTree(pattern, static_cast<uint32_t>(pattern.size() - 1), nodes, root)) {
+            return &getPresetKernels()[i];
+        }
+    }
+    return nullptr;
+}
+
+} // namespace graphgl
@@ -0,0 +1,68 @@
+#include "range_allocator.h"
+#include <iterator>
+
+namespace graphgl {
+
+RangeAllocator::RangeAllocator(size_t capacity)
+    : capacity_(0)
+    , used_(0)
+{
+    grow(capacity);
+}
+
+size_t RangeAllocator::allocate(size_t size) {
+    if (size == 0) {
+        return 0;
+    }
+    for (auto it = free_.begin(); it != free_.end(); ++it) {
+        if (it->second < size) {
+            continue;
+        }
+        const size_t offset = it->first;
+        const size_t rest = it->second - size;
+        free_.erase(it);
+        if (rest > 0) {
+            free_.emplace(offset + size, rest);
+        }
+        used_ += size;
+        return offset;
+    }
+    return NO_SPACE;
+}
+
+void RangeAllocator::release(size_t offset, size_t size) {
+    if (size == 0) {
+        return;
+    }
+    used_ -= size;
+    insertFree(offset, size);
+}
+
+void RangeAllocator::grow(size_t capacity) {
+    if (capacity <= capacity_) {
+        return;
+    }
+    const size_t added = capacity - capacity_;
+    const size_t offset = capacity_;
+    capacity_ = capacity;
+    insertFree(offset, added);
+}
+
+void RangeAllocator::insertFree(size_t offset, size_t size) {
+    auto next = free_.lower_bound(offset);
+    if (next != free_.begin()) {
+        const auto previous = std::prev(next);
+        if (previous->first + previous->second == offset) {
+            offset = previous->first;
+            size += previous->second;
+            free_.erase(previous);
+        }
+    }
+    if (next != free_.end() && offset + size == next->first) {
+        size += next->second;
+        free_.erase(next);
+    }
+    free_.emplace(offset, size);
+}
+
+} // namespace graphgl
@@ -0,0 +1,212 @@
+#include "rtin_mesh.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstdint>
+#include <limits>
+
+namespace graphgl {
+
+namespace {
+
+/// Largest vertical error of the plane through a, b and c against the lattice samples it
+/// covers. Mixing finite and non-finite samples gives infinity (the triangle straddles a
+/// domain edge); a triangle with no finite sample has nothing to approximate.
+float triangleError(const float* heights, size_t gridSize,
+                    int64_t ax, int64_t ay, int64_t bx, int64_t by, int64_t cx, int64_t cy) {
+    auto at = [&](int64_t x, int64_t y) { return heights[static_cast<size_t>(y) * gridSize + x]; };
+    const float ha = at(ax, ay);
+    const float hb = at(bx, by);
+    const float hc = at(cx, cy);
+
+    // Edge functions give barycentric weights scaled by det; samples on an edge count.
+    int64_t det = (bx - ax) * (cy - ay) - (cx - ax) * (by - ay);
+    const int64_t sign = det < 0 ? -1 : 1;
+    det *= sign;
+
+    bool anyFinite = false;
+    bool anyUndefined = false;
+    float error = 0.0f;
+    for (int64_t y = std::min({ay, by, cy}); y <= std::max({ay, by, cy}); ++y) {
+        for (int64_t x = std::min({ax, bx, cx}); x <= std::max({ax, bx, cx}); ++x) {
+            const int64_t wb = sign * ((x - ax) * (cy - ay) - (cx - ax) * (y - ay));
+            const int64_t wc = sign * ((bx - ax) * (y - ay) - (x - ax) * (by - ay));
+            if (wb < 0 || wc < 0 || wb + wc > det) {
+                continue;
+            }
+            const float h = at(x, y);
+            if (!std::isfinite(h)) {
+                anyUndefined = true;
+                continue;
+            }
+            anyFinite = true;
+            const float u = float(wb) / float(det);
+            const float v = float(wc) / float(det);
+            error = std::max(error, std::abs(ha + u * (hb - ha) + v * (hc - ha) - h));
+        }
+    }
+    if (anyFinite && anyUndefined) {
+        return std::numeric_limits<float>::infinity();
+    }
+    return anyFinite ? error : 0.0f;
+}
+
+/// triangleError with the lattice placed at columns xs and rows ys. The plane is fitted in
+/// those coordinates and only samples inside the placed triangle count; a triangle collapsed
+/// to zero area covers nothing.
+float placedTriangleError(const float* heights, size_t gridSize, const float* xs, const float* ys,
+                          int64_t ax, int64_t ay, int64_t bx, int64_t by, int64_t cx, int64_t cy) {
+    auto at = [&](int64_t x, int64_t y) { return heights[static_cast<size_t>(y) * gridSize + x]; };
+    const double pax = xs[ax], pay = ys[ay];
+    const double ubx = xs[bx] - pax, uby = ys[by] - pay;
+    const double ucx = xs[cx] - pax, ucy = ys[cy] - pay;
+    const double det = ubx * ucy - ucx * uby;
+    if (det == 0.0) {
+        return 0.0f;
+    }
+    const double ha = at(ax, ay);
+    const double hb = at(bx, by);
+    const double hc = at(cx, cy);
+    constexpr double kEdgeSlack = 1e-9;
+
+    bool anyFinite = false;
+    bool anyUndefined = false;
+    double error = 0.0;
+    for (int64_t y = std::min({ay, by, cy}); y <= std::max({ay, by, cy}); ++y) {
+        for (int64_t x = std::min({ax, bx, cx}); x <= std::max({ax, bx, cx}); ++x) {
+            const double px = xs[x] - pax;
+            const double py = ys[y] - pay;
+            const double u = (px * ucy - ucx * py) / det;
+            const double v = (ubx * py - px * uby) / det;
+            if (u < -kEdgeSlack || v < -kEdgeSlack || u + v > 1.0 + kEdgeSlack) {
+                continue;
+            }
+            const float h = at(x, y);
+            if (!std::isfinite(h)) {
+                anyUndefined = true;
+                continue;
+            }
+            anyFinite = true;
+            error = std::max(error, std::abs(ha + u * (hb - ha) + v * (hc - ha) - h));
+        }
+    }
+    if (anyFinite && anyUndefined) {
+        return std::numeric_limits<float>::infinity();
+    }
+    return anyFinite ? static_cast<float>(error) : 0.0f;
+}
+
+} // namespace
+
+void RtinMesh::build(const float* heights, uint32_t gridSize, const float* xs, const float* ys) {
+    gridSize_ = gridSize;
+    errors_.assign(static_cast<size_t>(gridSize) * gridSize, 0.0f);
+
+    // Triangles are numbered breadth-first (two roots, then children), so walking the ids
+    // backwards visits every level after the one below it and errors flow upwards.
+    const int32_t tileSize = static_cast<int32_t>(gridSize) - 1;
+    const size_t numTriangles = static_cast<size_t>(tileSize) * tileSize * 2 - 2;
+    const size_t numParentTriangles = numTriangles - static_cast<size_t>(tileSize) * tileSize;
+
+    for (size_t i = numTriangles; i-- > 0;) {
+        // Decode the hypotenuse (a, b) and apex c from the path bits of the id.
+        size_t id = i + 2;
+        int32_t ax = 0, ay = 0, bx = 0, by = 0, cx = 0, cy = 0;
+        if (id & 1) {
+            bx = by = cx = tileSize;
+        } else {
+            ax = ay = cy = tileSize;
+        }
+        while ((id >>= 1) > 1) {
+            const int32_t mx = (ax + bx) >> 1;
+            const int32_t my = (ay + by) >> 1;
+            if (id & 1) {
+                bx = ax; by = ay;
+                ax = cx; ay = cy;
+            } else {
+                ax = bx; ay = by;
+                bx = cx; by = cy;
+            }
+            cx = mx;
+            cy = my;
+        }
+
+        const int32_t mx = (ax + bx) >> 1;
+        const int32_t my = (ay + by) >> 1;
+        const size_t middle = static_cast<size_t>(my) * gridSize + mx;
+        float error = xs ? placedTriangleError(heights, gridSize, xs, ys, ax, ay, bx, by, cx, cy)
+                         : triangleError(heights, gridSize, ax, ay, bx, by, cx, cy);
+        if (i < numParentTriangles) {
+            const size_t left = static_cast<size_t>((ay + cy) >> 1) * gridSize + ((ax + cx) >> 1);
+            const size_t right = static_cast<size_t>((by + cy) >> 1) * gridSize + ((bx + cx) >> 1);
+            error = std::max({error, errors_[left], errors_[right]});
+        }
+        errors_[middle] = std::max(errors_[middle], error);
+    }
+}
+
+void RtinMesh::limitUndefinedErrors(float base) {
+    for (uint32_t y = 0; y < gridSize_; ++y) {
+        for (uint32_t x = 0; x < gridSize_; ++x) {
+            float& error = errors_[static_cast<size_t>(y) * gridSize_ + x];
+            if (std::isinf(error)) {
+                // A midpoint's lowest set coordinate bit is the leg size of its triangles.
+                const uint32_t bits = x | y;
+                error = base * float(1u + (bits & (~bits + 1u)));
+            }
+        }
+    }
+}
+
+void RtinMesh::extractTriangles(float maxError, std::vector<uint32_t>& triangles) const {
+    if (gridSize_ < 2) {
+        return;
+    }
+    const uint32_t last = gridSize_ - 1;
+    collect(0, 0, last, last, last, 0, maxError, triangles);
+    collect(last, last, 0, 0, 0, last, maxError, triangles);
+}
+
+float RtinMesh::extractSquare(uint32_t x, uint32_t y, uint32_t size, float maxError,
+                             std::vector<uint32_t>& triangles) const {
+    if (gridSize_ < 2 || size == 0) {
+        return 0.0f;
+    }
+    // The diagonal of the square runs through the corner at the centre of the square twice
+    // its size; the whole lattice is split along (0, 0) - (last, last).
+    uint32_t ax = x, ay = y;
+    if (size < gridSize_ - 1) {
+        ax = x - x % (2 * size) + size;
+        ay = y - y % (2 * size) + size;
+    }
+    const uint32_t bx = 2 * x + size - ax;
+    const uint32_t by = 2 * y + size - ay;
+    // The apexes are the other two corners; keep the winding of extractTriangles.
+    uint32_t cx = ax, cy = by;
+    if ((int64_t(bx) - ax) * (int64_t(cy) - ay) - (int64_t(cx) - ax) * (int64_t(by) - ay) > 0) {
+        cx = bx;
+        cy = ay;
+    }
+    const uint32_t dx = ax + bx - cx;
+    const uint32_t dy = ay + by - cy;
+    const float error = collect(ax, ay, bx, by, cx, cy, maxError, triangles);
+    return std::max(error, collect(bx, by, ax, ay, dx, dy, maxError, triangles));
+}
+
+float RtinMesh::collect(uint32_t ax, uint32_t ay, uint32_t bx, uint32_t by, uint32_t cx, uint32_t cy,
+                        float maxError, std::vector<uint32_t>& triangles) const {
+    const uint32_t mx = (ax + bx) >> 1;
+    const uint32_t my = (ay + by) >> 1;
+    const bool hasChildren = std::abs(int32_t(ax) - int32_t(cx)) + std::abs(int32_t(ay) - int32_t(cy)) > 1;
+    const float error = hasChildren ? errors_[static_cast<size_t>(my) * gridSize_ + mx] : 0.0f;
+    if (hasChildren && error > maxError) {
+        const float left = collect(cx, cy, ax, ay, mx, my, maxError, triangles);
+        return std::max(left, collect(bx, by, cx, cy, mx, my, maxError, triangles));
+    }
+    triangles.push_back(ay * gridSize_ + ax);
+    triangles.push_back(by * gridSize_ + bx);
+    triangles.push_back(cy * gridSize_ + cx);
+    return error;
+}
+
+} // namespace graphgl
@@ -0,0 +1,184 @@
+#include "separable_expression.h"
+#include "expression_optimizer.h"
+#include <algorithm>
+
+namespace graphgl {
+
+namespace {
+
+constexpr uint32_t kNoNode = 0xFFFFFFFFu;
+
+constexpr uint8_t kUsesX = 1;
+constexpr uint8_t kUsesY = 2;
+
+/// Copy the subtree rooted at index into dst (post-order, so the copy of index is appended last).
+uint32_t copySubtree(const std::vector<ExprNode>& nodes, uint32_t index, ExpressionProgram& dst,
+                     std::vector<uint32_t>& copied) {
+    if (copied[index] != kNoNode) {
+        return copied[index];
+    }
+    const ExprNode& node = nodes[index];
+    const int arity = exprOpArity(node.op);
+    const uint32_t lhs = arity >= 1 ? copySubtree(nodes, node.lhs, dst, copied) : 0;
+    const uint32_t rhs = arity == 2 ? copySubtree(nodes, node.rhs, dst, copied) : 0;
+    copied[index] = dst.addNode(node.op, lhs, rhs, node.value);
+    return copied[index];
+}
+
+/// Build the program for one factor from the terms selected for it.
+ExpressionProgram buildPart(const std::vector<ExprNode>& nodes, const std::vector<ExprTerm>& terms, bool additive,
+                            bool negate) {
+    ExpressionProgram part;
+    std::vector<uint32_t> copied(nodes.size(), kNoNode);
+
+    uint32_t acc = kNoNode;
+    if (additive) {
+        for (const ExprTerm& term : terms) {
+            const uint32_t value = copySubtree(nodes, term.node, part, copied);
+            if (acc == kNoNode) {
+                acc = term.inverted ? part.addNode(ExprOp::Neg, value) : value;
+            } else {
+                acc = part.addNode(term.inverted ? ExprOp::Sub : ExprOp::Add, acc, value);
+            }
+        }
+    } else {
+        uint32_t numerator = kNoNode;
+        uint32_t denominator = kNoNode;
+        for (const ExprTerm& term : terms) {
+            const uint32_t value = copySubtree(nodes, term.node, part, copied);
+            uint32_t& target = term.inverted ? denominator : numerator;
+            target = (target == kNoNode) ? value : part.addNode(ExprOp::Mul, target, value);
+        }
+        if (denominator != kNoNode) {
+            if (numerator == kNoNode) {
+                numerator = part.addNode(ExprOp::Const, 0, 0, 1.0f);
+            }
+            acc = part.addNode(ExprOp::Div, numerator, denominator);
+        } else {
+            acc = numerator;
+        }
+    }
+
+    if (acc == kNoNode) {
+        return ExpressionProgram();
+    }
+    if (negate) {
+        part.addNode(ExprOp::Neg, acc);
+    }
+    return optimizeExpression(part);
+}
+
+} // namespace
+
+SeparableExpression::SeparableExpression(ExprOp combine, ExpressionProgram xPart, ExpressionProgram yPart)
+    : combine_(combine)
+    , xPart_(std::move(xPart))
+    , yPart_(std::move(yPart))
+    , xSimd_(xPart_)
+    , ySimd_(yPart_)
+{
+}
+
+std::unique_ptr<const SeparableExpression> SeparableExpression::detect(const ExpressionProgram& program) {
+    const std::vector<ExprNode>& nodes = program.getNodes();
+    if (nodes.empty()) {
+        return nullptr;
+    }
+
+    std::vector<uint8_t> uses(nodes.size(), 0);
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        const ExprNode& node = nodes[i];
+        const int arity = exprOpArity(node.op);
+        uses[i] = (node.op == ExprOp::VarX) ? kUsesX : (node.op == ExprOp::VarY) ? kUsesY : 0;
+        if (arity >= 1) {
+            uses[i] |= uses[node.lhs];
+        }
+        if (arity == 2) {
+            uses[i] |= uses[node.rhs];
+        }
+    }
+
+    const uint32_t root = static_cast<uint32_t>(nodes.size() - 1);
+    if (uses[root] == 0) {
+        return nullptr; // constant surface, nothing to gain
+    }
+
+    auto mixes = [&](const ExprTerm& term) { return uses[term.node] == (kUsesX | kUsesY); };
+
+    // Try a sum first, then a product. Terms using neither variable go with x.
+    std::vector<ExprTerm> terms;
+    bool negated = false;
+    bool additive = true;
+    program.collectSum(root, terms);
+    if (std::any_of(terms.begin(), terms.end(), mixes)) {
+        terms.clear();
+        additive = false;
+        program.collectProduct(root, terms, negated);
+        if (std::any_of(terms.begin(), terms.end(), mixes)) {
+            return nullptr;
+        }
+    }
+
+    std::vector<ExprTerm> xTerms;
+    std::vector<ExprTerm> yTerms;
+    for (const ExprTerm& term : terms) {
+        (uses[term.node] == kUsesY ? yTerms : xTerms).push_back(term);
+    }
+
+    // A sign flip from negations inside a product goes to whichever factor exists.
+    const bool negateX = negated && !xTerms.empty();
+    const bool negateY = negated && xTerms.empty();
+    auto separable = std::make_unique<const SeparableExpression>(
+        additive ? ExprOp::Add : ExprOp::Mul,
+        buildPart(nodes, xTerms, additive, negateX),
+        buildPart(nodes, yTerms, additive, negateY));
+
+    if ((!separable->xPart_.empty() && !separable->xSimd_.isValid()) ||
+        (!separable->yPart_.empty() && !separable->ySimd_.isValid())) {
+        return nullptr;
+    }
+    return separable;
+}
+
+size_t SeparableExpression::getScratchSize() const {
+    return std::max(xSimd_.getScratchSize(), ySimd_.getScratchSize());
+}
+
+void SeparableExpression::evaluateGrid(const float* xs, size_t xCount, const float* ys, size_t yCount, float* out,
+                                       float* scratch, std::vector<float>& axisValues) const {
+    axisValues.resize(xCount + yCount);
+    float* xValues = axisValues.data();
+    float* yValues = axisValues.data() + xCount;
+
+    const bool hasX = !xPart_.empty();
+    const bool hasY = !yPart_.empty();
+    if (hasX) {
+        xSimd_.evaluateBatch(xs, nullptr, xValues, xCount, scratch);
+    }
+    if (hasY) {
+        // The y factor only reads y; the samples double as its (unused) x input.
+        ySimd_.evaluateBatch(ys, ys, yValues, yCount, scratch);
+    }
+
+    for (size_t row = 0; row < yCount; ++row) {
+        float* rowOut = out + row * xCount;
+        if (!hasY) {
+            std::copy(xValues, xValues + xCount, rowOut);
+            continue;
+        }
+        const float y = yValues[row];
+        if (!hasX) {
+            std::fill(rowOut, rowOut + xCount, y);
+        } else if (combine_ == ExprOp::Add) {
+            for (size_t col = 0; col < xCount; ++col) {
+                rowOut[col] = xValues[col] + y;
+            }
+        } else {
+            for (size_t col = 0; col < xCount; ++col) {
+                rowOut[col] = xValues[col] * y;
+            }
+        }
+    }
+}
+
+} // namespace graphgl
@@ -7,8 +7,16 @@ Settings::Settings()
     , height_(DEFAULT_HEIGHT)
     , maxViewDistance_(DEFAULT_MAX_VIEW_DISTANCE)
     , pointSize_(DEFAULT_POINT_SIZE)
+    , lineWidth_(DEFAULT_LINE_WIDTH)
     , maxDepth_(DEFAULT_MAX_DEPTH)
     , derivativeThreshold_(DEFAULT_DERIVATIVE_THRESHOLD)
+    , useNativeKernels_(DEFAULT_USE_NATIVE_KERNELS)
+    , useSampleBudget_(DEFAULT_USE_SAMPLE_BUDGET)
+    , useAngleRefinement_(DEFAULT_USE_ANGLE_REFINEMENT)
+    , angleTolerance_(DEFAULT_ANGLE_TOLERANCE)
+    , useSurfaceLod_(DEFAULT_USE_SURFACE_LOD)
+    , lodPixelTolerance_(DEFAULT_LOD_PIXEL_TOLERANCE)
+    , plotMode2D_(DEFAULT_PLOT_MODE_2D)
     , minX_(DEFAULT_MIN_X)
     , maxX_(DEFAULT_MAX_X)
     , minY_(DEFAULT_MIN_Y)
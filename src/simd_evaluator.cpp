@@ -0,0 +1,271 @@
+#include "simd_evaluator.h"
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+namespace graphgl {
+
+namespace {
+
+constexpr size_t kScratchAlignment = 32;
+
+constexpr uint16_t kNoRegister = std::numeric_limits<uint16_t>::max();
+
+} // namespace
+
+SimdEvaluator::SimdEvaluator(const ExpressionProgram& program)
+    : uniformCount_(0)
+    , registerCount_(0)
+    , result_(0)
+    , level_(detectLevel())
+{
+    const std::vector<ExprNode>& nodes = program.getNodes();
+    if (nodes.empty()) {
+        return;
+    }
+
+    // Last instruction reading each node, so its register can be recycled afterwards.
+    std::vector<size_t> lastUse(nodes.size(), 0);
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        const int arity = exprOpArity(nodes[i].op);
+        if (arity >= 1) {
+            lastUse[nodes[i].lhs] = i;
+        }
+        if (arity == 2) {
+            lastUse[nodes[i].rhs] = i;
+        }
+    }
+
+    // Leaves map to fixed registers; equal constants share one register.
+    std::vector<uint16_t> nodeRegister(nodes.size(), kNoRegister);
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        const ExprNode& node = nodes[i];
+        if (node.op == ExprOp::VarX) {
+            nodeRegister[i] = kSimdRegisterX;
+        } else if (node.op == ExprOp::VarY) {
+            nodeRegister[i] = kSimdRegisterY;
+        } else if (node.op == ExprOp::Const) {
+            size_t slot = 0;
+            while (slot < constants_.size() &&
+                   std::memcmp(&constants_[slot], &node.value, sizeof(float)) != 0) {
+                ++slot;
+            }
+            if (slot == constants_.size()) {
+                constants_.push_back(node.value);
+            }
+            nodeRegister[i] = static_cast<uint16_t>(kSimdFirstConstant + slot);
+        }
+    }
+
+    // The leading run of instructions that do not read x forms a per-row prologue (the
+    // optimizer orders programs that way). Their results must survive every block, so a
+    // prologue register is only recycled when its last reader is also in the prologue.
+    std::vector<bool> dependsOnX(nodes.size(), false);
+    std::vector<bool> inPrologue(nodes.size(), false);
+    bool prologue = true;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        const ExprNode& node = nodes[i];
+        const int arity = exprOpArity(node.op);
+        dependsOnX[i] = (node.op == ExprOp::VarX) ||
+                        (arity >= 1 && dependsOnX[node.lhs]) ||
+                        (arity == 2 && dependsOnX[node.rhs]);
+        if (arity > 0) {
+            prologue = prologue && !dependsOnX[i];
+            inPrologue[i] = prologue;
+        }
+    }
+
+    const size_t firstTemporary = kSimdFirstConstant + constants_.size();
+    size_t registerCount = firstTemporary;
+    std::vector<uint16_t> freeRegisters;
+
+    auto release = [&](uint32_t operand, size_t user) {
+        if (lastUse[operand] == user && nodeRegister[operand] >= firstTemporary &&
+            (!inPrologue[operand] || inPrologue[user])) {
+            freeRegisters.push_back(nodeRegister[operand]);
+        }
+    };
+
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        const ExprNode& node = nodes[i];
+        const int arity = exprOpArity(node.op);
+        if (arity == 0) {
+            continue;
+        }
+
+        // Operands die before the destination is chosen, so dst may reuse one of them;
+        // every operation is applied lane by lane, which makes that safe.
+        release(node.lhs, i);
+        if (arity == 2 && node.rhs != node.lhs) {
+            release(node.rhs, i);
+        }
+
+        uint16_t dst;
+        if (!freeRegisters.empty()) {
+            dst = freeRegisters.back();
+            freeRegisters.pop_back();
+        } else {
+            if (registerCount >= kNoRegister) {
+                instructions_.clear();
+                constants_.clear();
+                return;
+            }
+            dst = static_cast<uint16_t>(registerCount++);
+        }
+        nodeRegister[i] = dst;
+
+        SimdInstruction instruction;
+        instruction.op = node.op;
+        instruction.dst = dst;
+        instruction.lhs = nodeRegister[node.lhs];
+        instruction.rhs = (arity == 2) ? nodeRegister[node.rhs] : nodeRegister[node.lhs];
+        instructions_.push_back(instruction);
+        if (inPrologue[i]) {
+            ++uniformCount_;
+        }
+
+        // Results nobody reads (other than the final one) are dropped right away.
+        if (lastUse[i] == 0 && i + 1 < nodes.size()) {
+            freeRegisters.push_back(dst);
+        }
+    }
+
+    result_ = nodeRegister[nodes.size() - 1];
+    registerCount_ = static_cast<uint16_t>(registerCount);
+}
+
+SimdLevel SimdEvaluator::detectLevel() {
+    static const SimdLevel level = [] {
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+            return SimdLevel::Avx2;
+        }
+        if (__builtin_cpu_supports("sse4.1")) {
+            return SimdLevel::Sse41;
+        }
+#endif
+        return SimdLevel::Scalar;
+    }();
+    return level;
+}
+
+const char* SimdEvaluator::getLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::Avx2:  return "AVX2";
+        case SimdLevel::Sse41: return "SSE4.1";
+        default:               return "Scalar";
+    }
+}
+
+void SimdEvaluator::setLevel(SimdLevel level) {
+    const SimdLevel supported = detectLevel();
+    level_ = (static_cast<int>(level) > static_cast<int>(supported)) ? supported : level;
+}
+
+size_t SimdEvaluator::getScratchSize() const {
+    return static_cast<size_t>(registerCount_) * kSimdBlockSize + kScratchAlignment / sizeof(float);
+}
+
+SimdKernelArgs SimdEvaluator::makeArgs(float* scratch) const {
+    const uintptr_t address = reinterpret_cast<uintptr_t>(scratch);
+    const uintptr_t aligned = (address + kScratchAlignment - 1) & ~static_cast<uintptr_t>(kScratchAlignment - 1);
+
+    SimdKernelArgs args;
+    args.instructions = instructions_.data();
+    args.instructionCount = instructions_.size();
+    args.uniformCount = uniformCount_;
+    args.constants = constants_.data();
+    args.constantCount = constants_.size();
+    args.result = result_;
+    args.registers = reinterpret_cast<float*>(aligned);
+    return args;
+}
+
+void SimdEvaluator::run(const SimdKernelArgs& args, const float* xs, const float* ys, float yValue, float* out,
+                        size_t count) const {
+    switch (level_) {
+        case SimdLevel::Avx2:
+            runSimdKernelAvx2(args, xs, ys, yValue, out, count);
+            break;
+        case SimdLevel::Sse41:
+            runSimdKernelSse41(args, xs, ys, yValue, out, count);
+            break;
+        default:
+            runSimdKernelScalar(args, xs, ys, yValue, out, count);
+            break;
+    }
+}
+
+void SimdEvaluator::evaluateBatch(const float* xs, const float* ys, float* out, size_t count,
+                                  float* scratch) const {
+    if (!isValid() || count == 0) {
+        return;
+    }
+    run(makeArgs(scratch), xs, ys, 0.0f, out, count);
+}
+
+void SimdEvaluator::evaluateGrid(const float* xs, size_t xCount, const float* ys, size_t yCount, float* out,
+                                 float* scratch) const {
+    if (!isValid() || xCount == 0) {
+        return;
+    }
+    const SimdKernelArgs args = makeArgs(scratch);
+    for (size_t row = 0; row < yCount; ++row) {
+        run(args, xs, nullptr, ys ? ys[row] : 0.0f, out + row * xCount, xCount);
+    }
+}
+
+void runSimdKernelScalar(const SimdKernelArgs& args, const float* xs, const float* ys, float yValue,
+                         float* out, size_t count) {
+    float* registers = args.registers;
+    float* xReg = registers + kSimdRegisterX * kSimdBlockSize;
+    float* yReg = registers + kSimdRegisterY * kSimdBlockSize;
+    const float* result = registers + args.result * kSimdBlockSize;
+
+    auto execute = [registers](const SimdInstruction& ins, size_t lanes) {
+        const float* lhs = registers + ins.lhs * kSimdBlockSize;
+        const float* rhs = registers + ins.rhs * kSimdBlockSize;
+        float* dst = registers + ins.dst * kSimdBlockSize;
+        for (size_t i = 0; i < lanes; ++i) {
+            dst[i] = applyExprOp(ins.op, lhs[i], rhs[i]);
+        }
+    };
+
+    for (size_t c = 0; c < args.constantCount; ++c) {
+        float* reg = registers + (kSimdFirstConstant + c) * kSimdBlockSize;
+        for (size_t i = 0; i < kSimdBlockSize; ++i) {
+            reg[i] = args.constants[c];
+        }
+    }
+
+    size_t first = 0;
+    if (!ys) {
+        for (size_t i = 0; i < kSimdBlockSize; ++i) {
+            yReg[i] = yValue;
+        }
+        for (; first < args.uniformCount; ++first) {
+            execute(args.instructions[first], kSimdBlockSize);
+        }
+    }
+
+    for (size_t base = 0; base < count; base += kSimdBlockSize) {
+        const size_t n = (count - base < kSimdBlockSize) ? count - base : kSimdBlockSize;
+        for (size_t i = 0; i < n; ++i) {
+            xReg[i] = xs[base + i];
+            if (ys) {
+                yReg[i] = ys[base + i];
+            }
+        }
+
+        for (size_t k = first; k < args.instructionCount; ++k) {
+            execute(args.instructions[k], n);
+        }
+
+        for (size_t i = 0; i < n; ++i) {
+            out[base + i] = result[i];
+        }
+    }
+}
+
+} // namespace graphgl
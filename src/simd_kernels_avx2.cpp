@@ -0,0 +1,89 @@
+#include "simd_evaluator.h"
+
+// This file is compiled with -mavx2 -mfma. Nothing in it may run before
+// SimdEvaluator::detectLevel() has confirmed that the CPU supports both.
+
+#if defined(__AVX2__) && defined(__FMA__)
+
+#include "simd_kernels.h"
+#include <immintrin.h>
+
+namespace graphgl {
+
+namespace {
+
+struct Avx2Ops {
+    using F = __m256;
+    using I = __m256i;
+    static constexpr size_t kLanes = 8;
+
+    static F load(const float* p) { return _mm256_load_ps(p); }
+    static void store(float* p, F a) { _mm256_store_ps(p, a); }
+    static F set1(float v) { return _mm256_set1_ps(v); }
+    static I set1i(int v) { return _mm256_set1_epi32(v); }
+
+    static F add(F a, F b) { return _mm256_add_ps(a, b); }
+    static F sub(F a, F b) { return _mm256_sub_ps(a, b); }
+    static F mul(F a, F b) { return _mm256_mul_ps(a, b); }
+    static F div(F a, F b) { return _mm256_div_ps(a, b); }
+    static F fmadd(F a, F b, F c) { return _mm256_fmadd_ps(a, b, c); }
+    // Operand order reproduces std::min/std::max, including which side wins for NaN.
+    static F min(F a, F b) { return _mm256_min_ps(b, a); }
+    static F max(F a, F b) { return _mm256_max_ps(b, a); }
+    static F sqrt(F a) { return _mm256_sqrt_ps(a); }
+    static F floor(F a) { return _mm256_floor_ps(a); }
+    static F ceil(F a) { return _mm256_ceil_ps(a); }
+    static F trunc(F a) { return _mm256_round_ps(a, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC); }
+
+    static F and_(F a, F b) { return _mm256_and_ps(a, b); }
+    static F or_(F a, F b) { return _mm256_or_ps(a, b); }
+    static F xor_(F a, F b) { return _mm256_xor_ps(a, b); }
+    static F andnot(F a, F b) { return _mm256_andnot_ps(a, b); }
+    static F blend(F mask, F a, F b) { return _mm256_blendv_ps(b, a, mask); }
+
+    static F cmpeq(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+    static F cmplt(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    static F cmple(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+    static F cmpgt(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+    static F cmpge(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+    static F cmpnle(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_NLE_UQ); }
+    static F isnan(F a) { return _mm256_cmp_ps(a, a, _CMP_UNORD_Q); }
+    static bool any(F mask) { return _mm256_movemask_ps(mask) != 0; }
+    static bool all(F mask) { return _mm256_movemask_ps(mask) == 0xFF; }
+
+    static I cvtt(F a) { return _mm256_cvttps_epi32(a); }
+    static F cvt(I a) { return _mm256_cvtepi32_ps(a); }
+    static I castf2i(F a) { return _mm256_castps_si256(a); }
+    static F casti2f(I a) { return _mm256_castsi256_ps(a); }
+    static I addi(I a, I b) { return _mm256_add_epi32(a, b); }
+    static I subi(I a, I b) { return _mm256_sub_epi32(a, b); }
+    static I andi(I a, I b) { return _mm256_and_si256(a, b); }
+    static I ori(I a, I b) { return _mm256_or_si256(a, b); }
+    static I andnoti(I a, I b) { return _mm256_andnot_si256(a, b); }
+    static I cmpeqi(I a, I b) { return _mm256_cmpeq_epi32(a, b); }
+    template <int N> static I slli(I a) { return _mm256_slli_epi32(a, N); }
+    template <int N> static I srli(I a) { return _mm256_srli_epi32(a, N); }
+    template <int N> static I srai(I a) { return _mm256_srai_epi32(a, N); }
+};
+
+} // namespace
+
+void runSimdKernelAvx2(const SimdKernelArgs& args, const float* xs, const float* ys, float yValue,
+                       float* out, size_t count) {
+    simd::runSimdKernel<Avx2Ops>(args, xs, ys, yValue, out, count);
+}
+
+} // namespace graphgl
+
+#else
+
+namespace graphgl {
+
+void runSimdKernelAvx2(const SimdKernelArgs& args, const float* xs, const float* ys, float yValue,
+                       float* out, size_t count) {
+    runSimdKernelScalar(args, xs, ys, yValue, out, count);
+}
+
+} // namespace graphgl
+
+#endif
@@ -0,0 +1,89 @@
+#include "simd_evaluator.h"
+
+// This file is compiled with -msse4.1. Nothing in it may run before
+// SimdEvaluator::detectLevel() has confirmed that the CPU supports SSE4.1.
+
+#if defined(__SSE4_1__)
+
+#include "simd_kernels.h"
+#include <smmintrin.h>
+
+namespace graphgl {
+
+namespace {
+
+struct Sse41Ops {
+    using F = __m128;
+    using I = __m128i;
+    static constexpr size_t kLanes = 4;
+
+    static F load(const float* p) { return _mm_load_ps(p); }
+    static void store(float* p, F a) { _mm_store_ps(p, a); }
+    static F set1(float v) { return _mm_set1_ps(v); }
+    static I set1i(int v) { return _mm_set1_epi32(v); }
+
+    static F add(F a, F b) { return _mm_add_ps(a, b); }
+    static F sub(F a, F b) { return _mm_sub_ps(a, b); }
+    static F mul(F a, F b) { return _mm_mul_ps(a, b); }
+    static F div(F a, F b) { return _mm_div_ps(a, b); }
+    static F fmadd(F a, F b, F c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+    // Operand order reproduces std::min/std::max, including which side wins for NaN.
+    static F min(F a, F b) { return _mm_min_ps(b, a); }
+    static F max(F a, F b) { return _mm_max_ps(b, a); }
+    static F sqrt(F a) { return _mm_sqrt_ps(a); }
+    static F floor(F a) { return _mm_floor_ps(a); }
+    static F ceil(F a) { return _mm_ceil_ps(a); }
+    static F trunc(F a) { return _mm_round_ps(a, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC); }
+
+    static F and_(F a, F b) { return _mm_and_ps(a, b); }
+    static F or_(F a, F b) { return _mm_or_ps(a, b); }
+    static F xor_(F a, F b) { return _mm_xor_ps(a, b); }
+    static F andnot(F a, F b) { return _mm_andnot_ps(a, b); }
+    static F blend(F mask, F a, F b) { return _mm_blendv_ps(b, a, mask); }
+
+    static F cmpeq(F a, F b) { return _mm_cmpeq_ps(a, b); }
+    static F cmplt(F a, F b) { return _mm_cmplt_ps(a, b); }
+    static F cmple(F a, F b) { return _mm_cmple_ps(a, b); }
+    static F cmpgt(F a, F b) { return _mm_cmpgt_ps(a, b); }
+    static F cmpge(F a, F b) { return _mm_cmpge_ps(a, b); }
+    static F cmpnle(F a, F b) { return _mm_cmpnle_ps(a, b); }
+    static F isnan(F a) { return _mm_cmpunord_ps(a, a); }
+    static bool any(F mask) { return _mm_movemask_ps(mask) != 0; }
+    static bool all(F mask) { return _mm_movemask_ps(mask) == 0xF; }
+
+    static I cvtt(F a) { return _mm_cvttps_epi32(a); }
+    static F cvt(I a) { return _mm_cvtepi32_ps(a); }
+    static I castf2i(F a) { return _mm_castps_si128(a); }
+    static F casti2f(I a) { return _mm_castsi128_ps(a); }
+    static I addi(I a, I b) { return _mm_add_epi32(a, b); }
+    static I subi(I a, I b) { return _mm_sub_epi32(a, b); }
+    static I andi(I a, I b) { return _mm_and_si128(a, b); }
+    static I ori(I a, I b) { return _mm_or_si128(a, b); }
+    static I andnoti(I a, I b) { return _mm_andnot_si128(a, b); }
+    static I cmpeqi(I a, I b) { return _mm_cmpeq_epi32(a, b); }
+    template <int N> static I slli(I a) { return _mm_slli_epi32(a, N); }
+    template <int N> static I srli(I a) { return _mm_srli_epi32(a, N); }
+    template <int N> static I srai(I a) { return _mm_srai_epi32(a, N); }
+};
+
+} // namespace
+
+void runSimdKernelSse41(const SimdKernelArgs& args, const float* xs, const float* ys, float yValue,
+                        float* out, size_t count) {
+    simd::runSimdKernel<Sse41Ops>(args, xs, ys, yValue, out, count);
+}
+
+} // namespace graphgl
+
+#else
+
+namespace graphgl {
+
+void runSimdKernelSse41(const SimdKernelArgs& args, const float* xs, const float* ys, float yValue,
+                        float* out, size_t count) {
+    runSimdKernelScalar(args, xs, ys, yValue, out, count);
+}
+
+} // namespace graphgl
+
+#endif
@@ -0,0 +1,64 @@
+#include "surface_lod.h"
+#include <algorithm>
+#include <cmath>
+
+namespace graphgl {
+
+void SurfaceLod::selectLevels(const LodView& view, std::vector<uint8_t>& selected) const {
+    selected.assign(chunks.size(), 0);
+    if (levels == 0) {
+        return;
+    }
+    // The error a chunk may have where an on-screen pixel spans one unit at distance 1.
+    const float allowedPerUnit = view.pixelTolerance / std::max(view.pixelsPerUnit, 1e-6f);
+
+    for (size_t c = 0; c < chunks.size(); ++c) {
+        const SurfaceChunk& chunk = chunks[c];
+        if (chunk.boundsMin.x > chunk.boundsMax.x) {
+            selected[c] = static_cast<uint8_t>(levels - 1); // nothing to draw; never forces refinement
+            continue;
+        }
+        const glm::vec3 nearest = glm::clamp(view.eye, chunk.boundsMin, chunk.boundsMax);
+        const float allowed = glm::length(view.eye - nearest) * allowedPerUnit;
+        uint8_t level = 0;
+        while (level + 1u < levels && chunk.errors[level + 1] <= allowed) {
+            ++level;
+        }
+        selected[c] = level;
+    }
+
+    // Levels only ever drop, so this settles within `levels` passes.
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (uint32_t row = 0; row < rows; ++row) {
+            for (uint32_t col = 0; col < columns; ++col) {
+                uint8_t& level = selected[row * columns + col];
+                auto limit = [&](uint32_t neighbour) {
+                    if (level > selected[neighbour] + 1) {
+                        level = static_cast<uint8_t>(selected[neighbour] + 1);
+                        changed = true;
+                    }
+                };
+                if (col > 0) limit(row * columns + col - 1);
+                if (col + 1 < columns) limit(row * columns + col + 1);
+                if (row > 0) limit((row - 1) * columns + col);
+                if (row + 1 < rows) limit((row + 1) * columns + col);
+            }
+        }
+    }
+}
+
+void SurfaceLod::appendIndices(const std::vector<uint8_t>& selected, unsigned int baseVertex,
+                               std::vector<unsigned int>& out) const {
+    for (size_t c = 0; c < chunks.size(); ++c) {
+        const SurfaceChunk& chunk = chunks[c];
+        for (const IndexRange& range : {chunk.triangles[selected[c]], chunk.skirts[selected[c]]}) {
+            for (uint32_t i = range.first; i < range.first + range.count; ++i) {
+                out.push_back(indices[i] + baseVertex);
+            }
+        }
+    }
+}
+
+} // namespace graphgl
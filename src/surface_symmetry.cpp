@@ -0,0 +1,244 @@
+#include "surface_symmetry.h"
+#include "expression_optimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace graphgl {
+
+namespace {
+
+constexpr uint32_t kNoNode = 0xFFFFFFFFu;
+constexpr float kTwoPi = 6.28318530717958647692f;
+
+/// Rewrites f(x, y) into h(r), or fails if some use of x or y is not radial.
+class RadialRewriter {
+public:
+    explicit RadialRewriter(const ExpressionProgram& program)
+        : program_(program)
+        , nodes_(program.getNodes())
+        , built_(nodes_.size(), kNoNode)
+        , radius_(kNoNode)
+        , radiusSquared_(kNoNode)
+        , ok_(true)
+    {
+    }
+
+    bool run(ExpressionProgram& profile) {
+        const uint32_t result = build(static_cast<uint32_t>(nodes_.size() - 1));
+        if (!ok_ || radius_ == kNoNode) {
+            return false;
+        }
+        // Make the result the last node; the optimizer folds the "* 1" away again.
+        profile_.addNode(ExprOp::Mul, result, profile_.addNode(ExprOp::Const, 0, 0, 1.0f));
+        profile = optimizeExpression(profile_);
+        return true;
+    }
+
+private:
+    const ExpressionProgram& program_;
+    const std::vector<ExprNode>& nodes_;
+    ExpressionProgram profile_;
+    std::vector<uint32_t> built_;
+    uint32_t radius_;
+    uint32_t radiusSquared_;
+    bool ok_;
+
+    bool isSquareOf(uint32_t index, ExprOp variable) const {
+        const ExprNode& node = nodes_[index];
+        return node.op == ExprOp::Mul && nodes_[node.lhs].op == variable && nodes_[node.rhs].op == variable;
+    }
+
+    bool isHypotXY(const ExprNode& node) const {
+        if (node.op != ExprOp::Hypot) {
+            return false;
+        }
+        const ExprOp a = nodes_[node.lhs].op;
+        const ExprOp b = nodes_[node.rhs].op;
+        return (a == ExprOp::VarX && b == ExprOp::VarY) || (a == ExprOp::VarY && b == ExprOp::VarX);
+    }
+
+    uint32_t radius() {
+        if (radius_ == kNoNode) {
+            radius_ = profile_.addNode(ExprOp::VarX);
+        }
+        return radius_;
+    }
+
+    uint32_t radiusSquared() {
+        if (radiusSquared_ == kNoNode) {
+            const uint32_t r = radius();
+            radiusSquared_ = profile_.addNode(ExprOp::Mul, r, r);
+        }
+        return radiusSquared_;
+    }
+
+    uint32_t fail() {
+        ok_ = false;
+        return 0;
+    }
+
+    uint32_t build(uint32_t index) {
+        if (!ok_) {
+            return 0;
+        }
+        if (built_[index] != kNoNode) {
+            return built_[index];
+        }
+
+        const ExprNode& node = nodes_[index];
+        uint32_t result;
+        if (node.op == ExprOp::VarX || node.op == ExprOp::VarY ||
+            isSquareOf(index, ExprOp::VarX) || isSquareOf(index, ExprOp::VarY)) {
+            // x, y, x^2 or y^2 outside a sum that pairs them up.
+            return fail();
+        } else if (isHypotXY(node)) {
+            result = radius();
+        } else if (node.op == ExprOp::Add || node.op == ExprOp::Sub || node.op == ExprOp::Neg) {
+            result = buildSum(index);
+        } else {
+            const int arity = exprOpArity(node.op);
+            const uint32_t lhs = arity >= 1 ? build(node.lhs) : 0;
+            const uint32_t rhs = arity == 2 ? build(node.rhs) : 0;
+            result = profile_.addNode(node.op, lhs, rhs, node.value);
+        }
+        built_[index] = result;
+        return result;
+    }
+
+    /// A sum is radial if its x^2 and y^2 terms pair up with equal signs; each pair becomes r*r.
+    uint32_t buildSum(uint32_t index) {
+        std::vector<ExprTerm> terms;
+        program_.collectSum(index, terms);
+
+        int xBalance[2] = {0, 0};
+        int yBalance[2] = {0, 0};
+        for (const ExprTerm& term : terms) {
+            if (isSquareOf(term.node, ExprOp::VarX)) {
+                ++xBalance[term.inverted];
+            } else if (isSquareOf(term.node, ExprOp::VarY)) {
+                ++yBalance[term.inverted];
+            }
+        }
+        if (xBalance[0] != yBalance[0] || xBalance[1] != yBalance[1]) {
+            return fail();
+        }
+
+        uint32_t acc = kNoNode;
+        for (const ExprTerm& term : terms) {
+            if (isSquareOf(term.node, ExprOp::VarY)) {
+                continue; // folded into the matching x^2 term
+            }
+            const uint32_t value = isSquareOf(term.node, ExprOp::VarX) ? radiusSquared() : build(term.node);
+            if (!ok_) {
+                return 0;
+            }
+            if (acc == kNoNode) {
+                acc = term.inverted ? profile_.addNode(ExprOp::Neg, value) : value;
+            } else {
+                acc = profile_.addNode(term.inverted ? ExprOp::Sub : ExprOp::Add, acc, value);
+            }
+        }
+        return acc;
+    }
+};
+
+/// Period of the program along one variable, or 0.
+float findPeriod(const std::vector<ExprNode>& nodes, ExprOp variable) {
+    const size_t count = nodes.size();
+    std::vector<bool> depends(count, false);
+    std::vector<bool> affine(count, false);
+    std::vector<float> slope(count, 0.0f);
+    // Whether the variable reaches this node other than through a periodic function.
+    std::vector<bool> escapes(count, false);
+    std::vector<float> periods;
+
+    for (size_t i = 0; i < count; ++i) {
+        const ExprNode& node = nodes[i];
+        const int arity = exprOpArity(node.op);
+        const uint32_t a = node.lhs;
+        const uint32_t b = node.rhs;
+
+        depends[i] = (node.op == variable) || (arity >= 1 && depends[a]) || (arity == 2 && depends[b]);
+        if (!depends[i]) {
+            affine[i] = true; // constant offset in this variable
+            continue;
+        }
+
+        switch (node.op) {
+            case ExprOp::VarX:
+            case ExprOp::VarY:
+                affine[i] = true;
+                slope[i] = 1.0f;
+                break;
+            case ExprOp::Add:
+            case ExprOp::Sub:
+                affine[i] = affine[a] && affine[b];
+                slope[i] = (node.op == ExprOp::Add) ? slope[a] + slope[b] : slope[a] - slope[b];
+                break;
+            case ExprOp::Neg:
+                affine[i] = affine[a];
+                slope[i] = -slope[a];
+                break;
+            case ExprOp::Mul:
+                if (!depends[a] && nodes[a].op == ExprOp::Const) {
+                    affine[i] = affine[b];
+                    slope[i] = slope[b] * nodes[a].value;
+                } else if (!depends[b] && nodes[b].op == ExprOp::Const) {
+                    affine[i] = affine[a];
+                    slope[i] = slope[a] * nodes[b].value;
+                }
+                break;
+            case ExprOp::Div:
+                if (!depends[b] && nodes[b].op == ExprOp::Const) {
+                    affine[i] = affine[a];
+                    slope[i] = slope[a] / nodes[b].value;
+                }
+                break;
+            default:
+                break;
+        }
+
+        const bool trig = node.op == ExprOp::Sin || node.op == ExprOp::Cos || node.op == ExprOp::Tan;
+        if (trig && affine[a] && std::isfinite(slope[a]) && slope[a] != 0.0f) {
+            const float base = (node.op == ExprOp::Tan) ? kTwoPi * 0.5f : kTwoPi;
+            periods.push_back(base / std::fabs(slope[a]));
+            escapes[i] = false;
+        } else {
+            escapes[i] = (node.op == variable) || (arity >= 1 && escapes[a]) || (arity == 2 && escapes[b]);
+        }
+    }
+
+    if (count == 0 || !depends[count - 1] || escapes[count - 1] || periods.empty()) {
+        return 0.0f;
+    }
+
+    // The common period is the longest one, provided every other period divides it.
+    const float period = *std::max_element(periods.begin(), periods.end());
+    for (float p : periods) {
+        const float ratio = period / p;
+        if (std::fabs(ratio - std::round(ratio)) > 1e-4f * ratio) {
+            return 0.0f;
+        }
+    }
+    return period;
+}
+
+} // namespace
+
+SurfaceSymmetry SurfaceSymmetry::analyze(const ExpressionProgram& program) {
+    SurfaceSymmetry symmetry;
+    if (program.empty()) {
+        return symmetry;
+    }
+
+    RadialRewriter rewriter(program);
+    if (!rewriter.run(symmetry.radialProfile_)) {
+        symmetry.radialProfile_ = ExpressionProgram();
+    }
+    symmetry.periodX_ = findPeriod(program.getNodes(), ExprOp::VarX);
+    symmetry.periodY_ = findPeriod(program.getNodes(), ExprOp::VarY);
+    return symmetry;
+}
+
+} // namespace graphgl
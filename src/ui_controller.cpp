@@ -1,10 +1,12 @@
 #include "ui_controller.h"
+#include "preset_kernels.h"
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include "../lib/imgui/imgui.h"
 #include "../lib/imgui/backends/imgui_impl_glfw.h"
 #include "../lib/imgui/backends/imgui_impl_opengl3.h"
 #include <glm/gtx/string_cast.hpp>
+#include <algorithm>
 #include <cstring>
 
 namespace graphgl {
@@ -128,13 +130,49 @@ void UIController::renderMainMenuBar() {
                 settings_->setDerivativeThreshold(derivThresh);
             }
 
+            bool useAngleRefinement = settings_->getUseAngleRefinement();
+            if (ImGui::Checkbox("Refine Curves by Turning Angle", &useAngleRefinement)) {
+                settings_->setUseAngleRefinement(useAngleRefinement);
+            }
+
+            double angleTolerance = settings_->getAngleTolerance();
+            if (ImGui::InputDouble("Angle Tolerance (degrees)", &angleTolerance)) {
+                settings_->setAngleTolerance(
+                    std::clamp(angleTolerance, Settings::MIN_ANGLE_TOLERANCE, Settings::MAX_ANGLE_TOLERANCE));
+            }
+
             int maxDepth = settings_->getMaxDepth();
             if (ImGui::InputInt("Adjust Depth", &maxDepth)) {
                 settings_->setMaxDepth(maxDepth);
             }
 
+            bool useNativeKernels = settings_->getUseNativeKernels();
+            if (ImGui::Checkbox("Compile Equations to Native Code", &useNativeKernels)) {
+                settings_->setUseNativeKernels(useNativeKernels);
+            }
+
+            bool useSampleBudget = settings_->getUseSampleBudget();
+            if (ImGui::Checkbox("Limit Vertices to Sample Size", &useSampleBudget)) {
+                settings_->setUseSampleBudget(useSampleBudget);
+            }
+
+            bool useSurfaceLod = settings_->getUseSurfaceLod();
+            if (ImGui::Checkbox("View-Dependent Surface Detail", &useSurfaceLod)) {
+                settings_->setUseSurfaceLod(useSurfaceLod);
+            }
+
+            float lodPixelTolerance = settings_->getLodPixelTolerance();
+            if (ImGui::InputFloat("Surface Detail Tolerance (pixels)", &lodPixelTolerance)) {
+                settings_->setLodPixelTolerance(std::max(lodPixelTolerance, 0.1f));
+            }
+
             ImGui::Separator();
 
+            bool plotMode2D = settings_->getPlotMode2D();
+            if (ImGui::Checkbox("2D Plot Mode", &plotMode2D)) {
+                settings_->setPlotMode2D(plotMode2D);
+            }
+
             bool showAxes = settings_->getShowGridlines();
             if (ImGui::Checkbox("Show Axes", &showAxes)) {
                 settings_->setShowGridlines(showAxes);
@@ -170,6 +208,11 @@ void UIController::renderMainMenuBar() {
                 settings_->setPointSize(pointSize);
             }
 
+            float lineWidth = settings_->getLineWidth();
+            if (ImGui::InputFloat("Set Line Width (pixels)", &lineWidth)) {
+                settings_->setLineWidth(std::max(lineWidth, 0.5f));
+            }
+
             ImGui::Separator();
 
             ImGui::InputText("Filepath for Import (don't forget .mat extension)", 
@@ -254,14 +297,20 @@ void UIController::renderEquationInput(Equation& equation, size_t index) {
     buf[sizeof(buf) - 1] = '\0';
 
     bool needsRender = false;
+    bool styleChanged = false; // only the draw record changes, not the geometry
 
     if (ImGui::InputText("Equation", buf, sizeof(buf))) {
         equation.expression = buf;
         needsRender = true;
     }
 
+    // Meshes take their color from the draw record; lines store it in their vertices.
     if (ImGui::ColorEdit3("Colour", equation.color.data())) {
-        needsRender = true;
+        if (equation.isMesh) {
+            styleChanged = true;
+        } else {
+            needsRender = true;
+        }
     }
 
     if (ImGui::SliderInt("Sample Size", &equation.sampleSize, 1, 10000)) {
@@ -283,7 +332,7 @@ void UIController::renderEquationInput(Equation& equation, size_t index) {
     }
 
     if (ImGui::SliderFloat("Opacity", &equation.opacity, 0.0f, 1.0f)) {
-        needsRender = true;
+        styleChanged = true;
     }
 
     bool visibilityToggle = ImGui::Checkbox("Toggle Visibility", &equation.isVisible);
@@ -293,7 +342,7 @@ void UIController::renderEquationInput(Equation& equation, size_t index) {
     if (heatmapToggle) {
         settings_->setUseHeatmap(useHeatmap);
     }
-    bool meshToggle = ImGui::Checkbox("Toggle Mesh (might not work for all functions)", &equation.isMesh);
+    bool meshToggle = ImGui::Checkbox("Toggle Mesh", &equation.isMesh);
 
     if (visibilityToggle || toggle3D || heatmapToggle || meshToggle) {
         needsRender = true;
@@ -309,6 +358,8 @@ void UIController::renderEquationInput(Equation& equation, size_t index) {
         if (onEquationRender_) {
             onEquationRender_(equation, index);
         }
+    } else if (styleChanged && onEquationStyle_) {
+        onEquationStyle_(equation, index);
     }
 }
 
@@ -352,25 +403,8 @@ void UIController::renderPresets() {
         return;
     }
 
-    struct Preset {
-        const char* name;
-        const char* expression;
-        bool is3D;
-    };
-
-    static const Preset presets[] = {
-        {"Sine Wave",    "sin(x)",           false},
-        {"Parabola",     "x^2",              false},
-        {"Circle (top)", "sqrt(25 - x^2)",   false},
-        {"Ripple",       "sin(sqrt(x^2 + y^2))", true},
-        {"Saddle",       "x^2 - y^2",        true},
-        {"Hemisphere",   "sqrt(25 - x^2 - y^2)", true},
-        {"Waves",        "sin(x) * cos(y)",  true},
-        {"Egg Carton",   "sin(x) + sin(y)",  true},
-    };
-
     if (ImGui::TreeNode("Presets")) {
-        for (const auto& p : presets) {
+        for (const PresetKernel& p : getPresetKernels()) {
             if (ImGui::Button(p.name)) {
                 onEquationAdd_();
                 auto& eq = equations_->back();
@@ -388,6 +422,10 @@ void UIController::setOnEquationRender(std::function<void(Equation&, size_t)> ca
     onEquationRender_ = callback;
 }
 
+void UIController::setOnEquationStyle(std::function<void(Equation&, size_t)> callback) {
+    onEquationStyle_ = callback;
+}
+
 void UIController::setOnEquationRemove(std::function<void(size_t)> callback) {
     onEquationRemove_ = callback;
 }
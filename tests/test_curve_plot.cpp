@@ -0,0 +1,227 @@
+#include <gtest/gtest.h>
+#include "curve_plot.h"
+#include <cmath>
+#include <vector>
+
+using namespace graphgl;
+
+class CurvePlotTest : public ::testing::Test {
+protected:
+    static Equation curve(const char* expression) {
+        Equation eq;
+        eq.expression = expression;
+        eq.is3D = false;
+        return eq;
+    }
+
+    static GenerationOptions options() {
+        GenerationOptions opts;
+        opts.maxDepth = 5;
+        return opts;
+    }
+
+    // Update until every tile in view has arrived; returns the tiles requested on the way.
+    static size_t settle(CurvePlot& plot, const std::vector<Equation>& equations, double minX, double maxX) {
+        size_t requested = 0;
+        for (int attempt = 0; attempt < 100; ++attempt) {
+            const bool complete = plot.update(equations, minX, maxX, options());
+            requested += plot.getRequestedTiles();
+            if (complete) {
+                return requested;
+            }
+            plot.waitIdle();
+        }
+        ADD_FAILURE() << "tiles in view never arrived";
+        return requested;
+    }
+
+    static CurveTile tile(float x) {
+        CurveTile t;
+        t.points.emplace_back(x, 0.0f);
+        return t;
+    }
+};
+
+TEST_F(CurvePlotTest, ZoomLevelGivesAFewTilesPerView) {
+    for (double width : {0.001, 0.75, 20.0, 1000.0}) {
+        const double tile = CurvePlot::tileWidth(CurvePlot::zoomLevel(width));
+        EXPECT_GE(tile * 4.0, width);
+        EXPECT_LT(tile * 2.0, width);
+    }
+}
+
+TEST_F(CurvePlotTest, PanningSamplesOnlyNewTiles) {
+    std::vector<Equation> equations = {curve("sin(x)")};
+    CurvePlot plot;
+
+    // Width 20 uses tiles 8 wide: [-16, -8) through [8, 16) cover [-10, 10].
+    EXPECT_EQ(settle(plot, equations, -10.0, 10.0), 4u);
+    ASSERT_TRUE(plot.update(equations, -10.0, 10.0, options()));
+    EXPECT_EQ(plot.getRequestedTiles(), 0u);
+
+    EXPECT_EQ(settle(plot, equations, 0.0, 20.0), 1u);
+    EXPECT_EQ(plot.getCache().size(), 5u);
+}
+
+TEST_F(CurvePlotTest, RevisionChangesOnlyWithTheCurves) {
+    std::vector<Equation> equations = {curve("sin(x)")};
+    CurvePlot plot;
+    settle(plot, equations, -10.0, 10.0);
+    const uint64_t revision = plot.getRevision();
+
+    // Moving within the same tiles draws the same curves.
+    ASSERT_TRUE(plot.update(equations, -9.0, 11.0, options()));
+    EXPECT_EQ(plot.getRevision(), revision);
+
+    equations[0].color = {0.0f, 1.0f, 0.0f};
+    ASSERT_TRUE(plot.update(equations, -9.0, 11.0, options()));
+    EXPECT_GT(plot.getRevision(), revision);
+    EXPECT_FLOAT_EQ(plot.getVertices()[1].y, 1.0f);
+}
+
+TEST_F(CurvePlotTest, ZoomingBackReusesTheEarlierLevel) {
+    std::vector<Equation> equations = {curve("x^2")};
+    CurvePlot plot;
+    settle(plot, equations, -10.0, 10.0);
+
+    // Until the tiles 4 wide over [-8, 8) arrive, the tiles 8 wide stand in for them.
+    EXPECT_FALSE(plot.update(equations, -5.0, 5.0, options()));
+    EXPECT_EQ(plot.getRequestedTiles(), 4u);
+    ASSERT_EQ(plot.getStrips().size(), 1u);
+    EXPECT_LE(plot.getVertices().front().x, -8.0f);
+    EXPECT_GE(plot.getVertices()[plot.getVertices().size() - 2].x, 8.0f);
+    plot.waitIdle();
+    EXPECT_EQ(settle(plot, equations, -5.0, 5.0), 0u);
+
+    EXPECT_EQ(settle(plot, equations, -10.0, 10.0), 0u);
+}
+
+TEST_F(CurvePlotTest, KeepsAtMostTheBudgetInFlight) {
+    std::vector<Equation> equations = {curve("sin(x)")};
+    CurvePlot plot;
+
+    EXPECT_FALSE(plot.update(equations, -10.0, 10.0, options(), 2));
+    EXPECT_EQ(plot.getRequestedTiles(), 2u);
+    plot.waitIdle();
+
+    EXPECT_FALSE(plot.update(equations, -10.0, 10.0, options(), 2));
+    EXPECT_EQ(plot.getRequestedTiles(), 2u);
+    EXPECT_FALSE(plot.getStrips().empty());
+    plot.waitIdle();
+
+    EXPECT_TRUE(plot.update(equations, -10.0, 10.0, options(), 2));
+    EXPECT_EQ(plot.getRequestedTiles(), 0u);
+    EXPECT_EQ(plot.getCache().size(), 4u);
+}
+
+TEST_F(CurvePlotTest, TilesJoinIntoOneStrip) {
+    std::vector<Equation> equations = {curve("sin(x)")};
+    CurvePlot plot;
+    settle(plot, equations, -10.0, 10.0);
+
+    ASSERT_EQ(plot.getStrips().size(), 1u);
+    const std::vector<glm::vec3>& vertices = plot.getVertices();
+    const IndexRange strip = plot.getStrips()[0];
+    ASSERT_EQ(strip.first, 0u);
+    ASSERT_EQ(strip.count * 2, vertices.size());
+    EXPECT_LE(vertices.front().x, -10.0f);
+    EXPECT_GE(vertices[vertices.size() - 2].x, 10.0f);
+    for (uint32_t i = 1; i < strip.count; ++i) {
+        EXPECT_LT(vertices[2 * (i - 1)].x, vertices[2 * i].x); // shared tile ends appear once
+        EXPECT_NEAR(vertices[2 * i].y, std::sin(vertices[2 * i].x), 1e-4f);
+    }
+}
+
+TEST_F(CurvePlotTest, UndefinedStretchesSplitStrips) {
+    std::vector<Equation> equations = {curve("sqrt(sin(x))")};
+    CurvePlot plot;
+    settle(plot, equations, -10.0, 10.0);
+
+    // sin(x) >= 0 on five separate stretches of [-16, 16).
+    const std::vector<glm::vec3>& vertices = plot.getVertices();
+    EXPECT_GE(plot.getStrips().size(), 5u);
+    for (const IndexRange& strip : plot.getStrips()) {
+        for (uint32_t i = strip.first; i < strip.first + strip.count; ++i) {
+            EXPECT_TRUE(std::isfinite(vertices[2 * i].y));
+            if (i > strip.first) {
+                EXPECT_LT(vertices[2 * (i - 1)].x, vertices[2 * i].x);
+            }
+        }
+    }
+}
+
+TEST_F(CurvePlotTest, EditsAndRemovalsDropStaleTiles) {
+    std::vector<Equation> equations = {curve("x"), curve("2 * x")};
+    CurvePlot plot;
+    settle(plot, equations, -10.0, 10.0);
+    EXPECT_EQ(plot.getCache().size(), 8u);
+
+    equations[0].expression = "x + 1";
+    EXPECT_EQ(settle(plot, equations, -10.0, 10.0), 4u);
+    EXPECT_EQ(plot.getCache().size(), 8u);
+    EXPECT_NEAR(plot.getVertices()[0].y - plot.getVertices()[0].x, 1.0f, 1e-4f);
+
+    equations.erase(equations.begin());
+    ASSERT_TRUE(plot.update(equations, -10.0, 10.0, options()));
+    EXPECT_EQ(plot.getRequestedTiles(), 0u);
+    EXPECT_EQ(plot.getCache().size(), 4u);
+}
+
+TEST_F(CurvePlotTest, SkipsHiddenSurfacesAndInvalidExpressions) {
+    std::vector<Equation> equations = {curve("x"), curve("sin("), curve("x")};
+    equations[0].isVisible = false;
+    equations.push_back(curve("x * y"));
+    equations.back().is3D = true;
+
+    CurvePlot plot;
+    settle(plot, equations, -10.0, 10.0);
+    EXPECT_EQ(plot.getCache().size(), 4u);
+    EXPECT_EQ(plot.getStrips().size(), 1u);
+}
+
+TEST_F(CurvePlotTest, CacheEvictsLeastRecentlyUsed) {
+    CurveTileCache cache(2);
+    const CurveTileCache::Key a{1, 0, 0};
+    const CurveTileCache::Key b{1, 0, 1};
+    const CurveTileCache::Key c{2, 3, -1};
+
+    cache.insert(a, tile(0.0f));
+    cache.insert(b, tile(1.0f));
+    ASSERT_NE(cache.find(a), nullptr); // a is now more recent than b
+    cache.insert(c, tile(2.0f));
+
+    EXPECT_EQ(cache.size(), 2u);
+    EXPECT_EQ(cache.find(b), nullptr);
+    ASSERT_NE(cache.find(a), nullptr);
+    EXPECT_FLOAT_EQ(cache.find(c)->points[0].x, 2.0f);
+
+    cache.erase(1);
+    EXPECT_EQ(cache.size(), 1u);
+    EXPECT_EQ(cache.find(a), nullptr);
+}
+
+TEST_F(CurvePlotTest, ViewZoomsAboutTheAnchor) {
+    PlotView view;
+    const int width = 800;
+    const int height = 600;
+    auto worldX = [&](double x) { return view.getMinX(width) + x * view.getUnitsPerPixel(); };
+    auto worldY = [&](double y) { return view.getMaxY(height) - y * view.getUnitsPerPixel(); };
+
+    const double beforeX = worldX(200.0);
+    const double beforeY = worldY(450.0);
+    view.zoomAt(0.5, 200.0, 450.0, width, height);
+    EXPECT_DOUBLE_EQ(view.getUnitsPerPixel(), PlotView::DEFAULT_UNITS_PER_PIXEL * 0.5);
+    EXPECT_NEAR(worldX(200.0), beforeX, 1e-12);
+    EXPECT_NEAR(worldY(450.0), beforeY, 1e-12);
+
+    // Dragging right and down moves the content with the cursor.
+    const double centerX = view.getCenterX();
+    const double centerY = view.getCenterY();
+    view.pan(100.0, 50.0);
+    EXPECT_NEAR(view.getCenterX(), centerX - 100.0 * view.getUnitsPerPixel(), 1e-12);
+    EXPECT_NEAR(view.getCenterY(), centerY + 50.0 * view.getUnitsPerPixel(), 1e-12);
+
+    view.reset();
+    EXPECT_DOUBLE_EQ(view.getCenterX(), 0.0);
+    EXPECT_DOUBLE_EQ(view.getUnitsPerPixel(), PlotView::DEFAULT_UNITS_PER_PIXEL);
+}
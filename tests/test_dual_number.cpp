@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+#include "dual_number.h"
+#include "equation_parser.h"
+#include "expression_optimizer.h"
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace graphgl;
+
+class DualNumberTest : public ::testing::Test {
+protected:
+    static ExpressionProgram compile(const std::string& source) {
+        ExpressionProgram program;
+        EXPECT_TRUE(ExpressionProgram::parse(source, true, program)) << source;
+        return optimizeExpression(program);
+    }
+
+    static DualNumber gradient(const std::string& source, float x, float y) {
+        const ExpressionProgram program = compile(source);
+        std::vector<DualNumber> registers(program.size());
+        return evaluateDual(program, x, y, registers.data());
+    }
+
+    /// Values must match the interpreter exactly and derivatives must match central
+    /// differences wherever the function is smooth around the sample.
+    static void expectMatchesDifferences(const std::string& source) {
+        const ExpressionProgram program = compile(source);
+        std::vector<DualNumber> registers(program.size());
+        std::vector<float> floatRegisters(program.size());
+        std::mt19937 rng(11);
+        std::uniform_real_distribution<float> coordinate(-4.0f, 4.0f);
+
+        auto f = [&](double x, double y) {
+            return static_cast<double>(program.evaluate(static_cast<float>(x), static_cast<float>(y),
+                                                        floatRegisters.data()));
+        };
+
+        int checked = 0;
+        for (int i = 0; i < 200; ++i) {
+            const float x = coordinate(rng);
+            const float y = coordinate(rng);
+            const DualNumber d = evaluateDual(program, x, y, registers.data());
+            const float value = program.evaluate(x, y, floatRegisters.data());
+            if (std::isnan(value)) {
+                EXPECT_TRUE(std::isnan(d.value)) << source;
+                continue;
+            }
+            EXPECT_EQ(d.value, value) << source << " at " << x << ", " << y;
+
+            // Skip samples near kinks and jumps, where one-sided slopes disagree.
+            const double h = 1e-2;
+            const double dxLeft = (f(x, y) - f(x - h, y)) / h;
+            const double dxRight = (f(x + h, y) - f(x, y)) / h;
+            const double dyLeft = (f(x, y) - f(x, y - h)) / h;
+            const double dyRight = (f(x, y + h) - f(x, y)) / h;
+            const double dx = (dxLeft + dxRight) * 0.5;
+            const double dy = (dyLeft + dyRight) * 0.5;
+            const double scale = 1.0 + std::abs(dx) + std::abs(dy);
+            if (!std::isfinite(dx) || !std::isfinite(dy) ||
+                std::abs(dxLeft - dxRight) > 0.05 * scale || std::abs(dyLeft - dyRight) > 0.05 * scale) {
+                continue;
+            }
+            EXPECT_NEAR(d.dx, dx, 0.02 * scale) << source << " d/dx at " << x << ", " << y;
+            EXPECT_NEAR(d.dy, dy, 0.02 * scale) << source << " d/dy at " << x << ", " << y;
+            ++checked;
+        }
+        EXPECT_GT(checked, 20) << source;
+    }
+};
+
+TEST_F(DualNumberTest, AnalyticDerivatives) {
+    const DualNumber product = gradient("x^2 * y", 3.0f, 2.0f);
+    EXPECT_FLOAT_EQ(product.value, 18.0f);
+    EXPECT_FLOAT_EQ(product.dx, 12.0f);
+    EXPECT_FLOAT_EQ(product.dy, 9.0f);
+
+    const DualNumber waves = gradient("sin(x) * cos(y)", 0.5f, 1.0f);
+    EXPECT_NEAR(waves.dx, std::cos(0.5f) * std::cos(1.0f), 1e-6f);
+    EXPECT_NEAR(waves.dy, -std::sin(0.5f) * std::sin(1.0f), 1e-6f);
+
+    const DualNumber quotient = gradient("exp(x) / y", 0.0f, 2.0f);
+    EXPECT_NEAR(quotient.dx, 0.5f, 1e-6f);
+    EXPECT_NEAR(quotient.dy, -0.25f, 1e-6f);
+
+    // Variable exponents differentiate through the log term.
+    const DualNumber power = gradient("x^y", 2.0f, 3.0f);
+    EXPECT_NEAR(power.dx, 12.0f, 1e-5f);
+    EXPECT_NEAR(power.dy, 8.0f * std::log(2.0f), 1e-5f);
+
+    const DualNumber steps = gradient("floor(x) + sgn(y)", 1.5f, -2.0f);
+    EXPECT_EQ(steps.dx, 0.0f);
+    EXPECT_EQ(steps.dy, 0.0f);
+}
+
+TEST_F(DualNumberTest, MatchesFiniteDifferences) {
+    for (const char* source : {
+             "sin(x) * cos(y)", "sqrt(x^2 + y^2)", "x^3 - 3*x*y^2", "exp(-(x^2 + y^2) / 4)",
+             "log(abs(x) + 1) * y", "tan(x / 4) + atan(y)", "hypot(x, y) + atan2(y, x)",
+             "min(x, y) * max(x, y)", "sinh(x / 2) - cosh(y / 2) + tanh(x * y)", "x / (y^2 + 1)",
+             "asin(x / 5) + acos(y / 5)", "log10(x^2 + 1) + log2(y^2 + 1)", "x % 3 + abs(y)",
+             "(x^2 + 1)^(y / 4)", "sqrt(25 - x^2 - y^2)"}) {
+        expectMatchesDifferences(source);
+    }
+}
+
+TEST_F(DualNumberTest, ContextGradientAndFallback) {
+    EquationParser parser;
+    ASSERT_TRUE(parser.parseExpression("x^2 + 3*y", true));
+    EXPECT_TRUE(parser.hasGradient());
+    const DualNumber surface = parser.evaluateGradient(2.0f, 1.0f);
+    EXPECT_FLOAT_EQ(surface.value, 7.0f);
+    EXPECT_FLOAT_EQ(surface.dx, 4.0f);
+    EXPECT_FLOAT_EQ(surface.dy, 3.0f);
+
+    // 2D expressions ignore y.
+    ASSERT_TRUE(parser.parseExpression("x * y + x", false));
+    const DualNumber curve = parser.evaluateGradient(2.0f, 5.0f);
+    EXPECT_FLOAT_EQ(curve.value, 2.0f);
+    EXPECT_FLOAT_EQ(curve.dx, 1.0f);
+    EXPECT_EQ(curve.dy, 0.0f);
+
+    // ExprTk-only expressions use central differences.
+    ASSERT_TRUE(parser.parseExpression("x^1^1 * y", true));
+    EXPECT_FALSE(parser.hasGradient());
+    const DualNumber fallback = parser.evaluateGradient(2.0f, 3.0f);
+    EXPECT_NEAR(fallback.value, 6.0f, 1e-5f);
+    EXPECT_NEAR(fallback.dx, 3.0f, 1e-2f);
+    EXPECT_NEAR(fallback.dy, 2.0f, 1e-2f);
+
+    EquationParser invalid;
+    EXPECT_FALSE(invalid.hasGradient());
+    EXPECT_TRUE(std::isnan(invalid.evaluateGradient(0.0f).value));
+}
@@ -1,7 +1,9 @@
 #include <gtest/gtest.h>
 #include "equation_generator.h"
 #include "equation_parser.h"
+#include <algorithm>
 #include <cmath>
+#include <memory>
 
 using namespace graphgl;
 
@@ -72,8 +74,34 @@ TEST_F(EquationGeneratorTest, MeshGeneratesIndices) {
     gen.generateVertices(eq, parser);
 
     EXPECT_GT(eq.indices.size(), 0u);
-    // Triangle indices come in multiples of 6 (two triangles per quad).
-    EXPECT_EQ(eq.indices.size() % 6, 0u);
+    // Triangle indices come in multiples of 3.
+    EXPECT_EQ(eq.indices.size() % 3, 0u);
+}
+
+TEST_F(EquationGeneratorTest, MeshSkipsUndefinedSamples) {
+    Equation eq;
+    eq.expression = "sqrt(4 - x^2 - y^2)";
+    eq.is3D = true;
+    eq.isMesh = true;
+    eq.minX = -3.0f;
+    eq.maxX = 3.0f;
+    eq.minY = -3.0f;
+    eq.maxY = 3.0f;
+
+    ASSERT_TRUE(parser.parseExpression(eq.expression, eq.is3D));
+    gen.generateVertices(eq, parser);
+
+    // Only the hemisphere is meshed; every index refers to an emitted vertex.
+    ASSERT_GT(eq.indices.size(), 0u);
+    const size_t vertexCount = eq.vertices.size() / 2;
+    for (size_t i = 0; i < eq.indices.size(); ++i) {
+        ASSERT_LT(eq.indices[i], vertexCount);
+        const glm::vec3& v = eq.vertices[eq.indices[i] * 2];
+        EXPECT_TRUE(std::isfinite(v.y));
+        EXPECT_LE(v.x * v.x + v.z * v.z, 4.0f + 1e-3f);
+    }
+    EXPECT_TRUE(eq.indices.getWide().empty());
+    EXPECT_EQ(eq.indices.getCompact().size(), eq.indices.size());
 }
 
 TEST_F(EquationGeneratorTest, NonMeshHasNoIndices) {
@@ -91,3 +119,584 @@ TEST_F(EquationGeneratorTest, NonMeshHasNoIndices) {
 
     EXPECT_EQ(eq.indices.size(), 0u);
 }
+
+TEST_F(EquationGeneratorTest, MeshChunksPartitionTheIndicesWithinBounds) {
+    Equation eq;
+    eq.expression = "sin(x) * cos(y)";
+    eq.is3D = true;
+    eq.isMesh = true;
+
+    ASSERT_TRUE(parser.parseExpression(eq.expression, eq.is3D));
+    gen.generateVertices(eq, parser, 7); // 800 cells of 1/16 per side: 13 x 13 blocks
+    auto inside = [](const glm::vec3& v, const glm::vec3& lo, const glm::vec3& hi) {
+        return v.x >= lo.x && v.y >= lo.y && v.z >= lo.z && v.x <= hi.x && v.y <= hi.y && v.z <= hi.z;
+    };
+
+    ASSERT_GT(eq.meshChunks.size(), 16u);
+    EXPECT_LE(eq.meshChunks.size(), 169u);
+    uint32_t next = 0;
+    for (const MeshChunk& chunk : eq.meshChunks) {
+        EXPECT_EQ(chunk.indices.first, next);
+        EXPECT_EQ(chunk.indices.count % 3, 0u);
+        next += chunk.indices.count;
+        for (uint32_t i = chunk.indices.first; i < chunk.indices.first + chunk.indices.count; ++i) {
+            const glm::vec3& v = eq.vertices[eq.indices[i] * 2];
+            EXPECT_TRUE(inside(v, chunk.boundsMin, chunk.boundsMax));
+        }
+        // Blocks of a 50-wide domain are 4 wide, give or take a triangle.
+        EXPECT_LT(chunk.boundsMax.x - chunk.boundsMin.x, 6.0f);
+    }
+    EXPECT_EQ(next, eq.indices.size());
+
+    for (size_t i = 0; i < eq.vertices.size(); i += 2) {
+        EXPECT_TRUE(inside(eq.vertices[i], eq.boundsMin, eq.boundsMax));
+    }
+    EXPECT_FLOAT_EQ(eq.boundsMin.x, -25.0f);
+    EXPECT_FLOAT_EQ(eq.boundsMax.z, 25.0f);
+}
+
+TEST_F(EquationGeneratorTest, CurveStripsBreakAtUndefinedSamples) {
+    Equation eq;
+    eq.expression = "sqrt(sin(x))";
+    eq.is3D = false;
+    eq.minX = -10.0f;
+    eq.maxX = 10.0f;
+
+    ASSERT_TRUE(parser.parseExpression(eq.expression, eq.is3D));
+    gen.generateVertices(eq, parser);
+
+    // sin(x) >= 0 on four separate stretches of [-10, 10]; strips cover the vertices in order.
+    ASSERT_EQ(eq.strips.size(), 4u);
+    uint32_t next = 0;
+    for (const IndexRange& strip : eq.strips) {
+        EXPECT_EQ(strip.first, next);
+        next += strip.count;
+        for (uint32_t i = strip.first + 1; i < strip.first + strip.count; ++i) {
+            EXPECT_LT(eq.vertices[2 * (i - 1)].x, eq.vertices[2 * i].x);
+        }
+    }
+    EXPECT_EQ(next * 2, eq.vertices.size());
+    // Consecutive strips are separated by a stretch where sin(x) < 0.
+    for (size_t s = 1; s < eq.strips.size(); ++s) {
+        const float gapStart = eq.vertices[2 * (eq.strips[s].first - 1)].x;
+        const float gapEnd = eq.vertices[2 * eq.strips[s].first].x;
+        EXPECT_LT(std::sin(0.5f * (gapStart + gapEnd)), 0.0f);
+    }
+}
+
+TEST_F(EquationGeneratorTest, NonMeshSurfaceStripsFollowRows) {
+    Equation eq;
+    eq.expression = "sqrt(4 - x^2 - y^2)";
+    eq.is3D = true;
+    eq.isMesh = false;
+    eq.minX = -3.0f;
+    eq.maxX = 3.0f;
+    eq.minY = -3.0f;
+    eq.maxY = 3.0f;
+
+    ASSERT_TRUE(parser.parseExpression(eq.expression, eq.is3D));
+    gen.generateVertices(eq, parser);
+
+    // Each strip runs along x within one row of the disc; together they hold every vertex.
+    ASSERT_GT(eq.strips.size(), 1u);
+    uint32_t next = 0;
+    for (const IndexRange& strip : eq.strips) {
+        EXPECT_EQ(strip.first, next);
+        next += strip.count;
+        for (uint32_t i = strip.first + 1; i < strip.first + strip.count; ++i) {
+            const glm::vec3& previous = eq.vertices[2 * (i - 1)];
+            const glm::vec3& v = eq.vertices[2 * i];
+            EXPECT_EQ(v.z, previous.z);
+            EXPECT_LT(previous.x, v.x);
+            EXPECT_LE(v.x * v.x + v.z * v.z, 4.0f + 1e-3f);
+        }
+    }
+    EXPECT_EQ(next * 2, eq.vertices.size());
+}
+
+TEST_F(EquationGeneratorTest, SymmetricSurfacesMatchDirectEvaluation) {
+    struct Case { const char* expression; float extent; };
+    for (const Case& c : {Case{"sin(sqrt(x^2 + y^2))", 100.0f}, Case{"sqrt(25 - x^2 - y^2)", 10.0f},
+                          Case{"sin(x + 2*y)", 100.0f}}) {
+        Equation eq;
+        eq.expression = c.expression;
+        eq.is3D = true;
+        eq.minX = -c.extent;
+        eq.maxX = c.extent;
+        eq.minY = -c.extent;
+        eq.maxY = c.extent;
+        ASSERT_TRUE(parser.parseExpression(eq.expression, eq.is3D));
+
+        // Both sides keep the full lattice so their vertices line up.
+        Equation direct = eq;
+        gen.setSurfaceTolerance(0.0f);
+        gen.generateVertices(eq, parser);
+        EquationGenerator exact;
+        exact.setApproximationTolerance(0.0f);
+        exact.setSurfaceTolerance(0.0f);
+        exact.generateVertices(direct, parser);
+
+        ASSERT_EQ(eq.vertices.size(), direct.vertices.size()) << c.expression;
+        for (size_t i = 0; i < eq.vertices.size(); i += 2) {
+            EXPECT_EQ(eq.vertices[i].x, direct.vertices[i].x) << c.expression;
+            EXPECT_NEAR(eq.vertices[i].y, direct.vertices[i].y, 2e-3f) << c.expression;
+        }
+    }
+}
+
+TEST_F(EquationGeneratorTest, PrunedSurfacesMatchDirectEvaluation) {
+    struct Case { const char* expression; float extent; float tolerance; };
+    for (const Case& c : {Case{"sqrt(25 - x^2 - 2*y^2)", 25.0f, 1e-5f},
+                          Case{"exp(-(x^2 + 3*y^2))", 100.0f, 2e-4f}}) {
+        Equation eq;
+        eq.expression = c.expression;
+        eq.is3D = true;
+        eq.minX = -c.extent;
+        eq.maxX = c.extent;
+        eq.minY = -c.extent;
+        eq.maxY = c.extent;
+        ASSERT_TRUE(parser.parseExpression(eq.expression, eq.is3D));
+        gen.setSurfaceTolerance(0.0f);
+        gen.generateVertices(eq, parser);
+        ASSERT_FALSE(eq.vertices.empty()) << c.expression;
+
+        std::vector<float> xs;
+        std::vector<float> ys;
+        for (size_t i = 0; i < eq.vertices.size(); i += 2) {
+            const glm::vec3& v = eq.vertices[i];
+            EXPECT_NEAR(v.y, parser.evaluate(v.x, v.z), c.tolerance) << c.expression;
+            xs.push_back(v.x);
+            ys.push_back(v.z);
+        }
+
+        // Every defined sample of the grid has a vertex.
+        std::sort(xs.begin(), xs.end());
+        xs.erase(std::unique(xs.begin(), xs.end()), xs.end());
+        std::sort(ys.begin(), ys.end());
+        ys.erase(std::unique(ys.begin(), ys.end()), ys.end());
+        size_t defined = 0;
+        for (float y : ys) {
+            for (float x : xs) {
+                defined += std::isnan(parser.evaluate(x, y)) ? 0 : 1;
+            }
+        }
+        EXPECT_EQ(defined, eq.vertices.size() / 2) << c.expression;
+    }
+}
+
+TEST_F(EquationGeneratorTest, IntervalBoundsRefineCurves) {
+    // The domain edges of the circle are resolved down to the finest subdivision.
+    Equation circle;
+    circle.expression = "sqrt(25 - x^2)";
+    circle.is3D = false;
+    circle.minX = -10.0f;
+    circle.maxX = 10.0f;
+    ASSERT_TRUE(parser.parseExpression(circle.expression, circle.is3D));
+    gen.generateVertices(circle, parser);
+    float leftmost = circle.maxX;
+    for (size_t i = 0; i < circle.vertices.size(); i += 2) {
+        leftmost = std::min(leftmost, circle.vertices[i].x);
+    }
+    EXPECT_LT(leftmost, -4.99f);
+
+    // A spike between the base samples is found.
+    Equation spike;
+    spike.expression = "exp(-(100*x)^2)";
+    spike.is3D = false;
+    spike.minX = -10.0f;
+    spike.maxX = 10.0f;
+    ASSERT_TRUE(parser.parseExpression(spike.expression, spike.is3D));
+    gen.generateVertices(spike, parser);
+    EXPECT_GT(gen.getMaxHeight(), 0.9f);
+}
+
+TEST_F(EquationGeneratorTest, AdaptiveSurfaceStaysWithinTolerance) {
+    Equation eq;
+    eq.expression = "exp(-(x^2 + y^2))";
+    eq.is3D = true;
+    eq.isMesh = true;
+    eq.minX = -8.0f; // fills the power-of-two lattice exactly
+    eq.maxX = 8.0f;
+    eq.minY = -8.0f;
+    eq.maxY = 8.0f;
+    ASSERT_TRUE(parser.parseExpression(eq.expression, eq.is3D));
+
+    Equation full = eq;
+    EquationGenerator lattice;
+    lattice.setSurfaceTolerance(0.0f);
+    lattice.generateVertices(full, parser, 4);
+    gen.generateVertices(eq, parser, 4);
+
+    // The flat surroundings collapse to a few large triangles.
+    EXPECT_LT(eq.vertices.size() * 10, full.vertices.size());
+    EXPECT_NEAR(gen.getMaxHeight(), 1.0f, 1e-6f);
+
+    // Every lattice sample lies within the tolerance of the triangle covering it.
+    const float tolerance = gen.getSurfaceTolerance() * (gen.getMaxHeight() - gen.getMinHeight());
+    size_t covered = 0;
+    for (size_t s = 0; s < full.vertices.size(); s += 2) {
+        const glm::vec3& p = full.vertices[s];
+        for (size_t t = 0; t < eq.indices.size(); t += 3) {
+            const glm::vec3& a = eq.vertices[eq.indices[t] * 2];
+            const glm::vec3& b = eq.vertices[eq.indices[t + 1] * 2];
+            const glm::vec3& c = eq.vertices[eq.indices[t + 2] * 2];
+            const float det = (b.x - a.x) * (c.z - a.z) - (c.x - a.x) * (b.z - a.z);
+            const float u = ((p.x - a.x) * (c.z - a.z) - (c.x - a.x) * (p.z - a.z)) / det;
+            const float v = ((b.x - a.x) * (p.z - a.z) - (p.x - a.x) * (b.z - a.z)) / det;
+            if (u >= -1e-5f && v >= -1e-5f && u + v <= 1.0f + 1e-5f) {
+                EXPECT_NEAR(a.y + u * (b.y - a.y) + v * (c.y - a.y), p.y, tolerance + 1e-6f);
+                ++covered;
+                break;
+            }
+        }
+    }
+    EXPECT_EQ(covered, full.vertices.size() / 2);
+}
+
+TEST_F(EquationGeneratorTest, CurveSamplesAreOrderedAndReused) {
+    Equation eq;
+    eq.expression = "sin(5*x) / x";
+    eq.is3D = false;
+    eq.minX = -10.0f;
+    eq.maxX = 10.0f;
+    ASSERT_TRUE(parser.parseExpression(eq.expression, eq.is3D));
+    gen.generateVertices(eq, parser);
+    ASSERT_GT(eq.vertices.size(), 2u);
+
+    // Samples come out in increasing x, end exactly at the domain bounds and carry the
+    // values computed while subdividing.
+    EXPECT_EQ(eq.vertices.front().x, eq.minX);
+    EXPECT_EQ(eq.vertices[eq.vertices.size() - 2].x, eq.maxX);
+    for (size_t i = 0; i < eq.vertices.size(); i += 2) {
+        if (i > 0) {
+            EXPECT_LT(eq.vertices[i - 2].x, eq.vertices[i].x);
+        }
+        EXPECT_EQ(eq.vertices[i].y, parser.evaluate(eq.vertices[i].x));
+    }
+
+    // Reusing the generator's buffers gives the same curve.
+    Equation again = eq;
+    gen.generateVertices(again, parser);
+    ASSERT_EQ(again.vertices.size(), eq.vertices.size());
+    for (size_t i = 0; i < eq.vertices.size(); ++i) {
+        EXPECT_EQ(again.vertices[i], eq.vertices[i]);
+    }
+}
+
+TEST_F(EquationGeneratorTest, FallbackCurvesEvaluateEachSampleOnce) {
+    // x^1^1 is left to ExprTk, which has no gradients.
+    Equation eq;
+    eq.expression = "sin(3 * x^1^1)";
+    eq.is3D = false;
+    ASSERT_TRUE(parser.parseExpression(eq.expression, eq.is3D));
+    ASSERT_FALSE(parser.hasGradient());
+
+    for (bool useBudget : {false, true}) {
+        gen.setUseSampleBudget(useBudget);
+        eq.sampleSize = 300;
+        const size_t before = parser.getFallbackEvaluations();
+        gen.generateVertices(eq, parser, 6, 1.0);
+        const size_t samples = eq.vertices.size() / 2;
+        EXPECT_GT(samples, 100u); // slopes from neighbouring samples still refine the curve
+        EXPECT_EQ(parser.getFallbackEvaluations() - before, samples);
+        for (size_t i = 0; i < eq.vertices.size(); i += 2) {
+            EXPECT_NEAR(eq.vertices[i].y, std::sin(3.0f * eq.vertices[i].x), 1e-5f);
+        }
+    }
+}
+
+TEST_F(EquationGeneratorTest, SampleBudgetBoundsVertexCount) {
+    gen.setUseSampleBudget(true);
+
+    // A wavy curve spends the whole budget; a line needs only the base samples.
+    Equation wave;
+    wave.expression = "sin(x) * x";
+    wave.is3D = false;
+    wave.sampleSize = 500;
+    ASSERT_TRUE(parser.parseExpression(wave.expression, wave.is3D));
+    gen.generateVertices(wave, parser);
+    EXPECT_EQ(wave.vertices.size() / 2, 500u);
+    for (size_t i = 2; i < wave.vertices.size(); i += 2) {
+        EXPECT_LT(wave.vertices[i - 2].x, wave.vertices[i].x);
+    }
+
+    Equation line = wave;
+    line.expression = "2*x + 1";
+    ASSERT_TRUE(parser.parseExpression(line.expression, line.is3D));
+    gen.generateVertices(line, parser);
+    EXPECT_EQ(line.vertices.size() / 2, 100u);
+
+    // Surfaces stay within the budget and get more accurate as it grows.
+    float previousError = std::numeric_limits<float>::max();
+    for (int budget : {50, 400, 3000}) {
+        Equation surface;
+        surface.expression = "sin(x / 4) * cos(y / 6)";
+        surface.is3D = true;
+        surface.isMesh = true;
+        surface.sampleSize = budget;
+        ASSERT_TRUE(parser.parseExpression(surface.expression, surface.is3D));
+        gen.generateVertices(surface, parser, 4);
+        const size_t vertices = surface.vertices.size() / 2;
+        EXPECT_LE(vertices, size_t(budget));
+        EXPECT_GT(vertices, size_t(budget) / 2);
+
+        // Error at the centroids of the triangles against the function.
+        float error = 0.0f;
+        for (size_t t = 0; t < surface.indices.size(); t += 3) {
+            const glm::vec3 c = (surface.vertices[surface.indices[t] * 2] +
+                                 surface.vertices[surface.indices[t + 1] * 2] +
+                                 surface.vertices[surface.indices[t + 2] * 2]) / 3.0f;
+            error = std::max(error, std::abs(c.y - parser.evaluate(c.x, c.z)));
+        }
+        EXPECT_LT(error, previousError);
+        previousError = error;
+    }
+}
+
+TEST_F(EquationGeneratorTest, SampleBudgetCoarsensDomainEdges) {
+    gen.setUseSampleBudget(true);
+
+    // The rim of the hemisphere alone needs far more than the budget at the finest level.
+    for (int budget : {40, 120}) {
+        Equation surface;
+        surface.expression = "sqrt(100 - x*x - y*y)";
+        surface.is3D = true;
+        surface.isMesh = true;
+        surface.sampleSize = budget;
+        ASSERT_TRUE(parser.parseExpression(surface.expression, surface.is3D));
+        gen.generateVertices(surface, parser, 6);
+        const size_t vertices = surface.vertices.size() / 2;
+        EXPECT_LE(vertices, size_t(budget));
+        EXPECT_GT(vertices, size_t(budget) / 4);
+        EXPECT_FALSE(surface.indices.empty());
+    }
+}
+
+TEST_F(EquationGeneratorTest, TurningAngleRefinementFollowsCurveShape) {
+    auto sampleCount = [&](const char* expression, CurveRefinement refinement) {
+        Equation eq;
+        eq.expression = expression;
+        eq.is3D = false;
+        eq.minX = -10.0f;
+        eq.maxX = 10.0f;
+        EXPECT_TRUE(parser.parseExpression(eq.expression, eq.is3D));
+        gen.setCurveRefinement(refinement);
+        gen.generateVertices(eq, parser);
+
+        // Largest gap between the drawn polyline and the function, at segment midpoints.
+        float error = 0.0f;
+        for (size_t i = 2; i < eq.vertices.size(); i += 2) {
+            const glm::vec3 mid = (eq.vertices[i - 2] + eq.vertices[i]) * 0.5f;
+            error = std::max(error, std::abs(mid.y - parser.evaluate(mid.x)));
+        }
+        return std::make_pair(eq.vertices.size() / 2, error);
+    };
+
+    // A steep line needs no more than the base samples.
+    EXPECT_GT(sampleCount("100*x", CurveRefinement::Slope).first, 1000u);
+    EXPECT_EQ(sampleCount("100*x", CurveRefinement::TurningAngle).first, 100u);
+
+    // A gently sloped, fast wiggle is resolved instead of aliased.
+    const auto slope = sampleCount("0.05 * sin(50*x)", CurveRefinement::Slope);
+    const auto angle = sampleCount("0.05 * sin(50*x)", CurveRefinement::TurningAngle);
+    EXPECT_GT(angle.first, slope.first);
+    EXPECT_LT(angle.second, 0.005f);
+    EXPECT_GT(slope.second, 0.02f);
+}
+
+TEST_F(EquationGeneratorTest, ProgressiveLevelsEndAtFullResolution) {
+    for (bool is3D : {true, false}) {
+        Equation eq;
+        eq.expression = is3D ? "sin(x) * cos(y) + exp(-(x^2 + y^2))" : "sin(3*x) * x";
+        eq.is3D = is3D;
+        eq.isMesh = is3D;
+        eq.minX = eq.minY = -4.0f;
+        eq.maxX = eq.maxY = 4.0f;
+        ASSERT_TRUE(parser.parseExpression(eq.expression, eq.is3D));
+
+        std::vector<size_t> vertexCounts;
+        int finals = 0;
+        gen.generateProgressive(eq, parser, 6, 5.0, [&](const Equation& level, bool isFinal) {
+            vertexCounts.push_back(level.vertices.size());
+            finals += isFinal ? 1 : 0;
+        });
+        ASSERT_GE(vertexCounts.size(), 2u);
+        EXPECT_EQ(finals, 1);
+        for (size_t i = 1; i < vertexCounts.size(); ++i) {
+            EXPECT_LT(vertexCounts[i - 1], vertexCounts[i]);
+        }
+
+        // The last level is exactly what a direct call produces.
+        Equation direct = eq;
+        gen.generateVertices(direct, parser, 6, 5.0);
+        EXPECT_EQ(direct.vertices, eq.vertices);
+        EXPECT_EQ(direct.indices, eq.indices);
+    }
+}
+
+TEST_F(EquationGeneratorTest, RegenerationEvaluatesOnlyNewSamples) {
+    Equation eq;
+    eq.expression = "sin(x) * cos(y) + x * y / 50";
+    eq.is3D = true;
+    eq.isMesh = true;
+    eq.minX = -25.0f;
+    eq.maxX = 25.0f;
+    eq.minY = -25.0f;
+    eq.maxY = 25.0f;
+    ASSERT_TRUE(parser.parseExpression(eq.expression, eq.is3D));
+
+    // Approximate fills depend on the grid, so compare exact evaluations.
+    auto cache = std::make_shared<SurfaceSampleCache>();
+    gen.setSampleCache(cache);
+    gen.setApproximationTolerance(0.0f);
+    EquationGenerator cold;
+    cold.setApproximationTolerance(0.0f);
+    auto expectMatchesCold = [&](int maxDepth) {
+        Equation expected = eq;
+        cold.setSurfaceTolerance(gen.getSurfaceTolerance());
+        cold.generateVertices(expected, parser, maxDepth);
+        EXPECT_EQ(eq.vertices, expected.vertices);
+        EXPECT_EQ(eq.indices, expected.indices);
+    };
+
+    gen.generateVertices(eq, parser, 6);
+    const size_t fullCount = cache->evaluatedSamples;
+    EXPECT_EQ(fullCount, cache->xs.size() * cache->ys.size());
+
+    // Mesh-only changes evaluate nothing.
+    gen.setSurfaceTolerance(0.01f);
+    gen.generateVertices(eq, parser, 6);
+    EXPECT_EQ(cache->evaluatedSamples, 0u);
+    expectMatchesCold(6);
+
+    // Extending or shrinking the domain evaluates the new strips and edges only.
+    eq.minX = -26.0f;
+    gen.generateVertices(eq, parser, 6);
+    EXPECT_LT(cache->evaluatedSamples * 10, fullCount);
+    expectMatchesCold(6);
+
+    eq.maxY = 20.0f;
+    gen.generateVertices(eq, parser, 6);
+    EXPECT_LT(cache->evaluatedSamples * 10, fullCount);
+    expectMatchesCold(6);
+
+    // A finer lattice reuses every sample of the coarser one.
+    gen.generateVertices(eq, parser, 7);
+    EXPECT_LE(cache->evaluatedSamples, cache->xs.size() * cache->ys.size() * 3 / 4 + cache->xs.size() + cache->ys.size());
+    expectMatchesCold(7);
+
+    // A different expression starts over.
+    eq.expression = "x + y";
+    ASSERT_TRUE(parser.parseExpression(eq.expression, eq.is3D));
+    gen.generateVertices(eq, parser, 7);
+    EXPECT_EQ(cache->evaluatedSamples, cache->xs.size() * cache->ys.size());
+}
+
+TEST_F(EquationGeneratorTest, SurfaceLatticeKeepsRequestedSamplesInDomain) {
+    auto cache = std::make_shared<SurfaceSampleCache>();
+    gen.setSampleCache(cache);
+    Equation eq;
+    eq.expression = "sin(x) * cos(y)";
+    eq.is3D = true;
+    eq.isMesh = true;
+    ASSERT_TRUE(parser.parseExpression(eq.expression, eq.is3D));
+
+    // ±8 fills a power-of-two lattice exactly; the others leave up to half of it unused.
+    for (float half : {8.0f, 8.5f, 25.0f}) {
+        for (int maxDepth : {2, 6}) {
+            eq.minX = eq.minY = -half;
+            eq.maxX = half;
+            eq.maxY = half * 0.6f;
+            gen.generateVertices(eq, parser, maxDepth);
+            const size_t wanted = (size_t(1) << (maxDepth + 2)) + 1;
+            EXPECT_GE(cache->xs.size(), wanted) << half << " " << maxDepth;
+            EXPECT_GE(cache->ys.size(), wanted) << half << " " << maxDepth;
+            EXPECT_LE(cache->xs.size(), 2 * wanted + 1) << half << " " << maxDepth;
+            EXPECT_EQ(cache->xs.front(), eq.minX);
+            EXPECT_EQ(cache->xs.back(), eq.maxX);
+            EXPECT_EQ(cache->ys.back(), eq.maxY);
+            if (half == 8.0f) {
+                EXPECT_EQ(cache->xs.size(), wanted);
+            }
+        }
+    }
+}
+
+TEST_F(EquationGeneratorTest, ChunkedSurfaceLevelsCoverTheDomain) {
+    Equation eq;
+    eq.expression = "sin(x) * cos(y) + 0.1 * x";
+    eq.is3D = true;
+    eq.isMesh = true;
+    ASSERT_TRUE(parser.parseExpression(eq.expression, eq.is3D));
+    gen.setChunkedLod(true);
+
+    // ±8 fills the lattice; ±10 leaves the last chunks partly past the domain.
+    for (float half : {8.0f, 10.0f}) {
+        eq.minX = eq.minY = -half;
+        eq.maxX = eq.maxY = half;
+        gen.generateVertices(eq, parser, 4);
+        const SurfaceLod& lod = eq.lod;
+        EXPECT_TRUE(eq.indices.empty());
+        ASSERT_FALSE(lod.empty());
+        ASSERT_EQ(lod.chunks.size(), size_t(lod.columns) * lod.rows);
+        EXPECT_GT(lod.columns, 1u);
+
+        // Chunk borders lie where neighbouring chunk bounds meet.
+        std::vector<float> borderX;
+        std::vector<float> borderZ;
+        for (uint32_t col = 1; col < lod.columns; ++col) {
+            borderX.push_back(lod.chunks[col].boundsMin.x);
+            EXPECT_EQ(lod.chunks[col].boundsMin.x, lod.chunks[col - 1].boundsMax.x);
+        }
+        for (uint32_t row = 1; row < lod.rows; ++row) {
+            borderZ.push_back(lod.chunks[row * lod.columns].boundsMin.z);
+        }
+        auto onBorder = [](const std::vector<float>& borders, float v) {
+            return std::find(borders.begin(), borders.end(), v) != borders.end();
+        };
+
+        for (uint32_t level = 0; level < lod.levels; ++level) {
+            double area = 0.0;
+            for (const SurfaceChunk& chunk : lod.chunks) {
+                ASSERT_EQ(chunk.errors.size(), lod.levels);
+                if (level > 0) {
+                    EXPECT_GE(chunk.errors[level], chunk.errors[level - 1]);
+                    EXPECT_LE(chunk.triangles[level].count, chunk.triangles[level - 1].count);
+                }
+                const IndexRange& triangles = chunk.triangles[level];
+                for (uint32_t t = triangles.first; t < triangles.first + triangles.count; t += 3) {
+                    const glm::vec3& a = eq.vertices[lod.indices[t] * 2];
+                    const glm::vec3& b = eq.vertices[lod.indices[t + 1] * 2];
+                    const glm::vec3& c = eq.vertices[lod.indices[t + 2] * 2];
+                    area += std::abs((b.x - a.x) * (c.z - a.z) - (c.x - a.x) * (b.z - a.z)) * 0.5;
+                }
+
+                // Skirts hang from inner chunk borders only.
+                const IndexRange& skirts = chunk.skirts[level];
+                EXPECT_EQ(skirts.count % 6, 0u);
+                for (uint32_t t = skirts.first; t < skirts.first + skirts.count; t += 3) {
+                    const glm::vec3& a = eq.vertices[lod.indices[t] * 2];
+                    const glm::vec3& b = eq.vertices[lod.indices[t + 1] * 2];
+                    EXPECT_TRUE((a.x == b.x && onBorder(borderX, a.x)) || (a.z == b.z && onBorder(borderZ, a.z)));
+                }
+            }
+            EXPECT_NEAR(area, 4.0 * half * half, 1e-3) << "level " << level;
+        }
+
+        // A camera far above picks coarser levels than one close over the surface.
+        std::vector<uint8_t> nearLevels;
+        std::vector<uint8_t> farLevels;
+        LodView view;
+        view.pixelsPerUnit = 600.0f;
+        view.eye = glm::vec3(0.0f, 2.0f, 0.0f);
+        lod.selectLevels(view, nearLevels);
+        view.eye = glm::vec3(0.0f, 200.0f, 0.0f);
+        lod.selectLevels(view, farLevels);
+        std::vector<unsigned int> nearIndices;
+        std::vector<unsigned int> farIndices;
+        lod.appendIndices(nearLevels, 0, nearIndices);
+        lod.appendIndices(farLevels, 0, farIndices);
+        EXPECT_LT(farIndices.size() * 2, nearIndices.size());
+        EXPECT_EQ(*std::min_element(nearLevels.begin(), nearLevels.end()), 0);
+    }
+}
@@ -1,6 +1,8 @@
 #include <gtest/gtest.h>
 #include "equation_parser.h"
 #include <cmath>
+#include <thread>
+#include <vector>
 
 using namespace graphgl;
 
@@ -78,3 +80,113 @@ TEST_F(EquationParserTest, RecompileOverwritesPrevious) {
     ASSERT_TRUE(parser.parseExpression("x^2"));
     EXPECT_FLOAT_EQ(parser.evaluate(5.0f), 25.0f);
 }
+
+TEST_F(EquationParserTest, BatchMatchesScalar) {
+    ASSERT_TRUE(parser.parseExpression("x^2 + 3*y", true));
+    const float xs[] = {-2.0f, 0.0f, 1.5f, 4.0f};
+    const float ys[] = {1.0f, -1.0f, 2.0f, 0.5f};
+    float out[4];
+    parser.evaluateBatch(xs, ys, out, 4);
+    for (size_t i = 0; i < 4; ++i) {
+        EXPECT_FLOAT_EQ(out[i], parser.evaluate(xs[i], ys[i]));
+    }
+}
+
+TEST_F(EquationParserTest, Batch2DIgnoresY) {
+    ASSERT_TRUE(parser.parseExpression("x + y", false));
+    const float xs[] = {1.0f, 2.0f};
+    const float ys[] = {10.0f, 20.0f};
+    float out[2];
+    parser.evaluateBatch(xs, ys, out, 2);
+    EXPECT_FLOAT_EQ(out[0], 1.0f);
+    EXPECT_FLOAT_EQ(out[1], 2.0f);
+
+    parser.evaluateBatch(xs, nullptr, out, 2);
+    EXPECT_FLOAT_EQ(out[1], 2.0f);
+}
+
+TEST_F(EquationParserTest, GridIsRowMajor) {
+    ASSERT_TRUE(parser.parseExpression("10*x + y", true));
+    const float xs[] = {0.0f, 1.0f, 2.0f};
+    const float ys[] = {0.0f, 5.0f};
+    float out[6];
+    parser.evaluateGrid(xs, 3, ys, 2, out);
+    EXPECT_FLOAT_EQ(out[0], 0.0f);
+    EXPECT_FLOAT_EQ(out[2], 20.0f);
+    EXPECT_FLOAT_EQ(out[3], 5.0f);
+    EXPECT_FLOAT_EQ(out[5], 25.0f);
+}
+
+TEST_F(EquationParserTest, BatchBeforeParseIsNaN) {
+    const float xs[] = {1.0f, 2.0f};
+    float out[2] = {0.0f, 0.0f};
+    parser.evaluateBatch(xs, nullptr, out, 2);
+    EXPECT_TRUE(std::isnan(out[0]));
+    EXPECT_TRUE(std::isnan(out[1]));
+}
+
+TEST_F(EquationParserTest, ParseReturnsCompiledExpression) {
+    auto compiled = parser.parseExpression("sin(x) * cos(y)", true);
+    ASSERT_TRUE(compiled);
+    EXPECT_EQ(compiled, parser.getCompiledExpression());
+    EXPECT_EQ(compiled->getSource(), "sin(x) * cos(y)");
+    EXPECT_TRUE(compiled->is3D());
+    EXPECT_TRUE(compiled->hasProgram());
+}
+
+TEST_F(EquationParserTest, FailedParseClearsCompiledExpression) {
+    ASSERT_TRUE(parser.parseExpression("x"));
+    EXPECT_FALSE(parser.parseExpression("+++"));
+    EXPECT_EQ(parser.getCompiledExpression(), nullptr);
+}
+
+TEST_F(EquationParserTest, ContextsHaveIndependentBindings) {
+    auto compiled = parser.parseExpression("x * y", true);
+    ASSERT_TRUE(compiled);
+    auto a = compiled->createContext();
+    auto b = compiled->createContext();
+    EXPECT_FLOAT_EQ(a.evaluate(2.0f, 3.0f), 6.0f);
+    EXPECT_FLOAT_EQ(b.evaluate(4.0f, 5.0f), 20.0f);
+    EXPECT_FLOAT_EQ(a.evaluate(1.0f, 7.0f), 7.0f);
+}
+
+TEST_F(EquationParserTest, ContextsEvaluateConcurrently) {
+    auto compiled = parser.parseExpression("sin(x) + x * y", true);
+    ASSERT_TRUE(compiled);
+
+    constexpr size_t kSize = 64;
+    std::vector<float> axis(kSize);
+    for (size_t i = 0; i < kSize; ++i) {
+        axis[i] = -4.0f + 8.0f * i / (kSize - 1);
+    }
+
+    std::vector<float> expected(kSize * kSize);
+    parser.evaluateGrid(axis.data(), kSize, axis.data(), kSize, expected.data());
+
+    constexpr size_t kThreads = 4;
+    std::vector<float> actual(kSize * kSize);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&, t]() {
+            auto context = compiled->createContext();
+            const size_t rows = kSize / kThreads;
+            context.evaluateGrid(axis.data(), kSize, axis.data() + t * rows, rows,
+                                 actual.data() + t * rows * kSize);
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(actual, expected);
+}
+
+TEST_F(EquationParserTest, UnsupportedSyntaxFallsBackToExprtk) {
+    // Chained powers are left to ExprTk; x^1^1 is x under either associativity.
+    auto compiled = parser.parseExpression("x^1^1");
+    ASSERT_TRUE(compiled);
+    EXPECT_FALSE(compiled->hasProgram());
+    EXPECT_FLOAT_EQ(parser.evaluate(3.0f), 3.0f);
+
+    auto context = compiled->createContext();
+    EXPECT_FLOAT_EQ(context.evaluate(5.0f), 5.0f);
+}
@@ -0,0 +1,128 @@
+#include <gtest/gtest.h>
+#include "expression_optimizer.h"
+#include "simd_evaluator.h"
+#include <cmath>
+#include <string>
+#include <vector>
+
+using namespace graphgl;
+
+class ExpressionOptimizerTest : public ::testing::Test {
+protected:
+    ExpressionProgram original;
+    ExpressionProgram optimized;
+
+    void optimize(const std::string& source, bool is3D = true) {
+        ASSERT_TRUE(ExpressionProgram::parse(source, is3D, original)) << source;
+        optimized = optimizeExpression(original);
+        ASSERT_FALSE(optimized.empty());
+    }
+
+    size_t countOps(ExprOp op) const {
+        size_t count = 0;
+        for (const ExprNode& node : optimized.getNodes()) {
+            count += (node.op == op) ? 1 : 0;
+        }
+        return count;
+    }
+
+    static float eval(const ExpressionProgram& program, float x, float y) {
+        std::vector<float> registers(program.size());
+        return program.evaluate(x, y, registers.data());
+    }
+};
+
+TEST_F(ExpressionOptimizerTest, FoldsConstants) {
+    optimize("2 * pi + e^2 - 1");
+    ASSERT_EQ(optimized.size(), 1u);
+    EXPECT_EQ(optimized.getNodes()[0].op, ExprOp::Const);
+    EXPECT_NEAR(eval(optimized, 0.0f, 0.0f), 2.0 * M_PI + M_E * M_E - 1.0, 1e-5);
+}
+
+TEST_F(ExpressionOptimizerTest, SharesCommonSubexpressions) {
+    optimize("sin(x^2 + y^2) + cos(y^2 + x^2)");
+    // x, y, x*x, y*y, the sum, sin, cos and the final add.
+    EXPECT_EQ(optimized.size(), 8u);
+    EXPECT_EQ(countOps(ExprOp::Add), 2u);
+}
+
+TEST_F(ExpressionOptimizerTest, RewritesSmallPowersAsMultiplies) {
+    optimize("x^2 + x^3 - y^-1");
+    EXPECT_EQ(countOps(ExprOp::Pow), 0u);
+
+    optimize("x^2.5");
+    EXPECT_EQ(countOps(ExprOp::Pow), 1u);
+}
+
+TEST_F(ExpressionOptimizerTest, AppliesExactIdentities) {
+    optimize("1 * x / 1 - 0 + --y");
+    // x, y and the add.
+    EXPECT_EQ(optimized.size(), 3u);
+}
+
+TEST_F(ExpressionOptimizerTest, HoistsXIndependentNodes) {
+    optimize("x * sin(y) + cos(y) * x^2");
+    const std::vector<ExprNode>& nodes = optimized.getNodes();
+
+    bool seenX = false;
+    std::vector<bool> dependsOnX(nodes.size(), false);
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        const int arity = exprOpArity(nodes[i].op);
+        dependsOnX[i] = nodes[i].op == ExprOp::VarX ||
+                        (arity >= 1 && dependsOnX[nodes[i].lhs]) ||
+                        (arity == 2 && dependsOnX[nodes[i].rhs]);
+        EXPECT_FALSE(seenX && !dependsOnX[i]) << "x-independent node " << i << " after x-dependent nodes";
+        seenX = seenX || dependsOnX[i];
+    }
+
+    SimdEvaluator evaluator(optimized);
+    EXPECT_EQ(evaluator.getUniformInstructionCount(), 2u); // sin(y), cos(y)
+}
+
+TEST_F(ExpressionOptimizerTest, PreservesResults) {
+    const char* sources[] = {
+        "sin(sqrt(x^2 + y^2))",
+        "sqrt(25 - x^2 - y^2) * exp(-(x^2+y^2))",
+        "x^3 - 3*x*y^2",
+        "(x^2 + y^2)^2 / (1 + x^4)",
+        "max(x, y) * min(y, x) + x % 2 - pow(abs(x), 0.5)",
+    };
+    for (const char* source : sources) {
+        optimize(source);
+        for (float y = -3.0f; y <= 3.0f; y += 0.75f) {
+            for (float x = -3.0f; x <= 3.0f; x += 0.6f) {
+                const float expected = eval(original, x, y);
+                const float actual = eval(optimized, x, y);
+                if (std::isnan(expected)) {
+                    EXPECT_TRUE(std::isnan(actual)) << source;
+                } else {
+                    EXPECT_NEAR(actual, expected, 1e-5f * (1.0f + std::fabs(expected))) << source;
+                }
+            }
+        }
+    }
+}
+
+TEST_F(ExpressionOptimizerTest, HoistedGridMatchesBatch) {
+    optimize("x * sin(y) + cos(y) * x^2 + exp(-y^2)");
+    SimdEvaluator evaluator(optimized);
+    std::vector<float> scratch(evaluator.getScratchSize());
+
+    std::vector<float> xs;
+    for (int i = 0; i < 150; ++i) {
+        xs.push_back(-4.0f + 0.05f * static_cast<float>(i));
+    }
+    const float ys[] = {-1.0f, 0.25f, 2.0f};
+
+    std::vector<float> grid(xs.size() * 3);
+    evaluator.evaluateGrid(xs.data(), xs.size(), ys, 3, grid.data(), scratch.data());
+
+    for (size_t row = 0; row < 3; ++row) {
+        std::vector<float> rowYs(xs.size(), ys[row]);
+        std::vector<float> batch(xs.size());
+        evaluator.evaluateBatch(xs.data(), rowYs.data(), batch.data(), xs.size(), scratch.data());
+        for (size_t col = 0; col < xs.size(); ++col) {
+            EXPECT_FLOAT_EQ(grid[row * xs.size() + col], batch[col]);
+        }
+    }
+}
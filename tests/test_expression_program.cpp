@@ -0,0 +1,55 @@
+#include <gtest/gtest.h>
+#include "expression_program.h"
+#include <cmath>
+#include <vector>
+
+using namespace graphgl;
+
+class ExpressionProgramTest : public ::testing::Test {
+protected:
+    ExpressionProgram program;
+
+    float eval(const std::string& source, float x, float y = 0.0f, bool is3D = true) {
+        EXPECT_TRUE(ExpressionProgram::parse(source, is3D, program)) << source;
+        std::vector<float> registers(program.size());
+        return program.evaluate(x, y, registers.data());
+    }
+};
+
+TEST_F(ExpressionProgramTest, Arithmetic) {
+    EXPECT_FLOAT_EQ(eval("2*x + 1", 3.0f), 7.0f);
+    EXPECT_FLOAT_EQ(eval("(x - 1) / 4", 9.0f), 2.0f);
+    EXPECT_FLOAT_EQ(eval("x % 3", 7.0f), 1.0f);
+}
+
+TEST_F(ExpressionProgramTest, PowerBindsTighterThanNegation) {
+    EXPECT_FLOAT_EQ(eval("-x^2", 3.0f), -9.0f);
+    EXPECT_FLOAT_EQ(eval("2^-x", 1.0f), 0.5f);
+    EXPECT_FLOAT_EQ(eval("x^2 - y^2", 3.0f, 2.0f), 5.0f);
+}
+
+TEST_F(ExpressionProgramTest, FunctionsAndConstants) {
+    EXPECT_NEAR(eval("sin(sqrt(x^2 + y^2))", 3.0f, 4.0f), std::sin(5.0f), 1e-6f);
+    EXPECT_NEAR(eval("pi", 0.0f), M_PI, 1e-6f);
+    EXPECT_NEAR(eval("e", 0.0f), M_E, 1e-6f);
+    EXPECT_FLOAT_EQ(eval("max(x, 1, y)", 0.0f, 5.0f), 5.0f);
+    EXPECT_FLOAT_EQ(eval("pow(x, 3)", 2.0f), 8.0f);
+}
+
+TEST_F(ExpressionProgramTest, IdentifiersAreCaseInsensitive) {
+    EXPECT_NEAR(eval("SIN(X)", 1.0f), std::sin(1.0f), 1e-6f);
+}
+
+TEST_F(ExpressionProgramTest, YIsZeroIn2D) {
+    EXPECT_FLOAT_EQ(eval("x + y", 2.0f, 10.0f, false), 2.0f);
+}
+
+TEST_F(ExpressionProgramTest, RejectsSyntaxOutsideGrammar) {
+    EXPECT_FALSE(ExpressionProgram::parse("", true, program));
+    EXPECT_FALSE(ExpressionProgram::parse("2x", true, program));
+    EXPECT_FALSE(ExpressionProgram::parse("x^2^3", true, program));
+    EXPECT_FALSE(ExpressionProgram::parse("x < 1", true, program));
+    EXPECT_FALSE(ExpressionProgram::parse("foo(x)", true, program));
+    EXPECT_FALSE(ExpressionProgram::parse("sin(x", true, program));
+    EXPECT_TRUE(program.empty());
+}
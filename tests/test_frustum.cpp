@@ -0,0 +1,40 @@
+#include <gtest/gtest.h>
+#include "frustum.h"
+#include <glm/gtc/matrix_transform.hpp>
+
+using namespace graphgl;
+
+class FrustumTest : public ::testing::Test {
+protected:
+    // Camera at z = 10 looking at the origin, 90 degrees wide, seeing 1 to 100 units ahead.
+    Frustum frustum{glm::perspective(glm::radians(90.0f), 1.0f, 1.0f, 100.0f) *
+                    glm::lookAt(glm::vec3(0.0f, 0.0f, 10.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f))};
+
+    bool sees(const glm::vec3& boundsMin, const glm::vec3& boundsMax) const {
+        return frustum.intersects(boundsMin, boundsMax);
+    }
+};
+
+TEST_F(FrustumTest, KeepsBoxesInsideOrAcrossThePlanes) {
+    EXPECT_TRUE(sees(glm::vec3(-1.0f), glm::vec3(1.0f)));
+    // Straddles the left plane (x = -(10 - z) at this depth) and the near plane.
+    EXPECT_TRUE(sees(glm::vec3(-20.0f, -1.0f, -1.0f), glm::vec3(-9.0f, 1.0f, 1.0f)));
+    EXPECT_TRUE(sees(glm::vec3(-1.0f, -1.0f, 8.0f), glm::vec3(1.0f, 1.0f, 12.0f)));
+    // A huge box around the camera.
+    EXPECT_TRUE(sees(glm::vec3(-1000.0f), glm::vec3(1000.0f)));
+}
+
+TEST_F(FrustumTest, CullsBoxesOutsideAPlane) {
+    EXPECT_FALSE(sees(glm::vec3(-1.0f, -1.0f, 12.0f), glm::vec3(1.0f, 1.0f, 20.0f)));     // behind
+    EXPECT_FALSE(sees(glm::vec3(-1.0f, -1.0f, -200.0f), glm::vec3(1.0f, 1.0f, -100.0f))); // too far
+    EXPECT_FALSE(sees(glm::vec3(-30.0f, -1.0f, -1.0f), glm::vec3(-12.0f, 1.0f, 1.0f)));   // left
+    EXPECT_FALSE(sees(glm::vec3(-1.0f, 12.0f, -1.0f), glm::vec3(1.0f, 30.0f, 1.0f)));     // above
+}
+
+TEST_F(FrustumTest, EmptyBoxesAreCulledAndTheDefaultKeepsEverything) {
+    EXPECT_FALSE(sees(glm::vec3(1.0f), glm::vec3(-1.0f)));
+
+    const Frustum everything;
+    EXPECT_TRUE(everything.intersects(glm::vec3(1e6f), glm::vec3(2e6f)));
+    EXPECT_FALSE(everything.intersects(glm::vec3(1.0f), glm::vec3(0.0f)));
+}
@@ -0,0 +1,220 @@
+#include <gtest/gtest.h>
+#include "generation_scheduler.h"
+#include "equation_generator.h"
+#include "equation_parser.h"
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace graphgl;
+
+class GenerationSchedulerTest : public ::testing::Test {
+protected:
+    static Equation surface(const char* expression) {
+        Equation eq;
+        eq.expression = expression;
+        eq.is3D = true;
+        eq.isMesh = true;
+        eq.minX = -3.0f;
+        eq.maxX = 3.0f;
+        eq.minY = -3.0f;
+        eq.maxY = 3.0f;
+        return eq;
+    }
+
+    static GenerationOptions options() {
+        GenerationOptions opts;
+        opts.maxDepth = 5;
+        return opts;
+    }
+};
+
+TEST_F(GenerationSchedulerTest, MatchesSynchronousGeneration) {
+    Equation curve;
+    curve.expression = "sin(x) * x";
+    curve.is3D = false;
+    Equation mesh = surface("sin(x) * cos(y)");
+
+    GenerationScheduler scheduler(2);
+    scheduler.submit(curve, options());
+    scheduler.submit(mesh, options());
+    scheduler.waitIdle();
+    EXPECT_FALSE(scheduler.isBusy());
+    const std::vector<GenerationResult> results = scheduler.takeResults();
+    ASSERT_EQ(results.size(), 2u);
+
+    for (Equation* eq : {&curve, &mesh}) {
+        EquationParser parser;
+        EquationGenerator generator;
+        ASSERT_TRUE(parser.parseExpression(eq->expression, eq->is3D));
+        generator.generateVertices(*eq, parser, options().maxDepth, options().derivativeThreshold);
+
+        const GenerationResult* result = nullptr;
+        for (const GenerationResult& r : results) {
+            if (r.equationId == eq->id) {
+                result = &r;
+            }
+        }
+        ASSERT_NE(result, nullptr);
+        EXPECT_TRUE(result->isValid);
+        EXPECT_TRUE(result->isFinal);
+        EXPECT_EQ(result->vertices, eq->vertices);
+        EXPECT_EQ(result->indices, eq->indices);
+        EXPECT_EQ(result->minHeight, generator.getMinHeight());
+        EXPECT_EQ(result->maxHeight, generator.getMaxHeight());
+    }
+    EXPECT_TRUE(scheduler.takeResults().empty());
+}
+
+TEST_F(GenerationSchedulerTest, NewerSubmissionSupersedesOlder) {
+    Equation eq = surface("sin(x * y) + exp(-(x^2 + y^2))");
+    GenerationOptions heavy = options();
+    heavy.maxDepth = 8;
+
+    GenerationScheduler scheduler(1);
+    scheduler.submit(eq, heavy);
+    eq.expression = "x + y";
+    scheduler.submit(eq, options());
+    eq.expression = "2 * x";
+    scheduler.submit(eq, options());
+    scheduler.waitIdle();
+
+    // Only the last edit produces geometry: the plane 2x over [-3, 3].
+    const std::vector<GenerationResult> results = scheduler.takeResults();
+    ASSERT_EQ(results.size(), 1u);
+    EXPECT_EQ(results[0].equationId, eq.id);
+    EXPECT_FLOAT_EQ(results[0].minHeight, -6.0f);
+    EXPECT_FLOAT_EQ(results[0].maxHeight, 6.0f);
+}
+
+TEST_F(GenerationSchedulerTest, DomainEditsReuseSamplesOfRunningJob) {
+    Equation eq = surface("sin(x * y) + exp(-(x^2 + y^2))");
+    GenerationScheduler scheduler(2);
+    scheduler.submit(eq, options());
+    // Once its first preview is out the job is running; the next edits arrive meanwhile.
+    while (scheduler.takeResults().empty()) {
+        std::this_thread::yield();
+    }
+    eq.maxX = 3.5f;
+    scheduler.submit(eq, options());
+    eq.maxX = 4.0f;
+    scheduler.submit(eq, options());
+    scheduler.waitIdle();
+
+    const std::vector<GenerationResult> results = scheduler.takeResults();
+    ASSERT_EQ(results.size(), 1u);
+    ASSERT_TRUE(results[0].isFinal);
+
+    // The running job was not cancelled and the one queued behind it waited for its samples,
+    // so it only evaluates the new columns.
+    EquationParser parser;
+    EquationGenerator generator;
+    auto cache = std::make_shared<SurfaceSampleCache>();
+    generator.setSampleCache(cache);
+    ASSERT_TRUE(parser.parseExpression(eq.expression, eq.is3D));
+    generator.generateVertices(eq, parser, options().maxDepth, options().derivativeThreshold);
+    EXPECT_EQ(results[0].vertices, eq.vertices);
+    EXPECT_GT(results[0].evaluatedSamples, 0u);
+    EXPECT_LT(results[0].evaluatedSamples, cache->evaluatedSamples / 4);
+}
+
+TEST_F(GenerationSchedulerTest, SupersededSurfaceStopsBeforeMeshing) {
+    // What the scheduler does when a same-expression edit arrives after the first preview.
+    EquationParser parser;
+    EquationGenerator generator;
+    auto token = std::make_shared<CancellationToken>();
+    generator.setCancellationToken(token);
+    auto cache = std::make_shared<SurfaceSampleCache>();
+    generator.setSampleCache(cache);
+
+    Equation mesh = surface("sin(x * y) + exp(-(x^2 + y^2))");
+    ASSERT_TRUE(parser.parseExpression(mesh.expression, mesh.is3D));
+    size_t levels = 0;
+    generator.generateProgressive(mesh, parser, options().maxDepth, options().derivativeThreshold,
+                                  [&](const Equation&, bool) {
+                                      ++levels;
+                                      token->stopAfterSamples();
+                                  });
+    EXPECT_EQ(levels, 1u); // no later preview, no final mesh
+    EXPECT_TRUE(mesh.indices.empty());
+
+    // The final grid still reached the cache, so the edit that superseded the job reuses it.
+    EquationParser freshParser;
+    EquationGenerator fresh;
+    auto freshCache = std::make_shared<SurfaceSampleCache>();
+    fresh.setSampleCache(freshCache);
+    Equation full = surface(mesh.expression.c_str());
+    ASSERT_TRUE(freshParser.parseExpression(full.expression, full.is3D));
+    fresh.generateVertices(full, freshParser, options().maxDepth, options().derivativeThreshold);
+    EXPECT_EQ(cache->xs, freshCache->xs);
+    EXPECT_EQ(cache->ys, freshCache->ys);
+    EXPECT_EQ(cache->heights.size(), freshCache->heights.size());
+
+    // Cancelling outright still wins.
+    token->cancel();
+    token->stopAfterSamples();
+    EXPECT_TRUE(token->isCancelled());
+    EXPECT_FALSE(token->isStoppingAfterSamples());
+}
+
+TEST_F(GenerationSchedulerTest, CancelDropsWorkAndResults) {
+    GenerationScheduler scheduler(1);
+    Equation first = surface("sin(x) + cos(y)");
+    Equation second = surface("x * y");
+    scheduler.submit(first, options());
+    scheduler.submit(second, options());
+    scheduler.cancel(first.id);
+    scheduler.waitIdle();
+
+    std::vector<GenerationResult> results = scheduler.takeResults();
+    ASSERT_EQ(results.size(), 1u);
+    EXPECT_EQ(results[0].equationId, second.id);
+
+    // Finished but untaken results are dropped too.
+    scheduler.submit(second, options());
+    scheduler.waitIdle();
+    scheduler.cancel(second.id);
+    EXPECT_TRUE(scheduler.takeResults().empty());
+}
+
+TEST_F(GenerationSchedulerTest, ReportsParseErrors) {
+    GenerationScheduler scheduler(1);
+    Equation eq = surface("sin(x");
+    scheduler.submit(eq, options());
+    scheduler.waitIdle();
+
+    const std::vector<GenerationResult> results = scheduler.takeResults();
+    ASSERT_EQ(results.size(), 1u);
+    EXPECT_FALSE(results[0].isValid);
+    EXPECT_FALSE(results[0].errorMessage.empty());
+    EXPECT_TRUE(results[0].vertices.empty());
+}
+
+TEST_F(GenerationSchedulerTest, CancelledGeneratorStopsEarly) {
+    EquationParser parser;
+    EquationGenerator generator;
+    auto token = std::make_shared<CancellationToken>();
+    token->cancel();
+    generator.setCancellationToken(token);
+    auto cache = std::make_shared<SurfaceSampleCache>();
+    generator.setSampleCache(cache);
+
+    Equation mesh = surface("sin(x) * cos(y)");
+    ASSERT_TRUE(parser.parseExpression(mesh.expression, mesh.is3D));
+    generator.generateVertices(mesh, parser);
+    EXPECT_TRUE(mesh.vertices.empty());
+    EXPECT_TRUE(mesh.indices.empty());
+    EXPECT_TRUE(cache->heights.empty()); // the unfinished grid is not cached
+
+    Equation curve;
+    curve.expression = "sin(x)";
+    curve.is3D = false;
+    ASSERT_TRUE(parser.parseExpression(curve.expression, curve.is3D));
+    generator.generateVertices(curve, parser);
+    EXPECT_LE(curve.vertices.size(), 2u); // at most the closing sample
+
+    // Without a token the same generator runs to completion.
+    generator.setCancellationToken(nullptr);
+    generator.generateVertices(curve, parser);
+    EXPECT_GE(curve.vertices.size(), 200u); // every base sample
+}
@@ -0,0 +1,139 @@
+#include <gtest/gtest.h>
+#include "interval_arithmetic.h"
+#include "equation_parser.h"
+#include "expression_optimizer.h"
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace graphgl;
+
+class IntervalArithmeticTest : public ::testing::Test {
+protected:
+    static ExpressionProgram compile(const std::string& source) {
+        ExpressionProgram program;
+        EXPECT_TRUE(ExpressionProgram::parse(source, true, program)) << source;
+        return optimizeExpression(program);
+    }
+
+    static Interval bounds(const std::string& source, Interval x, Interval y) {
+        const ExpressionProgram program = compile(source);
+        std::vector<Interval> registers(program.size());
+        return evaluateInterval(program, x, y, registers.data());
+    }
+
+    /// Point samples inside random boxes must lie within the bounds, and NaNs may only
+    /// occur where the bounds allow them.
+    static void expectContainsSamples(const std::string& source) {
+        const ExpressionProgram program = compile(source);
+        const SimdEvaluator simd(program);
+        std::vector<Interval> registers(program.size());
+        std::vector<float> scalarRegisters(program.size());
+        std::vector<float> scratch(simd.getScratchSize());
+        std::mt19937 rng(7);
+        std::uniform_real_distribution<float> corner(-8.0f, 8.0f);
+        std::uniform_real_distribution<float> size(0.0f, 4.0f);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+        for (int box = 0; box < 200; ++box) {
+            const float x0 = corner(rng);
+            const float y0 = corner(rng);
+            const float x1 = x0 + size(rng);
+            const float y1 = y0 + size(rng);
+            const Interval z = evaluateInterval(program, Interval::of(x0, x1), Interval::of(y0, y1),
+                                                registers.data());
+
+            std::vector<float> xs;
+            std::vector<float> ys;
+            for (int i = 0; i < 64; ++i) {
+                xs.push_back(i == 0 ? x0 : (i == 1 ? x1 : x0 + (x1 - x0) * unit(rng)));
+                ys.push_back(i == 0 ? y0 : (i == 1 ? y1 : y0 + (y1 - y0) * unit(rng)));
+            }
+            std::vector<float> vectorized(xs.size());
+            simd.evaluateBatch(xs.data(), ys.data(), vectorized.data(), xs.size(), scratch.data());
+
+            for (size_t i = 0; i < xs.size(); ++i) {
+                for (float value : {program.evaluate(xs[i], ys[i], scalarRegisters.data()), vectorized[i]}) {
+                    if (std::isnan(value)) {
+                        EXPECT_TRUE(z.mayBeUndefined) << source << " at " << xs[i] << ", " << ys[i];
+                    } else {
+                        EXPECT_FALSE(z.isUndefined()) << source << " at " << xs[i] << ", " << ys[i];
+                        EXPECT_GE(value, z.lo) << source << " at " << xs[i] << ", " << ys[i];
+                        EXPECT_LE(value, z.hi) << source << " at " << xs[i] << ", " << ys[i];
+                    }
+                }
+            }
+        }
+    }
+};
+
+TEST_F(IntervalArithmeticTest, BoundsContainSamples) {
+    expectContainsSamples("sqrt(25 - x^2 - y^2)");
+    expectContainsSamples("sin(x) * cos(y) + x^3 - y / 7");
+    expectContainsSamples("x % 1.5 + pow(abs(y), 0.5) + pow(x, 3) - pow(y, -2)");
+    expectContainsSamples("min(x, y) + max(x, -y) + atan2(y, x) + hypot(x, y) + tan(x)");
+    expectContainsSamples("asin(y / 4) + acos(x / 4) + atan(x) + sinh(y) + cosh(x) + tanh(y)");
+    expectContainsSamples("exp(x) + log(x) + log10(y) + log2(x * y) + 1 / (x - y)");
+    expectContainsSamples("floor(x) + ceil(y) + round(x * y) + trunc(y) + sgn(x)");
+    expectContainsSamples("sin(sqrt(x^2 + y^2)) * exp(-(x^2 + y^2) / 20)");
+}
+
+TEST_F(IntervalArithmeticTest, ProvesUndefinedBoxes) {
+    EXPECT_TRUE(bounds("sqrt(25 - x^2 - y^2)", Interval::of(10, 20), Interval::of(-3, 3)).isUndefined());
+    EXPECT_TRUE(bounds("log(-1 - x^2)", Interval::of(-5, 5), Interval::point(0)).isUndefined());
+    EXPECT_TRUE(bounds("asin(x)", Interval::of(1.5, 2), Interval::point(0)).isUndefined());
+
+    const Interval inside = bounds("sqrt(25 - x^2 - y^2)", Interval::of(0, 1), Interval::of(0, 1));
+    EXPECT_FALSE(inside.isUndefined());
+    EXPECT_FALSE(inside.mayBeUndefined);
+    EXPECT_NEAR(inside.lo, std::sqrt(23.0), 1e-3);
+    EXPECT_NEAR(inside.hi, 5.0, 1e-3);
+
+    const Interval edge = bounds("sqrt(25 - x^2 - y^2)", Interval::of(4, 6), Interval::of(0, 1));
+    EXPECT_FALSE(edge.isUndefined());
+    EXPECT_TRUE(edge.mayBeUndefined);
+}
+
+TEST_F(IntervalArithmeticTest, TightBoundsForMonotonicAndPeriodicFunctions) {
+    const Interval s = bounds("sin(x)", Interval::of(0, 3.14159), Interval::point(0));
+    EXPECT_NEAR(s.lo, 0.0, 1e-4);
+    EXPECT_NEAR(s.hi, 1.0, 1e-4);
+
+    const Interval c = bounds("cos(x)", Interval::of(-1, 1), Interval::point(0));
+    EXPECT_NEAR(c.lo, std::cos(1.0), 1e-4);
+    EXPECT_NEAR(c.hi, 1.0, 1e-4);
+
+    const Interval square = bounds("x^2", Interval::of(-2, 1), Interval::point(0));
+    EXPECT_NEAR(square.lo, 0.0, 1e-4);
+    EXPECT_NEAR(square.hi, 4.0, 1e-4);
+
+    const Interval pole = bounds("1 / x", Interval::of(-1, 1), Interval::point(0));
+    EXPECT_TRUE(std::isinf(pole.lo));
+    EXPECT_TRUE(std::isinf(pole.hi));
+}
+
+TEST_F(IntervalArithmeticTest, ContextBoundsAndFallback) {
+    EquationParser parser;
+    auto compiled = parser.parseExpression("x^2 + y", true);
+    ASSERT_TRUE(compiled);
+    auto context = compiled->createContext();
+    const Interval z = context.evaluateInterval(Interval::of(1, 2), Interval::of(0, 1));
+    EXPECT_NEAR(z.lo, 1.0, 1e-4);
+    EXPECT_NEAR(z.hi, 5.0, 1e-4);
+
+    // 2D expressions ignore y.
+    compiled = parser.parseExpression("x + y", false);
+    ASSERT_TRUE(compiled);
+    auto context2D = compiled->createContext();
+    const Interval line = context2D.evaluateInterval(Interval::of(1, 2), Interval::of(100, 200));
+    EXPECT_NEAR(line.hi, 2.0, 1e-4);
+
+    // ExprTk-only expressions have no bounds.
+    compiled = parser.parseExpression("x^1^1", true);
+    ASSERT_TRUE(compiled);
+    auto fallback = compiled->createContext();
+    const Interval unknown = fallback.evaluateInterval(Interval::of(1, 2), Interval::of(0, 1));
+    EXPECT_TRUE(unknown.mayBeUndefined);
+    EXPECT_TRUE(std::isinf(unknown.lo));
+}
@@ -0,0 +1,69 @@
+#include <gtest/gtest.h>
+#include "mesh_indices.h"
+#include <algorithm>
+#include <vector>
+
+using namespace graphgl;
+
+class MeshIndicesTest : public ::testing::Test {
+protected:
+    static void expectSameSequence(const MeshIndices& packed, const std::vector<unsigned int>& indices) {
+        ASSERT_EQ(packed.size(), indices.size());
+        for (size_t i = 0; i < indices.size(); ++i) {
+            EXPECT_EQ(packed[i], indices[i]) << "at " << i;
+        }
+    }
+};
+
+TEST_F(MeshIndicesTest, SmallMeshIsOneCompactChunk) {
+    const std::vector<unsigned int> indices = {0, 1, 2, 2, 1, 3, 7, 5, 4};
+    MeshIndices packed;
+    packed.assign(indices);
+
+    ASSERT_EQ(packed.getChunks().size(), 1u);
+    EXPECT_FALSE(packed.getChunks()[0].wide);
+    EXPECT_EQ(packed.getCompact().size(), indices.size());
+    EXPECT_TRUE(packed.getWide().empty());
+    expectSameSequence(packed, indices);
+}
+
+TEST_F(MeshIndicesTest, LargeMeshesSplitIntoChunksUnder65536Vertices) {
+    // A strip of triangles over 200000 vertices, as a mesh emits them.
+    std::vector<unsigned int> indices;
+    for (unsigned int v = 0; v + 2 < 200000; ++v) {
+        indices.insert(indices.end(), {v, v + 1, v + 2});
+    }
+    MeshIndices packed;
+    packed.assign(indices);
+
+    EXPECT_GE(packed.getChunks().size(), 4u);
+    EXPECT_TRUE(packed.getWide().empty());
+    for (const IndexChunk& chunk : packed.getChunks()) {
+        EXPECT_EQ(chunk.count % 3, 0u);
+        uint32_t hi = 0;
+        for (uint32_t i = chunk.first; i < chunk.first + chunk.count; ++i) {
+            hi = std::max<uint32_t>(hi, packed.getCompact()[i]);
+        }
+        EXPECT_LE(hi, MeshIndices::MAX_CHUNK_SPAN);
+    }
+    expectSameSequence(packed, indices);
+}
+
+TEST_F(MeshIndicesTest, TrianglesSpanningTooManyVerticesStayWide) {
+    const std::vector<unsigned int> indices = {0, 1, 2, 0, 70000, 1, 3, 4, 5};
+    MeshIndices packed;
+    packed.assign(indices);
+
+    ASSERT_EQ(packed.getChunks().size(), 3u);
+    EXPECT_TRUE(packed.getChunks()[1].wide);
+    EXPECT_EQ(packed.getWide().size(), 3u);
+    EXPECT_EQ(packed.getCompact().size(), 6u);
+    expectSameSequence(packed, indices);
+
+    MeshIndices same;
+    same.assign(indices);
+    EXPECT_EQ(packed, same);
+    same.clear();
+    EXPECT_TRUE(same.empty());
+    EXPECT_NE(packed, same);
+}
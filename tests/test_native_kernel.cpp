@@ -0,0 +1,187 @@
+#include <gtest/gtest.h>
+#include "native_kernel.h"
+#include "equation_parser.h"
+#include "expression_optimizer.h"
+#include <cmath>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+using namespace graphgl;
+
+class NativeKernelTest : public ::testing::Test {
+protected:
+    std::string directory;
+
+    void SetUp() override {
+        directory = (std::filesystem::temp_directory_path() /
+                     ("graphgl_kernels_test_" + std::to_string(getpid()))).string();
+    }
+
+    void TearDown() override {
+        std::error_code error;
+        std::filesystem::remove_all(directory, error);
+    }
+
+    static ExpressionProgram compile(const std::string& source) {
+        ExpressionProgram program;
+        EXPECT_TRUE(ExpressionProgram::parse(source, true, program)) << source;
+        return optimizeExpression(program);
+    }
+
+    static void expectMatches(const ExpressionProgram& program, const NativeKernel& kernel,
+                              const std::string& source) {
+        std::vector<float> xs;
+        std::vector<float> ys;
+        for (int i = 0; i < 37; ++i) {
+            xs.push_back(-3.0f + 0.17f * static_cast<float>(i));
+        }
+        for (int i = 0; i < 11; ++i) {
+            ys.push_back(-2.0f + 0.41f * static_cast<float>(i));
+        }
+
+        std::vector<float> grid(xs.size() * ys.size());
+        kernel.evaluateGrid(xs.data(), xs.size(), ys.data(), ys.size(), grid.data());
+        std::vector<float> batch(xs.size());
+        std::vector<float> batchYs(xs.size(), ys[3]);
+        kernel.evaluateBatch(xs.data(), batchYs.data(), batch.data(), xs.size());
+
+        std::vector<float> registers(program.size());
+        for (size_t row = 0; row < ys.size(); ++row) {
+            for (size_t col = 0; col < xs.size(); ++col) {
+                const float expected = program.evaluate(xs[col], ys[row], registers.data());
+                const float actual = grid[row * xs.size() + col];
+                if (std::isnan(expected)) {
+                    EXPECT_TRUE(std::isnan(actual)) << source;
+                } else if (std::isinf(expected)) {
+                    EXPECT_EQ(actual, expected) << source;
+                } else {
+                    EXPECT_NEAR(actual, expected, 1e-5f * (1.0f + std::fabs(expected))) << source;
+                }
+                if (row == 3) {
+                    EXPECT_EQ(std::isnan(batch[col]), std::isnan(actual)) << source;
+                    if (!std::isnan(actual)) {
+                        EXPECT_FLOAT_EQ(batch[col], actual) << source;
+                    }
+                }
+            }
+        }
+    }
+};
+
+TEST_F(NativeKernelTest, TranspiledSourceExportsEntryPoints) {
+    const std::string source = transpileExpression(compile("sin(x) * cos(y) + min(x, 2.5)"));
+    EXPECT_NE(source.find("extern \"C\" void graphgl_kernel_batch"), std::string::npos);
+    EXPECT_NE(source.find("extern \"C\" void graphgl_kernel_grid"), std::string::npos);
+    EXPECT_NE(source.find("std::sin"), std::string::npos);
+    EXPECT_NE(source.find("std::cos"), std::string::npos);
+}
+
+TEST_F(NativeKernelTest, KernelsMatchInterpreter) {
+    NativeKernelCache cache(directory);
+    if (!cache.isCompilerAvailable()) {
+        GTEST_SKIP() << "No C++ compiler: " << cache.getCompiler();
+    }
+
+    for (const char* source : {
+             "sin(x) * cos(y) + x^3 - y / 7 + x % 1.5 + pow(abs(y), 0.5)",
+             "min(x, y) + max(x, -y) + atan2(y, x) + hypot(x, y) + tan(x) + asin(y / 4) + acos(x / 4)",
+             "atan(x) + sinh(y) + cosh(x) + tanh(y) + exp(x) + log(x) + log10(y) + log2(x * y) + sqrt(x)",
+             "floor(x) + ceil(y) + round(x * y) + trunc(y) + sgn(x) + 1e-3 * y + -pi"}) {
+        const ExpressionProgram program = compile(source);
+        const auto kernel = cache.load(program);
+        ASSERT_NE(kernel, nullptr) << source << ": " << cache.getLastError();
+        expectMatches(program, *kernel, source);
+    }
+}
+
+TEST_F(NativeKernelTest, LibrariesAreCachedOnDisk) {
+    const ExpressionProgram program = compile("x * x - y * y");
+    {
+        NativeKernelCache cache(directory);
+        if (!cache.isCompilerAvailable()) {
+            GTEST_SKIP() << "No C++ compiler: " << cache.getCompiler();
+        }
+        ASSERT_NE(cache.load(program), nullptr) << cache.getLastError();
+        EXPECT_EQ(cache.load(program), cache.load(program));
+        EXPECT_EQ(cache.getCompileCount(), 1u);
+    }
+
+    // A new cache (as in a later run) finds the library without compiling.
+    NativeKernelCache cache(directory);
+    const auto kernel = cache.load(program);
+    ASSERT_NE(kernel, nullptr) << cache.getLastError();
+    EXPECT_EQ(cache.getCompileCount(), 0u);
+    expectMatches(program, *kernel, "x * x - y * y");
+}
+
+TEST_F(NativeKernelTest, ConcurrentLoadsShareOneCompile) {
+    NativeKernelCache cache(directory);
+    if (!cache.isCompilerAvailable()) {
+        GTEST_SKIP() << "No C++ compiler: " << cache.getCompiler();
+    }
+
+    const ExpressionProgram program = compile("x * y + 3");
+    std::vector<std::shared_ptr<const NativeKernel>> kernels(4);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < kernels.size(); ++i) {
+        threads.emplace_back([&, i] { kernels[i] = cache.load(program); });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    ASSERT_NE(kernels[0], nullptr) << cache.getLastError();
+    for (const auto& kernel : kernels) {
+        EXPECT_EQ(kernel, kernels[0]);
+    }
+    EXPECT_EQ(cache.getCompileCount(), 1u);
+}
+
+TEST_F(NativeKernelTest, MissingCompilerYieldsNoKernel) {
+    NativeKernelCache cache(directory, "graphgl-no-such-compiler");
+    EXPECT_FALSE(cache.isCompilerAvailable());
+    EXPECT_EQ(cache.load(compile("x + y")), nullptr);
+    EXPECT_FALSE(cache.getLastError().empty());
+
+    // The parser keeps working through the interpreter.
+    EquationParser parser;
+    parser.setNativeKernelCache(std::make_shared<NativeKernelCache>(directory, "graphgl-no-such-compiler"));
+    const auto compiled = parser.parseExpression("x + y", true);
+    ASSERT_NE(compiled, nullptr);
+    EXPECT_EQ(compiled->getNativeKernel(), nullptr);
+    EXPECT_FLOAT_EQ(parser.evaluate(2.0f, 3.0f), 5.0f);
+}
+
+TEST_F(NativeKernelTest, ParserUsesNativeKernel) {
+    auto cache = std::make_shared<NativeKernelCache>(directory);
+    if (!cache->isCompilerAvailable()) {
+        GTEST_SKIP() << "No C++ compiler: " << cache->getCompiler();
+    }
+
+    EquationParser parser;
+    parser.setNativeKernelCache(cache);
+    const auto compiled = parser.parseExpression("sin(x * y) + x", true);
+    ASSERT_NE(compiled, nullptr);
+    ASSERT_NE(compiled->getNativeKernel(), nullptr) << cache->getLastError();
+
+    const float xs[] = {0.5f, 1.0f, 2.0f};
+    const float ys[] = {-1.0f, 0.25f};
+    float out[6];
+    parser.evaluateGrid(xs, 3, ys, 2, out);
+    for (size_t row = 0; row < 2; ++row) {
+        for (size_t col = 0; col < 3; ++col) {
+            EXPECT_NEAR(out[row * 3 + col], std::sin(xs[col] * ys[row]) + xs[col], 1e-6f);
+        }
+    }
+
+    // 2D expressions ignore y in every entry point.
+    ASSERT_NE(parser.parseExpression("x * 2", false), nullptr);
+    ASSERT_NE(parser.getCompiledExpression()->getNativeKernel(), nullptr);
+    parser.evaluateBatch(xs, ys, out, 2);
+    EXPECT_FLOAT_EQ(out[0], 1.0f);
+    EXPECT_FLOAT_EQ(out[1], 2.0f);
+}
@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+#include "preset_kernels.h"
+#include "equation_parser.h"
+#include "expression_optimizer.h"
+#include <cmath>
+#include <string>
+#include <vector>
+
+using namespace graphgl;
+
+class PresetKernelsTest : public ::testing::Test {
+protected:
+    static ExpressionProgram compile(const std::string& source, bool is3D = true) {
+        ExpressionProgram program;
+        EXPECT_TRUE(ExpressionProgram::parse(source, is3D, program)) << source;
+        return optimizeExpression(program);
+    }
+};
+
+TEST_F(PresetKernelsTest, EveryPresetMatchesItsExpression) {
+    ASSERT_FALSE(getPresetKernels().empty());
+    for (const PresetKernel& preset : getPresetKernels()) {
+        EXPECT_EQ(findPresetKernel(compile(preset.expression, preset.is3D)), &preset) << preset.name;
+    }
+}
+
+TEST_F(PresetKernelsTest, EquivalentSpellingsMatch) {
+    const PresetKernel* ripple = findPresetKernel(compile("sin(sqrt(x*x + y*y))"));
+    ASSERT_NE(ripple, nullptr);
+    EXPECT_STREQ(ripple->name, "Ripple");
+
+    const PresetKernel* parabola = findPresetKernel(compile("(x)^2"));
+    ASSERT_NE(parabola, nullptr);
+    EXPECT_STREQ(parabola->name, "Parabola");
+}
+
+TEST_F(PresetKernelsTest, OtherExpressionsDoNotMatch) {
+    for (const char* source : {"x^2 + y^2", "sin(x) * cos(y) + 1", "sqrt(24 - x^2)", "sin(y)", "cos(x) * sin(y)"}) {
+        EXPECT_EQ(findPresetKernel(compile(source)), nullptr) << source;
+    }
+    EXPECT_EQ(findPresetKernel(ExpressionProgram()), nullptr);
+}
+
+TEST_F(PresetKernelsTest, FunctorsMatchInterpreter) {
+    std::vector<float> xs;
+    std::vector<float> ys;
+    for (int i = 0; i < 41; ++i) {
+        xs.push_back(-6.0f + 0.3f * static_cast<float>(i));
+    }
+    for (int i = 0; i < 9; ++i) {
+        ys.push_back(-5.0f + 1.2f * static_cast<float>(i));
+    }
+
+    for (const PresetKernel& preset : getPresetKernels()) {
+        const ExpressionProgram program = compile(preset.expression, preset.is3D);
+        std::vector<float> grid(xs.size() * ys.size());
+        preset.evaluateGrid(xs.data(), xs.size(), ys.data(), ys.size(), grid.data());
+        std::vector<float> batch(xs.size());
+        preset.evaluateBatch(xs.data(), nullptr, batch.data(), xs.size());
+
+        std::vector<float> registers(program.size());
+        for (size_t row = 0; row < ys.size(); ++row) {
+            for (size_t col = 0; col < xs.size(); ++col) {
+                const float expected = program.evaluate(xs[col], preset.is3D ? ys[row] : 0.0f, registers.data());
+                const float actual = grid[row * xs.size() + col];
+                if (std::isnan(expected)) {
+                    EXPECT_TRUE(std::isnan(actual)) << preset.name;
+                } else {
+                    EXPECT_NEAR(actual, expected, 1e-6f * (1.0f + std::fabs(expected))) << preset.name;
+                }
+            }
+        }
+        for (size_t col = 0; col < xs.size(); ++col) {
+            const float expected = program.evaluate(xs[col], 0.0f, registers.data());
+            if (std::isnan(expected)) {
+                EXPECT_TRUE(std::isnan(batch[col])) << preset.name;
+            } else {
+                EXPECT_NEAR(batch[col], expected, 1e-6f * (1.0f + std::fabs(expected))) << preset.name;
+            }
+        }
+    }
+}
+
+TEST_F(PresetKernelsTest, ParserUsesPresetKernel) {
+    EquationParser parser;
+    ASSERT_NE(parser.parseExpression("sin(sqrt(x^2 + y^2))", true), nullptr);
+    ASSERT_NE(parser.getCompiledExpression()->getPresetKernel(), nullptr);
+
+    const float xs[] = {0.5f, 1.0f, 2.0f};
+    const float ys[] = {-1.0f, 0.25f};
+    float out[6];
+    parser.evaluateGrid(xs, 3, ys, 2, out);
+    for (size_t row = 0; row < 2; ++row) {
+        for (size_t col = 0; col < 3; ++col) {
+            EXPECT_NEAR(out[row * 3 + col], std::sin(std::hypot(xs[col], ys[row])), 1e-6f);
+        }
+    }
+
+    ASSERT_NE(parser.parseExpression("x^2 + 1", true), nullptr);
+    EXPECT_EQ(parser.getCompiledExpression()->getPresetKernel(), nullptr);
+}
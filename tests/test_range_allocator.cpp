@@ -0,0 +1,41 @@
+#include <gtest/gtest.h>
+#include "range_allocator.h"
+
+using namespace graphgl;
+
+TEST(RangeAllocatorTest, AllocatesFirstFitAndMergesReleasedRanges) {
+    RangeAllocator ranges(100);
+    const size_t a = ranges.allocate(30);
+    const size_t b = ranges.allocate(30);
+    const size_t c = ranges.allocate(30);
+    EXPECT_EQ(a, 0u);
+    EXPECT_EQ(b, 30u);
+    EXPECT_EQ(c, 60u);
+    EXPECT_EQ(ranges.getUsed(), 90u);
+    EXPECT_EQ(ranges.allocate(20), RangeAllocator::NO_SPACE);
+
+    // A freed hole is reused first; neighbours merge when released.
+    ranges.release(b, 30);
+    EXPECT_EQ(ranges.allocate(10), 30u);
+    ranges.release(30, 10);
+    ranges.release(a, 30);
+    EXPECT_EQ(ranges.getFreeRanges(), 2u); // [0, 60) and [90, 100)
+    EXPECT_EQ(ranges.allocate(60), 0u);
+    ranges.release(0, 60);
+    ranges.release(c, 30);
+    EXPECT_EQ(ranges.getFreeRanges(), 1u);
+    EXPECT_EQ(ranges.getUsed(), 0u);
+}
+
+TEST(RangeAllocatorTest, GrowingExtendsTheTrailingFreeRange) {
+    RangeAllocator ranges(10);
+    EXPECT_EQ(ranges.allocate(6), 0u);
+    EXPECT_EQ(ranges.allocate(6), RangeAllocator::NO_SPACE);
+
+    ranges.grow(20);
+    EXPECT_EQ(ranges.getCapacity(), 20u);
+    EXPECT_EQ(ranges.getFreeRanges(), 1u);
+    EXPECT_EQ(ranges.allocate(14), 6u);
+    EXPECT_EQ(ranges.allocate(0), 0u);
+    EXPECT_EQ(ranges.getUsed(), 20u);
+}
@@ -0,0 +1,214 @@
+#include <gtest/gtest.h>
+#include "rtin_mesh.h"
+#include <cmath>
+#include <functional>
+#include <map>
+#include <utility>
+#include <vector>
+
+using namespace graphgl;
+
+class RtinMeshTest : public ::testing::Test {
+protected:
+    static constexpr uint32_t kGridSize = 33;
+
+    static std::vector<float> lattice(const std::function<float(float, float)>& f) {
+        std::vector<float> heights(kGridSize * kGridSize);
+        for (uint32_t row = 0; row < kGridSize; ++row) {
+            for (uint32_t col = 0; col < kGridSize; ++col) {
+                heights[row * kGridSize + col] = f(col / 4.0f - 4.0f, row / 4.0f - 4.0f);
+            }
+        }
+        return heights;
+    }
+
+    /// Edges used by one triangle only must lie on the border; an interior one would be a
+    /// T-junction (crack) against a finer neighbour.
+    static void expectConforming(const std::vector<uint32_t>& triangles) {
+        std::map<std::pair<uint32_t, uint32_t>, int> edges;
+        for (size_t t = 0; t < triangles.size(); t += 3) {
+            for (int e = 0; e < 3; ++e) {
+                const uint32_t a = triangles[t + e];
+                const uint32_t b = triangles[t + (e + 1) % 3];
+                ++edges[{std::min(a, b), std::max(a, b)}];
+            }
+        }
+        const uint32_t last = kGridSize - 1;
+        auto onBorder = [&](uint32_t i) {
+            const uint32_t row = i / kGridSize;
+            const uint32_t col = i % kGridSize;
+            return row == 0 || row == last || col == 0 || col == last;
+        };
+        for (const auto& [edge, count] : edges) {
+            EXPECT_LE(count, 2);
+            if (count == 1) {
+                const bool sameRow = edge.first / kGridSize == edge.second / kGridSize;
+                const bool sameCol = edge.first % kGridSize == edge.second % kGridSize;
+                EXPECT_TRUE(onBorder(edge.first) && onBorder(edge.second) && (sameRow || sameCol))
+                    << edge.first << " - " << edge.second;
+            }
+        }
+    }
+};
+
+TEST_F(RtinMeshTest, PlaneIsTwoTriangles) {
+    const std::vector<float> heights = lattice([](float x, float y) { return 2.0f * x - y + 1.0f; });
+    RtinMesh rtin;
+    rtin.build(heights.data(), kGridSize);
+    std::vector<uint32_t> triangles;
+    rtin.extractTriangles(1e-4f, triangles);
+    EXPECT_EQ(triangles.size(), 6u);
+}
+
+TEST_F(RtinMeshTest, NegativeErrorYieldsFullLattice) {
+    const std::vector<float> heights = lattice([](float, float) { return 0.0f; });
+    RtinMesh rtin;
+    rtin.build(heights.data(), kGridSize);
+    std::vector<uint32_t> triangles;
+    rtin.extractTriangles(-1.0f, triangles);
+    EXPECT_EQ(triangles.size(), 3u * 2 * (kGridSize - 1) * (kGridSize - 1));
+    expectConforming(triangles);
+}
+
+TEST_F(RtinMeshTest, MeshIsCrackFreeAndWithinError) {
+    const std::vector<float> heights =
+        lattice([](float x, float y) { return std::sin(x * y) + std::exp(-(x * x + y * y)); });
+    RtinMesh rtin;
+    rtin.build(heights.data(), kGridSize);
+
+    for (float maxError : {0.5f, 0.1f, 0.01f}) {
+        std::vector<uint32_t> triangles;
+        rtin.extractTriangles(maxError, triangles);
+        ASSERT_FALSE(triangles.empty());
+        EXPECT_LT(triangles.size(), 3u * 2 * (kGridSize - 1) * (kGridSize - 1));
+        expectConforming(triangles);
+
+        // Every lattice sample is within maxError of the triangle that covers it.
+        std::vector<bool> covered(heights.size(), false);
+        for (size_t t = 0; t < triangles.size(); t += 3) {
+            const int ax = triangles[t] % kGridSize, ay = triangles[t] / kGridSize;
+            const int bx = triangles[t + 1] % kGridSize, by = triangles[t + 1] / kGridSize;
+            const int cx = triangles[t + 2] % kGridSize, cy = triangles[t + 2] / kGridSize;
+            const float det = float((bx - ax) * (cy - ay) - (cx - ax) * (by - ay));
+            for (int y = std::min({ay, by, cy}); y <= std::max({ay, by, cy}); ++y) {
+                for (int x = std::min({ax, bx, cx}); x <= std::max({ax, bx, cx}); ++x) {
+                    const float u = ((x - ax) * (cy - ay) - (cx - ax) * (y - ay)) / det;
+                    const float v = ((bx - ax) * (y - ay) - (x - ax) * (by - ay)) / det;
+                    if (u < 0.0f || v < 0.0f || u + v > 1.0f) {
+                        continue;
+                    }
+                    const float interpolated = heights[triangles[t]] +
+                                               u * (heights[triangles[t + 1]] - heights[triangles[t]]) +
+                                               v * (heights[triangles[t + 2]] - heights[triangles[t]]);
+                    EXPECT_NEAR(interpolated, heights[y * kGridSize + x], maxError + 1e-5f);
+                    covered[y * kGridSize + x] = true;
+                }
+            }
+        }
+        for (bool c : covered) {
+            EXPECT_TRUE(c);
+        }
+    }
+}
+
+TEST_F(RtinMeshTest, DomainEdgesRefineFully) {
+    // Outside the disc the heights are NaN; triangles along the rim reach the finest level.
+    const std::vector<float> heights =
+        lattice([](float x, float y) { return std::sqrt(9.0f - x * x - y * y); });
+    RtinMesh rtin;
+    rtin.build(heights.data(), kGridSize);
+    std::vector<uint32_t> triangles;
+    rtin.extractTriangles(0.5f, triangles);
+    expectConforming(triangles);
+
+    // Every defined sample next to an undefined one is a vertex of the mesh.
+    std::vector<bool> used(heights.size(), false);
+    for (uint32_t i : triangles) {
+        used[i] = true;
+    }
+    for (uint32_t row = 1; row + 1 < kGridSize; ++row) {
+        for (uint32_t col = 1; col + 1 < kGridSize; ++col) {
+            const uint32_t i = row * kGridSize + col;
+            const bool rim = !std::isnan(heights[i]) &&
+                             (std::isnan(heights[i - 1]) || std::isnan(heights[i + 1]) ||
+                              std::isnan(heights[i - kGridSize]) || std::isnan(heights[i + kGridSize]));
+            if (rim) {
+                EXPECT_TRUE(used[i]) << row << ", " << col;
+            }
+        }
+    }
+}
+
+TEST_F(RtinMeshTest, PlacedLatticeMeasuresErrorAtPositions) {
+    // A plane on a grid whose last columns and rows collapse onto the domain edge, as when a
+    // smaller domain is padded out to the lattice. In index space the padding is a kink.
+    std::vector<float> positions(kGridSize);
+    for (uint32_t i = 0; i < kGridSize; ++i) {
+        positions[i] = std::min(i, 24u) * 0.5f;
+    }
+    std::vector<float> heights(kGridSize * kGridSize);
+    for (uint32_t row = 0; row < kGridSize; ++row) {
+        for (uint32_t col = 0; col < kGridSize; ++col) {
+            heights[row * kGridSize + col] = 2.0f * positions[col] - positions[row];
+        }
+    }
+
+    RtinMesh placed;
+    placed.build(heights.data(), kGridSize, positions.data(), positions.data());
+    std::vector<uint32_t> triangles;
+    placed.extractTriangles(1e-4f, triangles);
+    EXPECT_EQ(triangles.size(), 6u);
+    expectConforming(triangles);
+
+    RtinMesh unplaced;
+    unplaced.build(heights.data(), kGridSize);
+    triangles.clear();
+    unplaced.extractTriangles(1e-4f, triangles);
+    EXPECT_GT(triangles.size(), 6u);
+}
+
+TEST_F(RtinMeshTest, SquaresTileTheHierarchy) {
+    const std::vector<float> heights =
+        lattice([](float x, float y) { return std::sin(x * y) + std::exp(-(x * x + y * y)); });
+    RtinMesh rtin;
+    rtin.build(heights.data(), kGridSize);
+
+    // The whole lattice as one square is extractTriangles.
+    std::vector<uint32_t> whole;
+    std::vector<uint32_t> square;
+    rtin.extractTriangles(0.1f, whole);
+    const float wholeError = rtin.extractSquare(0, 0, kGridSize - 1, 0.1f, square);
+    EXPECT_EQ(square, whole);
+    EXPECT_GT(wholeError, 0.0f);
+    EXPECT_LE(wholeError, 0.1f);
+
+    for (uint32_t size : {16u, 8u, 4u}) {
+        for (float maxError : {-1.0f, 0.1f, 1.0f}) {
+            size_t triangleCount = 0;
+            for (uint32_t y = 0; y < kGridSize - 1; y += size) {
+                for (uint32_t x = 0; x < kGridSize - 1; x += size) {
+                    square.clear();
+                    const float error = rtin.extractSquare(x, y, size, maxError, square);
+                    EXPECT_LE(error, std::max(maxError, 0.0f));
+                    triangleCount += square.size() / 3;
+
+                    // The triangles stay inside the square and cover its area.
+                    int64_t twiceArea = 0;
+                    for (size_t t = 0; t < square.size(); t += 3) {
+                        int64_t px[3], py[3];
+                        for (int i = 0; i < 3; ++i) {
+                            px[i] = square[t + i] % kGridSize;
+                            py[i] = square[t + i] / kGridSize;
+                            EXPECT_TRUE(px[i] >= x && px[i] <= x + size && py[i] >= y && py[i] <= y + size);
+                        }
+                        twiceArea += std::abs((px[1] - px[0]) * (py[2] - py[0]) - (px[2] - px[0]) * (py[1] - py[0]));
+                    }
+                    EXPECT_EQ(twiceArea, 2 * int64_t(size) * size);
+                }
+            }
+            if (maxError < 0.0f) {
+                EXPECT_EQ(triangleCount, 2u * (kGridSize - 1) * (kGridSize - 1));
+            }
+        }
+    }
+}
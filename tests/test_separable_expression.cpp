@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+#include "separable_expression.h"
+#include "equation_parser.h"
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace graphgl;
+
+class SeparableExpressionTest : public ::testing::Test {
+protected:
+    std::unique_ptr<const SeparableExpression> detect(const std::string& source) {
+        ExpressionProgram program;
+        EXPECT_TRUE(ExpressionProgram::parse(source, true, program)) << source;
+        return SeparableExpression::detect(program);
+    }
+
+    /// Compare the separable grid with direct per-sample evaluation.
+    void expectGridMatches(const std::string& source) {
+        ExpressionProgram program;
+        ASSERT_TRUE(ExpressionProgram::parse(source, true, program)) << source;
+        const auto separable = SeparableExpression::detect(program);
+        ASSERT_NE(separable, nullptr) << source;
+
+        std::vector<float> xs;
+        std::vector<float> ys;
+        for (int i = 0; i < 70; ++i) {
+            xs.push_back(-5.0f + 0.15f * static_cast<float>(i));
+        }
+        for (int i = 0; i < 23; ++i) {
+            ys.push_back(-4.0f + 0.35f * static_cast<float>(i));
+        }
+
+        std::vector<float> scratch(separable->getScratchSize());
+        std::vector<float> axisValues;
+        std::vector<float> grid(xs.size() * ys.size());
+        separable->evaluateGrid(xs.data(), xs.size(), ys.data(), ys.size(), grid.data(), scratch.data(),
+                                axisValues);
+
+        std::vector<float> registers(program.size());
+        for (size_t row = 0; row < ys.size(); ++row) {
+            for (size_t col = 0; col < xs.size(); ++col) {
+                const float expected = program.evaluate(xs[col], ys[row], registers.data());
+                const float actual = grid[row * xs.size() + col];
+                if (std::isnan(expected)) {
+                    EXPECT_TRUE(std::isnan(actual)) << source;
+                } else {
+                    EXPECT_NEAR(actual, expected, 1e-4f * (1.0f + std::fabs(expected))) << source;
+                }
+            }
+        }
+    }
+};
+
+TEST_F(SeparableExpressionTest, DetectsSums) {
+    for (const char* source : {"sin(x) + sin(y)", "x^2 - y^2", "x^2 + y^2 + 1", "-(cos(y) - x)"}) {
+        const auto separable = detect(source);
+        ASSERT_NE(separable, nullptr) << source;
+        EXPECT_EQ(separable->getCombineOp(), ExprOp::Add) << source;
+        EXPECT_FALSE(separable->getXPart().empty()) << source;
+        EXPECT_FALSE(separable->getYPart().empty()) << source;
+    }
+}
+
+TEST_F(SeparableExpressionTest, DetectsProducts) {
+    for (const char* source : {"sin(x) * cos(y)", "x * y", "-(x + 1) * (y - 2) / (1 + x^2)", "exp(-x^2) / cos(y)"}) {
+        const auto separable = detect(source);
+        ASSERT_NE(separable, nullptr) << source;
+        EXPECT_EQ(separable->getCombineOp(), ExprOp::Mul) << source;
+    }
+}
+
+TEST_F(SeparableExpressionTest, SingleVariableSurfacesNeedOneFactor) {
+    const auto separable = detect("sin(x) * 2");
+    ASSERT_NE(separable, nullptr);
+    EXPECT_FALSE(separable->getXPart().empty());
+    EXPECT_TRUE(separable->getYPart().empty());
+}
+
+TEST_F(SeparableExpressionTest, RejectsMixedTerms) {
+    EXPECT_EQ(detect("sin(x * y)"), nullptr);
+    EXPECT_EQ(detect("x * y + x"), nullptr);
+    EXPECT_EQ(detect("sqrt(x^2 + y^2)"), nullptr);
+    EXPECT_EQ(detect("3 * pi"), nullptr);
+}
+
+TEST_F(SeparableExpressionTest, GridMatchesDirectEvaluation) {
+    expectGridMatches("sin(x) + sin(y)");
+    expectGridMatches("x^2 - y^2 + 3");
+    expectGridMatches("sin(x) * cos(y)");
+    expectGridMatches("-(x + 1) * (y - 2) / (1 + x^2)");
+    expectGridMatches("log(x) * y");
+    expectGridMatches("cos(y) - 1");
+}
+
+TEST_F(SeparableExpressionTest, ParserUsesSeparableGrid) {
+    EquationParser parser;
+    ASSERT_TRUE(parser.parseExpression("sin(x) * cos(y)", true));
+    ASSERT_NE(parser.getCompiledExpression()->getSeparable(), nullptr);
+
+    const float xs[] = {0.5f, 1.0f, 2.0f};
+    const float ys[] = {-1.0f, 0.25f};
+    float out[6];
+    parser.evaluateGrid(xs, 3, ys, 2, out);
+    for (size_t row = 0; row < 2; ++row) {
+        for (size_t col = 0; col < 3; ++col) {
+            EXPECT_NEAR(out[row * 3 + col], std::sin(xs[col]) * std::cos(ys[row]), 1e-6f);
+        }
+    }
+
+    ASSERT_TRUE(parser.parseExpression("sin(x) * cos(y)", false));
+    EXPECT_EQ(parser.getCompiledExpression()->getSeparable(), nullptr);
+}
@@ -10,12 +10,20 @@ TEST(SettingsTest, DefaultValues) {
     EXPECT_EQ(s.getHeight(), Settings::DEFAULT_HEIGHT);
     EXPECT_FLOAT_EQ(s.getMaxViewDistance(), Settings::DEFAULT_MAX_VIEW_DISTANCE);
     EXPECT_FLOAT_EQ(s.getPointSize(), Settings::DEFAULT_POINT_SIZE);
+    EXPECT_FLOAT_EQ(s.getLineWidth(), Settings::DEFAULT_LINE_WIDTH);
     EXPECT_EQ(s.getMaxDepth(), Settings::DEFAULT_MAX_DEPTH);
     EXPECT_DOUBLE_EQ(s.getDerivativeThreshold(), Settings::DEFAULT_DERIVATIVE_THRESHOLD);
     EXPECT_TRUE(s.getShowControls());
     EXPECT_FALSE(s.getUseHeatmap());
     EXPECT_TRUE(s.getShowGridlines());
     EXPECT_TRUE(s.getShowLines());
+    EXPECT_FALSE(s.getUseNativeKernels());
+    EXPECT_FALSE(s.getUseSampleBudget());
+    EXPECT_FALSE(s.getUseAngleRefinement());
+    EXPECT_DOUBLE_EQ(s.getAngleTolerance(), Settings::DEFAULT_ANGLE_TOLERANCE);
+    EXPECT_FALSE(s.getUseSurfaceLod());
+    EXPECT_FLOAT_EQ(s.getLodPixelTolerance(), Settings::DEFAULT_LOD_PIXEL_TOLERANCE);
+    EXPECT_FALSE(s.getPlotMode2D());
 }
 
 TEST(SettingsTest, SettersAndGetters) {
@@ -31,8 +39,36 @@ TEST(SettingsTest, SettersAndGetters) {
     s.setPointSize(3.0f);
     EXPECT_FLOAT_EQ(s.getPointSize(), 3.0f);
 
+    s.setLineWidth(4.0f);
+    EXPECT_FLOAT_EQ(s.getLineWidth(), 4.0f);
+
     s.setUseHeatmap(true);
     EXPECT_TRUE(s.getUseHeatmap());
+
+    s.setUseNativeKernels(true);
+    EXPECT_TRUE(s.getUseNativeKernels());
+
+    s.setUseSampleBudget(true);
+    EXPECT_TRUE(s.getUseSampleBudget());
+
+    s.setUseAngleRefinement(true);
+    s.setAngleTolerance(5.0);
+    EXPECT_TRUE(s.getUseAngleRefinement());
+    EXPECT_DOUBLE_EQ(s.getAngleTolerance(), 5.0);
+    s.setAngleTolerance(0.0);
+    EXPECT_DOUBLE_EQ(s.getAngleTolerance(), Settings::MIN_ANGLE_TOLERANCE);
+    s.setAngleTolerance(-3.0);
+    EXPECT_DOUBLE_EQ(s.getAngleTolerance(), Settings::MIN_ANGLE_TOLERANCE);
+    s.setAngleTolerance(180.0);
+    EXPECT_DOUBLE_EQ(s.getAngleTolerance(), Settings::MAX_ANGLE_TOLERANCE);
+
+    s.setUseSurfaceLod(true);
+    s.setLodPixelTolerance(2.5f);
+    EXPECT_TRUE(s.getUseSurfaceLod());
+    EXPECT_FLOAT_EQ(s.getLodPixelTolerance(), 2.5f);
+
+    s.setPlotMode2D(true);
+    EXPECT_TRUE(s.getPlotMode2D());
 }
 
 TEST(SettingsTest, HeightTracking) {
@@ -0,0 +1,173 @@
+#include <gtest/gtest.h>
+#include "simd_evaluator.h"
+#include "../lib/exprtk/exprtk.hpp"
+#include <cmath>
+#include <string>
+#include <vector>
+
+using namespace graphgl;
+
+class SimdEvaluatorTest : public ::testing::Test {
+protected:
+    // Deliberately not multiples of the block size, so padded tail blocks are exercised.
+    static constexpr size_t kXCount = 77;
+    static constexpr size_t kYCount = 29;
+
+    std::vector<float> xs;
+    std::vector<float> ys;
+
+    void SetUp() override {
+        for (size_t i = 0; i < kXCount; ++i) {
+            xs.push_back(-10.0f + 20.0f * static_cast<float>(i) / (kXCount - 1));
+        }
+        for (size_t i = 0; i < kYCount; ++i) {
+            ys.push_back(-7.5f + 15.0f * static_cast<float>(i) / (kYCount - 1));
+        }
+    }
+
+    static std::vector<SimdLevel> availableLevels() {
+        std::vector<SimdLevel> levels = {SimdLevel::Scalar};
+        if (SimdEvaluator::detectLevel() >= SimdLevel::Sse41) {
+            levels.push_back(SimdLevel::Sse41);
+        }
+        if (SimdEvaluator::detectLevel() >= SimdLevel::Avx2) {
+            levels.push_back(SimdLevel::Avx2);
+        }
+        return levels;
+    }
+
+    /// Reference grid computed by ExprTk itself.
+    std::vector<float> exprtkGrid(const std::string& source) {
+        float x = 0.0f;
+        float y = 0.0f;
+        exprtk::symbol_table<float> symbols;
+        symbols.add_constant("e", static_cast<float>(M_E));
+        symbols.add_pi();
+        symbols.add_variable("x", x);
+        symbols.add_variable("y", y);
+        exprtk::expression<float> expression;
+        expression.register_symbol_table(symbols);
+        exprtk::parser<float> parser;
+        EXPECT_TRUE(parser.compile(source, expression)) << source;
+
+        std::vector<float> out;
+        for (float yv : ys) {
+            for (float xv : xs) {
+                x = xv;
+                y = yv;
+                out.push_back(expression.value());
+            }
+        }
+        return out;
+    }
+
+    static void expectClose(float actual, float expected, const std::string& context) {
+        if (std::isnan(expected)) {
+            EXPECT_TRUE(std::isnan(actual)) << context << " expected NaN, got " << actual;
+        } else if (std::isinf(expected)) {
+            EXPECT_EQ(actual, expected) << context;
+        } else {
+            const float tolerance = 2e-5f + 2e-5f * std::fabs(expected);
+            EXPECT_NEAR(actual, expected, tolerance) << context;
+        }
+    }
+
+    void checkAgainstExprtk(const std::string& source) {
+        ExpressionProgram program;
+        ASSERT_TRUE(ExpressionProgram::parse(source, true, program)) << source;
+        const std::vector<float> expected = exprtkGrid(source);
+
+        SimdEvaluator evaluator(program);
+        ASSERT_TRUE(evaluator.isValid());
+        std::vector<float> scratch(evaluator.getScratchSize());
+
+        for (SimdLevel level : availableLevels()) {
+            evaluator.setLevel(level);
+            ASSERT_EQ(evaluator.getLevel(), level);
+            const std::string name = source + " [" + SimdEvaluator::getLevelName(level) + "]";
+
+            std::vector<float> grid(kXCount * kYCount);
+            evaluator.evaluateGrid(xs.data(), kXCount, ys.data(), kYCount, grid.data(), scratch.data());
+
+            // The same samples as explicit (x, y) pairs.
+            std::vector<float> px;
+            std::vector<float> py;
+            for (float yv : ys) {
+                for (float xv : xs) {
+                    px.push_back(xv);
+                    py.push_back(yv);
+                }
+            }
+            std::vector<float> batch(px.size());
+            evaluator.evaluateBatch(px.data(), py.data(), batch.data(), px.size(), scratch.data());
+
+            for (size_t i = 0; i < expected.size(); ++i) {
+                const std::string at = name + " at (" + std::to_string(px[i]) + ", " + std::to_string(py[i]) + ")";
+                expectClose(grid[i], expected[i], at);
+                expectClose(batch[i], expected[i], at);
+            }
+        }
+    }
+};
+
+TEST_F(SimdEvaluatorTest, ArithmeticMatchesExprtk) {
+    checkAgainstExprtk("x^2 - y^2");
+    checkAgainstExprtk("x^3 - 3*x*y^2");
+    checkAgainstExprtk("(x + 1) / (y - 0.25) - -x");
+    checkAgainstExprtk("x % 3 + min(x, y) * max(x, 2)");
+}
+
+TEST_F(SimdEvaluatorTest, TranscendentalsMatchExprtk) {
+    checkAgainstExprtk("sin(x) * cos(y)");
+    checkAgainstExprtk("sin(sqrt(x^2 + y^2))");
+    checkAgainstExprtk("cos(1000 * x) + sin(y * 3000)");
+    checkAgainstExprtk("exp(-(x^2 + y^2) / 10)");
+    checkAgainstExprtk("exp(x * 10)");
+    checkAgainstExprtk("log(x^2 + y^2 + 1) + log10(abs(x) + 1) + log2(abs(y) + 1)");
+    checkAgainstExprtk("log(x) + sqrt(y)");
+    checkAgainstExprtk("tanh(x) + atan2(y, x) + hypot(x, y) + tan(y / 8)");
+}
+
+TEST_F(SimdEvaluatorTest, PowerMatchesExprtk) {
+    checkAgainstExprtk("pow(abs(x), 1.5) + pow(2, y)");
+    checkAgainstExprtk("x^-2 + y^5");
+    checkAgainstExprtk("pow(x, y / 4)");
+    checkAgainstExprtk("pow(x, 0) + pow(0, y)");
+}
+
+TEST_F(SimdEvaluatorTest, RoundingMatchesExprtk) {
+    checkAgainstExprtk("floor(x) + ceil(y) + trunc(x - y)");
+    checkAgainstExprtk("round(x * 2) + round(y * 0.5)");
+    checkAgainstExprtk("sgn(x) * abs(y)");
+}
+
+TEST_F(SimdEvaluatorTest, RegistersAreReused) {
+    ExpressionProgram program;
+    ASSERT_TRUE(ExpressionProgram::parse("((((x + 1) * 2 + 3) * 4 + 5) * 6 + 7) * 8", true, program));
+    SimdEvaluator evaluator(program);
+
+    // x, y, eight distinct constants and a single temporary.
+    EXPECT_EQ(evaluator.getInstructionCount(), 8u);
+    EXPECT_EQ(evaluator.getRegisterCount(), 2u + 8u + 1u);
+}
+
+TEST_F(SimdEvaluatorTest, LeafProgramsAndEmptyInput) {
+    ExpressionProgram program;
+    ASSERT_TRUE(ExpressionProgram::parse("y", true, program));
+    SimdEvaluator evaluator(program);
+    ASSERT_TRUE(evaluator.isValid());
+    EXPECT_EQ(evaluator.getInstructionCount(), 0u);
+
+    std::vector<float> scratch(evaluator.getScratchSize());
+    const float x[] = {1.0f, 2.0f};
+    const float y[] = {3.0f, 4.0f};
+    float out[2] = {0.0f, 0.0f};
+    evaluator.evaluateBatch(x, y, out, 2, scratch.data());
+    EXPECT_FLOAT_EQ(out[0], 3.0f);
+    EXPECT_FLOAT_EQ(out[1], 4.0f);
+
+    evaluator.evaluateBatch(x, nullptr, out, 2, scratch.data());
+    EXPECT_FLOAT_EQ(out[0], 0.0f);
+
+    EXPECT_FALSE(SimdEvaluator(ExpressionProgram()).isValid());
+}
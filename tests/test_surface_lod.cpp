@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+#include "surface_lod.h"
+#include <cstdlib>
+#include <vector>
+
+using namespace graphgl;
+
+class SurfaceLodTest : public ::testing::Test {
+protected:
+    /// A row of unit chunks along x at height 0. Level l has error 0.01 * 4^l and one
+    /// triangle of indices {l, l, l}; skirts are {10 + l} x 3.
+    static SurfaceLod row(uint32_t columns, uint32_t levels) {
+        SurfaceLod lod;
+        lod.columns = columns;
+        lod.rows = 1;
+        lod.levels = levels;
+        for (uint32_t l = 0; l < levels; ++l) {
+            lod.indices.insert(lod.indices.end(), {l, l, l});
+        }
+        for (uint32_t l = 0; l < levels; ++l) {
+            lod.indices.insert(lod.indices.end(), {10 + l, 10 + l, 10 + l});
+        }
+        for (uint32_t c = 0; c < columns; ++c) {
+            SurfaceChunk chunk;
+            chunk.boundsMin = glm::vec3(float(c), 0.0f, 0.0f);
+            chunk.boundsMax = glm::vec3(float(c + 1), 0.0f, 1.0f);
+            float error = 0.01f;
+            for (uint32_t l = 0; l < levels; ++l, error *= 4.0f) {
+                chunk.errors.push_back(l == 0 ? 0.0f : error);
+                chunk.triangles.push_back({3 * l, 3});
+                chunk.skirts.push_back({3 * (levels + l), 3});
+            }
+            lod.chunks.push_back(chunk);
+        }
+        return lod;
+    }
+
+    static LodView view(const glm::vec3& eye) {
+        LodView v;
+        v.eye = eye;
+        v.pixelsPerUnit = 10.0f;
+        v.pixelTolerance = 1.0f;
+        return v;
+    }
+};
+
+TEST_F(SurfaceLodTest, DistantChunksAreCoarser) {
+    const SurfaceLod lod = row(32, 5);
+    std::vector<uint8_t> levels;
+    lod.selectLevels(view(glm::vec3(0.5f, 0.0f, 0.5f)), levels);
+    ASSERT_EQ(levels.size(), 32u);
+
+    // The chunk under the camera is finest, levels never decrease away from it, and the
+    // far end reaches the coarsest level.
+    EXPECT_EQ(levels.front(), 0);
+    for (size_t c = 1; c < levels.size(); ++c) {
+        EXPECT_GE(levels[c], levels[c - 1]);
+        EXPECT_LE(levels[c] - levels[c - 1], 1);
+    }
+    EXPECT_EQ(levels.back(), 4);
+
+    // Every chosen level projects within the tolerance.
+    for (size_t c = 1; c < levels.size(); ++c) {
+        const float distance = float(c) - 0.5f;
+        EXPECT_LE(lod.chunks[c].errors[levels[c]] * 10.0f / distance, 1.0f + 1e-4f) << c;
+    }
+}
+
+TEST_F(SurfaceLodTest, NeighboursDifferByOneLevel) {
+    SurfaceLod lod = row(8, 5);
+    // A chunk much rougher than the rest keeps the finest level; its neighbours follow.
+    for (size_t l = 1; l < 5; ++l) {
+        lod.chunks[4].errors[l] = 1e6f;
+    }
+    std::vector<uint8_t> levels;
+    lod.selectLevels(view(glm::vec3(1000.0f, 0.0f, 0.0f)), levels);
+    EXPECT_EQ(levels[4], 0);
+    for (size_t c = 1; c < levels.size(); ++c) {
+        EXPECT_LE(std::abs(int(levels[c]) - int(levels[c - 1])), 1) << c;
+    }
+    EXPECT_EQ(levels[0], 4);
+}
+
+TEST_F(SurfaceLodTest, AppendsSelectedTrianglesAndSkirts) {
+    const SurfaceLod lod = row(2, 3);
+    std::vector<unsigned int> indices = {7};
+    lod.appendIndices({0, 2}, 100, indices);
+    const std::vector<unsigned int> expected = {7, 100, 100, 100, 110, 110, 110, 102, 102, 102, 112, 112, 112};
+    EXPECT_EQ(indices, expected);
+}
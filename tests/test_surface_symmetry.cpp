@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+#include "surface_symmetry.h"
+#include "expression_optimizer.h"
+#include "equation_parser.h"
+#include <cmath>
+#include <string>
+#include <vector>
+
+using namespace graphgl;
+
+class SurfaceSymmetryTest : public ::testing::Test {
+protected:
+    SurfaceSymmetry analyze(const std::string& source) {
+        ExpressionProgram program;
+        EXPECT_TRUE(ExpressionProgram::parse(source, true, program)) << source;
+        return SurfaceSymmetry::analyze(optimizeExpression(program));
+    }
+
+    static constexpr float kTwoPi = 6.28318530717958647692f;
+};
+
+TEST_F(SurfaceSymmetryTest, DetectsRadialSurfaces) {
+    for (const char* source : {"sin(sqrt(x^2 + y^2))", "sqrt(25 - x^2 - y^2)", "exp(-(x*x + y*y))",
+                               "hypot(x, y) * 2"}) {
+        EXPECT_TRUE(analyze(source).isRadial()) << source;
+    }
+}
+
+TEST_F(SurfaceSymmetryTest, RadialProfileMatchesSurface) {
+    ExpressionProgram program;
+    ASSERT_TRUE(ExpressionProgram::parse("sin(sqrt(x^2 + y^2)) / 2 + 1", true, program));
+    const SurfaceSymmetry symmetry = SurfaceSymmetry::analyze(optimizeExpression(program));
+    ASSERT_TRUE(symmetry.isRadial());
+
+    const ExpressionProgram& profile = symmetry.getRadialProfile();
+    std::vector<float> registers(std::max(program.size(), profile.size()));
+    for (float x : {-3.0f, 0.0f, 1.5f}) {
+        for (float y : {-2.0f, 0.5f, 4.0f}) {
+            const float expected = program.evaluate(x, y, registers.data());
+            EXPECT_NEAR(profile.evaluate(std::hypot(x, y), 0.0f, registers.data()), expected, 1e-5f);
+        }
+    }
+}
+
+TEST_F(SurfaceSymmetryTest, RejectsNonRadialSurfaces) {
+    for (const char* source : {"x^2 - y^2", "sin(x*y)", "x^2 + 2*y^2", "sqrt(x^2 + y^2) + x", "x^2 * y^2"}) {
+        EXPECT_FALSE(analyze(source).isRadial()) << source;
+    }
+}
+
+TEST_F(SurfaceSymmetryTest, DetectsPeriods) {
+    const SurfaceSymmetry affine = analyze("sin(x + 2*y)");
+    EXPECT_NEAR(affine.getPeriodX(), kTwoPi, 1e-5f);
+    EXPECT_NEAR(affine.getPeriodY(), kTwoPi / 2.0f, 1e-5f);
+
+    EXPECT_NEAR(analyze("sin(2*x) + cos(x)").getPeriodX(), kTwoPi, 1e-5f);
+    EXPECT_NEAR(analyze("tan(x / 2)").getPeriodX(), kTwoPi, 1e-5f);
+    EXPECT_EQ(analyze("sin(2*x) + cos(x)").getPeriodY(), 0.0f);
+}
+
+TEST_F(SurfaceSymmetryTest, RejectsAperiodicSurfaces) {
+    EXPECT_EQ(analyze("sin(x) + x").getPeriodX(), 0.0f);
+    EXPECT_EQ(analyze("sin(x) + sin(1.41421*x)").getPeriodX(), 0.0f);
+    EXPECT_EQ(analyze("sin(x*x)").getPeriodX(), 0.0f);
+    EXPECT_EQ(analyze("x^2 + y").getPeriodY(), 0.0f);
+}
+
+TEST_F(SurfaceSymmetryTest, CompiledExpressionsCarryTheirSymmetry) {
+    EquationParser parser;
+    auto radial = parser.parseExpression("sin(sqrt(x^2 + y^2))", true);
+    ASSERT_TRUE(radial);
+    EXPECT_TRUE(radial->getSymmetry().isRadial());
+
+    auto periodic = parser.parseExpression("sin(x + 2*y)", true);
+    ASSERT_TRUE(periodic);
+    EXPECT_NEAR(periodic->getSymmetry().getPeriodY(), kTwoPi / 2.0f, 1e-5f);
+
+    // Curves are not analyzed.
+    auto curve = parser.parseExpression("sin(sqrt(x^2 + y^2))", false);
+    ASSERT_TRUE(curve);
+    EXPECT_FALSE(curve->getSymmetry().isRadial());
+    EXPECT_EQ(curve->getSymmetry().getPeriodX(), 0.0f);
+}